@@ -1,13 +1,15 @@
 #include "BlockNode.hpp"
 
-BlockNode::BlockNode() : type(), param(), directives(), sub_blocks() {}
+BlockNode::BlockNode()
+    : type(), param(), modifier(), directives(), sub_blocks() {}
 
 BlockNode::BlockNode(const std::string& t, const std::string& p)
-    : type(t), param(p), directives(), sub_blocks() {}
+    : type(t), param(p), modifier(), directives(), sub_blocks() {}
 
 BlockNode::BlockNode(const BlockNode& other)
     : type(other.type),
       param(other.param),
+      modifier(other.modifier),
       directives(other.directives),
       sub_blocks(other.sub_blocks) {}
 
@@ -15,6 +17,7 @@ BlockNode& BlockNode::operator=(const BlockNode& other) {
   if (this != &other) {
     type = other.type;
     param = other.param;
+    modifier = other.modifier;
     directives = other.directives;
     sub_blocks = other.sub_blocks;
   }
@@ -15,6 +15,7 @@ class BlockNode {
 
   std::string type;   // e.g. "server" or "location" or "root"
   std::string param;  // optional parameter for block (e.g. /path)
+  std::string modifier;  // location match modifier ("=", "~", "~*", "^~")
   std::vector<DirectiveNode>
       directives;                     // directives directly inside this block
   std::vector<BlockNode> sub_blocks;  // nested blocks
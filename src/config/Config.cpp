@@ -2,21 +2,27 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <strings.h>
 #include <sys/stat.h>
 
 #include <cctype>
 #include <cerrno>
 #include <climits>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 
+#include "ByteBuilder.hpp"
+#include "GzipEncoder.hpp"
 #include "HttpMethod.hpp"
 #include "HttpStatus.hpp"
 #include "Location.hpp"
 #include "Logger.hpp"
+#include "constants.hpp"
+#include "net_utils.hpp"
 #include "utils.hpp"
 
 // ==================== PUBLIC METHODS ====================
@@ -27,6 +33,14 @@ Config::Config()
       servers_(),
       global_error_pages_(),
       global_max_request_body_(kMaxRequestBodyUnset),
+      global_client_body_buffer_size_(kClientBodyBufferSizeUnset),
+      global_client_header_buffer_size_(kClientHeaderBufferSizeUnset),
+      global_large_client_header_buffers_(kClientHeaderBufferSizeUnset),
+      global_large_client_header_buffer_size_(kClientHeaderBufferSizeUnset),
+      global_open_file_cache_max_(kOpenFileCacheUnset),
+      global_open_file_cache_inactive_(kOpenFileCacheTimeUnset),
+      global_open_file_cache_valid_(kOpenFileCacheTimeUnset),
+      global_open_file_cache_errors_(UNSET),
       idx_(0),
       current_server_index_(kGlobalContext),
       current_location_path_() {}
@@ -39,6 +53,18 @@ Config::Config(const Config& other)
       servers_(other.servers_),
       global_error_pages_(other.global_error_pages_),
       global_max_request_body_(other.global_max_request_body_),
+      global_client_body_buffer_size_(other.global_client_body_buffer_size_),
+      global_client_header_buffer_size_(
+          other.global_client_header_buffer_size_),
+      global_large_client_header_buffers_(
+          other.global_large_client_header_buffers_),
+      global_large_client_header_buffer_size_(
+          other.global_large_client_header_buffer_size_),
+      global_open_file_cache_max_(other.global_open_file_cache_max_),
+      global_open_file_cache_inactive_(
+          other.global_open_file_cache_inactive_),
+      global_open_file_cache_valid_(other.global_open_file_cache_valid_),
+      global_open_file_cache_errors_(other.global_open_file_cache_errors_),
       idx_(other.idx_),
       current_server_index_(other.current_server_index_),
       current_location_path_(other.current_location_path_) {}
@@ -51,6 +77,17 @@ Config& Config::operator=(const Config& other) {
     servers_ = other.servers_;
     global_error_pages_ = other.global_error_pages_;
     global_max_request_body_ = other.global_max_request_body_;
+    global_client_body_buffer_size_ = other.global_client_body_buffer_size_;
+    global_client_header_buffer_size_ =
+        other.global_client_header_buffer_size_;
+    global_large_client_header_buffers_ =
+        other.global_large_client_header_buffers_;
+    global_large_client_header_buffer_size_ =
+        other.global_large_client_header_buffer_size_;
+    global_open_file_cache_max_ = other.global_open_file_cache_max_;
+    global_open_file_cache_inactive_ = other.global_open_file_cache_inactive_;
+    global_open_file_cache_valid_ = other.global_open_file_cache_valid_;
+    global_open_file_cache_errors_ = other.global_open_file_cache_errors_;
     current_server_index_ = other.current_server_index_;
     current_location_path_ = other.current_location_path_;
   }
@@ -120,6 +157,14 @@ std::vector<Server> Config::getServers(void) {
 
   // Parse and validate global directives
   global_max_request_body_ = kMaxRequestBodyUnset;
+  global_client_body_buffer_size_ = kClientBodyBufferSizeUnset;
+  global_client_header_buffer_size_ = kClientHeaderBufferSizeUnset;
+  global_large_client_header_buffers_ = kClientHeaderBufferSizeUnset;
+  global_large_client_header_buffer_size_ = kClientHeaderBufferSizeUnset;
+  global_open_file_cache_max_ = kOpenFileCacheUnset;
+  global_open_file_cache_inactive_ = kOpenFileCacheTimeUnset;
+  global_open_file_cache_valid_ = kOpenFileCacheTimeUnset;
+  global_open_file_cache_errors_ = UNSET;
   global_error_pages_.clear();
 
   LOG(DEBUG) << "Processing " << root_.directives.size()
@@ -142,6 +187,40 @@ std::vector<Server> Config::getServers(void) {
       global_max_request_body_ = parsePositiveNumber_(d.args[0]);
       LOG(DEBUG) << "Global max_request_body set to: "
                  << global_max_request_body_;
+    } else if (d.name == "client_body_buffer_size") {
+      requireArgsEqual_(d, 1);
+      global_client_body_buffer_size_ = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Global client_body_buffer_size set to: "
+                 << global_client_body_buffer_size_;
+    } else if (d.name == "client_header_buffer_size") {
+      requireArgsEqual_(d, 1);
+      global_client_header_buffer_size_ = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Global client_header_buffer_size set to: "
+                 << global_client_header_buffer_size_;
+    } else if (d.name == "large_client_header_buffers") {
+      requireArgsEqual_(d, 2);
+      global_large_client_header_buffers_ = parsePositiveNumber_(d.args[0]);
+      global_large_client_header_buffer_size_ =
+          parsePositiveNumber_(d.args[1]);
+      LOG(DEBUG) << "Global large_client_header_buffers set to: "
+                 << global_large_client_header_buffers_ << " x "
+                 << global_large_client_header_buffer_size_;
+    } else if (d.name == "open_file_cache") {
+      parseOpenFileCache_(d, global_open_file_cache_max_,
+                          global_open_file_cache_inactive_);
+      LOG(DEBUG) << "Global open_file_cache: max="
+                 << global_open_file_cache_max_
+                 << " inactive=" << global_open_file_cache_inactive_;
+    } else if (d.name == "open_file_cache_valid") {
+      requireArgsEqual_(d, 1);
+      global_open_file_cache_valid_ = parseSeconds_(d.args[0]);
+      LOG(DEBUG) << "Global open_file_cache_valid set to: "
+                 << global_open_file_cache_valid_;
+    } else if (d.name == "open_file_cache_errors") {
+      requireArgsEqual_(d, 1);
+      global_open_file_cache_errors_ = parseBooleanValue_(d.args[0]) ? ON : OFF;
+      LOG(DEBUG) << "Global open_file_cache_errors set to: "
+                 << (global_open_file_cache_errors_ == ON ? "on" : "off");
     } else {
       throwUnrecognizedDirective_(d, "as global directive");
     }
@@ -293,9 +372,12 @@ bool Config::isBlock() const {
   // This can be:
   //   - Immediately after (e.g., "server {")
   //   - After one parameter (e.g., "location /path {")
-  // We look ahead at most 2 positions to accommodate blocks with parameters.
+  //   - After a location modifier and its path (e.g., "location = /path {")
+  // We look ahead at most 3 positions to accommodate blocks with parameters.
   return (idx_ + 1 < tokens_.size() && tokens_[idx_ + 1] == "{") ||
-         (idx_ + 2 < tokens_.size() && tokens_[idx_ + 2] == "{");
+         (idx_ + 2 < tokens_.size() && tokens_[idx_ + 2] == "{") ||
+         (idx_ + 3 < tokens_.size() && tokens_[idx_] == "location" &&
+          tokens_[idx_ + 3] == "{");
 }
 
 DirectiveNode Config::parseDirective() {
@@ -320,6 +402,12 @@ BlockNode Config::parseBlock() {
       throw std::runtime_error("location missing parameter");
     }
     b.param = get();
+    // "location <modifier> <path> {"
+    if (peek() != "{" && (b.param == "=" || b.param == "~" ||
+                          b.param == "~*" || b.param == "^~")) {
+      b.modifier = b.param;
+      b.param = get();
+    }
   }
   if (get() != "{") {
     throw std::runtime_error("Expected '{' after block type");
@@ -387,7 +475,8 @@ http::Status Config::parseRedirectCode_(const std::string& value) {
 
   try {
     http::Status s = http::intToStatus(code);
-    if (!http::isRedirect(s)) {
+    // 304 is a 3xx status but not a redirect
+    if (!http::isRedirect(s) || s == http::S_304_NOT_MODIFIED) {
       std::ostringstream oss;
       oss << configErrorPrefix() << "Invalid redirect status code " << code
           << " (valid: 301, 302, 303, 307, 308)";
@@ -435,6 +524,218 @@ std::size_t Config::parsePositiveNumber_(const std::string& value) {
   return static_cast<std::size_t>(num);
 }
 
+time_t Config::parseSeconds_(const std::string& value) {
+  std::string digits = value;
+  time_t unit = 1;
+  if (!digits.empty()) {
+    switch (digits[digits.size() - 1]) {
+      case 's':
+        unit = 1;
+        break;
+      case 'm':
+        unit = 60;
+        break;
+      case 'h':
+        unit = 3600;
+        break;
+      case 'd':
+        unit = 86400;
+        break;
+      default:
+        unit = 0;
+        break;
+    }
+    if (unit != 0) {
+      digits.erase(digits.size() - 1);
+    } else {
+      unit = 1;
+    }
+  }
+  if (digits == "0") {
+    return 0;
+  }
+  std::size_t n = 0;
+  try {
+    n = parsePositiveNumber_(digits);
+  } catch (const std::runtime_error&) {
+    std::ostringstream oss;
+    oss << configErrorPrefix() << "Invalid time '" << value
+        << "' (expected seconds, optionally with an s/m/h/d unit)";
+    throw std::runtime_error(oss.str());
+  }
+  if (n > static_cast<std::size_t>(INT_MAX) / static_cast<std::size_t>(unit)) {
+    std::ostringstream oss;
+    oss << configErrorPrefix() << "Time value out of range: '" << value << "'";
+    throw std::runtime_error(oss.str());
+  }
+  return static_cast<time_t>(n) * unit;
+}
+
+std::size_t Config::parseCacheMaxSize_(const DirectiveNode& d) {
+  requireArgsEqual_(d, 1);
+  if (d.args[0] == "off") {
+    return 0;
+  }
+  return parsePositiveNumber_(d.args[0]);
+}
+
+std::string Config::parseExpires_(const DirectiveNode& d) {
+  requireArgsEqual_(d, 1);
+  const std::string& value = d.args[0];
+  if (value == "off") {
+    return "";
+  }
+  if (value == "epoch") {
+    return "Expires: Thu, 01 Jan 1970 00:00:01 GMT" CRLF
+           "Cache-Control: no-cache" CRLF;
+  }
+  if (value == "max") {
+    return "Expires: Thu, 31 Dec 2037 23:55:55 GMT" CRLF
+           "Cache-Control: max-age=315360000" CRLF;
+  }
+  // Relative times only get max-age: an Expires date would have to be
+  // formatted per request, and HTTP/1.1 caches prefer max-age anyway
+  std::string out;
+  ByteBuilder(out)
+      .append("Cache-Control: max-age=")
+      .appendNumber(static_cast<long long>(parseSeconds_(value)))
+      .appendCrlf();
+  return out;
+}
+
+std::string Config::parseAddHeader_(const DirectiveNode& d) {
+  requireArgsAtLeast_(d, 2);
+  const std::string& name = d.args[0];
+  static const char kTokenChars[] = "!#$%&'*+-.^_`|~";
+  bool valid = true;
+  for (std::size_t i = 0; i < name.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(name[i]);
+    if (!std::isalnum(c) && std::strchr(kTokenChars, c) == NULL) {
+      valid = false;
+    }
+  }
+  // Framing is the server's business
+  if (!valid || strcasecmp(name.c_str(), "Content-Length") == 0 ||
+      strcasecmp(name.c_str(), "Transfer-Encoding") == 0 ||
+      strcasecmp(name.c_str(), "Connection") == 0) {
+    std::ostringstream oss;
+    oss << configErrorPrefix() << "Invalid add_header name '" << name << "'";
+    LOG(ERROR) << oss.str();
+    throw std::runtime_error(oss.str());
+  }
+  // A control character, CR or LF above all, must never reach a response
+  // head, where it could inject headers
+  for (std::size_t i = 1; i < d.args.size(); ++i) {
+    for (std::size_t j = 0; j < d.args[i].size(); ++j) {
+      if (std::iscntrl(static_cast<unsigned char>(d.args[i][j]))) {
+        std::ostringstream oss;
+        oss << configErrorPrefix() << "Invalid add_header value for '" << name
+            << "' (control character)";
+        LOG(ERROR) << oss.str();
+        throw std::runtime_error(oss.str());
+      }
+    }
+  }
+  std::string out;
+  ByteBuilder b(out);
+  b.append(name).append(": ").append(d.args[1]);
+  for (std::size_t i = 2; i < d.args.size(); ++i) {
+    b.append(' ').append(d.args[i]);
+  }
+  b.appendCrlf();
+  return out;
+}
+
+bool Config::parseGzip_(const DirectiveNode& d) {
+  requireArgsEqual_(d, 1);
+  bool on = parseBooleanValue_(d.args[0]);
+  if (on && !GzipEncoder::available()) {
+    LOG(INFO) << configErrorPrefix()
+              << "built without zlib, responses will not be compressed";
+  }
+  return on;
+}
+
+int Config::parseGzipCompLevel_(const DirectiveNode& d) {
+  requireArgsEqual_(d, 1);
+  std::size_t level = parsePositiveNumber_(d.args[0]);
+  if (level > 9) {
+    std::ostringstream oss;
+    oss << configErrorPrefix() << "Invalid gzip_comp_level '" << d.args[0]
+        << "' (expected 1-9)";
+    throw std::runtime_error(oss.str());
+  }
+  return static_cast<int>(level);
+}
+
+std::size_t Config::parseGzipMinLength_(const DirectiveNode& d) {
+  requireArgsEqual_(d, 1);
+  if (d.args[0] == "0") {
+    return 0;
+  }
+  return parsePositiveNumber_(d.args[0]);
+}
+
+std::set<std::string> Config::parseGzipTypes_(const DirectiveNode& d) {
+  requireArgsAtLeast_(d, 1);
+  std::set<std::string> types;
+  for (std::size_t i = 0; i < d.args.size(); ++i) {
+    const std::string& arg = d.args[i];
+    std::string type;
+    for (std::size_t j = 0; j < arg.size(); ++j) {
+      type += static_cast<char>(
+          std::tolower(static_cast<unsigned char>(arg[j])));
+    }
+    if (type != "*" && (type.find('/') == std::string::npos ||
+                        type.find(';') != std::string::npos)) {
+      std::ostringstream oss;
+      oss << configErrorPrefix() << "Invalid MIME type '" << arg
+          << "' in gzip_types";
+      throw std::runtime_error(oss.str());
+    }
+    types.insert(type);
+  }
+  return types;
+}
+
+std::size_t Config::parseLimitRate_(const DirectiveNode& d) {
+  requireArgsEqual_(d, 1);
+  if (d.args[0] == "0") {
+    return 0;
+  }
+  return parsePositiveNumber_(d.args[0]);
+}
+
+void Config::parseOpenFileCache_(const DirectiveNode& d, std::size_t& max,
+                                 time_t& inactive) {
+  requireArgsAtLeast_(d, 1);
+  if (d.args.size() == 1 && d.args[0] == "off") {
+    max = 0;
+    inactive = kOpenFileCacheInactiveDefault;
+    return;
+  }
+  max = kOpenFileCacheUnset;
+  inactive = kOpenFileCacheInactiveDefault;
+  for (size_t i = 0; i < d.args.size(); ++i) {
+    const std::string& arg = d.args[i];
+    if (arg.compare(0, 4, "max=") == 0) {
+      max = parsePositiveNumber_(arg.substr(4));
+    } else if (arg.compare(0, 9, "inactive=") == 0) {
+      inactive = parseSeconds_(arg.substr(9));
+    } else {
+      std::ostringstream oss;
+      oss << configErrorPrefix() << "Invalid open_file_cache parameter '"
+          << arg << "' (expected 'off', max=<n> or inactive=<time>)";
+      throw std::runtime_error(oss.str());
+    }
+  }
+  if (max == kOpenFileCacheUnset) {
+    std::ostringstream oss;
+    oss << configErrorPrefix() << "open_file_cache requires max=<n> or 'off'";
+    throw std::runtime_error(oss.str());
+  }
+}
+
 void Config::requireArgsAtLeast_(const DirectiveNode& d, size_t n) const {
   if (d.args.size() < n) {
     std::ostringstream oss;
@@ -547,18 +848,40 @@ void Config::translateServerBlock_(const BlockNode& server_block, Server& srv,
   current_location_path_.clear();
 
   // Process server directives (handle listen + others in one pass)
+  bool open_file_cache_errors_set = false;
   LOG(DEBUG) << "Processing " << server_block.directives.size()
              << " server directive(s)";
   for (size_t i = 0; i < server_block.directives.size(); ++i) {
     const DirectiveNode& d = server_block.directives[i];
 
     if (d.name == "listen") {
-      requireArgsEqual_(d, 1);
+      requireArgsAtLeast_(d, 1);
       Config::ListenInfo li = parseListen(d.args[0]);
       srv.port = li.port;
       srv.host = li.host;
-      LOG(DEBUG) << "Server listen: " << inet_ntoa(*(in_addr*)&srv.host) << ":"
-                 << srv.port;
+      for (size_t j = 1; j < d.args.size(); ++j) {
+        if (d.args[j] == "default_server") {
+          srv.default_server = true;
+        } else if (d.args[j].compare(0, 9, "ipv6only=") == 0) {
+          srv.ipv6only = parseBooleanValue_(d.args[j].substr(9));
+        } else {
+          std::ostringstream oss;
+          oss << configErrorPrefix() << "Unknown listen parameter '"
+              << d.args[j] << "' (expected default_server or ipv6only=)";
+          LOG(ERROR) << oss.str();
+          throw std::runtime_error(oss.str());
+        }
+      }
+      LOG(DEBUG) << "Server listen: "
+                 << net_utils::formatHostPort(srv.host, srv.port)
+                 << (srv.default_server ? " default_server" : "");
+
+    } else if (d.name == "server_name") {
+      requireArgsAtLeast_(d, 1);
+      for (size_t j = 0; j < d.args.size(); ++j) {
+        srv.server_names.push_back(parseServerName_(d.args[j]));
+      }
+      LOG(DEBUG) << "Server names: " << d.args.size() << " name(s)";
 
     } else if (d.name == "root") {
       requireArgsEqual_(d, 1);
@@ -599,6 +922,80 @@ void Config::translateServerBlock_(const BlockNode& server_block, Server& srv,
       requireArgsEqual_(d, 1);
       srv.max_request_body = parsePositiveNumber_(d.args[0]);
       LOG(DEBUG) << "Server max_request_body: " << srv.max_request_body;
+    } else if (d.name == "client_body_buffer_size") {
+      requireArgsEqual_(d, 1);
+      srv.client_body_buffer_size = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Server client_body_buffer_size: "
+                 << srv.client_body_buffer_size;
+    } else if (d.name == "client_header_buffer_size") {
+      requireArgsEqual_(d, 1);
+      srv.client_header_buffer_size = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Server client_header_buffer_size: "
+                 << srv.client_header_buffer_size;
+    } else if (d.name == "large_client_header_buffers") {
+      requireArgsEqual_(d, 2);
+      srv.large_client_header_buffers = parsePositiveNumber_(d.args[0]);
+      srv.large_client_header_buffer_size = parsePositiveNumber_(d.args[1]);
+      LOG(DEBUG) << "Server large_client_header_buffers: "
+                 << srv.large_client_header_buffers << " x "
+                 << srv.large_client_header_buffer_size;
+    } else if (d.name == "open_file_cache") {
+      parseOpenFileCache_(d, srv.open_file_cache_max,
+                          srv.open_file_cache_inactive);
+      LOG(DEBUG) << "Server open_file_cache: max=" << srv.open_file_cache_max
+                 << " inactive=" << srv.open_file_cache_inactive;
+    } else if (d.name == "open_file_cache_valid") {
+      requireArgsEqual_(d, 1);
+      srv.open_file_cache_valid = parseSeconds_(d.args[0]);
+      LOG(DEBUG) << "Server open_file_cache_valid: "
+                 << srv.open_file_cache_valid;
+    } else if (d.name == "open_file_cache_errors") {
+      requireArgsEqual_(d, 1);
+      srv.open_file_cache_errors = parseBooleanValue_(d.args[0]);
+      open_file_cache_errors_set = true;
+      LOG(DEBUG) << "Server open_file_cache_errors: "
+                 << (srv.open_file_cache_errors ? "on" : "off");
+    } else if (d.name == "cache_max_size") {
+      srv.cache_max_size = parseCacheMaxSize_(d);
+      LOG(DEBUG) << "Server cache_max_size: " << srv.cache_max_size;
+    } else if (d.name == "max_file_size") {
+      requireArgsEqual_(d, 1);
+      srv.max_file_size = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Server max_file_size: " << srv.max_file_size;
+    } else if (d.name == "gzip_static") {
+      requireArgsEqual_(d, 1);
+      srv.gzip_static = parseBooleanValue_(d.args[0]);
+      LOG(DEBUG) << "Server gzip_static: "
+                 << (srv.gzip_static ? "on" : "off");
+    } else if (d.name == "gzip") {
+      srv.gzip = parseGzip_(d);
+      LOG(DEBUG) << "Server gzip: " << (srv.gzip ? "on" : "off");
+    } else if (d.name == "gzip_comp_level") {
+      srv.gzip_comp_level = parseGzipCompLevel_(d);
+      LOG(DEBUG) << "Server gzip_comp_level: " << srv.gzip_comp_level;
+    } else if (d.name == "gzip_min_length") {
+      srv.gzip_min_length = parseGzipMinLength_(d);
+      LOG(DEBUG) << "Server gzip_min_length: " << srv.gzip_min_length;
+    } else if (d.name == "gzip_max_length") {
+      requireArgsEqual_(d, 1);
+      srv.gzip_max_length = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Server gzip_max_length: " << srv.gzip_max_length;
+    } else if (d.name == "gzip_types") {
+      srv.gzip_types = parseGzipTypes_(d);
+      LOG(DEBUG) << "Server gzip_types: " << d.args.size() << " type(s)";
+    } else if (d.name == "gzip_buffer_size") {
+      requireArgsEqual_(d, 1);
+      srv.gzip_buffer_size = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Server gzip_buffer_size: " << srv.gzip_buffer_size;
+    } else if (d.name == "gzip_cache_size") {
+      srv.gzip_cache_size = parseCacheMaxSize_(d);
+      LOG(DEBUG) << "Server gzip_cache_size: " << srv.gzip_cache_size;
+    } else if (d.name == "limit_rate") {
+      srv.limit_rate = parseLimitRate_(d);
+      LOG(DEBUG) << "Server limit_rate: " << srv.limit_rate;
+    } else if (d.name == "limit_rate_after") {
+      srv.limit_rate_after = parseLimitRate_(d);
+      LOG(DEBUG) << "Server limit_rate_after: " << srv.limit_rate_after;
     } else {
       throwUnrecognizedDirective_(d, "in server block");
     }
@@ -614,7 +1011,7 @@ void Config::translateServerBlock_(const BlockNode& server_block, Server& srv,
   }
 
   // Minimum requirements: ensure listen was specified and root is set
-  if (srv.port <= 0) {
+  if (srv.port <= 0 && !net_utils::isUnixHost(srv.host)) {
     std::ostringstream oss;
     oss << configErrorPrefix() << "server #" << server_index
         << " missing 'listen' directive or invalid port";
@@ -646,6 +1043,77 @@ void Config::translateServerBlock_(const BlockNode& server_block, Server& srv,
     }
   }
 
+  // client_body_buffer_size inheritance: global -> server -> default
+  if (srv.client_body_buffer_size == kClientBodyBufferSizeUnset) {
+    if (global_client_body_buffer_size_ != kClientBodyBufferSizeUnset) {
+      srv.client_body_buffer_size = global_client_body_buffer_size_;
+    } else {
+      srv.client_body_buffer_size = kClientBodyBufferSizeDefault;
+    }
+    LOG(DEBUG) << "Applied client_body_buffer_size to server: "
+               << srv.client_body_buffer_size;
+  }
+
+  // Header buffer inheritance: global -> server -> default
+  if (srv.client_header_buffer_size == kClientHeaderBufferSizeUnset) {
+    if (global_client_header_buffer_size_ != kClientHeaderBufferSizeUnset) {
+      srv.client_header_buffer_size = global_client_header_buffer_size_;
+    } else {
+      srv.client_header_buffer_size = kClientHeaderBufferSizeDefault;
+    }
+  }
+  if (srv.large_client_header_buffers == kClientHeaderBufferSizeUnset) {
+    if (global_large_client_header_buffers_ != kClientHeaderBufferSizeUnset) {
+      srv.large_client_header_buffers = global_large_client_header_buffers_;
+      srv.large_client_header_buffer_size =
+          global_large_client_header_buffer_size_;
+    } else {
+      srv.large_client_header_buffers = kLargeClientHeaderBuffersDefault;
+      srv.large_client_header_buffer_size =
+          kLargeClientHeaderBufferSizeDefault;
+    }
+  }
+  LOG(DEBUG) << "Applied header buffers to server: "
+             << srv.client_header_buffer_size << ", "
+             << srv.large_client_header_buffers << " x "
+             << srv.large_client_header_buffer_size;
+
+  // Static cache defaults for locations that set neither
+  if (srv.cache_max_size == kStaticCacheSizeUnset) {
+    srv.cache_max_size = 0;
+  }
+  if (srv.max_file_size == kStaticCacheSizeUnset) {
+    srv.max_file_size = kMaxFileSizeDefault;
+  }
+
+  // open_file_cache inheritance: global -> server -> default (off)
+  if (srv.open_file_cache_max == kOpenFileCacheUnset) {
+    if (global_open_file_cache_max_ != kOpenFileCacheUnset) {
+      srv.open_file_cache_max = global_open_file_cache_max_;
+      srv.open_file_cache_inactive = global_open_file_cache_inactive_;
+    } else {
+      srv.open_file_cache_max = 0;
+    }
+  }
+  if (srv.open_file_cache_inactive == kOpenFileCacheTimeUnset) {
+    srv.open_file_cache_inactive = kOpenFileCacheInactiveDefault;
+  }
+  if (srv.open_file_cache_valid == kOpenFileCacheTimeUnset) {
+    if (global_open_file_cache_valid_ != kOpenFileCacheTimeUnset) {
+      srv.open_file_cache_valid = global_open_file_cache_valid_;
+    } else {
+      srv.open_file_cache_valid = kOpenFileCacheValidDefault;
+    }
+  }
+  if (!open_file_cache_errors_set && global_open_file_cache_errors_ != UNSET) {
+    srv.open_file_cache_errors = global_open_file_cache_errors_ == ON;
+  }
+  LOG(DEBUG) << "Applied open_file_cache to server: max="
+             << srv.open_file_cache_max
+             << " inactive=" << srv.open_file_cache_inactive
+             << " valid=" << srv.open_file_cache_valid << " errors="
+             << (srv.open_file_cache_errors ? "on" : "off");
+
   LOG(DEBUG) << "Processing " << server_block.sub_blocks.size()
              << " location block(s)";
   for (size_t i = 0; i < server_block.sub_blocks.size(); ++i) {
@@ -654,9 +1122,18 @@ void Config::translateServerBlock_(const BlockNode& server_block, Server& srv,
       LOG(DEBUG) << "Translating location: " << block.param;
       Location loc(block.param);
       translateLocationBlock_(block, loc);
-      srv.locations[loc.path] = loc;
+      loc.position = i;
+      if (srv.locations.find(loc.key()) != srv.locations.end()) {
+        std::ostringstream oss;
+        oss << configErrorPrefix() << "duplicate location '" << loc.key()
+            << "'";
+        LOG(ERROR) << oss.str();
+        throw std::runtime_error(oss.str());
+      }
+      srv.locations[loc.key()] = loc;
     }
   }
+  srv.compileLocations();
   LOG(DEBUG) << "Server block translation completed";
   // restore to global context
   current_server_index_ = kGlobalContext;
@@ -667,10 +1144,33 @@ void Config::translateLocationBlock_(const BlockNode& location_block,
                                      Location& loc) {
   // Set path from constructor parameter (block.param)
   loc.path = location_block.param;
-  LOG(DEBUG) << "Translating location block: " << loc.path;
+  LOG(DEBUG) << "Translating location block: " << location_block.modifier
+             << " " << loc.path;
   // set current location context (server_index already set by caller)
   current_location_path_ = loc.path;
 
+  const std::string& modifier = location_block.modifier;
+  if (modifier == "=") {
+    loc.match = MATCH_EXACT;
+  } else if (modifier == "^~") {
+    loc.match = MATCH_PREFIX_NO_REGEX;
+  } else if (modifier == "~" || modifier == "~*") {
+    loc.match = modifier == "~" ? MATCH_REGEX : MATCH_REGEX_ICASE;
+    // Compiled here, once; copies of the location share the result
+    std::string error;
+    if (!loc.regex.compile(loc.path, loc.match == MATCH_REGEX_ICASE, error)) {
+      std::ostringstream oss;
+      oss << configErrorPrefix() << "invalid regex in location '" << loc.path
+          << "': " << error;
+      LOG(ERROR) << oss.str();
+      throw std::runtime_error(oss.str());
+    }
+  }
+
+  // "expires" replaces an earlier one; "add_header" lines accumulate
+  std::string expires_headers;
+  std::string added_headers;
+
   // Parse directives
   LOG(DEBUG) << "Processing " << location_block.directives.size()
              << " location directive(s)";
@@ -738,10 +1238,63 @@ void Config::translateLocationBlock_(const BlockNode& location_block,
       requireArgsEqual_(d, 1);
       loc.max_request_body = parsePositiveNumber_(d.args[0]);
       LOG(DEBUG) << "  Location max_request_body: " << loc.max_request_body;
+    } else if (d.name == "client_body_buffer_size") {
+      requireArgsEqual_(d, 1);
+      loc.client_body_buffer_size = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "  Location client_body_buffer_size: "
+                 << loc.client_body_buffer_size;
+    } else if (d.name == "cache_max_size") {
+      loc.cache_max_size = parseCacheMaxSize_(d);
+      LOG(DEBUG) << "  Location cache_max_size: " << loc.cache_max_size;
+    } else if (d.name == "max_file_size") {
+      requireArgsEqual_(d, 1);
+      loc.max_file_size = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "  Location max_file_size: " << loc.max_file_size;
+    } else if (d.name == "gzip_static") {
+      requireArgsEqual_(d, 1);
+      loc.gzip_static = parseBooleanValue_(d.args[0]) ? ON : OFF;
+      LOG(DEBUG) << "  Location gzip_static: "
+                 << (loc.gzip_static == ON ? "on" : "off");
+    } else if (d.name == "gzip") {
+      loc.gzip = parseGzip_(d) ? ON : OFF;
+      LOG(DEBUG) << "  Location gzip: " << (loc.gzip == ON ? "on" : "off");
+    } else if (d.name == "gzip_comp_level") {
+      loc.gzip_comp_level = parseGzipCompLevel_(d);
+      LOG(DEBUG) << "  Location gzip_comp_level: " << loc.gzip_comp_level;
+    } else if (d.name == "gzip_min_length") {
+      loc.gzip_min_length = parseGzipMinLength_(d);
+      LOG(DEBUG) << "  Location gzip_min_length: " << loc.gzip_min_length;
+    } else if (d.name == "gzip_max_length") {
+      requireArgsEqual_(d, 1);
+      loc.gzip_max_length = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "  Location gzip_max_length: " << loc.gzip_max_length;
+    } else if (d.name == "gzip_types") {
+      loc.gzip_types = parseGzipTypes_(d);
+      LOG(DEBUG) << "  Location gzip_types: " << d.args.size() << " type(s)";
+    } else if (d.name == "gzip_buffer_size") {
+      requireArgsEqual_(d, 1);
+      loc.gzip_buffer_size = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "  Location gzip_buffer_size: " << loc.gzip_buffer_size;
+    } else if (d.name == "gzip_cache_size") {
+      loc.gzip_cache_size = parseCacheMaxSize_(d);
+      LOG(DEBUG) << "  Location gzip_cache_size: " << loc.gzip_cache_size;
+    } else if (d.name == "limit_rate") {
+      loc.limit_rate = parseLimitRate_(d);
+      LOG(DEBUG) << "  Location limit_rate: " << loc.limit_rate;
+    } else if (d.name == "limit_rate_after") {
+      loc.limit_rate_after = parseLimitRate_(d);
+      LOG(DEBUG) << "  Location limit_rate_after: " << loc.limit_rate_after;
+    } else if (d.name == "expires") {
+      expires_headers = parseExpires_(d);
+      LOG(DEBUG) << "  Location expires: " << d.args[0];
+    } else if (d.name == "add_header") {
+      added_headers += parseAddHeader_(d);
+      LOG(DEBUG) << "  Location add_header: " << d.args[0];
     } else {
       throwUnrecognizedDirective_(d, "in location block");
     }
   }
+  loc.response_headers = expires_headers + added_headers;
 
   // Validate: location cannot have both CGI and redirect
   if (!loc.cgi_root.empty() && loc.redirect_code != http::S_0_UNKNOWN) {
@@ -770,29 +1323,89 @@ void Config::translateLocationBlock_(const BlockNode& location_block,
 
 // ==================== DIRECTIVE PARSERS ====================
 
+std::string Config::parseServerName_(const std::string& value) {
+  std::string name;
+  for (size_t i = 0; i < value.size(); ++i) {
+    name += static_cast<char>(
+        std::tolower(static_cast<unsigned char>(value[i])));
+  }
+  // A wildcard is only allowed as the whole first label ("*.example.com");
+  // ".example.com" is shorthand for the name plus that wildcard.
+  size_t star = name.find('*');
+  bool bad = name.empty() || name == "." || name == "*." ||
+             (star != std::string::npos &&
+              (star != 0 || name.size() < 3 || name[1] != '.' ||
+               name.find('*', 1) != std::string::npos));
+  for (size_t i = 0; !bad && i < name.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(name[i]);
+    bad = !(std::isalnum(c) || c == '-' || c == '.' || c == '*' || c == '_');
+  }
+  if (bad) {
+    std::ostringstream oss;
+    oss << configErrorPrefix() << "Invalid server_name '" << value << "'";
+    LOG(ERROR) << oss.str();
+    throw std::runtime_error(oss.str());
+  }
+  return name;
+}
+
 Config::ListenInfo Config::parseListen(const std::string& listen_arg) {
   Config::ListenInfo li;
-  size_t colon_pos = listen_arg.find(':');
+  std::string hoststr;
+  std::string portstr = listen_arg;
+  bool bracketed = !listen_arg.empty() && listen_arg[0] == '[';
+
+  // "unix:/path" names a Unix domain socket; it has no port
+  if (net_utils::isUnixHost(listen_arg)) {
+    sockaddr_storage addr;
+    socklen_t len;
+    if (!net_utils::makeSockAddr(listen_arg, 0, addr, len)) {
+      std::ostringstream oss;
+      oss << configErrorPrefix()
+          << "Invalid Unix socket path in listen directive: " << listen_arg;
+      LOG(ERROR) << oss.str();
+      throw std::runtime_error(oss.str());
+    }
+    li.host = listen_arg;
+    li.port = 0;
+    return li;
+  }
 
-  // Extract port string
-  std::string portstr;
-  if (colon_pos != std::string::npos) {
-    portstr = listen_arg.substr(colon_pos + 1);
+  // "[v6addr]:port", "v4addr:port" or just "port"
+  if (bracketed) {
+    std::size_t close = listen_arg.find(']');
+    if (close == std::string::npos || close + 1 >= listen_arg.size() ||
+        listen_arg[close + 1] != ':') {
+      std::ostringstream oss;
+      oss << configErrorPrefix()
+          << "Invalid IPv6 address in listen directive (expected "
+             "[address]:port): "
+          << listen_arg;
+      LOG(ERROR) << oss.str();
+      throw std::runtime_error(oss.str());
+    }
+    hoststr = listen_arg.substr(1, close - 1);
+    portstr = listen_arg.substr(close + 2);
   } else {
-    portstr = listen_arg;
+    std::size_t colon_pos = listen_arg.find(':');
+    if (colon_pos != std::string::npos) {
+      hoststr = listen_arg.substr(0, colon_pos);
+      portstr = listen_arg.substr(colon_pos + 1);
+    }
   }
   li.port = parsePortValue_(portstr);
 
   // no host
-  if (colon_pos == std::string::npos) {
-    li.host = INADDR_ANY;
+  if (hoststr.empty() && !bracketed) {
+    li.host = "0.0.0.0";
     return li;
   }
 
-  li.host = inet_addr(listen_arg.substr(0, colon_pos).c_str());
+  li.host = net_utils::canonicalHost(hoststr);
 
-  // invalid host
-  if (li.host == INADDR_NONE) {
+  // invalid host; IPv6 addresses must be bracketed
+  bool ipv6 = hoststr.find(':') != std::string::npos;
+  if (li.host.empty() || bracketed != ipv6) {
     std::ostringstream oss;
     oss << configErrorPrefix()
         << "Invalid IP address in listen directive: " << listen_arg;
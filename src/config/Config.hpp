@@ -25,6 +25,14 @@ class Config {
   std::vector<Server> servers_;
   std::map<http::Status, std::string> global_error_pages_;
   std::size_t global_max_request_body_;
+  std::size_t global_client_body_buffer_size_;
+  std::size_t global_client_header_buffer_size_;
+  std::size_t global_large_client_header_buffers_;
+  std::size_t global_large_client_header_buffer_size_;
+  std::size_t global_open_file_cache_max_;
+  time_t global_open_file_cache_inactive_;
+  time_t global_open_file_cache_valid_;
+  Tristate global_open_file_cache_errors_;
   size_t idx_;
   static const size_t kGlobalContext = static_cast<size_t>(-1);
   size_t current_server_index_;
@@ -46,6 +54,27 @@ class Config {
   http::Method parseHttpMethod_(const std::string& method);
   http::Status parseRedirectCode_(const std::string& value);
   std::size_t parsePositiveNumber_(const std::string& value);
+  // Time in seconds, with an optional s/m/h/d unit ("30", "10m"); 0 allowed
+  time_t parseSeconds_(const std::string& value);
+  // open_file_cache off | max=<n> [inactive=<time>]; max 0 means off
+  void parseOpenFileCache_(const DirectiveNode& d, std::size_t& max,
+                           time_t& inactive);
+  // cache_max_size <bytes> | off (0)
+  std::size_t parseCacheMaxSize_(const DirectiveNode& d);
+  // expires <time> | epoch | max | off, as serialized header lines
+  std::string parseExpires_(const DirectiveNode& d);
+  // add_header <name> <value>..., as one serialized header line
+  std::string parseAddHeader_(const DirectiveNode& d);
+  // gzip on|off; notes at startup when zlib is not built in
+  bool parseGzip_(const DirectiveNode& d);
+  // gzip_comp_level 1-9
+  int parseGzipCompLevel_(const DirectiveNode& d);
+  // gzip_min_length <bytes>; 0 compresses every body
+  std::size_t parseGzipMinLength_(const DirectiveNode& d);
+  // gzip_types <mime>|* ..., lowercased
+  std::set<std::string> parseGzipTypes_(const DirectiveNode& d);
+  // limit_rate / limit_rate_after <bytes>; 0 = no limit
+  std::size_t parseLimitRate_(const DirectiveNode& d);
   // Return-style parse helpers (convert+validate and return the value)
   std::set<http::Method> parseMethods(const std::vector<std::string>& args);
   std::map<http::Status, std::string> parseErrorPages(
@@ -54,10 +83,12 @@ class Config {
       const std::vector<std::string>& args);
   http::Status parseStatusCode_(const std::string& value);
   struct ListenInfo {
-    in_addr_t host;
+    std::string host;  // canonical numeric address, IPv6 without brackets
     int port;
   };
   ListenInfo parseListen(const std::string& listen_arg);
+  // Lowercase and validate one server_name argument; throws on invalid
+  std::string parseServerName_(const std::string& value);
 
   // Argument count validators
   // Throw if directive does not have at least n arguments
@@ -178,9 +178,155 @@ TEST(ConfigListen, HostAndPort) {
   cfg.parseFile(tmpFile.path());
 
   std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].host, "127.0.0.1");
   EXPECT_EQ(servers[0].port, 8080);
 }
 
+TEST(ConfigListen, PortOnlyListensOnAllIpv4Addresses) {
+  std::string config =
+      "server {\n"
+      "  listen 9000;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].host, "0.0.0.0");
+  EXPECT_TRUE(servers[0].ipv6only);
+}
+
+TEST(ConfigListen, BracketedIpv6Address) {
+  std::string config =
+      "server {\n"
+      "  listen [::]:8080;\n"
+      "  root /var/www;\n"
+      "}\n"
+      "server {\n"
+      "  listen [0:0::1]:8081 ipv6only=off;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  ASSERT_EQ(servers.size(), 2u);
+  EXPECT_EQ(servers[0].host, "::");
+  EXPECT_EQ(servers[0].port, 8080);
+  EXPECT_TRUE(servers[0].ipv6only);
+  // Written in canonical form so equal addresses group together
+  EXPECT_EQ(servers[1].host, "::1");
+  EXPECT_EQ(servers[1].port, 8081);
+  EXPECT_FALSE(servers[1].ipv6only);
+}
+
+TEST(ConfigListen, Ipv4AndIpv6WildcardsOnOnePortAreSeparate) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n"
+      "server {\n"
+      "  listen [::]:8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  ASSERT_EQ(servers.size(), 2u);
+  EXPECT_EQ(servers[0].host, "0.0.0.0");
+  EXPECT_EQ(servers[1].host, "::");
+  // [::] must not take the IPv4 port as well
+  EXPECT_TRUE(servers[1].ipv6only);
+}
+
+TEST(ConfigListen, UnbracketedIpv6AddressThrows) {
+  std::string config =
+      "server {\n"
+      "  listen ::1:8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+TEST(ConfigListen, BracketedIpv4AddressThrows) {
+  std::string config =
+      "server {\n"
+      "  listen [127.0.0.1]:8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+TEST(ConfigListen, UnknownListenParameterThrows) {
+  std::string config =
+      "server {\n"
+      "  listen [::]:8080 ipv6only=maybe;\n"
+      "  root /var/www;\n"
+      "}\n"
+      "server {\n"
+      "  listen 8081 reuseport;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+TEST(ConfigListen, UnixSocketPath) {
+  std::string config =
+      "server {\n"
+      "  listen unix:/run/webserv.sock;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].host, "unix:/run/webserv.sock");
+  EXPECT_EQ(servers[0].port, 0);
+}
+
+TEST(ConfigListen, InvalidUnixSocketPathThrows) {
+  std::string config =
+      "server {\n"
+      "  listen unix:;\n"
+      "  root /var/www;\n"
+      "}\n"
+      "server {\n"
+      "  listen unix:/" + std::string(200, 'a') + ";\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
 TEST(ConfigListen, InvalidPortZeroThrows) {
   std::string config =
       "server {\n"
@@ -542,6 +688,539 @@ TEST(ConfigMaxRequestBody, ServerOverridesGlobal) {
   EXPECT_EQ(servers[0].max_request_body, 4096u);
 }
 
+// ==================== CLIENT_BODY_BUFFER_SIZE TESTS ====================
+
+TEST(ConfigClientBodyBufferSize, DefaultApplied) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].client_body_buffer_size, kClientBodyBufferSizeDefault);
+}
+
+TEST(ConfigClientBodyBufferSize, GlobalServerAndLocationLevels) {
+  std::string config =
+      "client_body_buffer_size 1024;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  location /upload {\n"
+      "    client_body_buffer_size 65536;\n"
+      "  }\n"
+      "  location / {\n"
+      "  }\n"
+      "}\n"
+      "server {\n"
+      "  listen 8081;\n"
+      "  root /var/www;\n"
+      "  client_body_buffer_size 2048;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].client_body_buffer_size, 1024u);
+  EXPECT_EQ(servers[0].matchLocation("/upload/x").client_body_buffer_size,
+            65536u);
+  EXPECT_EQ(servers[0].matchLocation("/other").client_body_buffer_size,
+            1024u);
+  EXPECT_EQ(servers[1].client_body_buffer_size, 2048u);
+}
+
+TEST(ConfigStaticCache, ServerAndLocationLevels) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  cache_max_size 1048576;\n"
+      "  location /static/ {\n"
+      "    max_file_size 4096;\n"
+      "  }\n"
+      "  location /uploads/ {\n"
+      "    cache_max_size off;\n"
+      "  }\n"
+      "}\n"
+      "server {\n"
+      "  listen 8081;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  const Location& other = servers[0].matchLocation("/a.css");
+  EXPECT_EQ(other.cache_max_size, 1048576u);
+  EXPECT_EQ(other.max_file_size, kMaxFileSizeDefault);
+  const Location& statics = servers[0].matchLocation("/static/a.css");
+  EXPECT_EQ(statics.cache_max_size, 1048576u);
+  EXPECT_EQ(statics.max_file_size, 4096u);
+  EXPECT_EQ(servers[0].matchLocation("/uploads/a").cache_max_size, 0u);
+  EXPECT_EQ(servers[1].matchLocation("/").cache_max_size, 0u);
+}
+
+TEST(ConfigStaticCache, InvalidValueThrows) {
+  const char* bad[] = {"cache_max_size 0;", "cache_max_size on;",
+                       "max_file_size off;", "max_file_size 1 2;", NULL};
+  for (int i = 0; bad[i] != NULL; ++i) {
+    std::string config = std::string(
+                             "server {\n"
+                             "  listen 8080;\n"
+                             "  root /var/www;\n  ") +
+                         bad[i] + "\n}\n";
+    TempConfigFile tmpFile(config);
+    Config cfg;
+    cfg.parseFile(tmpFile.path());
+    EXPECT_THROW(cfg.getServers(), std::runtime_error) << bad[i];
+  }
+}
+
+TEST(ConfigGzipStatic, LocationsInheritTheServerValue) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  gzip_static on;\n"
+      "  location /raw/ {\n"
+      "    gzip_static off;\n"
+      "  }\n"
+      "}\n"
+      "server {\n"
+      "  listen 8081;\n"
+      "  root /var/www;\n"
+      "  location /assets/ {\n"
+      "    gzip_static on;\n"
+      "  }\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].matchLocation("/app.js").gzip_static, ON);
+  EXPECT_EQ(servers[0].matchLocation("/raw/app.js").gzip_static, OFF);
+  EXPECT_EQ(servers[1].matchLocation("/app.js").gzip_static, OFF);
+  EXPECT_EQ(servers[1].matchLocation("/assets/app.js").gzip_static, ON);
+}
+
+TEST(ConfigGzip, LocationsInheritTheServerSettings) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  gzip on;\n"
+      "  gzip_comp_level 6;\n"
+      "  gzip_types text/CSS application/javascript;\n"
+      "  gzip_cache_size 65536;\n"
+      "  location /raw/ {\n"
+      "    gzip off;\n"
+      "  }\n"
+      "  location /api/ {\n"
+      "    gzip_types *;\n"
+      "    gzip_min_length 0;\n"
+      "    gzip_max_length 2048;\n"
+      "    gzip_buffer_size 16384;\n"
+      "    gzip_cache_size off;\n"
+      "  }\n"
+      "}\n"
+      "server {\n"
+      "  listen 8081;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  const Location& root = servers[0].matchLocation("/a.css");
+  EXPECT_EQ(root.gzip, ON);
+  EXPECT_EQ(root.gzip_comp_level, 6);
+  EXPECT_EQ(root.gzip_min_length, kGzipMinLengthDefault);
+  EXPECT_EQ(root.gzip_max_length, kGzipMaxLengthDefault);
+  EXPECT_EQ(root.gzip_types.size(), 2u);
+  EXPECT_EQ(root.gzip_types.count("text/css"), 1u);
+  EXPECT_EQ(root.gzip_buffer_size, kGzipBufferSizeDefault);
+  EXPECT_EQ(root.gzip_cache_size, 65536u);
+  EXPECT_EQ(servers[0].matchLocation("/raw/a.css").gzip, OFF);
+  const Location& api = servers[0].matchLocation("/api/x");
+  EXPECT_EQ(api.gzip, ON);
+  EXPECT_EQ(api.gzip_types.count("*"), 1u);
+  EXPECT_EQ(api.gzip_min_length, 0u);
+  EXPECT_EQ(api.gzip_max_length, 2048u);
+  EXPECT_EQ(api.gzip_buffer_size, 16384u);
+  EXPECT_EQ(api.gzip_cache_size, 0u);
+
+  const Location& other = servers[1].matchLocation("/");
+  EXPECT_EQ(other.gzip, OFF);
+  EXPECT_EQ(other.gzip_comp_level, kGzipCompLevelDefault);
+  EXPECT_TRUE(other.gzip_types.empty());
+  EXPECT_EQ(other.gzip_cache_size, 0u);
+}
+
+TEST(ConfigGzip, InvalidValueThrows) {
+  const char* bad[] = {"gzip yes;",
+                       "gzip_comp_level 0;",
+                       "gzip_comp_level 10;",
+                       "gzip_min_length -1;",
+                       "gzip_max_length 0;",
+                       "gzip_types;",
+                       "gzip_types text;",
+                       "gzip_comp_level fast;",
+                       "gzip_buffer_size 0;",
+                       "gzip_cache_size 0;",
+                       NULL};
+  for (int i = 0; bad[i] != NULL; ++i) {
+    std::string config = std::string(
+                             "server {\n"
+                             "  listen 8080;\n"
+                             "  root /var/www;\n  ") +
+                         bad[i] + "\n}\n";
+    TempConfigFile tmpFile(config);
+    Config cfg;
+    cfg.parseFile(tmpFile.path());
+    EXPECT_THROW(cfg.getServers(), std::runtime_error) << bad[i];
+  }
+}
+
+TEST(ConfigLimitRate, LocationsInheritTheServerSettings) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  limit_rate_after 1048576;\n"
+      "  location /downloads/ {\n"
+      "    limit_rate 65536;\n"
+      "  }\n"
+      "  location /mirror/ {\n"
+      "    limit_rate 1000;\n"
+      "    limit_rate_after 0;\n"
+      "  }\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  const Location& root = servers[0].matchLocation("/a.bin");
+  EXPECT_EQ(root.limit_rate, 0u);
+  EXPECT_EQ(root.limit_rate_after, 1048576u);
+  const Location& downloads = servers[0].matchLocation("/downloads/a.iso");
+  EXPECT_EQ(downloads.limit_rate, 65536u);
+  EXPECT_EQ(downloads.limit_rate_after, 1048576u);
+  const Location& mirror = servers[0].matchLocation("/mirror/a.iso");
+  EXPECT_EQ(mirror.limit_rate, 1000u);
+  EXPECT_EQ(mirror.limit_rate_after, 0u);
+}
+
+TEST(ConfigLimitRate, InvalidValueThrows) {
+  const char* bad[] = {"limit_rate;",         "limit_rate -1;",
+                       "limit_rate 10k;",     "limit_rate 1 2;",
+                       "limit_rate_after x;", NULL};
+  for (int i = 0; bad[i] != NULL; ++i) {
+    std::string config = std::string(
+                             "server {\n"
+                             "  listen 8080;\n"
+                             "  root /var/www;\n  ") +
+                         bad[i] + "\n}\n";
+    TempConfigFile tmpFile(config);
+    Config cfg;
+    cfg.parseFile(tmpFile.path());
+    EXPECT_THROW(cfg.getServers(), std::runtime_error) << bad[i];
+  }
+}
+
+TEST(ConfigCachePolicy, ExpiresAndAddHeaderArePreSerialized) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  location /assets/ {\n"
+      "    expires 1h;\n"
+      "    add_header Cache-Control public, immutable;\n"
+      "    add_header X-Frame-Options DENY;\n"
+      "  }\n"
+      "  location /max/ {\n"
+      "    expires 10;\n"
+      "    expires max;\n"
+      "  }\n"
+      "  location /epoch/ {\n"
+      "    expires epoch;\n"
+      "  }\n"
+      "  location /off/ {\n"
+      "    expires off;\n"
+      "  }\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].matchLocation("/assets/a.css").response_headers,
+            "Cache-Control: max-age=3600\r\n"
+            "Cache-Control: public, immutable\r\n"
+            "X-Frame-Options: DENY\r\n");
+  EXPECT_EQ(servers[0].matchLocation("/max/a").response_headers,
+            "Expires: Thu, 31 Dec 2037 23:55:55 GMT\r\n"
+            "Cache-Control: max-age=315360000\r\n");
+  EXPECT_EQ(servers[0].matchLocation("/epoch/a").response_headers,
+            "Expires: Thu, 01 Jan 1970 00:00:01 GMT\r\n"
+            "Cache-Control: no-cache\r\n");
+  EXPECT_EQ(servers[0].matchLocation("/off/a").response_headers, "");
+  EXPECT_EQ(servers[0].matchLocation("/").response_headers, "");
+}
+
+TEST(ConfigCachePolicy, InvalidValueThrows) {
+  const char* bad[] = {"expires;",
+                       "expires soon;",
+                       "expires 1h 2h;",
+                       "add_header X-Only;",
+                       "add_header Bad:Name v;",
+                       "add_header Content-Length 5;",
+                       "add_header connection keep-alive;",
+                       "add_header X-Bell ding\adong;",
+                       "add_header X-Del a \x7f;",
+                       NULL};
+  for (int i = 0; bad[i] != NULL; ++i) {
+    std::string config = std::string(
+                             "server {\n"
+                             "  listen 8080;\n"
+                             "  root /var/www;\n"
+                             "  location / {\n    ") +
+                         bad[i] + "\n  }\n}\n";
+    TempConfigFile tmpFile(config);
+    Config cfg;
+    cfg.parseFile(tmpFile.path());
+    EXPECT_THROW(cfg.getServers(), std::runtime_error) << bad[i];
+  }
+}
+
+TEST(ConfigClientBodyBufferSize, InvalidValueThrows) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  client_body_buffer_size big;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+TEST(ConfigHeaderBuffers, DefaultsApplied) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].client_header_buffer_size,
+            kClientHeaderBufferSizeDefault);
+  EXPECT_EQ(servers[0].large_client_header_buffers,
+            kLargeClientHeaderBuffersDefault);
+  EXPECT_EQ(servers[0].large_client_header_buffer_size,
+            kLargeClientHeaderBufferSizeDefault);
+}
+
+TEST(ConfigHeaderBuffers, GlobalAndServerLevels) {
+  std::string config =
+      "client_header_buffer_size 2048;\n"
+      "large_client_header_buffers 8 16384;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n"
+      "server {\n"
+      "  listen 8081;\n"
+      "  root /var/www;\n"
+      "  client_header_buffer_size 512;\n"
+      "  large_client_header_buffers 2 32768;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].client_header_buffer_size, 2048u);
+  EXPECT_EQ(servers[0].large_client_header_buffers, 8u);
+  EXPECT_EQ(servers[0].large_client_header_buffer_size, 16384u);
+  EXPECT_EQ(servers[1].client_header_buffer_size, 512u);
+  EXPECT_EQ(servers[1].large_client_header_buffers, 2u);
+  EXPECT_EQ(servers[1].large_client_header_buffer_size, 32768u);
+}
+
+TEST(ConfigHeaderBuffers, LargeBuffersNeedNumberAndSize) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  large_client_header_buffers 8192;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+TEST(ConfigHeaderBuffers, NotAllowedInLocation) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  location / {\n"
+      "    client_header_buffer_size 512;\n"
+      "  }\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+// ==================== OPEN FILE CACHE TESTS ====================
+
+TEST(ConfigOpenFileCache, OffByDefault) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].open_file_cache_max, 0u);
+  EXPECT_EQ(servers[0].open_file_cache_inactive,
+            kOpenFileCacheInactiveDefault);
+  EXPECT_EQ(servers[0].open_file_cache_valid, kOpenFileCacheValidDefault);
+}
+
+TEST(ConfigOpenFileCache, GlobalAndServerLevels) {
+  std::string config =
+      "open_file_cache max=100 inactive=2m;\n"
+      "open_file_cache_valid 30s;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n"
+      "server {\n"
+      "  listen 8081;\n"
+      "  root /var/www;\n"
+      "  open_file_cache max=10;\n"
+      "  open_file_cache_valid 0;\n"
+      "}\n"
+      "server {\n"
+      "  listen 8082;\n"
+      "  root /var/www;\n"
+      "  open_file_cache off;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].open_file_cache_max, 100u);
+  EXPECT_EQ(servers[0].open_file_cache_inactive, 120);
+  EXPECT_EQ(servers[0].open_file_cache_valid, 30);
+  EXPECT_EQ(servers[1].open_file_cache_max, 10u);
+  EXPECT_EQ(servers[1].open_file_cache_inactive,
+            kOpenFileCacheInactiveDefault);
+  EXPECT_EQ(servers[1].open_file_cache_valid, 0);
+  EXPECT_EQ(servers[2].open_file_cache_max, 0u);
+}
+
+TEST(ConfigOpenFileCache, ErrorsInheritedFromGlobal) {
+  std::string config =
+      "open_file_cache max=100;\n"
+      "open_file_cache_errors on;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n"
+      "server {\n"
+      "  listen 8081;\n"
+      "  root /var/www;\n"
+      "  open_file_cache_errors off;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_TRUE(servers[0].open_file_cache_errors);
+  EXPECT_FALSE(servers[1].open_file_cache_errors);
+}
+
+TEST(ConfigOpenFileCache, InvalidArgumentsRejected) {
+  const char* bad[] = {"open_file_cache;",
+                       "open_file_cache on;",
+                       "open_file_cache inactive=10s;",
+                       "open_file_cache max=0;",
+                       "open_file_cache max=10 inactive=soon;",
+                       "open_file_cache_valid 10x;",
+                       "open_file_cache_valid -1;",
+                       "open_file_cache_errors maybe;",
+                       NULL};
+  for (int i = 0; bad[i] != NULL; ++i) {
+    std::string config = std::string(
+                             "server {\n"
+                             "  listen 8080;\n"
+                             "  root /var/www;\n  ") +
+                         bad[i] + "\n}\n";
+    TempConfigFile tmpFile(config);
+    Config cfg;
+    cfg.parseFile(tmpFile.path());
+    EXPECT_THROW(cfg.getServers(), std::runtime_error) << bad[i];
+  }
+}
+
+TEST(ConfigOpenFileCache, NotAllowedInLocation) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  location / {\n"
+      "    open_file_cache max=10;\n"
+      "  }\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
 // ==================== GLOBAL ERROR_PAGE TESTS ====================
 
 TEST(ConfigGlobalErrorPage, GlobalErrorPageApplied) {
@@ -790,6 +1469,23 @@ TEST(ConfigRedirect, InvalidRedirectCode404Throws) {
   EXPECT_THROW(cfg.getServers(), std::runtime_error);
 }
 
+TEST(ConfigRedirect, NotModifiedIsNotARedirect) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  location /bad {\n"
+      "    redirect 304 /cached;\n"
+      "  }\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
 TEST(ConfigRedirect, MissingArgumentsThrows) {
   std::string config =
       "server {\n"
@@ -1575,3 +2271,135 @@ TEST(MaxRequestBodyInheritance, MultipleLocationsWithDifferentLimits) {
   Location defaultLoc = servers[0].matchLocation("/default/file");
   EXPECT_EQ(defaultLoc.max_request_body, 4096u);
 }
+
+// ==================== server_name ====================
+
+TEST(ConfigServerName, NamesAreLowercasedAndKept) {
+  std::string config =
+      "server {\n"
+      "  listen 8080 default_server;\n"
+      "  server_name Example.com *.example.com .example.org;\n"
+      "  root /var/www;\n"
+      "}\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  ASSERT_EQ(servers.size(), 2u);
+  ASSERT_EQ(servers[0].server_names.size(), 3u);
+  EXPECT_EQ(servers[0].server_names[0], "example.com");
+  EXPECT_EQ(servers[0].server_names[1], "*.example.com");
+  EXPECT_EQ(servers[0].server_names[2], ".example.org");
+  EXPECT_TRUE(servers[0].default_server);
+  EXPECT_TRUE(servers[1].server_names.empty());
+  EXPECT_FALSE(servers[1].default_server);
+}
+
+TEST(ConfigServerName, MisplacedWildcardIsRejected) {
+  const char* names[] = {"www.*.com", "*example.com", "**.example.com", "*",
+                         "a/b", NULL};
+  for (int i = 0; names[i] != NULL; ++i) {
+    std::string config = std::string(
+                             "server {\n"
+                             "  listen 8080;\n"
+                             "  root /var/www;\n"
+                             "  server_name ") +
+                         names[i] + ";\n}\n";
+    TempConfigFile tmpFile(config);
+    Config cfg;
+    cfg.parseFile(tmpFile.path());
+    EXPECT_THROW(cfg.getServers(), std::runtime_error) << names[i];
+  }
+}
+
+TEST(ConfigServerName, ListenOnlyAcceptsDefaultServerFlag) {
+  std::string config =
+      "server {\n"
+      "  listen 8080 reuseport;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+// ==================== location modifiers ====================
+
+TEST(ConfigLocationModifiers, ModifiersAreParsedAndRouted) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  location / {\n"
+      "    root /var/default;\n"
+      "  }\n"
+      "  location = / {\n"
+      "    root /var/home;\n"
+      "  }\n"
+      "  location ^~ /static/ {\n"
+      "    root /var/static;\n"
+      "  }\n"
+      "  location ~* \\.(png|jpg)$ {\n"
+      "    root /var/images;\n"
+      "  }\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  ASSERT_EQ(servers[0].locations.size(), 4u);
+  EXPECT_EQ(servers[0].locations["= /"].match, MATCH_EXACT);
+  EXPECT_EQ(servers[0].locations["/static/"].match, MATCH_PREFIX_NO_REGEX);
+  EXPECT_EQ(servers[0].locations["~* \\.(png|jpg)$"].match,
+            MATCH_REGEX_ICASE);
+
+  EXPECT_EQ(servers[0].matchLocation("/").root, "/var/home");
+  EXPECT_EQ(servers[0].matchLocation("/index.html").root, "/var/default");
+  EXPECT_EQ(servers[0].matchLocation("/a/B.PNG").root, "/var/images");
+  EXPECT_EQ(servers[0].matchLocation("/static/b.png").root, "/var/static");
+}
+
+TEST(ConfigLocationModifiers, InvalidRegexIsRejected) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  location ~ (unclosed {\n"
+      "  }\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+TEST(ConfigLocationModifiers, DuplicateLocationIsRejected) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  location /a {\n"
+      "  }\n"
+      "  location ^~ /a {\n"
+      "  }\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
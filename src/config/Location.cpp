@@ -4,9 +4,22 @@
 
 const std::size_t kMaxRequestBodyUnset = static_cast<std::size_t>(-1);
 const std::size_t kMaxRequestBodyDefault = 4096;
+const std::size_t kClientBodyBufferSizeUnset = static_cast<std::size_t>(-1);
+const std::size_t kClientBodyBufferSizeDefault = 16384;
+const std::size_t kStaticCacheSizeUnset = static_cast<std::size_t>(-1);
+const std::size_t kMaxFileSizeDefault = 65536;
+const std::size_t kGzipSizeUnset = static_cast<std::size_t>(-1);
+const int kGzipCompLevelDefault = 1;
+const std::size_t kGzipMinLengthDefault = 20;
+const std::size_t kGzipMaxLengthDefault = 1048576;
+const std::size_t kGzipBufferSizeDefault = 4096;
+const std::size_t kLimitRateUnset = static_cast<std::size_t>(-1);
 
 Location::Location()
     : path(),
+      match(MATCH_PREFIX),
+      regex(),
+      position(0),
       allow_methods(),
       redirect_code(http::S_0_UNKNOWN),
       redirect_location(),
@@ -16,12 +29,29 @@ Location::Location()
       autoindex(UNSET),
       root(),
       error_page(),
-      max_request_body(kMaxRequestBodyUnset) {
+      max_request_body(kMaxRequestBodyUnset),
+      client_body_buffer_size(kClientBodyBufferSizeUnset),
+      cache_max_size(kStaticCacheSizeUnset),
+      max_file_size(kStaticCacheSizeUnset),
+      gzip_static(UNSET),
+      gzip(UNSET),
+      gzip_comp_level(0),
+      gzip_min_length(kGzipSizeUnset),
+      gzip_max_length(kGzipSizeUnset),
+      gzip_types(),
+      gzip_buffer_size(kGzipSizeUnset),
+      gzip_cache_size(kGzipSizeUnset),
+      limit_rate(kLimitRateUnset),
+      limit_rate_after(kLimitRateUnset),
+      response_headers() {
   LOG(DEBUG) << "Location() default constructor called";
 }
 
 Location::Location(const std::string& p)
     : path(p),
+      match(MATCH_PREFIX),
+      regex(),
+      position(0),
       allow_methods(),
       redirect_code(http::S_0_UNKNOWN),
       redirect_location(),
@@ -31,12 +61,29 @@ Location::Location(const std::string& p)
       autoindex(UNSET),
       root(),
       error_page(),
-      max_request_body(kMaxRequestBodyUnset) {
+      max_request_body(kMaxRequestBodyUnset),
+      client_body_buffer_size(kClientBodyBufferSizeUnset),
+      cache_max_size(kStaticCacheSizeUnset),
+      max_file_size(kStaticCacheSizeUnset),
+      gzip_static(UNSET),
+      gzip(UNSET),
+      gzip_comp_level(0),
+      gzip_min_length(kGzipSizeUnset),
+      gzip_max_length(kGzipSizeUnset),
+      gzip_types(),
+      gzip_buffer_size(kGzipSizeUnset),
+      gzip_cache_size(kGzipSizeUnset),
+      limit_rate(kLimitRateUnset),
+      limit_rate_after(kLimitRateUnset),
+      response_headers() {
   LOG(DEBUG) << "Location(path) constructor called with path: " << p;
 }
 
 Location::Location(const Location& other)
     : path(other.path),
+      match(other.match),
+      regex(other.regex),
+      position(other.position),
       allow_methods(other.allow_methods),
       redirect_code(other.redirect_code),
       redirect_location(other.redirect_location),
@@ -46,11 +93,28 @@ Location::Location(const Location& other)
       autoindex(other.autoindex),
       root(other.root),
       error_page(other.error_page),
-      max_request_body(other.max_request_body) {}
+      max_request_body(other.max_request_body),
+      client_body_buffer_size(other.client_body_buffer_size),
+      cache_max_size(other.cache_max_size),
+      max_file_size(other.max_file_size),
+      gzip_static(other.gzip_static),
+      gzip(other.gzip),
+      gzip_comp_level(other.gzip_comp_level),
+      gzip_min_length(other.gzip_min_length),
+      gzip_max_length(other.gzip_max_length),
+      gzip_types(other.gzip_types),
+      gzip_buffer_size(other.gzip_buffer_size),
+      gzip_cache_size(other.gzip_cache_size),
+      limit_rate(other.limit_rate),
+      limit_rate_after(other.limit_rate_after),
+      response_headers(other.response_headers) {}
 
 Location& Location::operator=(const Location& other) {
   if (this != &other) {
     path = other.path;
+    match = other.match;
+    regex = other.regex;
+    position = other.position;
     allow_methods = other.allow_methods;
     redirect_code = other.redirect_code;
     redirect_location = other.redirect_location;
@@ -61,8 +125,39 @@ Location& Location::operator=(const Location& other) {
     root = other.root;
     error_page = other.error_page;
     max_request_body = other.max_request_body;
+    client_body_buffer_size = other.client_body_buffer_size;
+    cache_max_size = other.cache_max_size;
+    max_file_size = other.max_file_size;
+    gzip_static = other.gzip_static;
+    gzip = other.gzip;
+    gzip_comp_level = other.gzip_comp_level;
+    gzip_min_length = other.gzip_min_length;
+    gzip_max_length = other.gzip_max_length;
+    gzip_types = other.gzip_types;
+    gzip_buffer_size = other.gzip_buffer_size;
+    gzip_cache_size = other.gzip_cache_size;
+    limit_rate = other.limit_rate;
+    limit_rate_after = other.limit_rate_after;
+    response_headers = other.response_headers;
   }
   return *this;
 }
 
 Location::~Location() {}
+
+bool Location::isRegex() const {
+  return match == MATCH_REGEX || match == MATCH_REGEX_ICASE;
+}
+
+std::string Location::key() const {
+  switch (match) {
+    case MATCH_EXACT:
+      return "= " + path;
+    case MATCH_REGEX:
+      return "~ " + path;
+    case MATCH_REGEX_ICASE:
+      return "~* " + path;
+    default:
+      return path;
+  }
+}
@@ -7,12 +7,33 @@
 
 #include "HttpMethod.hpp"
 #include "HttpStatus.hpp"
+#include "Regex.hpp"
 
 // Tri-state for boolean directives that need to distinguish "not set"
 enum Tristate { UNSET = -1, OFF = 0, ON = 1 };
 
+// How a location's path is compared with request paths
+// ("location [modifier] path")
+enum LocationMatch {
+  MATCH_PREFIX,           // none: longest prefix, regexes may override
+  MATCH_PREFIX_NO_REGEX,  // ^~ : longest prefix, regexes are not tried
+  MATCH_EXACT,            // =  : whole path only, checked first
+  MATCH_REGEX,            // ~  : POSIX extended regex, in config order
+  MATCH_REGEX_ICASE       // ~* : same, case-insensitive
+};
+
 extern const std::size_t kMaxRequestBodyUnset;
 extern const std::size_t kMaxRequestBodyDefault;
+extern const std::size_t kClientBodyBufferSizeUnset;
+extern const std::size_t kClientBodyBufferSizeDefault;
+extern const std::size_t kStaticCacheSizeUnset;
+extern const std::size_t kMaxFileSizeDefault;
+extern const std::size_t kGzipSizeUnset;
+extern const int kGzipCompLevelDefault;
+extern const std::size_t kGzipMinLengthDefault;
+extern const std::size_t kGzipMaxLengthDefault;
+extern const std::size_t kGzipBufferSizeDefault;
+extern const std::size_t kLimitRateUnset;
 
 class Location {
  public:
@@ -22,8 +43,13 @@ class Location {
   Location& operator=(const Location& other);
   ~Location();
 
-  // Location path identifier
+  // Location path identifier (the pattern for regex locations)
   std::string path;
+  LocationMatch match;
+  // Compiled `path` for regex locations, empty otherwise
+  Regex regex;
+  // Index of the block within its server; regexes are tried in this order
+  std::size_t position;
 
   // Location-specific configuration
   std::set<http::Method> allow_methods;
@@ -36,4 +62,40 @@ class Location {
   std::string root;
   std::map<http::Status, std::string> error_page;
   std::size_t max_request_body;
+  // Request bodies larger than this are spooled to a temporary file
+  std::size_t client_body_buffer_size;
+  // In-memory cache of small static files (see StaticCache): up to
+  // cache_max_size bytes for this location (0 = off), files of at most
+  // max_file_size bytes
+  std::size_t cache_max_size;
+  std::size_t max_file_size;
+  // Serve "<file>.br" or "<file>.gz" instead of a file when it exists and
+  // the client accepts that encoding
+  Tristate gzip_static;
+  // On-the-fly compression (see GzipEncoder): deflate level (0 = unset),
+  // smallest and largest body compressed, MIME types compressed besides
+  // text/html
+  // ("*" = any; empty = unset), encoder output buffer, and bytes of
+  // compressed static files kept in the GzipCache (0 = off)
+  Tristate gzip;
+  int gzip_comp_level;
+  std::size_t gzip_min_length;
+  std::size_t gzip_max_length;
+  std::set<std::string> gzip_types;
+  std::size_t gzip_buffer_size;
+  std::size_t gzip_cache_size;
+  // Bytes per second a static file body is sent at (0 = no limit), after
+  // the first limit_rate_after bytes went out at full speed
+  std::size_t limit_rate;
+  std::size_t limit_rate_after;
+  // Header lines from "expires" and "add_header", serialized once when the
+  // configuration is loaded and written as-is into successful static file
+  // and autoindex responses
+  std::string response_headers;
+
+  bool isRegex() const;
+  // Key in Server::locations: the path, preceded by the modifier for exact
+  // and regex locations ("= /", "~ \.php$"). Both prefix forms share the
+  // plain path, so "/a" and "^~ /a" cannot be configured together.
+  std::string key() const;
 };
@@ -1,18 +1,22 @@
 #include "Connection.hpp"
 
+#include <strings.h>
 #include <sys/socket.h>
-#include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cctype>
 #include <cerrno>
 #include <cstdio>
 #include <iostream>
-#include <sstream>
+#include <vector>
 
 #include "AutoindexHandler.hpp"
+#include "ByteBuilder.hpp"
 #include "CgiHandler.hpp"
 #include "ErrorFileHandler.hpp"
 #include "FileHandler.hpp"
+#include "GzipEncoder.hpp"
 #include "HttpMethod.hpp"
 #include "HttpStatus.hpp"
 #include "Location.hpp"
@@ -20,35 +24,73 @@
 #include "RedirectHandler.hpp"
 #include "Server.hpp"
 #include "constants.hpp"
+#include "file_utils.hpp"
+#include "http_utils.hpp"
 #include "utils.hpp"
 
 Connection::Connection()
     : fd(-1),
       server_fd(-1),
       write_offset(0),
+      send_quota(),
       headers_end_pos(std::string::npos),
       write_ready(false),
       parsed_content_length(-1),
+      body_chunked(false),
+      chunked_decoder(),
+      request_complete(false),
+      body_buffer_size(kClientBodyBufferSizeUnset),
+      body_spool_dir(),
+      header_pool(NULL),
+      header_buffer_borrowed(false),
+      file_cache(NULL),
+      static_cache(NULL),
+      gzip_cache(NULL),
+      vhost(NULL),
+      current_location(NULL),
       request(),
       response(),
       active_handler(NULL),
       error_pages(),
       read_start(time(NULL)),
-      write_start(0) {}
+      write_start(0),
+      write_paused_until(0),
+      peer_half_closed(false),
+      lingering(false),
+      linger_start(0),
+      linger_discarded(0) {}
 
 Connection::Connection(int fd)
     : fd(fd),
       server_fd(-1),
       write_offset(0),
+      send_quota(),
       headers_end_pos(std::string::npos),
       write_ready(false),
       parsed_content_length(-1),
+      body_chunked(false),
+      chunked_decoder(),
+      request_complete(false),
+      body_buffer_size(kClientBodyBufferSizeUnset),
+      body_spool_dir(),
+      header_pool(NULL),
+      header_buffer_borrowed(false),
+      file_cache(NULL),
+      static_cache(NULL),
+      gzip_cache(NULL),
+      vhost(NULL),
+      current_location(NULL),
       request(),
       response(),
       active_handler(NULL),
       error_pages(),
       read_start(time(NULL)),
-      write_start(0) {}
+      write_start(0),
+      write_paused_until(0),
+      peer_half_closed(false),
+      lingering(false),
+      linger_start(0),
+      linger_discarded(0) {}
 
 Connection::Connection(const Connection& other)
     : fd(other.fd),
@@ -57,28 +99,50 @@ Connection::Connection(const Connection& other)
       read_buffer(other.read_buffer),
       write_buffer(other.write_buffer),
       write_offset(other.write_offset),
+      send_quota(other.send_quota),
       headers_end_pos(other.headers_end_pos),
       write_ready(other.write_ready),
       parsed_content_length(other.parsed_content_length),
+      body_chunked(other.body_chunked),
+      chunked_decoder(other.chunked_decoder),
+      request_complete(other.request_complete),
+      body_buffer_size(other.body_buffer_size),
+      body_spool_dir(other.body_spool_dir),
+      header_pool(other.header_pool),
+      header_buffer_borrowed(false),
+      file_cache(other.file_cache),
+      static_cache(other.static_cache),
+      gzip_cache(other.gzip_cache),
+      vhost(other.vhost),
+      current_location(other.current_location),
       request(other.request),
       response(other.response),
       active_handler(NULL),
       error_pages(other.error_pages),
       read_start(other.read_start),
-      write_start(other.write_start) {}
+      write_start(other.write_start),
+      write_paused_until(other.write_paused_until),
+      peer_half_closed(other.peer_half_closed),
+      lingering(other.lingering),
+      linger_start(other.linger_start),
+      linger_discarded(other.linger_discarded) {}
 
 Connection::~Connection() {
   clearHandler();
+  releaseHeaderBuffer();
 }
 
 Connection& Connection::operator=(const Connection& other) {
   if (this != &other) {
+    // Hand back a borrowed header buffer before read_buffer is overwritten
+    releaseHeaderBuffer();
     fd = other.fd;
     server_fd = other.server_fd;
     remote_addr = other.remote_addr;
     read_buffer = other.read_buffer;
     write_buffer = other.write_buffer;
     write_offset = other.write_offset;
+    send_quota = other.send_quota;
     headers_end_pos = other.headers_end_pos;
     write_ready = other.write_ready;
     request = other.request;
@@ -86,8 +150,24 @@ Connection& Connection::operator=(const Connection& other) {
     clearHandler();
     error_pages = other.error_pages;
     parsed_content_length = other.parsed_content_length;
+    body_chunked = other.body_chunked;
+    chunked_decoder = other.chunked_decoder;
+    request_complete = other.request_complete;
+    body_buffer_size = other.body_buffer_size;
+    body_spool_dir = other.body_spool_dir;
+    header_pool = other.header_pool;
+    file_cache = other.file_cache;
+    static_cache = other.static_cache;
+    gzip_cache = other.gzip_cache;
+    vhost = other.vhost;
+    current_location = other.current_location;
     read_start = other.read_start;
     write_start = other.write_start;
+    write_paused_until = other.write_paused_until;
+    peer_half_closed = other.peer_half_closed;
+    lingering = other.lingering;
+    linger_start = other.linger_start;
+    linger_discarded = other.linger_discarded;
   }
   return *this;
 }
@@ -117,12 +197,15 @@ bool Connection::isWriteTimedOut(int timeout_seconds) const {
   return (now - write_start) >= timeout_seconds;
 }
 
-int Connection::handleRead(const Server& server) {
+int Connection::handleRead(const VirtualHosts& vhosts) {
   char buf[WRITE_BUF_SIZE] = {0};
 
   ssize_t r = recv(fd, buf, sizeof(buf), 0);
 
   if (r < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+      return 0;
+    }
     LOG_PERROR(ERROR, "read");
     return -1;
   }
@@ -135,15 +218,15 @@ int Connection::handleRead(const Server& server) {
   // Add new data to persistent buffer
   read_buffer.append(buf, r);
 
-  // If headers not yet complete, enforce a cap while searching
+  // If headers not yet complete, enforce the header buffer limits
   if (headers_end_pos == std::string::npos) {
-    if (read_buffer.size() > HEADERS_SEARCH_LIMIT) {
-      // Headers too large / not found within limit -> Bad Request
-      prepareErrorResponse(http::S_400_BAD_REQUEST);
+    std::size_t pos = read_buffer.find(CRLF CRLF);
+    std::size_t head_len =
+        pos == std::string::npos ? read_buffer.size() : pos + 4;
+    if (!reserveHeaderBuffer(vhosts.defaultServer(), head_len)) {
+      prepareErrorResponse(http::S_431_REQUEST_HEADER_FIELDS_TOO_LARGE);
       return 2; /* response ready, signal caller to enable EPOLLOUT */
     }
-
-    std::size_t pos = read_buffer.find(CRLF CRLF);
     if (pos == std::string::npos) {
       // headers not complete yet
       return 0;
@@ -152,69 +235,272 @@ int Connection::handleRead(const Server& server) {
     headers_end_pos = pos;
     // Attempt to parse headers. Prepare any immediate error responses
     // (411/400/413) and return a code indicating a response is ready.
-    int ph = processParsedHeaders(server);
+    int ph = 2;
+    if (parseRequestHead()) {
+      std::string host;
+      request.getHeader("Host", host);
+      vhost = &vhosts.select(trim_copy(host));
+      ph = processParsedHeaders(*vhost);
+    }
+    // The head now lives in `request`; a large buffer is no longer needed.
+    releaseHeaderBuffer();
     if (ph != 0) {
       // Ready to process response. Error response prepared or no body
       // expected.
+      request_complete = (ph == 1);
       return ph;
     }
   }
 
-  if (isBodyReady()) {
-    return 1;
+  if (body_chunked) {
+    int cs = readChunkedBody();
+    request_complete = (cs == 1);
+    return cs;
   }
 
-  return 0;
+  int bs = readContentLengthBody();
+  request_complete = (bs == 1);
+  return bs;
+}
+
+namespace {
+
+// Length of the longest line in the first `len` bytes of `buf`, counting a
+// trailing line that has not ended yet
+std::size_t longestLine(const std::string& buf, std::size_t len) {
+  std::size_t longest = 0;
+  std::size_t start = 0;
+  while (start < len) {
+    std::size_t eol = buf.find('\n', start);
+    std::size_t end = (eol == std::string::npos || eol >= len) ? len : eol;
+    if (end - start > longest) {
+      longest = end - start;
+    }
+    start = end + 1;
+  }
+  return longest;
 }
 
-bool Connection::isBodyReady() {
+}  // namespace
+
+bool Connection::reserveHeaderBuffer(const Server& server,
+                                     std::size_t head_len) {
+  if (!header_buffer_borrowed &&
+      head_len <= server.client_header_buffer_size) {
+    return true;
+  }
+  // Like nginx, the request line and each header field must fit in one
+  // large buffer and the whole head in all of this connection's buffers
+  std::size_t large = server.large_client_header_buffer_size;
+  if (head_len > large * server.large_client_header_buffers ||
+      longestLine(read_buffer, head_len) > large) {
+    LOG(INFO) << "Request header too large on fd " << fd << " (" << head_len
+              << " bytes)";
+    return false;
+  }
+  if (!header_buffer_borrowed && header_pool != NULL) {
+    header_pool->acquire(read_buffer);
+    header_buffer_borrowed = true;
+  }
+  return true;
+}
+
+void Connection::releaseHeaderBuffer() {
+  if (header_buffer_borrowed) {
+    header_pool->release(read_buffer);
+    header_buffer_borrowed = false;
+  }
+}
+
+int Connection::readContentLengthBody() {
   // If parsed_content_length is negative or zero, there is no body to read
   if (parsed_content_length <= 0) {
-    return true;  // no body expected
+    return 1;  // no body expected
   }
 
-  // check whether we've received the full body
+  // Move whatever part of the body has arrived out of read_buffer
   std::size_t body_start = headers_end_pos + 4;
-  std::size_t available = 0;
-  if (body_start < read_buffer.size()) {
-    available = read_buffer.size() - body_start;
+  std::size_t expected = static_cast<std::size_t>(parsed_content_length);
+  std::size_t have = request.getBody().size();
+  if (body_start < read_buffer.size() && have < expected) {
+    std::size_t n = read_buffer.size() - body_start;
+    if (n > expected - have) {
+      n = expected - have;
+    }
+    if (!storeBody(read_buffer.data() + body_start, n)) {
+      prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+      return 2;
+    }
+    read_buffer.erase(body_start, n);
   }
 
-  if (available < static_cast<std::size_t>(parsed_content_length)) {
-    // not enough body bytes yet
+  return request.getBody().size() == expected ? 1 : 0;
+}
+
+bool Connection::storeBody(const char* data, std::size_t len) {
+  Body& body = request.getBody();
+  if (!body.isSpooled() && body.size() + len > body_buffer_size) {
+    int spool_fd = file_utils::createTempFile(body_spool_dir);
+    if (spool_fd < 0 || !body.spoolTo(spool_fd)) {
+      LOG(ERROR) << "Failed to spool request body to disk on fd " << fd;
+      return false;
+    }
+    LOG(DEBUG) << "Spooling request body to disk on fd " << fd
+               << " (exceeds client_body_buffer_size " << body_buffer_size
+               << ")";
+  }
+  if (!body.append(data, len)) {
+    LOG_PERROR(ERROR, "write request body spool");
     return false;
   }
+  return true;
+}
 
-  // full body available, extract
-  request.getBody().data = read_buffer.substr(
-      body_start, static_cast<std::size_t>(parsed_content_length));
+namespace {
+
+// Check the Transfer-Encoding values of a request. Returns S_0_UNKNOWN when
+// the only coding is "chunked", 400 when "chunked" is not the final coding
+// (the body length cannot be determined) and 501 for any other coding.
+http::Status checkTransferCodings(const std::vector<std::string>& values) {
+  std::vector<std::string> codings;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    std::size_t start = 0;
+    while (start <= values[i].size()) {
+      std::size_t comma = values[i].find(',', start);
+      if (comma == std::string::npos) {
+        comma = values[i].size();
+      }
+      std::string coding = trim_copy(values[i].substr(start, comma - start));
+      if (!coding.empty()) {
+        codings.push_back(coding);
+      }
+      start = comma + 1;
+    }
+  }
+  if (codings.empty() || strcasecmp(codings.back().c_str(), "chunked") != 0) {
+    return http::S_400_BAD_REQUEST;
+  }
+  if (codings.size() > 1) {
+    return http::S_501_NOT_IMPLEMENTED;
+  }
+  return http::S_0_UNKNOWN;
+}
 
-  return true;
+}  // namespace
+
+int Connection::readChunkedBody() {
+  std::size_t body_start = headers_end_pos + 4;
+  if (body_start >= read_buffer.size()) {
+    return chunked_decoder.done() ? 1 : 0;
+  }
+
+  std::size_t consumed = 0;
+  std::string decoded;
+  ChunkedDecoder::Result res = chunked_decoder.feed(
+      read_buffer.data() + body_start, read_buffer.size() - body_start,
+      decoded, consumed);
+  // Only the decoded payload is kept; the encoded bytes are dropped as soon
+  // as they have been consumed so read_buffer stays around one recv() worth.
+  read_buffer.erase(body_start, consumed);
+  if (!storeBody(decoded.data(), decoded.size())) {
+    prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+    return 2;
+  }
+
+  switch (res) {
+    case ChunkedDecoder::CHUNKED_DONE:
+      return 1;
+    case ChunkedDecoder::CHUNKED_NEED_MORE:
+      return 0;
+    case ChunkedDecoder::CHUNKED_TOO_LARGE:
+      LOG(DEBUG) << "Chunked body exceeds max_request_body on fd " << fd;
+      prepareErrorResponse(http::S_413_PAYLOAD_TOO_LARGE);
+      return 2;
+    default:
+      LOG(INFO) << "Malformed chunked body on fd " << fd;
+      prepareErrorResponse(http::S_400_BAD_REQUEST);
+      return 2;
+  }
 }
 
-int Connection::processParsedHeaders(const Server& server) {
-  // Parse start line and headers to populate request and URI
+bool Connection::parseRequestHead() {
   if (!request.parseStartAndHeaders(read_buffer, headers_end_pos)) {
     LOG(INFO) << "Malformed request on fd " << fd
               << ", sending 400 Bad Request";
     prepareErrorResponse(http::S_400_BAD_REQUEST);
-    return 2;
+    return false;
   }
+  return true;
+}
 
+int Connection::processParsedHeaders(const Server& server) {
   // Determine whether to expect a body: only POST and PUT have bodies.
-  std::string method_tmp = request.request_line.method;
-  if (method_tmp != "POST" && method_tmp != "PUT") {
-    return 1;
+  switch (request.request_line.method) {
+    case http::POST:
+    case http::PUT:
+      break;
+    default:
+      return 1;
   }
 
   // Determine location-specific max_request_body from provided server
   std::size_t loc_max = kMaxRequestBodyUnset;
-  Location loc = server.matchLocation(request.uri.getPath());
+  const Location& loc = server.matchLocation(request.uri.getPath());
   loc_max = loc.max_request_body;
 
-  // If Content-Length present, validate against location max
+  // Bodies over client_body_buffer_size go to a temp file. It is created
+  // under the location root so uploads can be linked into place.
+  body_buffer_size = loc.client_body_buffer_size;
+  body_spool_dir = loc.cgi_root.empty() ? loc.root : std::string();
+
+  // Validate version, method and framing before any of the body is read so
+  // a rejected upload is answered at once; with "Expect: 100-continue" the
+  // client then never transmits the body at all.
+  error_pages = loc.error_page;
+  http::Status vstat = validateRequestForLocation(loc);
+  if (vstat != http::S_0_UNKNOWN) {
+    prepareErrorResponse(vstat);
+    return 2;
+  }
+
+  bool expect_continue = false;
+  std::string expect;
+  if (request.getHeader("Expect", expect)) {
+    if (strcasecmp(trim_copy(expect).c_str(), "100-continue") != 0) {
+      LOG(INFO) << "Unsupported expectation on fd " << fd << ": " << expect;
+      prepareErrorResponse(http::S_417_EXPECTATION_FAILED);
+      return 2;
+    }
+    // HTTP/1.0 clients cannot handle interim responses (RFC 9110 10.1.1)
+    expect_continue = request.request_line.version == "HTTP/1.1";
+  }
+
   std::string content_length_str;
-  if (!request.getHeader("Content-Length", content_length_str)) {
+  bool has_content_length =
+      request.getHeader("Content-Length", content_length_str);
+
+  std::vector<std::string> transfer_codings =
+      request.getHeaders("Transfer-Encoding");
+  if (!transfer_codings.empty()) {
+    // Only "chunked" is supported. A request carrying both framings, or a
+    // Transfer-Encoding on HTTP/1.0, cannot be delimited reliably
+    // (RFC 9112 6.1) and is rejected rather than guessed at.
+    if (has_content_length || request.request_line.version == "HTTP/1.0") {
+      prepareErrorResponse(http::S_400_BAD_REQUEST);
+      return 2;
+    }
+    http::Status te_status = checkTransferCodings(transfer_codings);
+    if (te_status != http::S_0_UNKNOWN) {
+      prepareErrorResponse(te_status);
+      return 2;
+    }
+    body_chunked = true;
+    chunked_decoder.reset(loc_max);
+    return expect_continue ? sendContinue() : 0;
+  }
+
+  // If Content-Length present, validate against location max
+  if (!has_content_length) {
     // Body expected but no Content-Length supplied
     prepareErrorResponse(http::S_411_LENGTH_REQUIRED);
     return 2;
@@ -235,28 +521,74 @@ int Connection::processParsedHeaders(const Server& server) {
     return 2;
   }
 
-  // Cache parsed Content-Length. Only extract the body when the full body
-  // is present using headers_end_pos to compute the body start.
+  // Cache parsed Content-Length; body bytes are moved out of read_buffer as
+  // they arrive, starting at headers_end_pos + 4.
   parsed_content_length = content_len;
 
+  if (expect_continue && content_len > 0) {
+    return sendContinue();
+  }
+  return 0;
+}
+
+int Connection::sendContinue() {
+  // The client may have started sending the body without waiting; then the
+  // interim response is pointless (RFC 9110 10.1.1).
+  if (read_buffer.size() > headers_end_pos + 4) {
+    return 0;
+  }
+
+  std::string line = *http::statusLine(http::S_100_CONTINUE, HTTP_VERSION);
+  line += CRLF;
+  // Nothing else has been written to the socket yet, so a line this short
+  // fits in the send buffer; a short write means the connection is broken.
+  ssize_t w = send(fd, line.data(), line.size(), 0);
+  if (w != static_cast<ssize_t>(line.size())) {
+    LOG_PERROR(ERROR, "send 100 Continue");
+    return -1;
+  }
+  LOG(DEBUG) << "Sent 100 Continue on fd " << fd;
   return 0;
 }
 
 int Connection::handleWrite() {
+  // What is left once the budget is used up waits for this connection's
+  // next turn: epoll keeps reporting the socket writable, behind the other
+  // ready connections
+  send_quota.refill(SEND_BUDGET_PER_WAKEUP);
+  if (write_start == 0) {
+    startWritePhase();
+  }
+  int status = sendPending();
+  // A client that stops reading makes no progress and times out
+  if (send_quota.sent > 0) {
+    startWritePhase();
+  }
+  return status;
+}
+
+int Connection::sendPending() {
   while (write_offset < write_buffer.size()) {
-    ssize_t w =
-        send(fd, write_buffer.c_str() + write_offset,
-             static_cast<size_t>(write_buffer.size()) - write_offset, 0);
+    if (send_quota.budget == 0) {
+      return 1;
+    }
+    size_t len = std::min(write_buffer.size() - write_offset,
+                          send_quota.budget);
+    ssize_t w = send(fd, write_buffer.c_str() + write_offset, len, 0);
 
     LOG(DEBUG) << "Sent " << w << " bytes to fd=" << fd;
 
     if (w < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return 1;
+      }
       // Error occurred during send
       LOG_PERROR(ERROR, "write");
       return -1;
     }
 
     write_offset += static_cast<size_t>(w);
+    send_quota.consume(static_cast<size_t>(w), len);
   }
 
   // If there's an active handler, ask it to resume (streaming, CGI, etc.)
@@ -277,6 +609,55 @@ int Connection::handleWrite() {
   return 0;
 }
 
+bool Connection::needsLingeringClose() const {
+  return !request_complete;
+}
+
+bool Connection::startLingeringClose() {
+  if (shutdown(fd, SHUT_WR) < 0) {
+    LOG_PERROR(ERROR, "shutdown");
+    return false;
+  }
+  lingering = true;
+  linger_start = time(NULL);
+  linger_discarded = 0;
+  // Nothing read from now on is parsed
+  releaseHeaderBuffer();
+  std::string().swap(read_buffer);
+  LOG(DEBUG) << "Lingering close on fd " << fd;
+  return true;
+}
+
+int Connection::discardInput() {
+  char buf[WRITE_BUF_SIZE];
+  ssize_t r = recv(fd, buf, sizeof(buf), 0);
+  if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+    return 0;
+  }
+  if (r <= 0) {
+    return -1;
+  }
+  linger_discarded += static_cast<std::size_t>(r);
+  if (linger_discarded >= LINGERING_DISCARD_LIMIT) {
+    LOG(INFO) << "Discarded " << linger_discarded
+              << " bytes while lingering on fd " << fd << ", closing";
+    return -1;
+  }
+  return 0;
+}
+
+bool Connection::isLingerTimedOut(int timeout_seconds) const {
+  if (!lingering) {
+    return false;
+  }
+  time_t now = time(NULL);
+  if (now < linger_start) {
+    // Clock went backwards, consider not timed out
+    return false;
+  }
+  return (now - linger_start) >= timeout_seconds;
+}
+
 std::string Connection::getHttpVersion() const {
   if (request.request_line.version == "HTTP/1.0" ||
       request.request_line.version == "HTTP/1.1") {
@@ -313,28 +694,175 @@ void Connection::prepareErrorResponse(http::Status status) {
   }
 
   std::string title = http::statusWithReason(status);
-  std::ostringstream body;
-  body << "<html>" << CRLF << "<head><title>" << title << "</title></head>"
-       << CRLF << "<body>" << CRLF << "<center><h1>" << title
-       << "</h1></center>" << CRLF << "</body>" << CRLF << "</html>" << CRLF;
+  std::string body;
+  ByteBuilder b(body);
+  b.append("<html>" CRLF "<head><title>")
+      .append(title)
+      .append("</title></head>" CRLF "<body>" CRLF "<center><h1>")
+      .append(title)
+      .append("</h1></center>" CRLF "</body>" CRLF "</html>" CRLF);
 
   // For HEAD requests, send only headers (with correct Content-Length).
-  const std::string& method = request.request_line.method;
-  if (method == "HEAD") {
+  if (request.request_line.method == http::HEAD) {
     response.addHeader("Content-Type", "text/html; charset=utf-8");
-    std::ostringstream len;
-    len << body.str().size();
-    response.addHeader("Content-Length", len.str());
-
-    std::ostringstream header_stream;
-    header_stream << response.startLine() << CRLF;
-    header_stream << response.serializeHeadersWithConnection();
-    header_stream << CRLF;
-    write_buffer = header_stream.str();
+    response.addHeader("Content-Length",
+                       toDecimalString(static_cast<long long>(body.size())));
+    response.serializeHeadInto(write_buffer);
   } else {
-    response.setBodyWithContentType(body.str(), "text/html; charset=utf-8");
-    write_buffer = response.serialize();
+    response.setBodyWithContentType(body, "text/html; charset=utf-8");
+    gzipBody(response.getBody().data);
+    response.serializeInto(write_buffer);
+  }
+}
+
+namespace {
+
+// Whether `content_type` (parameters ignored) is compressed in `loc`:
+// text/html always is, other types when gzip_types lists them or "*"
+bool isGzipType(const Location& loc, const std::string& content_type) {
+  std::string type = content_type.substr(0, content_type.find(';'));
+  type = trim_copy(type);
+  for (std::size_t i = 0; i < type.size(); ++i) {
+    type[i] = static_cast<char>(
+        std::tolower(static_cast<unsigned char>(type[i])));
+  }
+  if (type.empty()) {
+    return false;
+  }
+  return type == "text/html" || loc.gzip_types.count("*") != 0 ||
+         loc.gzip_types.count(type) != 0;
+}
+
+GzipEncoder::Format gzipFormat(const std::string& coding) {
+  return coding == "deflate" ? GzipEncoder::DEFLATE : GzipEncoder::GZIP;
+}
+
+}  // namespace
+
+bool Connection::addGzipVary(const std::string& content_type,
+                             off_t length) {
+  const Location* loc = current_location;
+  std::string unused;
+  if (loc == NULL || loc->gzip != ON ||
+      length < static_cast<off_t>(loc->gzip_min_length) ||
+      length > static_cast<off_t>(loc->gzip_max_length) ||
+      response.getHeader("Content-Encoding", unused) ||
+      !isGzipType(*loc, content_type)) {
+    return false;
+  }
+  // The answer depends on Accept-Encoding whether or not it is compressed
+  response.addVary("Accept-Encoding");
+  return true;
+}
+
+std::string Connection::negotiateGzip(const std::string& content_type,
+                                      off_t length) {
+  if (!addGzipVary(content_type, length)) {
+    return "";
+  }
+  if (request.request_line.method == http::HEAD ||
+      !GzipEncoder::available()) {
+    return "";
+  }
+  std::vector<std::string> values = request.getHeaders("Accept-Encoding");
+  std::string accept;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    accept += i == 0 ? values[i] : ", " + values[i];
+  }
+  if (http::acceptsEncoding(accept, "gzip")) {
+    return "gzip";
+  }
+  if (http::acceptsEncoding(accept, "deflate")) {
+    return "deflate";
+  }
+  return "";
+}
+
+bool Connection::gzipBody(std::string& body) {
+  std::string content_type;
+  response.getHeader("Content-Type", content_type);
+  std::string coding =
+      negotiateGzip(content_type, static_cast<off_t>(body.size()));
+  if (coding.empty()) {
+    return false;
+  }
+  std::string out;
+  if (!GzipEncoder::compress(body, gzipFormat(coding),
+                             current_location->gzip_comp_level,
+                             current_location->gzip_buffer_size, out)) {
+    return false;
+  }
+  LOG(DEBUG) << "Connection: " << coding << " " << body.size() << " -> "
+             << out.size() << " bytes";
+  body.swap(out);
+  response.addHeader("Content-Encoding", coding);
+  std::string length;
+  if (response.getHeader("Content-Length", length)) {
+    response.removeHeader("Content-Length");
+    response.addHeader("Content-Length",
+                       toDecimalString(static_cast<long long>(body.size())));
+  }
+  return true;
+}
+
+const std::string* Connection::gzipFile(const std::string& path,
+                                        const FileInfo& fi,
+                                        const std::string& coding,
+                                        std::string& scratch) {
+  const Location* loc = current_location;
+  if (loc == NULL || fi.size > static_cast<off_t>(loc->gzip_max_length)) {
+    return NULL;
   }
+  bool cached = gzip_cache != NULL && loc->gzip_cache_size > 0;
+  if (cached) {
+    const std::string* hit =
+        gzip_cache->find(path, coding, fi.inode, fi.size, fi.mtime);
+    if (hit != NULL) {
+      LOG(DEBUG) << "Connection: gzip cache hit for " << path;
+      return hit;
+    }
+  }
+
+  GzipEncoder encoder;
+  if (!encoder.init(gzipFormat(coding), loc->gzip_comp_level,
+                    loc->gzip_buffer_size)) {
+    return NULL;
+  }
+  scratch.clear();
+  std::vector<char> buf(loc->gzip_buffer_size);
+  off_t offset = 0;
+  while (offset < fi.size) {
+    std::size_t want = buf.size();
+    if (static_cast<off_t>(want) > fi.size - offset) {
+      want = static_cast<std::size_t>(fi.size - offset);
+    }
+    ssize_t n = pread(fi.fd, &buf[0], want, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      LOG_PERROR(ERROR, "Connection: pread " << path);
+      return NULL;
+    }
+    if (!encoder.update(&buf[0], static_cast<std::size_t>(n), scratch)) {
+      return NULL;
+    }
+    offset += n;
+  }
+  if (!encoder.finish(scratch)) {
+    return NULL;
+  }
+  LOG(DEBUG) << "Connection: " << coding << " " << path << " " << fi.size
+             << " -> " << scratch.size() << " bytes";
+  if (cached) {
+    const std::string* stored =
+        gzip_cache->store(path, coding, fi.inode, fi.size, fi.mtime, loc,
+                          loc->gzip_cache_size, scratch);
+    if (stored != NULL) {
+      return stored;
+    }
+  }
+  return &scratch;
 }
 
 void Connection::setHandler(IHandler* h) {
@@ -353,6 +881,22 @@ void Connection::clearHandler() {
   }
 }
 
+void Connection::cancelHandler() {
+  if (active_handler) {
+    active_handler->cancel(*this);
+    clearHandler();
+  }
+}
+
+bool Connection::peerClosed() const {
+  char c;
+  ssize_t r = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (r == 0) {
+    return true;
+  }
+  return r < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+}
+
 HandlerResult Connection::executeHandler(IHandler* handler) {
   // setHandler takes ownership of handler and clears any previous handler.
   setHandler(handler);
@@ -393,7 +937,7 @@ void Connection::processRequest(const Server& server) {
 
   LOG(DEBUG) << "Request path: " << path;
 
-  Location location = server.matchLocation(path);
+  const Location& location = server.matchLocation(path);
 
   processResponse(location);
 }
@@ -405,6 +949,7 @@ void Connection::processResponse(const Location& location) {
 
   // Store error page config (paths already resolved in matchLocation)
   error_pages = location.error_page;
+  current_location = &location;
 
   // Reset response state at the beginning to ensure all handlers start clean
   response = Response();
@@ -474,8 +1019,7 @@ void Connection::processResponse(const Location& location) {
   }
 
   // For POST/PUT/DELETE on directories, use FileHandler which can create files
-  std::string method = request.request_line.method;
-  if (is_directory && method == "POST") {
+  if (is_directory && request.request_line.method == http::POST) {
     // FileHandler can handle POST to directory (creates new file)
     IHandler* handler = new FileHandler(resolved_path, request.uri.getPath());
     HandlerResult hr = executeHandler(handler);
@@ -499,7 +1043,8 @@ void Connection::processResponse(const Location& location) {
         display_path += '/';
       }
 
-      AutoindexHandler* ah = new AutoindexHandler(resolved_path, display_path);
+      AutoindexHandler* ah =
+          new AutoindexHandler(resolved_path, display_path, &location);
       HandlerResult hr = executeHandler(ah);
       if (hr == HR_WOULD_BLOCK) {
         return;  // handler will continue later
@@ -519,7 +1064,8 @@ void Connection::processResponse(const Location& location) {
   }
 
   // Static file handling - FileHandler handles GET, HEAD, PUT, DELETE
-  IHandler* handler = new FileHandler(resolved_path, request.uri.getPath());
+  IHandler* handler =
+      new FileHandler(resolved_path, request.uri.getPath(), &location);
   HandlerResult hr = executeHandler(handler);
   if (hr == HR_WOULD_BLOCK) {
     return;  // handler will continue later
@@ -535,17 +1081,15 @@ http::Status Connection::validateRequestForLocation(const Location& location) {
   }
 
   // 2. Check HTTP method
-  http::Method method;
-  try {
-    method = http::stringToMethod(request.request_line.method);
-  } catch (const std::invalid_argument&) {
-    LOG(INFO) << "Not implemented method: " << request.request_line.method;
+  http::Method method = request.request_line.method;
+  if (method == http::UNKNOWN) {
+    LOG(INFO) << "Not implemented method: " << request.request_line.method_name;
     return http::S_501_NOT_IMPLEMENTED;
   }
 
   // Check if method is allowed in this location
   if (location.allow_methods.find(method) == location.allow_methods.end()) {
-    LOG(INFO) << "Method not allowed: " << request.request_line.method
+    LOG(INFO) << "Method not allowed: " << http::methodToString(method)
               << " for location: " << location.path;
     // Build Allow header with allowed methods
     std::string allow_header;
@@ -627,9 +1171,10 @@ bool Connection::resolvePathForLocation(const Location& location,
   // Get the decoded path (query string already stripped by Uri parser)
   std::string uri = request.uri.getDecodedPath();
 
-  // Relative path inside the location
+  // Relative path inside the location; a regex location has no prefix to
+  // strip, so the whole path is looked up under its root
   std::string rel = uri;
-  if (!location.path.empty() && location.path != "/") {
+  if (!location.isRegex() && !location.path.empty() && location.path != "/") {
     if (rel.find(location.path) == 0) {
       rel = rel.substr(location.path.size());
       if (rel.empty()) {
@@ -662,11 +1207,11 @@ bool Connection::resolvePathForLocation(const Location& location,
     path = root + rel;
   }
 
-  struct stat st;
+  FileStat st;
   bool path_is_dir = false;
-  bool path_exists = (stat(path.c_str(), &st) == 0);
+  bool path_exists = file_utils::statPath(path, st, file_cache);
 
-  if (path_exists && S_ISDIR(st.st_mode)) {
+  if (path_exists && st.is_dir) {
     path_is_dir = true;
     if (!path.empty() && path[path.size() - 1] != '/') {
       path += '/';
@@ -685,7 +1230,7 @@ bool Connection::resolvePathForLocation(const Location& location,
     for (std::set<std::string>::const_iterator it = location.index.begin();
          it != location.index.end(); ++it) {
       std::string cand = path + *it;
-      if (stat(cand.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+      if (file_utils::statPath(cand, st, file_cache) && st.is_reg) {
         path = cand;
         found_index = true;
         break;
@@ -709,7 +1254,7 @@ void Connection::logAccess() const {
   // Example: 127.0.0.1 - - [12/Dec/2025:15:45:00 +0000] "GET /index.html
   // HTTP/1.1" 200 1234
 
-  std::string method = request.request_line.method;
+  std::string method = request.request_line.method_name;
   std::string uri = request.request_line.uri;
   std::string version = request.request_line.version;
   int status = static_cast<int>(response.status_line.status_code);
@@ -7,11 +7,18 @@
 #include <map>
 #include <string>
 
+#include "ChunkedDecoder.hpp"
+#include "GzipCache.hpp"
+#include "HeaderBufferPool.hpp"
 #include "HttpStatus.hpp"
 #include "IHandler.hpp"
+#include "OpenFileCache.hpp"
 #include "Request.hpp"
 #include "Response.hpp"
 #include "Server.hpp"
+#include "StaticCache.hpp"
+#include "VirtualHosts.hpp"
+#include "file_utils.hpp"
 
 class Connection {
  public:
@@ -28,44 +35,151 @@ class Connection {
   std::string read_buffer;
   std::string write_buffer;
   std::size_t write_offset;
+  // Bytes this connection may still send in the current event loop turn
+  // and its sendfile() chunk size; refilled by handleWrite() and used by
+  // handlers streaming a body from resume()
+  SendQuota send_quota;
   std::size_t headers_end_pos;
   bool write_ready;
   // Cached parsed Content-Length (negative if not present)
   long long parsed_content_length;
+  // Body uses Transfer-Encoding: chunked; decoded as it arrives
+  bool body_chunked;
+  ChunkedDecoder chunked_decoder;
+  // Headers and body fully received; the request may be dispatched
+  bool request_complete;
+  // Location's client_body_buffer_size and the directory to spool bodies
+  // above it into (empty = system temp dir)
+  std::size_t body_buffer_size;
+  std::string body_spool_dir;
+  // Large buffers for request heads over client_header_buffer_size; set by
+  // ServerManager to the pool of the accepting listener (may be NULL)
+  HeaderBufferPool* header_pool;
+  // read_buffer currently holds a buffer borrowed from header_pool
+  bool header_buffer_borrowed;
+  // Open file cache of the accepting listener, set by ServerManager (may be
+  // NULL); static files are stat'ed and opened through it
+  OpenFileCache* file_cache;
+  // In-memory copies of small static files, shared by every connection;
+  // set by ServerManager (may be NULL)
+  StaticCache* static_cache;
+  // Compressed copies of static files, shared by every connection; set by
+  // ServerManager (may be NULL)
+  GzipCache* gzip_cache;
+  // Virtual server chosen from the Host header once the head is parsed;
+  // NULL until then. Points into ServerManager's VirtualHosts.
+  const Server* vhost;
+  // Location the request was routed to; NULL until processResponse(). Its
+  // gzip settings apply to whatever response is produced for it.
+  const Location* current_location;
   Request request;
   Response response;
   IHandler* active_handler;
   std::map<http::Status, std::string> error_pages;
   time_t read_start;   // Timestamp when connection started (for read timeout)
-  time_t write_start;  // Timestamp when write phase started (0 if not started)
+  // When the response last made progress: set as the write phase starts
+  // and on every send (0 if not started). The write timeout counts from it.
+  time_t write_start;
+  // Monotonic time in ms until which the active handler holds back output
+  // (limit_rate); ServerManager stops watching for EPOLLOUT until then.
+  // 0 = not paused.
+  long long write_paused_until;
+  // The client shut down its sending side after a complete request
+  // (shutdown(SHUT_WR)); it is no longer watched for EPOLLRDHUP.
+  bool peer_half_closed;
+  // Lingering close state: the response is sent and input is being drained
+  bool lingering;
+  time_t linger_start;
+  std::size_t linger_discarded;
 
   // handleRead returns: -1 = error, 0 = need more data, 1 = ready,
   // 2 = response prepared (error page ready)
-  // Now accepts the servers map so it can parse headers that depend on
-  // server configuration (location limits) and prepare error responses
-  // before returning.
-  // `server` is the Server configuration to use for parsing headers.
-  // If no server configuration is available, callers should pass a
-  // default-constructed `Server` whose defaults indicate unset values.
-  int handleRead(const Server& server);
-  // Check whether the request body is ready/complete based on headers and
-  // any previously parsed Content-Length. Returns `true` when the body is
-  // complete (or no body); returns `false` when more data is required.
-  // In case of a parsing error this will prepare an error response.
-  bool isBodyReady();
-  // Parse start line and headers to populate request/URI and determine
-  // whether the body should be ignored. Returns: 1 = ready to process response,
-  // 0 = wait for more data, 2 = error response prepared.
+  // `vhosts` are the servers of the accepting listener. Header buffer limits
+  // come from its default server; once the head is parsed the request's
+  // server is selected from the Host header into `vhost` and its location
+  // limits are applied before any of the body is read.
+  int handleRead(const VirtualHosts& vhosts);
+  // Move the Content-Length body bytes received so far from read_buffer into
+  // the request body. Returns 1 when the body is complete (or there is no
+  // body), 0 when more data is needed and 2 when an error response was
+  // prepared.
+  int readContentLengthBody();
+  // Check an incomplete or just-completed head of `head_len` bytes against
+  // client_header_buffer_size, borrowing a large buffer from header_pool
+  // once it outgrows that. Returns false if the head exceeds this
+  // connection's large_client_header_buffers (431).
+  bool reserveHeaderBuffer(const Server& server, std::size_t head_len);
+  // Return a borrowed large header buffer to the pool, keeping the contents
+  void releaseHeaderBuffer();
+  // Append decoded body bytes to the request, spooling the body to a temp
+  // file once it grows past body_buffer_size. Returns false on I/O error.
+  bool storeBody(const char* data, std::size_t len);
+  // Decode the chunked body bytes received so far into the request body,
+  // dropping them from read_buffer. Returns 1 when the body is complete,
+  // 0 when more data is needed and 2 when an error response (400/413) was
+  // prepared.
+  int readChunkedBody();
+  // Parse start line and headers into `request`. Prepares 400 and returns
+  // false if they are malformed.
+  bool parseRequestHead();
+  // Determine from the parsed head whether the body should be ignored
+  // (call parseRequestHead() first). Requests with a body are checked
+  // against their location (version, method, framing, max_request_body)
+  // before the body is read, and "Expect: 100-continue" is answered.
+  // Returns: 1 = ready to process response, 0 = wait for more data,
+  // 2 = error response prepared, -1 = connection failed.
   int processParsedHeaders(const Server& server);
-  void startWritePhase();  // Mark the start of write phase
+  // Send the "100 Continue" interim response unless body bytes have already
+  // arrived. Returns 0, or -1 if the socket write failed.
+  int sendContinue();
+  // Mark the start of the write phase, or progress in it
+  void startWritePhase();
   bool isReadTimedOut(
       int timeout_seconds) const;  // Check if read phase timed out
-  bool isWriteTimedOut(
-      int timeout_seconds) const;  // Check if write phase timed out
+  // Check if the write phase made no progress for `timeout_seconds`
+  bool isWriteTimedOut(int timeout_seconds) const;
+  // Send what fits in one turn's SEND_BUDGET_PER_WAKEUP, then let the
+  // active handler stream more within what is left. Returns 1 while there
+  // is more to send, 0 when done and -1 on error.
   int handleWrite();
+  // The sending part of handleWrite(), within the refilled send_quota
+  int sendPending();
+  // True when the response went out before the whole request was read, so
+  // closing right away could reset the connection under the response.
+  bool needsLingeringClose() const;
+  // Shut down the write side and start draining input. Returns false if the
+  // socket could not be half-closed (close it instead).
+  bool startLingeringClose();
+  // Read and drop one batch of input while lingering. Returns 0 to keep
+  // waiting, -1 once the peer closed or LINGERING_DISCARD_LIMIT is reached.
+  int discardInput();
+  bool isLingerTimedOut(int timeout_seconds) const;
   void processRequest(const class Server& server);
   void processResponse(const class Location& location);
   void prepareErrorResponse(http::Status status);
+  // Content coding ("gzip" or "deflate") to send a body of `length` bytes
+  // of `content_type` in, or "" to send it as is: the location has gzip
+  // on, the type is listed, the body is within gzip_min_length and
+  // gzip_max_length, it is not encoded already and the client accepts one.
+  // Adds "Vary: Accept-Encoding" to every response that could have been
+  // compressed.
+  std::string negotiateGzip(const std::string& content_type, off_t length);
+  // Add "Vary: Accept-Encoding" if a body of `length` bytes of
+  // `content_type` could be compressed here, whatever the client accepts.
+  // A 304 or 206 calls this for the 200 it stands for. Returns whether it
+  // could.
+  bool addGzipVary(const std::string& content_type, off_t length);
+  // Compress the in-memory `body` of `response` in place when
+  // negotiateGzip() allows it, adding Content-Encoding and fixing
+  // Content-Length. Returns true if the body was compressed.
+  bool gzipBody(std::string& body);
+  // `fi` (opened from `path`) compressed in `coding`: from the gzip cache,
+  // or read in gzip_buffer_size pieces through the encoder into `scratch`
+  // and cached. NULL if the file is over the location's gzip_max_length or
+  // cannot be read or compressed.
+  const std::string* gzipFile(const std::string& path, const FileInfo& fi,
+                              const std::string& coding,
+                              std::string& scratch);
   // Get the HTTP version from request, defaulting to HTTP/1.1 if not set
   std::string getHttpVersion() const;
   // Validate request version and method for a given location.
@@ -81,6 +195,11 @@ class Connection {
                               std::string& out_path, bool& out_is_directory);
   void setHandler(IHandler* h);
   void clearHandler();
+  // Tell the active handler its client is gone, then delete it
+  void cancelHandler();
+  // True if the peer has closed its side and no unread input is left, i.e.
+  // nothing more of the request can arrive.
+  bool peerClosed() const;
   // Helper to run a handler's start() and perform common error handling.
   // Returns the HandlerResult from the handler.
   HandlerResult executeHandler(IHandler* handler);
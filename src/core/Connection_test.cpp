@@ -17,6 +17,7 @@
 #include <unistd.h>
 
 #include <string>
+#include <vector>
 
 #include "HttpStatus.hpp"
 #include "Location.hpp"
@@ -105,7 +106,7 @@ TEST(ConnectionTests, ActiveHandlerIsNull) {
 TEST(ConnectionTests, AcceptsHttp11Requests) {
   Connection conn;
   conn.request.request_line.version = "HTTP/1.1";
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
 
   Location location;
   location.path = "/";
@@ -121,7 +122,7 @@ TEST(ConnectionTests, AcceptsHttp11Requests) {
 TEST(ConnectionTests, AcceptsHttp10Requests) {
   Connection conn;
   conn.request.request_line.version = "HTTP/1.0";
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
 
   Location location;
   location.path = "/";
@@ -137,7 +138,7 @@ TEST(ConnectionTests, AcceptsHttp10Requests) {
 TEST(ConnectionTests, RejectsOtherHttpVersions) {
   Connection conn;
   conn.request.request_line.version = "HTTP/2.0";
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
 
   Location location;
   location.path = "/";
@@ -152,7 +153,7 @@ TEST(ConnectionTests, RejectsOtherHttpVersions) {
 TEST(ConnectionTests, RejectsInvalidHttpVersions) {
   Connection conn;
   conn.request.request_line.version = "HTTP/1.2";
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
 
   Location location;
   location.path = "/";
@@ -167,7 +168,7 @@ TEST(ConnectionTests, RejectsInvalidHttpVersions) {
 TEST(ConnectionTests, ErrorResponseUsesRequestVersion) {
   Connection conn;
   conn.request.request_line.version = "HTTP/1.0";
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
 
   conn.prepareErrorResponse(http::S_404_NOT_FOUND);
 
@@ -234,7 +235,7 @@ TEST(ConnectionErrorPageTests, CustomErrorPageSuccess) {
   ASSERT_FALSE(custom_path.empty());
   Connection conn;
   // Set up a GET request (FileHandler needs this)
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
   conn.error_pages[http::S_404_NOT_FOUND] = custom_path;
 
   // Use a socketpair so the handler can send headers/body to a real fd
@@ -306,7 +307,7 @@ TEST(ConnectionErrorPageTests, CustomErrorPageSuccess) {
 TEST(ConnectionErrorPageTests, FallbackWhenCustomFileMissing) {
   Connection conn;
   // Set up a GET request
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
   // Point to a non-existent file
   conn.error_pages[http::S_404_NOT_FOUND] = "/nonexistent/path/404.html";
 
@@ -331,7 +332,7 @@ TEST(ConnectionErrorPageTests, FallbackWhenCustomFileMissing) {
 // (The 404 handler would normally trigger another 404 for the missing file)
 TEST(ConnectionErrorPageTests, NoInfiniteRecursionOnMissingErrorPage) {
   Connection conn;
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
   // Set a 404 error page that doesn't exist - this should NOT cause recursion
   conn.error_pages[http::S_404_NOT_FOUND] = "/missing/404.html";
 
@@ -350,7 +351,7 @@ TEST(ConnectionErrorPageTests, ErrorPagesRestoredAfterSuccess) {
   ASSERT_FALSE(custom_path.empty());
 
   Connection conn;
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
   conn.error_pages[http::S_404_NOT_FOUND] = custom_path;
   conn.error_pages[http::S_500_INTERNAL_SERVER_ERROR] = "/other/500.html";
 
@@ -368,7 +369,7 @@ TEST(ConnectionErrorPageTests, ErrorPagesRestoredAfterSuccess) {
 // Test: error_pages is restored after failed custom error page
 TEST(ConnectionErrorPageTests, ErrorPagesRestoredAfterFailure) {
   Connection conn;
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
   conn.error_pages[http::S_404_NOT_FOUND] = "/missing/404.html";
   conn.error_pages[http::S_500_INTERNAL_SERVER_ERROR] = "/other/500.html";
 
@@ -391,7 +392,7 @@ TEST(ConnectionErrorPageTests, DifferentStatusUsesDifferentPage) {
   ASSERT_FALSE(path_500.empty());
 
   Connection conn;
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
   conn.error_pages[http::S_404_NOT_FOUND] = path_404;
   conn.error_pages[http::S_500_INTERNAL_SERVER_ERROR] = path_500;
 
@@ -413,7 +414,7 @@ TEST(ConnectionErrorPageTests, UnconfiguredStatusUsesDefault) {
   ASSERT_FALSE(path_404.empty());
 
   Connection conn;
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
   conn.error_pages[http::S_404_NOT_FOUND] = path_404;
 
   // Request 403 error (not configured)
@@ -1033,13 +1034,45 @@ TEST(ConnectionTimeout, WriteTimeoutWithEmptyWriteBufferShouldStillTimeout) {
   EXPECT_TRUE(conn.isWriteTimedOut(WRITE_TIMEOUT_SECONDS));
 }
 
+TEST(ConnectionTimeout, HandleWriteStartsWritePhase) {
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+  Connection conn(sv[1]);
+  conn.write_buffer = "HTTP/1.1 200 OK\r\n\r\n";
+  EXPECT_EQ(conn.handleWrite(), 0);
+  EXPECT_GT(conn.write_start, 0);
+  close(sv[0]);
+  close(sv[1]);
+}
+
+TEST(ConnectionTimeout, WriteTimeoutCountsIdleTimeOnly) {
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+  Connection conn(sv[1]);
+  conn.write_buffer = std::string(16 * 1024 * 1024, 'x');
+
+  // Sending for long is fine as long as the response moves
+  conn.write_start = time(NULL) - 60;
+  EXPECT_EQ(conn.handleWrite(), 1);
+  EXPECT_FALSE(conn.isWriteTimedOut(WRITE_TIMEOUT_SECONDS));
+
+  // The peer stopped reading: the socket is full and nothing goes out
+  while (conn.handleWrite() == 1 && conn.send_quota.sent > 0) {
+  }
+  conn.write_start = time(NULL) - 60;
+  EXPECT_EQ(conn.handleWrite(), 1);
+  EXPECT_TRUE(conn.isWriteTimedOut(WRITE_TIMEOUT_SECONDS));
+  close(sv[0]);
+  close(sv[1]);
+}
+
 // =============================================================================
 // Max Request Body Validation Tests
 // =============================================================================
 
 TEST(MaxRequestBodyValidation, BodyExceedsLimitReturns413) {
   Connection conn;
-  conn.request.request_line.method = "POST";
+  conn.request.request_line.method = http::POST;
   conn.request.request_line.uri = "/upload";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = std::string(1000, 'X');  // 1000 bytes body
@@ -1057,7 +1090,7 @@ TEST(MaxRequestBodyValidation, BodyExceedsLimitReturns413) {
 
 TEST(MaxRequestBodyValidation, BodyExceedsLimitByOne) {
   Connection conn;
-  conn.request.request_line.method = "POST";
+  conn.request.request_line.method = http::POST;
   conn.request.request_line.uri = "/upload";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = std::string(101, 'X');  // 101 bytes
@@ -1076,7 +1109,7 @@ TEST(MaxRequestBodyValidation, BodyExceedsLimitByOne) {
 
 TEST(MaxRequestBodyValidation, BodyExactlyAtLimitIsAllowed) {
   Connection conn;
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
   conn.request.request_line.uri = "/";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = std::string(100, 'X');  // Exactly 100 bytes
@@ -1092,7 +1125,7 @@ TEST(MaxRequestBodyValidation, BodyExactlyAtLimitIsAllowed) {
 
 TEST(MaxRequestBodyValidation, BodyBelowLimitIsAllowed) {
   Connection conn;
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
   conn.request.request_line.uri = "/";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = std::string(50, 'X');  // 50 bytes
@@ -1112,7 +1145,7 @@ TEST(MaxRequestBodyValidation, BodyBelowLimitIsAllowed) {
 
 TEST(MaxRequestBodyValidation, EmptyBodyIsAllowed) {
   Connection conn;
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
   conn.request.request_line.uri = "/";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = "";  // Empty body
@@ -1127,7 +1160,7 @@ TEST(MaxRequestBodyValidation, EmptyBodyIsAllowed) {
 
 TEST(MaxRequestBodyValidation, EmptyBodyWithZeroLimitIsAllowed) {
   Connection conn;
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
   conn.request.request_line.uri = "/";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = "";  // Empty body
@@ -1148,7 +1181,7 @@ TEST(MaxRequestBodyValidation, EmptyBodyWithZeroLimitIsAllowed) {
 
 TEST(MaxRequestBodyValidation, ZeroLimitRejectsNonEmptyBody) {
   Connection conn;
-  conn.request.request_line.method = "POST";
+  conn.request.request_line.method = http::POST;
   conn.request.request_line.uri = "/";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = "x";  // 1 byte body
@@ -1168,7 +1201,7 @@ TEST(MaxRequestBodyValidation, ZeroLimitRejectsNonEmptyBody) {
 
 TEST(MaxRequestBodyValidation, UnsetLimitAllowsAnyBodySize) {
   Connection conn;
-  conn.request.request_line.method = "POST";
+  conn.request.request_line.method = http::POST;
   conn.request.request_line.uri = "/";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = std::string(1000000, 'X');  // 1MB body
@@ -1188,7 +1221,7 @@ TEST(MaxRequestBodyValidation, UnsetLimitAllowsAnyBodySize) {
 
 TEST(MaxRequestBodyValidation, LargeBodyWithLargeLimitIsAllowed) {
   Connection conn;
-  conn.request.request_line.method = "POST";
+  conn.request.request_line.method = http::POST;
   conn.request.request_line.uri = "/";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = std::string(10000, 'X');  // 10KB body
@@ -1203,7 +1236,7 @@ TEST(MaxRequestBodyValidation, LargeBodyWithLargeLimitIsAllowed) {
 
 TEST(MaxRequestBodyValidation, LargeBodyExceedsLargeLimit) {
   Connection conn;
-  conn.request.request_line.method = "POST";
+  conn.request.request_line.method = http::POST;
   conn.request.request_line.uri = "/upload";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = std::string(2000000, 'X');  // 2MB body
@@ -1222,7 +1255,7 @@ TEST(MaxRequestBodyValidation, LargeBodyExceedsLargeLimit) {
 
 TEST(MaxRequestBodyValidation, PostMethodWithExcessiveBody) {
   Connection conn;
-  conn.request.request_line.method = "POST";
+  conn.request.request_line.method = http::POST;
   conn.request.request_line.uri = "/api/data";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = std::string(200, 'X');
@@ -1237,7 +1270,7 @@ TEST(MaxRequestBodyValidation, PostMethodWithExcessiveBody) {
 
 TEST(MaxRequestBodyValidation, PutMethodWithExcessiveBody) {
   Connection conn;
-  conn.request.request_line.method = "PUT";
+  conn.request.request_line.method = http::PUT;
   conn.request.request_line.uri = "/files/test.txt";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = std::string(500, 'X');
@@ -1254,7 +1287,7 @@ TEST(MaxRequestBodyValidation, PutMethodWithExcessiveBody) {
 TEST(MaxRequestBodyValidation, GetMethodWithExcessiveBody) {
   // GET requests can technically have a body (though uncommon)
   Connection conn;
-  conn.request.request_line.method = "GET";
+  conn.request.request_line.method = http::GET;
   conn.request.request_line.uri = "/search";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = std::string(200, 'X');
@@ -1273,7 +1306,7 @@ TEST(MaxRequestBodyValidation, GetMethodWithExcessiveBody) {
 
 TEST(MaxRequestBodyValidation, Response413HasCorrectReasonPhrase) {
   Connection conn;
-  conn.request.request_line.method = "POST";
+  conn.request.request_line.method = http::POST;
   conn.request.request_line.uri = "/upload";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = std::string(1000, 'X');
@@ -1287,7 +1320,7 @@ TEST(MaxRequestBodyValidation, Response413HasCorrectReasonPhrase) {
 
 TEST(MaxRequestBodyValidation, Response413HasHtmlBody) {
   Connection conn;
-  conn.request.request_line.method = "POST";
+  conn.request.request_line.method = http::POST;
   conn.request.request_line.uri = "/upload";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = std::string(1000, 'X');
@@ -1309,7 +1342,7 @@ TEST(MaxRequestBodyValidation, Response413HasHtmlBody) {
 TEST(MaxRequestBodyValidation, BodyCheckHappensEarlyInProcessing) {
   // Even if the path doesn't exist, we should get 413 first
   Connection conn;
-  conn.request.request_line.method = "POST";
+  conn.request.request_line.method = http::POST;
   conn.request.request_line.uri = "/nonexistent/path/that/does/not/exist";
   conn.request.request_line.version = "HTTP/1.1";
   conn.request.getBody().data = std::string(1000, 'X');
@@ -1322,3 +1355,573 @@ TEST(MaxRequestBodyValidation, BodyCheckHappensEarlyInProcessing) {
   EXPECT_EQ(conn.response.status_line.status_code,
             http::S_413_PAYLOAD_TOO_LARGE);
 }
+
+// =============================================================================
+// Test: Transfer-Encoding: chunked request bodies
+// =============================================================================
+
+// Helper: Server with a single "/" location limited to `max_body` bytes
+static Server createServerWithMaxBody(std::size_t max_body) {
+  Server srv;
+  srv.locations["/"] = createLocationWithMaxBody(max_body);
+  srv.compileLocations();
+  return srv;
+}
+
+// Helper: load `head` into the connection and run header processing
+static int parseHead(Connection& conn, const Server& srv,
+                     const std::string& head) {
+  conn.read_buffer = head;
+  conn.headers_end_pos = conn.read_buffer.find("\r\n\r\n");
+  if (!conn.parseRequestHead()) {
+    return 2;
+  }
+  return conn.processParsedHeaders(srv);
+}
+
+TEST(ChunkedRequestBody, ChunkedPostIsAcceptedWithoutContentLength) {
+  Connection conn;
+  Server srv = createServerWithMaxBody(1024);
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n";
+  EXPECT_EQ(parseHead(conn, srv, head), 0);
+  EXPECT_TRUE(conn.body_chunked);
+  EXPECT_TRUE(conn.write_buffer.empty());
+}
+
+TEST(ChunkedRequestBody, BodyIsDecodedAsItArrives) {
+  Connection conn;
+  Server srv = createServerWithMaxBody(1024);
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n";
+  ASSERT_EQ(parseHead(conn, srv, head), 0);
+
+  conn.read_buffer += "5;ext=1\r\nhello\r\n6\r\n wor";
+  EXPECT_EQ(conn.readChunkedBody(), 0);
+  EXPECT_EQ(conn.request.getBody().data, "hello wor");
+  // Decoded bytes are dropped from the read buffer
+  EXPECT_EQ(conn.read_buffer, head);
+
+  conn.read_buffer += "ld\r\n0\r\nX-Trailer: 1\r\n\r\n";
+  EXPECT_EQ(conn.readChunkedBody(), 1);
+  EXPECT_EQ(conn.request.getBody().data, "hello world");
+}
+
+TEST(ChunkedRequestBody, OversizedChunkIsRejectedWith413) {
+  Connection conn;
+  Server srv = createServerWithMaxBody(10);
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n";
+  ASSERT_EQ(parseHead(conn, srv, head), 0);
+
+  conn.read_buffer += "400\r\n";
+  EXPECT_EQ(conn.readChunkedBody(), 2);
+  EXPECT_EQ(conn.response.status_line.status_code,
+            http::S_413_PAYLOAD_TOO_LARGE);
+}
+
+TEST(ChunkedRequestBody, MalformedChunkIsRejectedWith400) {
+  Connection conn;
+  Server srv = createServerWithMaxBody(1024);
+  std::string head =
+      "POST /file HTTP/1.1\r\nHost: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n";
+  ASSERT_EQ(parseHead(conn, srv, head), 0);
+
+  conn.read_buffer += "nothex\r\n";
+  EXPECT_EQ(conn.readChunkedBody(), 2);
+  EXPECT_EQ(conn.response.status_line.status_code, http::S_400_BAD_REQUEST);
+}
+
+TEST(ChunkedRequestBody, ContentLengthWithTransferEncodingIsRejected) {
+  Connection conn;
+  Server srv = createServerWithMaxBody(1024);
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n";
+  EXPECT_EQ(parseHead(conn, srv, head), 2);
+  EXPECT_EQ(conn.response.status_line.status_code, http::S_400_BAD_REQUEST);
+}
+
+TEST(ChunkedRequestBody, UnsupportedTransferCodingIsNotImplemented) {
+  Connection conn;
+  Server srv = createServerWithMaxBody(1024);
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+      "Transfer-Encoding: gzip, chunked\r\n\r\n";
+  EXPECT_EQ(parseHead(conn, srv, head), 2);
+  EXPECT_EQ(conn.response.status_line.status_code,
+            http::S_501_NOT_IMPLEMENTED);
+}
+
+TEST(ChunkedRequestBody, ChunkedMustBeTheFinalCoding) {
+  Connection conn;
+  Server srv = createServerWithMaxBody(1024);
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+      "Transfer-Encoding: chunked, gzip\r\n\r\n";
+  EXPECT_EQ(parseHead(conn, srv, head), 2);
+  EXPECT_EQ(conn.response.status_line.status_code, http::S_400_BAD_REQUEST);
+}
+
+TEST(ChunkedRequestBody, MissingFramingStillRequiresLength) {
+  Connection conn;
+  Server srv = createServerWithMaxBody(1024);
+  std::string head = "POST /upload HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  EXPECT_EQ(parseHead(conn, srv, head), 2);
+  EXPECT_EQ(conn.response.status_line.status_code,
+            http::S_411_LENGTH_REQUIRED);
+}
+
+// =============================================================================
+// Test: Request bodies over client_body_buffer_size are spooled to disk
+// =============================================================================
+
+TEST(RequestBodySpooling, SmallBodyStaysInMemory) {
+  Connection conn;
+  Server srv = createServerWithMaxBody(1024);
+  srv.locations["/"].client_body_buffer_size = 16;
+  srv.compileLocations();
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n\r\n";
+  ASSERT_EQ(parseHead(conn, srv, head), 0);
+
+  conn.read_buffer += "hello";
+  EXPECT_EQ(conn.readContentLengthBody(), 1);
+  EXPECT_FALSE(conn.request.getBody().isSpooled());
+  EXPECT_EQ(conn.request.getBody().data, "hello");
+}
+
+TEST(RequestBodySpooling, LargeBodyIsSpooledAsItArrives) {
+  Connection conn;
+  Server srv = createServerWithMaxBody(1024);
+  srv.locations["/"].client_body_buffer_size = 16;
+  srv.compileLocations();
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\nContent-Length: 40\r\n\r\n";
+  ASSERT_EQ(parseHead(conn, srv, head), 0);
+
+  conn.read_buffer += std::string(10, 'a');
+  EXPECT_EQ(conn.readContentLengthBody(), 0);
+  EXPECT_FALSE(conn.request.getBody().isSpooled());
+
+  conn.read_buffer += std::string(30, 'b');
+  EXPECT_EQ(conn.readContentLengthBody(), 1);
+  const Body& body = conn.request.getBody();
+  ASSERT_TRUE(body.isSpooled());
+  EXPECT_TRUE(body.data.empty());
+  EXPECT_EQ(body.size(), 40u);
+  // Body bytes do not linger in the read buffer
+  EXPECT_EQ(conn.read_buffer, head);
+
+  std::string on_disk(40, '\0');
+  EXPECT_EQ(pread(body.fd, &on_disk[0], on_disk.size(), 0), 40);
+  EXPECT_EQ(on_disk, std::string(10, 'a') + std::string(30, 'b'));
+}
+
+TEST(RequestBodySpooling, ChunkedBodyIsSpooledToo) {
+  Connection conn;
+  Server srv = createServerWithMaxBody(1024);
+  srv.locations["/"].client_body_buffer_size = 4;
+  srv.compileLocations();
+  std::string head =
+      "POST /file HTTP/1.1\r\nHost: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n";
+  ASSERT_EQ(parseHead(conn, srv, head), 0);
+
+  conn.read_buffer += "3\r\nabc\r\n5\r\ndefgh\r\n0\r\n\r\n";
+  EXPECT_EQ(conn.readChunkedBody(), 1);
+  EXPECT_TRUE(conn.request.getBody().isSpooled());
+  EXPECT_EQ(conn.request.getBody().size(), 8u);
+}
+
+// Helper: read whatever the server side has written to the peer socket
+static std::string drainPeer(int peer) {
+  std::string out;
+  char buf[256];
+  ssize_t n;
+  while ((n = recv(peer, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+    out.append(buf, n);
+  }
+  return out;
+}
+
+class ExpectContinue : public ::testing::Test {
+ protected:
+  void SetUp() {
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv_), 0);
+    conn_.fd = sv_[1];
+    srv_ = createServerWithMaxBody(100);
+  }
+  void TearDown() {
+    close(sv_[0]);
+    close(sv_[1]);
+  }
+
+  int sv_[2];
+  Connection conn_;
+  Server srv_;
+};
+
+TEST_F(ExpectContinue, ValidRequestGets100Continue) {
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+      "Content-Length: 10\r\nExpect: 100-Continue\r\n\r\n";
+  EXPECT_EQ(parseHead(conn_, srv_, head), 0);
+  EXPECT_EQ(drainPeer(sv_[0]), "HTTP/1.1 100 Continue\r\n\r\n");
+  // The interim response is not part of the final response
+  EXPECT_TRUE(conn_.write_buffer.empty());
+}
+
+TEST_F(ExpectContinue, ChunkedRequestGets100Continue) {
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+      "Transfer-Encoding: chunked\r\nExpect: 100-continue\r\n\r\n";
+  EXPECT_EQ(parseHead(conn_, srv_, head), 0);
+  EXPECT_EQ(drainPeer(sv_[0]), "HTTP/1.1 100 Continue\r\n\r\n");
+}
+
+TEST_F(ExpectContinue, OversizedBodyIsRejectedWithoutContinue) {
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+      "Content-Length: 101\r\nExpect: 100-continue\r\n\r\n";
+  EXPECT_EQ(parseHead(conn_, srv_, head), 2);
+  EXPECT_EQ(conn_.response.status_line.status_code,
+            http::S_413_PAYLOAD_TOO_LARGE);
+  EXPECT_TRUE(drainPeer(sv_[0]).empty());
+}
+
+TEST_F(ExpectContinue, DisallowedMethodIsRejectedBeforeBody) {
+  std::string head =
+      "PUT /file HTTP/1.1\r\nHost: localhost\r\n"
+      "Content-Length: 10\r\nExpect: 100-continue\r\n\r\n";
+  EXPECT_EQ(parseHead(conn_, srv_, head), 2);
+  EXPECT_EQ(conn_.response.status_line.status_code,
+            http::S_405_METHOD_NOT_ALLOWED);
+  EXPECT_TRUE(drainPeer(sv_[0]).empty());
+}
+
+TEST_F(ExpectContinue, MissingLengthIsRejectedWithoutContinue) {
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+      "Expect: 100-continue\r\n\r\n";
+  EXPECT_EQ(parseHead(conn_, srv_, head), 2);
+  EXPECT_EQ(conn_.response.status_line.status_code,
+            http::S_411_LENGTH_REQUIRED);
+  EXPECT_TRUE(drainPeer(sv_[0]).empty());
+}
+
+TEST_F(ExpectContinue, UnknownExpectationIsRejectedWith417) {
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+      "Content-Length: 10\r\nExpect: something-else\r\n\r\n";
+  EXPECT_EQ(parseHead(conn_, srv_, head), 2);
+  EXPECT_EQ(conn_.response.status_line.status_code,
+            http::S_417_EXPECTATION_FAILED);
+  EXPECT_TRUE(drainPeer(sv_[0]).empty());
+}
+
+TEST_F(ExpectContinue, NoContinueOnceBodyHasArrived) {
+  std::string head =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+      "Content-Length: 4\r\nExpect: 100-continue\r\n\r\n";
+  EXPECT_EQ(parseHead(conn_, srv_, head + "da"), 0);
+  EXPECT_TRUE(drainPeer(sv_[0]).empty());
+}
+
+TEST_F(ExpectContinue, NoContinueForHttp10OrEmptyBody) {
+  std::string head10 =
+      "POST /upload HTTP/1.0\r\nHost: localhost\r\n"
+      "Content-Length: 4\r\nExpect: 100-continue\r\n\r\n";
+  EXPECT_EQ(parseHead(conn_, srv_, head10), 0);
+  EXPECT_TRUE(drainPeer(sv_[0]).empty());
+
+  Connection empty;
+  empty.fd = sv_[1];
+  std::string head_empty =
+      "POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+      "Content-Length: 0\r\nExpect: 100-continue\r\n\r\n";
+  EXPECT_NE(parseHead(empty, srv_, head_empty), 2);
+  EXPECT_TRUE(drainPeer(sv_[0]).empty());
+}
+
+// Helper: a server with small header buffer limits for the tests below
+static Server createServerWithHeaderBuffers(std::size_t small,
+                                            std::size_t large) {
+  Server srv = createServerWithMaxBody(1024);
+  srv.client_header_buffer_size = small;
+  srv.large_client_header_buffers = 1;
+  srv.large_client_header_buffer_size = large;
+  return srv;
+}
+
+TEST(HeaderBuffers, SmallHeadNeedsNoLargeBuffer) {
+  Server srv = createServerWithHeaderBuffers(64, 256);
+  HeaderBufferPool pool(1, 256);
+  Connection conn;
+  conn.header_pool = &pool;
+  conn.read_buffer = std::string(64, 'h');
+  EXPECT_TRUE(conn.reserveHeaderBuffer(srv, conn.read_buffer.size()));
+  EXPECT_FALSE(conn.header_buffer_borrowed);
+  EXPECT_EQ(pool.inUse(), 0u);
+}
+
+TEST(HeaderBuffers, LargeHeadBorrowsAndReturnsBuffer) {
+  Server srv = createServerWithHeaderBuffers(64, 256);
+  HeaderBufferPool pool(1, 256);
+  Connection conn;
+  conn.header_pool = &pool;
+  conn.read_buffer = std::string(100, 'h');
+  EXPECT_TRUE(conn.reserveHeaderBuffer(srv, conn.read_buffer.size()));
+  EXPECT_TRUE(conn.header_buffer_borrowed);
+  EXPECT_EQ(pool.inUse(), 1u);
+  EXPECT_EQ(conn.read_buffer, std::string(100, 'h'));
+
+  // Growing within the borrowed buffer needs no second one
+  conn.read_buffer += std::string(100, 'h');
+  EXPECT_TRUE(conn.reserveHeaderBuffer(srv, conn.read_buffer.size()));
+  EXPECT_EQ(pool.inUse(), 1u);
+
+  conn.releaseHeaderBuffer();
+  EXPECT_FALSE(conn.header_buffer_borrowed);
+  EXPECT_EQ(pool.inUse(), 0u);
+  EXPECT_EQ(conn.read_buffer, std::string(200, 'h'));
+}
+
+TEST(HeaderBuffers, HeadOverLargeBufferIsRejected) {
+  Server srv = createServerWithHeaderBuffers(64, 256);
+  HeaderBufferPool pool(1, 256);
+  Connection conn;
+  conn.header_pool = &pool;
+  EXPECT_FALSE(conn.reserveHeaderBuffer(srv, 257));
+  EXPECT_EQ(pool.inUse(), 0u);
+}
+
+TEST(HeaderBuffers, SlowHeadsDoNotStarveOtherConnections) {
+  Server srv = createServerWithHeaderBuffers(64, 256);
+  HeaderBufferPool pool(1, 256);
+  // More connections hold a partial large head than there are buffers
+  std::vector<Connection> slow(srv.large_client_header_buffers + 1);
+  for (std::size_t i = 0; i < slow.size(); ++i) {
+    slow[i].header_pool = &pool;
+    slow[i].read_buffer = std::string(100, 'h');
+    ASSERT_TRUE(slow[i].reserveHeaderBuffer(srv, 100));
+  }
+  Connection next;
+  next.header_pool = &pool;
+  next.read_buffer = std::string(100, 'h');
+  EXPECT_TRUE(next.reserveHeaderBuffer(srv, 100));
+  EXPECT_EQ(pool.inUse(), slow.size() + 1);
+  for (std::size_t i = 0; i < slow.size(); ++i) {
+    slow[i].releaseHeaderBuffer();
+  }
+}
+
+TEST(HeaderBuffers, HeadMayUseAllBuffersOfTheConnection) {
+  Server srv = createServerWithHeaderBuffers(64, 256);
+  srv.large_client_header_buffers = 2;
+  HeaderBufferPool pool(2, 256);
+  Connection conn;
+  conn.header_pool = &pool;
+  std::string line = std::string(200, 'h') + "\r\n";
+  conn.read_buffer = line + line;
+  EXPECT_TRUE(conn.reserveHeaderBuffer(srv, conn.read_buffer.size()));
+  conn.read_buffer += line;
+  EXPECT_FALSE(conn.reserveHeaderBuffer(srv, conn.read_buffer.size()));
+}
+
+TEST(HeaderBuffers, LineOverLargeBufferIsRejected) {
+  Server srv = createServerWithHeaderBuffers(64, 256);
+  srv.large_client_header_buffers = 4;
+  HeaderBufferPool pool(4, 256);
+  Connection conn;
+  conn.header_pool = &pool;
+  // Still unterminated: the line being read counts too
+  conn.read_buffer = "GET / HTTP/1.1\r\nX-Big: " + std::string(300, 'v');
+  EXPECT_FALSE(conn.reserveHeaderBuffer(srv, conn.read_buffer.size()));
+}
+
+TEST(HeaderBuffers, DestroyedConnectionReturnsItsBuffer) {
+  Server srv = createServerWithHeaderBuffers(64, 256);
+  HeaderBufferPool pool(1, 256);
+  {
+    Connection conn;
+    conn.header_pool = &pool;
+    ASSERT_TRUE(conn.reserveHeaderBuffer(srv, 100));
+    // A copy does not share the lease
+    Connection copy(conn);
+    EXPECT_FALSE(copy.header_buffer_borrowed);
+  }
+  EXPECT_EQ(pool.inUse(), 0u);
+}
+
+TEST(HeaderBuffers, OversizedHeadIsAnsweredWith431) {
+  VirtualHosts vhosts;
+  vhosts.add(createServerWithHeaderBuffers(64, 256));
+  HeaderBufferPool pool(1, 256);
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+  Connection conn(sv[1]);
+  conn.header_pool = &pool;
+
+  std::string head = "GET / HTTP/1.1\r\nX-Big: " + std::string(300, 'v');
+  ASSERT_EQ(send(sv[0], head.data(), head.size(), 0),
+            static_cast<ssize_t>(head.size()));
+  EXPECT_EQ(conn.handleRead(vhosts), 2);
+  EXPECT_EQ(conn.response.status_line.status_code,
+            http::S_431_REQUEST_HEADER_FIELDS_TOO_LARGE);
+  conn.clearHandler();
+  close(sv[0]);
+  close(sv[1]);
+}
+
+// ==================== Virtual host selection ====================
+
+// Read `head` through handleRead on a socket pair and return the server
+// the connection picked
+static const Server* readHeadForVhost(const VirtualHosts& vhosts,
+                                      const std::string& head) {
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+    return NULL;
+  }
+  Connection conn(sv[1]);
+  send(sv[0], head.data(), head.size(), 0);
+  int status = conn.handleRead(vhosts);
+  close(sv[0]);
+  close(sv[1]);
+  return status == 1 ? conn.vhost : NULL;
+}
+
+TEST(VirtualHostSelection, HostHeaderPicksTheServer) {
+  Server a;
+  a.server_names.push_back("a.example");
+  Server b;
+  b.server_names.push_back("b.example");
+  VirtualHosts vhosts;
+  vhosts.add(a);
+  vhosts.add(b);
+
+  const Server* s = readHeadForVhost(
+      vhosts, "GET / HTTP/1.1\r\nHost: B.example:8080\r\n\r\n");
+  ASSERT_TRUE(s != NULL);
+  EXPECT_EQ(s->server_names[0], "b.example");
+}
+
+TEST(VirtualHostSelection, MissingHostUsesTheDefaultServer) {
+  Server a;
+  a.server_names.push_back("a.example");
+  Server b;
+  b.server_names.push_back("b.example");
+  b.default_server = true;
+  VirtualHosts vhosts;
+  vhosts.add(a);
+  vhosts.add(b);
+
+  const Server* s = readHeadForVhost(vhosts, "GET / HTTP/1.0\r\n\r\n");
+  ASSERT_TRUE(s != NULL);
+  EXPECT_EQ(s->server_names[0], "b.example");
+}
+
+TEST(LingeringClose, OnlyNeededWhenRequestWasNotFullyRead) {
+  Connection conn;
+  EXPECT_TRUE(conn.needsLingeringClose());
+  conn.request_complete = true;
+  EXPECT_FALSE(conn.needsLingeringClose());
+}
+
+TEST(LingeringClose, HalfClosesAndDiscardsUntilPeerCloses) {
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+  Connection conn(sv[1]);
+  conn.read_buffer = "POST / HTTP/1.1\r\nContent-Length: 100\r\n\r\n";
+  ASSERT_TRUE(conn.startLingeringClose());
+  EXPECT_TRUE(conn.lingering);
+  EXPECT_TRUE(conn.read_buffer.empty());
+
+  // The peer sees end-of-stream after the response
+  char c;
+  EXPECT_EQ(recv(sv[0], &c, 1, 0), 0);
+
+  // Body bytes still in flight are read and dropped
+  ASSERT_EQ(send(sv[0], "abcdef", 6, 0), 6);
+  EXPECT_EQ(conn.discardInput(), 0);
+  EXPECT_EQ(conn.linger_discarded, 6u);
+  EXPECT_TRUE(conn.read_buffer.empty());
+
+  close(sv[0]);
+  EXPECT_EQ(conn.discardInput(), -1);
+  close(sv[1]);
+}
+
+TEST(LingeringClose, StopsAtDiscardLimit) {
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+  Connection conn(sv[1]);
+  ASSERT_TRUE(conn.startLingeringClose());
+  conn.linger_discarded = LINGERING_DISCARD_LIMIT - 2;
+  ASSERT_EQ(send(sv[0], "xy", 2, 0), 2);
+  EXPECT_EQ(conn.discardInput(), -1);
+  close(sv[0]);
+  close(sv[1]);
+}
+
+TEST(LingeringClose, IsBoundedInTime) {
+  Connection conn;
+  EXPECT_FALSE(conn.isLingerTimedOut(0));
+  conn.lingering = true;
+  conn.linger_start = time(NULL);
+  EXPECT_FALSE(conn.isLingerTimedOut(LINGERING_TIME_SECONDS));
+  conn.linger_start = time(NULL) - LINGERING_TIME_SECONDS;
+  EXPECT_TRUE(conn.isLingerTimedOut(LINGERING_TIME_SECONDS));
+}
+
+// Handler that records whether it was cancelled
+class CancelRecordingHandler : public IHandler {
+ public:
+  explicit CancelRecordingHandler(bool* cancelled) : cancelled_(cancelled) {}
+  virtual HandlerResult start(Connection&) { return HR_WOULD_BLOCK; }
+  virtual HandlerResult resume(Connection&) { return HR_WOULD_BLOCK; }
+  virtual void cancel(Connection&) { *cancelled_ = true; }
+
+ private:
+  bool* cancelled_;
+};
+
+TEST(ClientAbort, CancelHandlerNotifiesAndDeletesHandler) {
+  bool cancelled = false;
+  Connection conn;
+  conn.setHandler(new CancelRecordingHandler(&cancelled));
+  conn.cancelHandler();
+  EXPECT_TRUE(cancelled);
+  EXPECT_TRUE(conn.active_handler == NULL);
+}
+
+TEST(ClientAbort, ClearHandlerDoesNotCancel) {
+  bool cancelled = false;
+  Connection conn;
+  conn.setHandler(new CancelRecordingHandler(&cancelled));
+  conn.clearHandler();
+  EXPECT_FALSE(cancelled);
+}
+
+TEST(ClientAbort, PeerClosedOnlyOnceInputIsDrained) {
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+  Connection conn(sv[1]);
+  EXPECT_FALSE(conn.peerClosed());
+
+  ASSERT_EQ(send(sv[0], "GET", 3, 0), 3);
+  shutdown(sv[0], SHUT_WR);
+  // Unread request bytes are still pending
+  EXPECT_FALSE(conn.peerClosed());
+
+  char buf[8];
+  ASSERT_EQ(recv(sv[1], buf, sizeof(buf), 0), 3);
+  EXPECT_TRUE(conn.peerClosed());
+  close(sv[0]);
+  close(sv[1]);
+}
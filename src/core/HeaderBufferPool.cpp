@@ -0,0 +1,72 @@
+#include "HeaderBufferPool.hpp"
+
+HeaderBufferPool::HeaderBufferPool()
+    : max_idle_(0), buffer_size_(0), in_use_(0), free_() {}
+
+HeaderBufferPool::HeaderBufferPool(std::size_t max_idle,
+                                   std::size_t buffer_size)
+    : max_idle_(max_idle), buffer_size_(buffer_size), in_use_(0), free_() {}
+
+HeaderBufferPool::HeaderBufferPool(const HeaderBufferPool& other)
+    : max_idle_(other.max_idle_),
+      buffer_size_(other.buffer_size_),
+      in_use_(0),
+      free_() {}
+
+// Only the configuration is copied: lent buffers belong to the source pool.
+HeaderBufferPool& HeaderBufferPool::operator=(const HeaderBufferPool& other) {
+  if (this != &other) {
+    max_idle_ = other.max_idle_;
+    buffer_size_ = other.buffer_size_;
+    in_use_ = 0;
+    free_.clear();
+  }
+  return *this;
+}
+
+HeaderBufferPool::~HeaderBufferPool() {}
+
+void HeaderBufferPool::acquire(std::string& buf) {
+  std::string large;
+  if (!free_.empty()) {
+    large.swap(free_.back());
+    free_.pop_back();
+  } else {
+    large.reserve(buffer_size_);
+  }
+  large.assign(buf);
+  buf.swap(large);
+  ++in_use_;
+}
+
+void HeaderBufferPool::release(std::string& buf) {
+  std::string small(buf);
+  buf.swap(small);
+  // `small` now holds the large buffer; clear() keeps its capacity
+  small.clear();
+  if (in_use_ > 0) {
+    --in_use_;
+  }
+  // A buffer that grew past buffer_size_ is freed so the idle buffers never
+  // hold more than max_idle_ * buffer_size_ bytes
+  if (free_.size() < max_idle_ && small.capacity() <= buffer_size_) {
+    free_.push_back(std::string());
+    free_.back().swap(small);
+  }
+}
+
+std::size_t HeaderBufferPool::bufferSize() const {
+  return buffer_size_;
+}
+
+std::size_t HeaderBufferPool::maxIdle() const {
+  return max_idle_;
+}
+
+std::size_t HeaderBufferPool::inUse() const {
+  return in_use_;
+}
+
+std::size_t HeaderBufferPool::idle() const {
+  return free_.size();
+}
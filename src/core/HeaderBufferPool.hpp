@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Free list of large request-header buffers kept by one listening socket
+// ("large_client_header_buffers <number> <size>").
+//
+// A connection reads its request head into an ordinary small buffer and
+// only borrows a large one when the head outgrows client_header_buffer_size.
+// Buffers are swapped in and out of the connection's std::string so their
+// capacity is reused instead of being reallocated per request. Lending never
+// fails: how much of a head one connection may hold is limited per
+// connection (see Connection::reserveHeaderBuffer), so slow clients cannot
+// starve the others. At most `maxIdle()` returned buffers of `bufferSize()`
+// bytes are kept; buffers that grew past that size are freed on return.
+class HeaderBufferPool {
+ public:
+  HeaderBufferPool();
+  HeaderBufferPool(std::size_t max_idle, std::size_t buffer_size);
+  HeaderBufferPool(const HeaderBufferPool& other);
+  HeaderBufferPool& operator=(const HeaderBufferPool& other);
+  ~HeaderBufferPool();
+
+  // Swap a large buffer into `buf`, keeping its contents
+  void acquire(std::string& buf);
+  // Move the contents of `buf` into a right-sized string and take the large
+  // buffer back. Must only be called for a buffer obtained from acquire().
+  void release(std::string& buf);
+
+  std::size_t bufferSize() const;
+  std::size_t maxIdle() const;
+  std::size_t inUse() const;
+  std::size_t idle() const;
+
+ private:
+  std::size_t max_idle_;
+  std::size_t buffer_size_;
+  std::size_t in_use_;
+  // Returned buffers, cleared but with their capacity kept
+  std::vector<std::string> free_;
+};
@@ -0,0 +1,77 @@
+#include "HeaderBufferPool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(HeaderBufferPoolTests, AcquireKeepsContentsAndReservesBufferSize) {
+  HeaderBufferPool pool(2, 8192);
+  std::string buf = "GET / HTTP/1.1\r\n";
+  pool.acquire(buf);
+  EXPECT_EQ(buf, "GET / HTTP/1.1\r\n");
+  EXPECT_GE(buf.capacity(), 8192u);
+  EXPECT_EQ(pool.inUse(), 1u);
+}
+
+TEST(HeaderBufferPoolTests, AcquireNeverRunsOut) {
+  HeaderBufferPool pool(2, 1024);
+  std::string bufs[3] = {"a", "b", "c"};
+  for (int i = 0; i < 3; ++i) {
+    pool.acquire(bufs[i]);
+  }
+  EXPECT_EQ(bufs[2], "c");
+  EXPECT_EQ(pool.inUse(), 3u);
+
+  // Only max_idle of them are kept once returned
+  for (int i = 0; i < 3; ++i) {
+    pool.release(bufs[i]);
+  }
+  EXPECT_EQ(pool.inUse(), 0u);
+  EXPECT_EQ(pool.idle(), 2u);
+}
+
+TEST(HeaderBufferPoolTests, GrownBufferIsNotKept) {
+  HeaderBufferPool pool(1, 256);
+  std::string buf = "x";
+  pool.acquire(buf);
+  buf += std::string(1024, 'y');
+  pool.release(buf);
+  EXPECT_EQ(pool.idle(), 0u);
+  EXPECT_EQ(buf.size(), 1025u);
+}
+
+TEST(HeaderBufferPoolTests, ReleaseKeepsContentsInASmallBuffer) {
+  HeaderBufferPool pool(1, 65536);
+  std::string buf = "Host: example.com\r\n";
+  pool.acquire(buf);
+  buf += "\r\n";
+  pool.release(buf);
+  EXPECT_EQ(buf, "Host: example.com\r\n\r\n");
+  EXPECT_LT(buf.capacity(), 65536u);
+  EXPECT_EQ(pool.inUse(), 0u);
+}
+
+TEST(HeaderBufferPoolTests, ReleasedBufferIsReused) {
+  HeaderBufferPool pool(1, 4096);
+  std::string buf = "x";
+  pool.acquire(buf);
+  const char* storage = buf.data();
+  pool.release(buf);
+
+  std::string other = "y";
+  pool.acquire(other);
+  EXPECT_EQ(other.data(), storage);
+  EXPECT_EQ(other, "y");
+}
+
+TEST(HeaderBufferPoolTests, CopyTakesConfigurationOnly) {
+  HeaderBufferPool pool(3, 2048);
+  std::string buf = "x";
+  pool.acquire(buf);
+
+  HeaderBufferPool copy(pool);
+  EXPECT_EQ(copy.maxIdle(), 3u);
+  EXPECT_EQ(copy.bufferSize(), 2048u);
+  EXPECT_EQ(copy.inUse(), 0u);
+  pool.release(buf);
+}
@@ -0,0 +1,213 @@
+#include "LocationRouter.hpp"
+
+#include <algorithm>
+
+#include "Logger.hpp"
+
+namespace {
+
+// Orders indexes into a location vector by configuration position
+struct ByPosition {
+  explicit ByPosition(const std::vector<Location>& locations)
+      : locations_(&locations) {}
+  bool operator()(std::size_t a, std::size_t b) const {
+    return (*locations_)[a].position < (*locations_)[b].position;
+  }
+  const std::vector<Location>* locations_;
+};
+
+}  // namespace
+
+LocationRouter::LocationRouter()
+    : locations_(), fallback_(), exact_(), nodes_(1), regex_() {
+  nodes_[0].prefix = -1;
+  nodes_[0].dir = -1;
+}
+
+LocationRouter::LocationRouter(const LocationRouter& other)
+    : locations_(other.locations_),
+      fallback_(other.fallback_),
+      exact_(other.exact_),
+      nodes_(other.nodes_),
+      regex_(other.regex_) {}
+
+LocationRouter& LocationRouter::operator=(const LocationRouter& other) {
+  if (this != &other) {
+    locations_ = other.locations_;
+    fallback_ = other.fallback_;
+    exact_ = other.exact_;
+    nodes_ = other.nodes_;
+    regex_ = other.regex_;
+  }
+  return *this;
+}
+
+LocationRouter::~LocationRouter() {}
+
+void LocationRouter::build(const std::vector<Location>& locations,
+                           const Location& fallback) {
+  locations_ = locations;
+  fallback_ = fallback;
+  exact_.clear();
+  nodes_.assign(1, Node());
+  nodes_[0].prefix = -1;
+  nodes_[0].dir = -1;
+  regex_.clear();
+
+  for (std::size_t i = 0; i < locations_.size(); ++i) {
+    switch (locations_[i].match) {
+      case MATCH_EXACT:
+        exact_.insert(locations_[i].path, static_cast<int>(i));
+        break;
+      case MATCH_REGEX:
+      case MATCH_REGEX_ICASE:
+        regex_.push_back(i);
+        break;
+      default:
+        addPrefix_(static_cast<int>(i));
+        break;
+    }
+  }
+  std::stable_sort(regex_.begin(), regex_.end(), ByPosition(locations_));
+  LOG(DEBUG) << "Location tables built: " << exact_.size() << " exact, "
+             << regex_.size() << " regex, " << nodes_.size()
+             << " prefix trie node(s)";
+}
+
+const Location* LocationRouter::match(const std::string& path) const {
+  int exact = exact_.find(path);
+  if (exact >= 0) {
+    return &locations_[exact];
+  }
+
+  int prefix = matchPrefix_(path);
+  if (prefix >= 0 && locations_[prefix].match == MATCH_PREFIX_NO_REGEX) {
+    return &locations_[prefix];
+  }
+
+  for (std::size_t i = 0; i < regex_.size(); ++i) {
+    if (locations_[regex_[i]].regex.matches(path)) {
+      return &locations_[regex_[i]];
+    }
+  }
+
+  if (prefix < 0) {
+    return &fallback_;
+  }
+  return &locations_[prefix];
+}
+
+std::size_t LocationRouter::size() const {
+  return locations_.size();
+}
+
+void LocationRouter::addPrefix_(int index) {
+  std::string path = locations_[index].path;
+  // Request paths always start with '/', so nothing else can match
+  if (path.empty() || path[0] != '/') {
+    LOG(DEBUG) << "Location '" << path << "' can never match, skipped";
+    return;
+  }
+  bool dir = path[path.size() - 1] == '/';
+  if (dir) {
+    path.erase(path.size() - 1);
+  }
+
+  std::size_t node = 0;
+  std::size_t begin = 1;
+  while (begin <= path.size()) {
+    std::size_t end = path.find('/', begin);
+    if (end == std::string::npos) {
+      end = path.size();
+    }
+    node = addChild_(node, path.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  if (dir) {
+    nodes_[node].dir = index;
+  } else {
+    nodes_[node].prefix = index;
+  }
+}
+
+// Longest prefix location for `path`, or -1
+int LocationRouter::matchPrefix_(const std::string& path) const {
+  if (path.empty() || path[0] != '/') {
+    return -1;
+  }
+
+  // Every path continues past the root with its leading '/'
+  int best = nodes_[0].dir;
+  std::size_t node = 0;
+  std::size_t begin = 1;
+  while (true) {
+    std::size_t end = path.find('/', begin);
+    bool last = end == std::string::npos;
+    if (last) {
+      end = path.size();
+    }
+    node = findChild_(node, path, begin, end);
+    if (node == 0) {
+      break;
+    }
+    if (last) {
+      if (nodes_[node].prefix >= 0) {
+        best = nodes_[node].prefix;
+      }
+      break;
+    }
+    // Followed by '/': "/a/b/" is longer than "/a/b", so it wins
+    if (nodes_[node].dir >= 0) {
+      best = nodes_[node].dir;
+    } else if (nodes_[node].prefix >= 0) {
+      best = nodes_[node].prefix;
+    }
+    begin = end + 1;
+  }
+  return best;
+}
+
+// Binary search over the sorted children without building a key string.
+// Returns 0 (the root, never a child) when there is no such child.
+std::size_t LocationRouter::findChild_(std::size_t node,
+                                       const std::string& path,
+                                       std::size_t begin,
+                                       std::size_t end) const {
+  const std::vector<std::pair<std::string, std::size_t> >& children =
+      nodes_[node].children;
+  std::size_t lo = 0;
+  std::size_t hi = children.size();
+  while (lo < hi) {
+    std::size_t mid = lo + (hi - lo) / 2;
+    int cmp = path.compare(begin, end - begin, children[mid].first);
+    if (cmp == 0) {
+      return children[mid].second;
+    }
+    if (cmp > 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return 0;
+}
+
+std::size_t LocationRouter::addChild_(std::size_t node,
+                                      const std::string& segment) {
+  std::vector<std::pair<std::string, std::size_t> >& children =
+      nodes_[node].children;
+  std::size_t pos = 0;
+  while (pos < children.size() && children[pos].first < segment) {
+    ++pos;
+  }
+  if (pos < children.size() && children[pos].first == segment) {
+    return children[pos].second;
+  }
+  std::size_t child = nodes_.size();
+  children.insert(children.begin() + pos, std::make_pair(segment, child));
+  // `children` may dangle after this push_back; it is not used again
+  nodes_.push_back(Node());
+  nodes_[child].prefix = -1;
+  nodes_[child].dir = -1;
+  return child;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Location.hpp"
+#include "StringIndex.hpp"
+
+// Location lookup, built once from fully inherited Location objects so a
+// request only walks precompiled tables and gets back a pointer into them:
+// nothing is copied or allocated per request.
+//
+// Locations are tried in the nginx order:
+//   1. "= path" exact locations, from a hash table;
+//   2. the longest prefix location, from a trie of path segments; if it is
+//      a "^~" location the search stops there;
+//   3. "~" / "~*" regex locations in configuration order, first match wins;
+//   4. the prefix from step 2, or the fallback.
+//
+// Prefixes keep the segment-boundary rules of the original matcher:
+// "/api" matches "/api" and "/api/..." but not "/apix", while "/api/"
+// matches only "/api/..." (it needs the slash).
+class LocationRouter {
+ public:
+  LocationRouter();
+  LocationRouter(const LocationRouter& other);
+  LocationRouter& operator=(const LocationRouter& other);
+  ~LocationRouter();
+
+  // Replace the table. `fallback` answers paths no location matches.
+  void build(const std::vector<Location>& locations, const Location& fallback);
+
+  // Location serving `path`; never NULL. The pointer stays valid until the
+  // next build() or until the router is destroyed.
+  const Location* match(const std::string& path) const;
+
+  std::size_t size() const;
+
+ private:
+  struct Node {
+    // (segment, node index), sorted by segment
+    std::vector<std::pair<std::string, std::size_t> > children;
+    int prefix;  // location "/a/b", -1 when none
+    int dir;     // location "/a/b/", -1 when none
+  };
+
+  void addPrefix_(int index);
+  int matchPrefix_(const std::string& path) const;
+  std::size_t findChild_(std::size_t node, const std::string& path,
+                         std::size_t begin, std::size_t end) const;
+  std::size_t addChild_(std::size_t node, const std::string& segment);
+
+  std::vector<Location> locations_;
+  Location fallback_;
+  StringIndex exact_;               // path -> index into locations_
+  std::vector<Node> nodes_;         // node 0 is the root ("/")
+  std::vector<std::size_t> regex_;  // regex locations, in config order
+};
@@ -0,0 +1,119 @@
+#include "LocationRouter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+LocationRouter buildRouter(const char* const* paths) {
+  std::vector<Location> locations;
+  for (int i = 0; paths[i] != NULL; ++i) {
+    locations.push_back(Location(paths[i]));
+  }
+  Location fallback("(none)");
+  LocationRouter router;
+  router.build(locations, fallback);
+  return router;
+}
+
+Location modified(LocationMatch match, const std::string& path,
+                  std::size_t position) {
+  Location loc(path);
+  loc.match = match;
+  loc.position = position;
+  if (loc.isRegex()) {
+    std::string error;
+    loc.regex.compile(path, match == MATCH_REGEX_ICASE, error);
+  }
+  return loc;
+}
+
+}  // namespace
+
+TEST(LocationRouterTests, LongestPrefixWins) {
+  const char* paths[] = {"/", "/api", "/api/v1", "/static/", NULL};
+  LocationRouter r = buildRouter(paths);
+  EXPECT_EQ(r.match("/")->path, "/");
+  EXPECT_EQ(r.match("/index.html")->path, "/");
+  EXPECT_EQ(r.match("/api")->path, "/api");
+  EXPECT_EQ(r.match("/api/users")->path, "/api");
+  EXPECT_EQ(r.match("/api/v1/users")->path, "/api/v1");
+  EXPECT_EQ(r.match("/static/css/a.css")->path, "/static/");
+  EXPECT_EQ(r.size(), 4u);
+}
+
+TEST(LocationRouterTests, PrefixesRespectSegmentBoundaries) {
+  const char* paths[] = {"/", "/api", "/static/", NULL};
+  LocationRouter r = buildRouter(paths);
+  EXPECT_EQ(r.match("/apix")->path, "/");
+  EXPECT_EQ(r.match("/api/")->path, "/api");
+  // A trailing-slash location needs the slash
+  EXPECT_EQ(r.match("/static")->path, "/");
+  EXPECT_EQ(r.match("/static/")->path, "/static/");
+}
+
+TEST(LocationRouterTests, SlashFormIsPreferredWhenBothExist) {
+  const char* paths[] = {"/docs", "/docs/", NULL};
+  LocationRouter r = buildRouter(paths);
+  EXPECT_EQ(r.match("/docs")->path, "/docs");
+  EXPECT_EQ(r.match("/docs/")->path, "/docs/");
+  EXPECT_EQ(r.match("/docs/a")->path, "/docs/");
+}
+
+TEST(LocationRouterTests, UnmatchedPathsUseFallback) {
+  const char* paths[] = {"/api", NULL};
+  LocationRouter r = buildRouter(paths);
+  EXPECT_EQ(r.match("/other")->path, "(none)");
+  EXPECT_EQ(r.match("")->path, "(none)");
+  EXPECT_EQ(r.match("relative")->path, "(none)");
+}
+
+TEST(LocationRouterTests, LookupReturnsTheStoredLocation) {
+  const char* paths[] = {"/a", NULL};
+  LocationRouter r = buildRouter(paths);
+  EXPECT_EQ(r.match("/a"), r.match("/a/b"));
+  // Copies own their table
+  LocationRouter copy(r);
+  EXPECT_NE(copy.match("/a"), r.match("/a"));
+  EXPECT_EQ(copy.match("/a")->path, "/a");
+}
+
+TEST(LocationRouterTests, ExactLocationIsCheckedFirst) {
+  std::vector<Location> locs;
+  locs.push_back(modified(MATCH_PREFIX, "/", 0));
+  locs.push_back(modified(MATCH_EXACT, "/", 1));
+  locs.push_back(modified(MATCH_REGEX, "^/$", 2));
+  LocationRouter r;
+  r.build(locs, Location("(none)"));
+  EXPECT_EQ(r.match("/")->match, MATCH_EXACT);
+  EXPECT_EQ(r.match("/index.html")->match, MATCH_PREFIX);
+}
+
+TEST(LocationRouterTests, RegexOverridesPlainPrefixInConfigOrder) {
+  std::vector<Location> locs;
+  // Stored out of order on purpose: position decides
+  locs.push_back(modified(MATCH_REGEX, "\\.(php|py)$", 3));
+  locs.push_back(modified(MATCH_PREFIX, "/app", 0));
+  locs.push_back(modified(MATCH_REGEX_ICASE, "\\.php$", 2));
+  LocationRouter r;
+  r.build(locs, Location("(none)"));
+  EXPECT_EQ(r.match("/app/index.php")->match, MATCH_REGEX_ICASE);
+  EXPECT_EQ(r.match("/app/INDEX.PHP")->match, MATCH_REGEX_ICASE);
+  EXPECT_EQ(r.match("/app/run.py")->match, MATCH_REGEX);
+  EXPECT_EQ(r.match("/app/readme.txt")->path, "/app");
+  EXPECT_EQ(r.match("/x.py")->match, MATCH_REGEX);
+  EXPECT_EQ(r.match("/x.txt")->path, "(none)");
+}
+
+TEST(LocationRouterTests, CaretTildePrefixSkipsRegexes) {
+  std::vector<Location> locs;
+  locs.push_back(modified(MATCH_PREFIX_NO_REGEX, "/static/", 0));
+  locs.push_back(modified(MATCH_PREFIX, "/", 1));
+  locs.push_back(modified(MATCH_REGEX, "\\.php$", 2));
+  LocationRouter r;
+  r.build(locs, Location("(none)"));
+  EXPECT_EQ(r.match("/static/evil.php")->path, "/static/");
+  EXPECT_EQ(r.match("/other/index.php")->match, MATCH_REGEX);
+}
@@ -4,6 +4,7 @@
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <cerrno>
@@ -11,37 +12,129 @@
 
 #include "Logger.hpp"
 #include "constants.hpp"
+#include "net_utils.hpp"
 #include "utils.hpp"
 
+const std::size_t kClientHeaderBufferSizeUnset = static_cast<std::size_t>(-1);
+const std::size_t kClientHeaderBufferSizeDefault = 4096;
+const std::size_t kLargeClientHeaderBuffersDefault = 4;
+const std::size_t kLargeClientHeaderBufferSizeDefault = 8192;
+const std::size_t kOpenFileCacheUnset = static_cast<std::size_t>(-1);
+const time_t kOpenFileCacheTimeUnset = -1;
+const time_t kOpenFileCacheInactiveDefault = 60;
+const time_t kOpenFileCacheValidDefault = 60;
+
+namespace {
+
+// Make room for a Unix listener at `addr`. A socket file left behind by a
+// server that died without cleaning up is removed; a file that is not a
+// socket, or a socket someone still accepts on, is left alone and false is
+// returned.
+bool clearStaleUnixSocket(const sockaddr_storage& addr, socklen_t len,
+                          const std::string& path) {
+  struct stat st;
+  if (lstat(path.c_str(), &st) < 0) {
+    return errno == ENOENT;
+  }
+  if (!S_ISSOCK(st.st_mode)) {
+    LOG(ERROR) << path << " exists and is not a socket";
+    return false;
+  }
+  int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (probe < 0) {
+    return false;
+  }
+  bool live = connect(probe, (const struct sockaddr*)&addr, len) == 0;
+  close(probe);
+  if (live) {
+    LOG(ERROR) << path << " is in use by another server";
+    return false;
+  }
+  LOG(INFO) << "Removing stale socket " << path;
+  return unlink(path.c_str()) == 0;
+}
+
+}  // namespace
+
 Server::Server(void)
     : fd(-1),
       port(-1),
-      host(INADDR_ANY),
+      host("0.0.0.0"),
+      ipv6only(true),
+      server_names(),
+      default_server(false),
       allow_methods(),
       index(),
       autoindex(false),
       root(),
       error_page(),
       max_request_body(kMaxRequestBodyUnset),
-      locations() {
+      client_body_buffer_size(kClientBodyBufferSizeUnset),
+      cache_max_size(kStaticCacheSizeUnset),
+      max_file_size(kStaticCacheSizeUnset),
+      gzip_static(false),
+      gzip(false),
+      gzip_comp_level(kGzipCompLevelDefault),
+      gzip_min_length(kGzipMinLengthDefault),
+      gzip_max_length(kGzipMaxLengthDefault),
+      gzip_types(),
+      gzip_buffer_size(kGzipBufferSizeDefault),
+      gzip_cache_size(0),
+      limit_rate(0),
+      limit_rate_after(0),
+      client_header_buffer_size(kClientHeaderBufferSizeUnset),
+      large_client_header_buffers(kClientHeaderBufferSizeUnset),
+      large_client_header_buffer_size(kClientHeaderBufferSizeUnset),
+      open_file_cache_max(kOpenFileCacheUnset),
+      open_file_cache_inactive(kOpenFileCacheTimeUnset),
+      open_file_cache_valid(kOpenFileCacheTimeUnset),
+      open_file_cache_errors(false),
+      locations(),
+      routes_() {
   LOG(DEBUG) << "Server() default constructor called";
   initDefaultHttpMethods(allow_methods);
+  compileLocations();
   LOG(DEBUG) << "Server initialized with default allowed methods";
 }
 
 Server::Server(int port)
     : fd(-1),
       port(port),
-      host(INADDR_ANY),
+      host("0.0.0.0"),
+      ipv6only(true),
+      server_names(),
+      default_server(false),
       allow_methods(),
       index(),
       autoindex(false),
       root(),
       error_page(),
       max_request_body(kMaxRequestBodyUnset),
-      locations() {
+      client_body_buffer_size(kClientBodyBufferSizeUnset),
+      cache_max_size(kStaticCacheSizeUnset),
+      max_file_size(kStaticCacheSizeUnset),
+      gzip_static(false),
+      gzip(false),
+      gzip_comp_level(kGzipCompLevelDefault),
+      gzip_min_length(kGzipMinLengthDefault),
+      gzip_max_length(kGzipMaxLengthDefault),
+      gzip_types(),
+      gzip_buffer_size(kGzipBufferSizeDefault),
+      gzip_cache_size(0),
+      limit_rate(0),
+      limit_rate_after(0),
+      client_header_buffer_size(kClientHeaderBufferSizeUnset),
+      large_client_header_buffers(kClientHeaderBufferSizeUnset),
+      large_client_header_buffer_size(kClientHeaderBufferSizeUnset),
+      open_file_cache_max(kOpenFileCacheUnset),
+      open_file_cache_inactive(kOpenFileCacheTimeUnset),
+      open_file_cache_valid(kOpenFileCacheTimeUnset),
+      open_file_cache_errors(false),
+      locations(),
+      routes_() {
   LOG(DEBUG) << "Server(port) constructor called with port: " << port;
   initDefaultHttpMethods(allow_methods);
+  compileLocations();
   LOG(DEBUG) << "Server on port " << port
              << " initialized with default allowed methods";
 }
@@ -50,13 +143,37 @@ Server::Server(const Server& other)
     : fd(other.fd),
       port(other.port),
       host(other.host),
+      ipv6only(other.ipv6only),
+      server_names(other.server_names),
+      default_server(other.default_server),
       allow_methods(other.allow_methods),
       index(other.index),
       autoindex(other.autoindex),
       root(other.root),
       error_page(other.error_page),
       max_request_body(other.max_request_body),
-      locations(other.locations) {}
+      client_body_buffer_size(other.client_body_buffer_size),
+      cache_max_size(other.cache_max_size),
+      max_file_size(other.max_file_size),
+      gzip_static(other.gzip_static),
+      gzip(other.gzip),
+      gzip_comp_level(other.gzip_comp_level),
+      gzip_min_length(other.gzip_min_length),
+      gzip_max_length(other.gzip_max_length),
+      gzip_types(other.gzip_types),
+      gzip_buffer_size(other.gzip_buffer_size),
+      gzip_cache_size(other.gzip_cache_size),
+      limit_rate(other.limit_rate),
+      limit_rate_after(other.limit_rate_after),
+      client_header_buffer_size(other.client_header_buffer_size),
+      large_client_header_buffers(other.large_client_header_buffers),
+      large_client_header_buffer_size(other.large_client_header_buffer_size),
+      open_file_cache_max(other.open_file_cache_max),
+      open_file_cache_inactive(other.open_file_cache_inactive),
+      open_file_cache_valid(other.open_file_cache_valid),
+      open_file_cache_errors(other.open_file_cache_errors),
+      locations(other.locations),
+      routes_(other.routes_) {}
 
 Server::~Server() {
   disconnect();
@@ -67,22 +184,53 @@ Server& Server::operator=(const Server& other) {
     fd = other.fd;
     port = other.port;
     host = other.host;
+    ipv6only = other.ipv6only;
+    server_names = other.server_names;
+    default_server = other.default_server;
     allow_methods = other.allow_methods;
     index = other.index;
     autoindex = other.autoindex;
     root = other.root;
     error_page = other.error_page;
     max_request_body = other.max_request_body;
+    client_body_buffer_size = other.client_body_buffer_size;
+    cache_max_size = other.cache_max_size;
+    max_file_size = other.max_file_size;
+    gzip_static = other.gzip_static;
+    gzip = other.gzip;
+    gzip_comp_level = other.gzip_comp_level;
+    gzip_min_length = other.gzip_min_length;
+    gzip_max_length = other.gzip_max_length;
+    gzip_types = other.gzip_types;
+    gzip_buffer_size = other.gzip_buffer_size;
+    gzip_cache_size = other.gzip_cache_size;
+    limit_rate = other.limit_rate;
+    limit_rate_after = other.limit_rate_after;
+    client_header_buffer_size = other.client_header_buffer_size;
+    large_client_header_buffers = other.large_client_header_buffers;
+    large_client_header_buffer_size = other.large_client_header_buffer_size;
+    open_file_cache_max = other.open_file_cache_max;
+    open_file_cache_inactive = other.open_file_cache_inactive;
+    open_file_cache_valid = other.open_file_cache_valid;
+    open_file_cache_errors = other.open_file_cache_errors;
     locations = other.locations;
+    routes_ = other.routes_;
   }
   return *this;
 }
 
 void Server::init(void) {
-  LOG(DEBUG) << "Initializing server on " << inet_ntoa(*(in_addr*)&host) << ":"
-             << port << "...";
+  std::string where = net_utils::formatHostPort(host, port);
+  LOG(DEBUG) << "Initializing server on " << where << "...";
+
+  struct sockaddr_storage addr;
+  socklen_t addr_len;
+  if (!net_utils::makeSockAddr(host, port, addr, addr_len)) {
+    LOG(ERROR) << "Invalid listen address: " << where;
+    throw std::runtime_error("listen address");
+  }
 
-  fd = socket(AF_INET, SOCK_STREAM, 0);
+  fd = socket(addr.ss_family, SOCK_STREAM, 0);
   if (fd < 0) {
     LOG_PERROR(ERROR, "socket");
     throw std::runtime_error("socket");
@@ -98,20 +246,38 @@ void Server::init(void) {
   }
   LOG(DEBUG) << "SO_REUSEADDR option set on socket";
 
-  struct sockaddr_in addr;
-  std::memset(&addr, 0, sizeof(addr));
-  addr.sin_family = AF_INET;
-  /* bind to configured host (INADDR_ANY if not set) */
-  addr.sin_addr.s_addr = host;
-  addr.sin_port = htons(port);
+  std::string unix_path = net_utils::unixPath(host);
+  if (!unix_path.empty() && !clearStaleUnixSocket(addr, addr_len, unix_path)) {
+    disconnect();
+    throw std::runtime_error("bind");
+  }
+
+  /* an IPv6 wildcard socket also accepts IPv4 clients with ipv6only=off */
+  if (addr.ss_family == AF_INET6) {
+    int v6only = ipv6only ? 1 : 0;
+    if (setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only)) <
+        0) {
+      disconnect();
+      LOG_PERROR(ERROR, "setsockopt IPV6_V6ONLY");
+      throw std::runtime_error("setsockopt");
+    }
+  }
 
-  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+  if (bind(fd, (struct sockaddr*)&addr, addr_len) < 0) {
     disconnect();
     LOG_PERROR(ERROR, "bind");
     throw std::runtime_error("bind");
   }
-  LOG(DEBUG) << "Socket bound to " << inet_ntoa(*(in_addr*)&host) << ":"
-             << port;
+  LOG(DEBUG) << "Socket bound to " << where;
+
+  /* like a TCP port, the socket is open to every local user; restrict
+     access with the permissions of its directory */
+  if (!unix_path.empty() && chmod(unix_path.c_str(), 0666) < 0) {
+    LOG_PERROR(ERROR, "chmod");
+    disconnect();
+    unlink(unix_path.c_str());
+    throw std::runtime_error("chmod");
+  }
 
   if (listen(fd, MAX_CONNECTIONS_PER_SERVER) < 0) {
     disconnect();
@@ -127,11 +293,22 @@ void Server::init(void) {
   }
   LOG(DEBUG) << "Socket set to non-blocking mode";
 
-  LOG(INFO) << "Server listening on " << inet_ntoa(*(in_addr*)&host) << ":"
-            << port;
+  LOG(INFO) << "Server listening on " << where;
   LOG(DEBUG) << "Server socket fd: " << fd;
 }
 
+void Server::adopt(int listen_fd) {
+  std::string where = net_utils::formatHostPort(host, port);
+  fd = listen_fd;
+  if (set_nonblocking(fd) < 0) {
+    LOG_PERROR(ERROR, "set_nonblocking");
+    disconnect();
+    throw std::runtime_error("set_nonblocking");
+  }
+  LOG(INFO) << "Server listening on " << where << " (inherited fd " << fd
+            << ")";
+}
+
 void Server::disconnect(void) {
   if (fd != -1) {
     LOG(DEBUG) << "Closing server socket fd: " << fd;
@@ -140,52 +317,28 @@ void Server::disconnect(void) {
   }
 }
 
-Location Server::matchLocation(const std::string& path) const {
-  LOG(DEBUG) << "Matching path '" << path << "' against " << locations.size()
-             << " location(s)";
-
-  // Find the longest matching prefix
-  std::string best_match;
-  std::map<std::string, Location>::const_iterator best_it = locations.end();
-
+void Server::compileLocations() {
+  std::vector<Location> resolved;
+  resolved.reserve(locations.size());
   for (std::map<std::string, Location>::const_iterator it = locations.begin();
        it != locations.end(); ++it) {
-    const std::string& loc_path = it->first;
-
-    // Check if this location path is a prefix of the request path, respecting
-    // path segment boundaries
-    if (path.find(loc_path) == 0) {
-      // If location ends with '/', it's already a proper prefix
-      // Otherwise, ensure it's an exact match or followed by '/'
-      bool is_match = false;
-      if (!loc_path.empty() && loc_path[loc_path.length() - 1] == '/') {
-        // Location ends with '/', so it's a valid prefix match
-        is_match = true;
-      } else if (path.length() == loc_path.length()) {
-        // Exact match
-        is_match = true;
-      } else if (path.length() > loc_path.length() &&
-                 path[loc_path.length()] == '/') {
-        // Followed by '/' (path boundary)
-        is_match = true;
-      }
-
-      if (is_match && loc_path.length() > best_match.length()) {
-        best_match = loc_path;
-        best_it = it;
-      }
-    }
+    resolved.push_back(inheritLocation_(it->second));
   }
+  // Paths no location matches get the server's own settings
+  Location fallback;
+  fallback.path = "/";
+  routes_.build(resolved, inheritLocation_(fallback));
+}
 
-  Location result;
-  if (best_it != locations.end()) {
-    LOG(DEBUG) << "Matched location: '" << best_it->first << "'";
-    result = best_it->second;
-  } else {
-    // No location matched, start with default location
-    LOG(DEBUG) << "No location matched, using server defaults";
-    result.path = "/";
-  }
+const Location& Server::matchLocation(const std::string& path) const {
+  const Location* loc = routes_.match(path);
+  LOG(DEBUG) << "Matched location '" << loc->path << "' for path '" << path
+             << "'";
+  return *loc;
+}
+
+Location Server::inheritLocation_(const Location& loc) const {
+  Location result(loc);
 
   // Apply inheritance from server for unset values
   if (result.root.empty()) {
@@ -208,6 +361,45 @@ Location Server::matchLocation(const std::string& path) const {
   if (result.max_request_body == kMaxRequestBodyUnset) {
     result.max_request_body = max_request_body;
   }
+  if (result.client_body_buffer_size == kClientBodyBufferSizeUnset) {
+    result.client_body_buffer_size = client_body_buffer_size;
+  }
+  if (result.cache_max_size == kStaticCacheSizeUnset) {
+    result.cache_max_size = cache_max_size;
+  }
+  if (result.max_file_size == kStaticCacheSizeUnset) {
+    result.max_file_size = max_file_size;
+  }
+  if (result.gzip_static == UNSET) {
+    result.gzip_static = gzip_static ? ON : OFF;
+  }
+  if (result.gzip == UNSET) {
+    result.gzip = gzip ? ON : OFF;
+  }
+  if (result.gzip_comp_level == 0) {
+    result.gzip_comp_level = gzip_comp_level;
+  }
+  if (result.gzip_min_length == kGzipSizeUnset) {
+    result.gzip_min_length = gzip_min_length;
+  }
+  if (result.gzip_max_length == kGzipSizeUnset) {
+    result.gzip_max_length = gzip_max_length;
+  }
+  if (result.gzip_types.empty()) {
+    result.gzip_types = gzip_types;
+  }
+  if (result.gzip_buffer_size == kGzipSizeUnset) {
+    result.gzip_buffer_size = gzip_buffer_size;
+  }
+  if (result.gzip_cache_size == kGzipSizeUnset) {
+    result.gzip_cache_size = gzip_cache_size;
+  }
+  if (result.limit_rate == kLimitRateUnset) {
+    result.limit_rate = limit_rate;
+  }
+  if (result.limit_rate_after == kLimitRateUnset) {
+    result.limit_rate_after = limit_rate_after;
+  }
 
   // Resolve error_page paths to absolute filesystem paths using root
   if (!result.root.empty()) {
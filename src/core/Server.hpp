@@ -1,12 +1,22 @@
 #pragma once
 
-#include <netinet/in.h>
-
+#include <ctime>
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "Location.hpp"
+#include "LocationRouter.hpp"
+
+extern const std::size_t kClientHeaderBufferSizeUnset;
+extern const std::size_t kClientHeaderBufferSizeDefault;
+extern const std::size_t kLargeClientHeaderBuffersDefault;
+extern const std::size_t kLargeClientHeaderBufferSizeDefault;
+extern const std::size_t kOpenFileCacheUnset;
+extern const time_t kOpenFileCacheTimeUnset;
+extern const time_t kOpenFileCacheInactiveDefault;
+extern const time_t kOpenFileCacheValidDefault;
 
 class Server {
  public:
@@ -19,7 +29,15 @@ class Server {
 
   int fd;
   int port;
-  in_addr_t host;
+  // Numeric listen address, IPv4 or IPv6 without brackets ("::" listens on
+  // every IPv6 address, and also on IPv4 ones when ipv6only is off)
+  std::string host;
+  bool ipv6only;
+  // Names matched against the Host header ("example.com", "*.example.com",
+  // ".example.com"); servers sharing host:port are told apart by them
+  std::vector<std::string> server_names;
+  // Serves requests whose Host matches no name on this host:port
+  bool default_server;
 
   std::set<http::Method> allow_methods;
   std::set<std::string> index;
@@ -27,10 +45,60 @@ class Server {
   std::string root;
   std::map<http::Status, std::string> error_page;
   std::size_t max_request_body;
+  std::size_t client_body_buffer_size;
+  // Defaults for the locations' in-memory static cache (Location)
+  std::size_t cache_max_size;
+  std::size_t max_file_size;
+  // Default for Location::gzip_static
+  bool gzip_static;
+  // Defaults for the locations' gzip settings (Location)
+  bool gzip;
+  int gzip_comp_level;
+  std::size_t gzip_min_length;
+  std::size_t gzip_max_length;
+  std::set<std::string> gzip_types;
+  std::size_t gzip_buffer_size;
+  std::size_t gzip_cache_size;
+  // Defaults for Location::limit_rate and limit_rate_after
+  std::size_t limit_rate;
+  std::size_t limit_rate_after;
+  // Request heads are read into a buffer of client_header_buffer_size bytes;
+  // longer ones may use up to large_client_header_buffers buffers of
+  // large_client_header_buffer_size bytes per connection.
+  std::size_t client_header_buffer_size;
+  std::size_t large_client_header_buffers;
+  std::size_t large_client_header_buffer_size;
+  // Open file cache shared by the listener (see OpenFileCache):
+  // open_file_cache_max entries (0 = off), dropped after
+  // open_file_cache_inactive idle seconds and rechecked against the
+  // filesystem every open_file_cache_valid seconds; with
+  // open_file_cache_errors, paths found missing are cached as well
+  std::size_t open_file_cache_max;
+  time_t open_file_cache_inactive;
+  time_t open_file_cache_valid;
+  bool open_file_cache_errors;
 
+  // Locations as configured, keyed by Location::key(); matchLocation()
+  // serves the resolved copies built by compileLocations()
   std::map<std::string, Location> locations;
 
   void init(void);
+  // Serve on a listening socket that is already bound, e.g. one handed over
+  // by a supervisor, instead of opening one in init()
+  void adopt(int listen_fd);
   void disconnect(void);
-  Location matchLocation(const std::string& path) const;
+  // Resolve every location against the server settings (root, index,
+  // error pages, limits...) and index them for matchLocation(). Must be
+  // called again after the server or its locations change.
+  void compileLocations();
+  // Location serving `path` (exact, prefix and regex rules, see
+  // LocationRouter), or the server defaults when nothing matches. The
+  // reference stays valid until the next compileLocations().
+  const Location& matchLocation(const std::string& path) const;
+
+ private:
+  // Copy of `loc` with unset values taken from the server
+  Location inheritLocation_(const Location& loc) const;
+
+  LocationRouter routes_;
 };
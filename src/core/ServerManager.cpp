@@ -16,7 +16,6 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
-#include <set>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -27,6 +26,50 @@
 #include "IHandler.hpp"
 #include "Logger.hpp"
 #include "constants.hpp"
+#include "net_utils.hpp"
+#include "utils.hpp"
+
+namespace {
+
+struct InheritedListener {
+  int fd;
+  sockaddr_storage addr;
+};
+
+// Listening sockets passed in by a socket-activating supervisor. The
+// variables are cleared so CGI children do not mistake them for their own.
+std::vector<InheritedListener> takeInheritedListeners() {
+  std::vector<int> fds = net_utils::listenFdsFromEnv(
+      std::getenv("LISTEN_PID"), std::getenv("LISTEN_FDS"), getpid());
+  unsetenv("LISTEN_PID");
+  unsetenv("LISTEN_FDS");
+  unsetenv("LISTEN_FDNAMES");
+
+  std::vector<InheritedListener> listeners;
+  for (std::size_t i = 0; i < fds.size(); ++i) {
+    InheritedListener l;
+    l.fd = fds[i];
+    socklen_t len = sizeof(l.addr);
+    int accepting = 0;
+    socklen_t optlen = sizeof(accepting);
+    if (getsockname(l.fd, (struct sockaddr*)&l.addr, &len) < 0 ||
+        getsockopt(l.fd, SOL_SOCKET, SO_ACCEPTCONN, &accepting, &optlen) <
+            0 ||
+        !accepting) {
+      LOG(ERROR) << "Inherited fd " << l.fd
+                 << " is not a listening socket, ignored";
+      continue;
+    }
+    listeners.push_back(l);
+  }
+  if (!fds.empty()) {
+    LOG(INFO) << "Inherited " << listeners.size()
+              << " listening socket(s) from the supervisor";
+  }
+  return listeners;
+}
+
+}  // namespace
 
 ServerManager::ServerManager() : efd_(-1), sfd_(-1), stop_requested_(false) {}
 
@@ -48,31 +91,67 @@ ServerManager::~ServerManager() {
 void ServerManager::initServers(std::vector<Server>& servers) {
   LOG(DEBUG) << "Initializing " << servers.size() << " server(s)...";
 
-  /* Check for duplicate listen addresses before initializing */
-  std::set<std::pair<in_addr_t, int> > listen_addresses;
+  /* Group servers by listen address; servers sharing one are virtual
+     hosts told apart by server_name, in configuration order */
+  std::vector<std::pair<std::string, int> > addresses;
+  std::map<std::pair<std::string, int>, VirtualHosts> groups;
   for (std::vector<Server>::iterator it = servers.begin(); it != servers.end();
        ++it) {
-    std::pair<in_addr_t, int> addr(it->host, it->port);
-    if (listen_addresses.find(addr) != listen_addresses.end()) {
-      LOG(ERROR) << "Duplicate listen address found: "
-                 << inet_ntoa(*(in_addr*)&it->host) << ":" << it->port;
-      throw std::runtime_error("Duplicate listen address in configuration");
+    std::pair<std::string, int> addr(it->host, it->port);
+    if (groups.find(addr) == groups.end()) {
+      addresses.push_back(addr);
+    }
+    groups[addr].add(*it);
+  }
+
+  std::vector<InheritedListener> inherited = takeInheritedListeners();
+
+  for (std::size_t i = 0; i < addresses.size(); ++i) {
+    const VirtualHosts& vhosts = groups[addresses[i]];
+    /* the listening socket is opened once per address */
+    Server listener = vhosts.defaultServer();
+    std::string where =
+        net_utils::formatHostPort(listener.host, listener.port);
+    LOG(DEBUG) << "Initializing server on " << where << " (" << vhosts.size()
+               << " virtual host(s))";
+
+    /* a socket bound to this address by the supervisor wins */
+    sockaddr_storage addr;
+    socklen_t addr_len;
+    std::size_t match = inherited.size();
+    if (net_utils::makeSockAddr(listener.host, listener.port, addr,
+                                addr_len)) {
+      for (match = 0; match < inherited.size(); ++match) {
+        if (net_utils::sameSockAddr(inherited[match].addr, addr)) {
+          break;
+        }
+      }
+    }
+    if (match < inherited.size()) {
+      listener.adopt(inherited[match].fd);
+      inherited_fds_.insert(listener.fd);
+      inherited.erase(inherited.begin() + match);
+    } else {
+      listener.init();
     }
-    listen_addresses.insert(addr);
+    servers_[listener.fd] = vhosts;
+    header_pools_[listener.fd] =
+        HeaderBufferPool(listener.large_client_header_buffers,
+                         listener.large_client_header_buffer_size);
+    file_caches_[listener.fd] = OpenFileCache(
+        listener.open_file_cache_max, listener.open_file_cache_inactive,
+        listener.open_file_cache_valid, listener.open_file_cache_errors);
+    LOG(DEBUG) << "Server registered (" << where
+               << ") with fd: " << listener.fd;
+    /* the fd is owned by servers_ from now on */
+    listener.fd = -1;
+  }
+  for (std::size_t i = 0; i < inherited.size(); ++i) {
+    LOG(INFO) << "Inherited fd " << inherited[i].fd
+              << " matches no listen directive, closed";
+    close(inherited[i].fd);
   }
 
-  for (std::vector<Server>::iterator it = servers.begin(); it != servers.end();
-       ++it) {
-    LOG(DEBUG) << "Initializing server on " << inet_ntoa(*(in_addr*)&it->host)
-               << ":" << it->port;
-    it->init();
-    /* store by listening fd */
-    servers_[it->fd] = *it;
-    LOG(DEBUG) << "Server registered (" << inet_ntoa(*(in_addr*)&it->host)
-               << ":" << it->port << ") with fd: " << it->fd;
-    /* prevent server destructor from closing the fd of the temporary */
-    it->fd = -1;
-  }
   /* clear servers after moving them to ServerManager */
   servers.clear();
   LOG(DEBUG) << "All servers initialized successfully";
@@ -81,10 +160,14 @@ void ServerManager::initServers(std::vector<Server>& servers) {
 void ServerManager::acceptConnection(int listen_fd) {
   LOG(DEBUG) << "Accepting new connections on listen_fd: " << listen_fd;
   while (1) {
-    struct sockaddr_in client_addr;
+    struct sockaddr_storage client_addr;
     socklen_t client_len = sizeof(client_addr);
-    int conn_fd =
-        accept(listen_fd, (struct sockaddr*)&client_addr, &client_len);
+    // CLOEXEC keeps CGI children from holding the client socket open after
+    // the connection is closed (the peer would never see the close).
+    // NONBLOCK: a slow client fills its socket buffer and waits for EPOLLOUT
+    // instead of stalling every other connection inside send/sendfile.
+    int conn_fd = accept4(listen_fd, (struct sockaddr*)&client_addr,
+                          &client_len, SOCK_CLOEXEC | SOCK_NONBLOCK);
     if (conn_fd < 0) {
       LOG(DEBUG) << "accept returned error on fd: " << listen_fd
                  << " (stop accepting for now)";
@@ -97,7 +180,11 @@ void ServerManager::acceptConnection(int listen_fd) {
     Connection connection(conn_fd);
     /* record which listening/server fd accepted this connection */
     connection.server_fd = listen_fd;
-    connection.remote_addr = inet_ntoa(client_addr.sin_addr);
+    connection.header_pool = &header_pools_[listen_fd];
+    connection.file_cache = &file_caches_[listen_fd];
+    connection.static_cache = &static_cache_;
+    connection.gzip_cache = &gzip_cache_;
+    connection.remote_addr = net_utils::sockAddrHost(client_addr);
     connections_[conn_fd] = connection;
 
     updateEvents(conn_fd, EPOLLIN);
@@ -111,6 +198,13 @@ void ServerManager::updateEvents(int fd, uint32_t events) {
     return;
   }
 
+  // Connections watch for the client going away so work done on its behalf
+  // can be cancelled early
+  std::map<int, Connection>::iterator it = connections_.find(fd);
+  if (it != connections_.end() && !it->second.peer_half_closed) {
+    events |= EPOLLRDHUP;
+  }
+
   struct epoll_event ev;
   ev.events = events;
   ev.data.fd = fd;
@@ -142,7 +236,7 @@ int ServerManager::run() {
   /* register listener fds */
   LOG(DEBUG) << "Registering " << servers_.size()
              << " server socket(s) with epoll";
-  for (std::map<int, Server>::const_iterator it = servers_.begin();
+  for (std::map<int, VirtualHosts>::const_iterator it = servers_.begin();
        it != servers_.end(); ++it) {
     int listen_fd = it->first;
     struct epoll_event ev;
@@ -168,6 +262,17 @@ int ServerManager::run() {
     return EXIT_FAILURE;
   }
 
+  /* inotify for the static cache; without it the cache stays off */
+  if (static_cache_.init()) {
+    struct epoll_event cache_ev;
+    cache_ev.events = EPOLLIN;
+    cache_ev.data.fd = static_cache_.fd();
+    if (epoll_ctl(efd_, EPOLL_CTL_ADD, static_cache_.fd(), &cache_ev) < 0) {
+      LOG_PERROR(ERROR, "epoll_ctl ADD inotify fd");
+      return EXIT_FAILURE;
+    }
+  }
+
   /* event loop */
   struct epoll_event events[MAX_EVENTS];
   LOG(DEBUG) << "Entering main event loop (waiting for connections)...";
@@ -175,7 +280,7 @@ int ServerManager::run() {
   while (!stop_requested_) {
     // Use 1 second timeout to periodically check for CGI/connection timeouts
     // even when there are no I/O events
-    int n = epoll_wait(efd_, events, MAX_EVENTS, 1000);
+    int n = epoll_wait(efd_, events, MAX_EVENTS, nextEventTimeout(1000));
     if (n < 0) {
       if (errno == EINTR) {
         if (stop_requested_) {
@@ -202,6 +307,8 @@ int ServerManager::run() {
       }
     }
 
+    resumePausedWrites();
+
     /* After processing events, iterate connections to prepare responses
        for those that completed reading but don't yet have a write buffer. */
     LOG(DEBUG) << "Checking " << connections_.size()
@@ -300,6 +407,7 @@ void ServerManager::shutdown() {
   LOG(DEBUG) << "Closing " << connections_.size() << " connection(s)";
   for (std::map<int, Connection>::iterator it = connections_.begin();
        it != connections_.end(); ++it) {
+    it->second.cancelHandler();
     close(it->first);
   }
   connections_.clear();
@@ -310,11 +418,20 @@ void ServerManager::shutdown() {
 
   // close listening fds
   LOG(DEBUG) << "Closing " << servers_.size() << " server socket(s)";
-  for (std::map<int, Server>::iterator it = servers_.begin();
+  for (std::map<int, VirtualHosts>::iterator it = servers_.begin();
        it != servers_.end(); ++it) {
-    it->second.disconnect();
+    LOG(DEBUG) << "Closing server socket fd: " << it->first;
+    close(it->first);
+    /* a Unix socket file outlives its socket */
+    std::string path = net_utils::unixPath(it->second.defaultServer().host);
+    if (!path.empty() && inherited_fds_.count(it->first) == 0) {
+      unlink(path.c_str());
+    }
   }
   servers_.clear();
+  inherited_fds_.clear();
+  header_pools_.clear();
+  file_caches_.clear();
 
   LOG(INFO) << "webserv shutdown complete";
 }
@@ -373,6 +490,16 @@ void ServerManager::handleCgiPipeEvent(int pipe_fd) {
   HandlerResult hr = conn.active_handler->resume(conn);
 
   if (hr == HR_WOULD_BLOCK) {
+    // The output so far is drained first, so only a script still running
+    // past its deadline is answered with a 504
+    if (conn.active_handler->checkTimeout(conn)) {
+      LOG(INFO) << "CGI timeout on fd " << conn_fd;
+      unregisterCgiPipe(pipe_fd);
+      conn.clearHandler();
+      conn.prepareErrorResponse(http::S_504_GATEWAY_TIMEOUT);
+      updateEvents(conn_fd, EPOLLOUT);
+      return;
+    }
     // More data expected, keep monitoring the pipe
     LOG(DEBUG) << "CGI handler would block, continuing to monitor pipe fd "
                << pipe_fd;
@@ -403,7 +530,8 @@ void ServerManager::prepareResponses() {
     Connection& conn = it->second;
     int conn_fd = it->first;
 
-    if (conn.headers_end_pos == std::string::npos) {
+    // Wait until the whole request (headers and body) has been read
+    if (!conn.request_complete) {
       continue;
     }
 
@@ -418,8 +546,9 @@ void ServerManager::prepareResponses() {
 
     LOG(DEBUG) << "Preparing response for connection fd: " << conn_fd;
 
-    /* find the server that accepted this connection */
-    std::map<int, Server>::iterator srv_it = servers_.find(conn.server_fd);
+    /* find the listener that accepted this connection */
+    std::map<int, VirtualHosts>::iterator srv_it =
+        servers_.find(conn.server_fd);
     if (srv_it == servers_.end()) {
       /* shouldn't happen, but handle gracefully */
       LOG(ERROR) << "Server not found for connection fd " << conn_fd
@@ -429,11 +558,15 @@ void ServerManager::prepareResponses() {
       continue;
     }
 
+    /* the virtual server picked from the Host header, or the listener's
+       default if the head never got that far */
+    const Server& srv =
+        conn.vhost != NULL ? *conn.vhost : srv_it->second.defaultServer();
     LOG(DEBUG) << "Found server configuration for fd " << conn_fd
-               << " (port: " << srv_it->second.port << ")";
+               << " (port: " << srv.port << ")";
 
     /* process request using new handler methods */
-    conn.processRequest(srv_it->second);
+    conn.processRequest(srv);
 
     // Check if handler needs async I/O (e.g., CGI pipe monitoring)
     if (conn.active_handler != NULL) {
@@ -479,7 +612,20 @@ void ServerManager::handleEvent(int fd, u_int32_t ev_mask) {
     return;
   }
 
-  std::map<int, Server>::iterator s_it = servers_.find(fd);
+  if (fd == static_cache_.fd()) {
+    // Files changed on disk: the open file caches must not keep serving
+    // them from their old fds either
+    std::vector<std::string> changed = static_cache_.handleEvents();
+    for (std::map<int, OpenFileCache>::iterator it = file_caches_.begin();
+         it != file_caches_.end(); ++it) {
+      for (std::size_t i = 0; i < changed.size(); ++i) {
+        it->second.invalidate(changed[i]);
+      }
+    }
+    return;
+  }
+
+  std::map<int, VirtualHosts>::iterator s_it = servers_.find(fd);
   if (s_it != servers_.end()) {
     LOG(DEBUG) << "Event is on server listen socket, accepting connections...";
     acceptConnection(fd);
@@ -502,18 +648,27 @@ void ServerManager::handleEvent(int fd, u_int32_t ev_mask) {
 
   Connection& c = c_it->second;
 
+  /* draining input after the response went out */
+  if (c.lingering) {
+    if ((ev_mask & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) &&
+        c.discardInput() < 0) {
+      closeAndRemoveConnection(fd);
+    }
+    return;
+  }
+
   /* readable */
   if (ev_mask & EPOLLIN) {
     LOG(DEBUG) << "EPOLLIN event on connection fd: " << fd;
-    std::map<int, Server>::iterator srv_it_conn = servers_.find(c.server_fd);
+    std::map<int, VirtualHosts>::iterator srv_it_conn =
+        servers_.find(c.server_fd);
     if (srv_it_conn == servers_.end()) {
       LOG(ERROR) << "Server not found for connection fd " << fd
                  << " (server_fd: " << c.server_fd << ") - closing";
       closeAndRemoveConnection(fd);
       return;
     }
-    const Server& srv_ref = srv_it_conn->second;
-    int status = c.handleRead(srv_ref);
+    int status = c.handleRead(srv_it_conn->second);
 
     if (status < 0) {
       LOG(DEBUG) << "handleRead failed, closing connection fd: " << fd;
@@ -530,14 +685,51 @@ void ServerManager::handleEvent(int fd, u_int32_t ev_mask) {
     }
   }
 
+  /* client went away: drop a request that can no longer complete and stop
+     a CGI working for it. A FIN after a complete request may be a
+     half-close (shutdown(SHUT_WR)) by a client still waiting for the
+     response, so anything else keeps being sent until a write fails with
+     EPIPE or ECONNRESET. */
+  if ((ev_mask & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && !c.peer_half_closed) {
+    bool cgi =
+        c.active_handler != NULL && c.active_handler->getMonitorFd() >= 0;
+    if (!c.request_complete || cgi || (ev_mask & (EPOLLHUP | EPOLLERR))) {
+      if (c.peerClosed()) {
+        LOG(INFO) << "Client closed connection fd " << fd
+                  << ", cancelling request";
+        closeAndRemoveConnection(fd);
+        return;
+      }
+    } else {
+      LOG(DEBUG) << "Client half-closed connection fd " << fd;
+      // Level-triggered EPOLLRDHUP would keep firing: stop watching for it
+      c.peer_half_closed = true;
+      if (c.write_paused_until != 0) {
+        updateEvents(fd, 0);
+      } else {
+        updateEvents(fd, EPOLLOUT);
+      }
+    }
+  }
+
   /* writable */
   if (ev_mask & EPOLLOUT) {
     LOG(DEBUG) << "EPOLLOUT event on connection fd: " << fd;
     int status = c.handleWrite();
 
+    if (status > 0 && c.write_paused_until != 0) {
+      pauseWrites(fd, c);
+      return;
+    }
     if (status <= 0) {
       // Log the completed request in nginx-style format
       c.logAccess();
+      // The client may still be sending a body nobody read; closing now
+      // would reset the connection and could destroy the response.
+      if (status == 0 && c.needsLingeringClose() && c.startLingeringClose()) {
+        updateEvents(fd, EPOLLIN);
+        return;
+      }
       LOG(DEBUG) << "handleWrite complete or failed, closing connection fd: "
                  << fd;
       closeAndRemoveConnection(fd);
@@ -545,6 +737,43 @@ void ServerManager::handleEvent(int fd, u_int32_t ev_mask) {
   }
 }
 
+void ServerManager::pauseWrites(int fd, const Connection& c) {
+  LOG(DEBUG) << "Pausing output on fd " << fd << " until "
+             << c.write_paused_until;
+  write_timers_.insert(std::make_pair(c.write_paused_until, fd));
+  // Only EPOLLRDHUP stays on, so a client that leaves is still noticed
+  updateEvents(fd, 0);
+}
+
+void ServerManager::resumePausedWrites() {
+  long long now = monotonicMillis();
+  while (!write_timers_.empty() && write_timers_.begin()->first <= now) {
+    long long due = write_timers_.begin()->first;
+    int fd = write_timers_.begin()->second;
+    write_timers_.erase(write_timers_.begin());
+    // The connection may have been closed and its fd reused meanwhile
+    std::map<int, Connection>::iterator it = connections_.find(fd);
+    if (it == connections_.end() || it->second.write_paused_until != due) {
+      continue;
+    }
+    it->second.write_paused_until = 0;
+    // The pause does not count as idle time
+    it->second.startWritePhase();
+    updateEvents(fd, EPOLLOUT);
+  }
+}
+
+int ServerManager::nextEventTimeout(int max_ms) const {
+  if (write_timers_.empty()) {
+    return max_ms;
+  }
+  long long wait = write_timers_.begin()->first - monotonicMillis();
+  if (wait < 0) {
+    return 0;
+  }
+  return wait < max_ms ? static_cast<int>(wait) : max_ms;
+}
+
 void ServerManager::cleanupHandlerResources(Connection& c) {
   if (c.active_handler != NULL) {
     int monitor_fd = c.active_handler->getMonitorFd();
@@ -557,6 +786,8 @@ void ServerManager::cleanupHandlerResources(Connection& c) {
 void ServerManager::checkConnectionTimeouts() {
   std::vector<int> timed_out_fds;
   std::vector<int> cgi_timed_out_fds;
+  std::vector<int> cgi_pipe_fds;
+  std::vector<int> linger_done_fds;
 
   // First pass: identify timed out connections
   for (std::map<int, Connection>::iterator it = connections_.begin();
@@ -564,6 +795,24 @@ void ServerManager::checkConnectionTimeouts() {
     Connection& conn = it->second;
     int conn_fd = it->first;
 
+    // Lingering connections only wait for the client to stop sending
+    if (conn.lingering) {
+      if (conn.isLingerTimedOut(LINGERING_TIME_SECONDS)) {
+        LOG(DEBUG) << "Lingering close finished on fd " << conn_fd;
+        linger_done_fds.push_back(conn_fd);
+      }
+      continue;
+    }
+
+    // A running CGI is governed by the CGI timeout alone. Its pipe is
+    // drained before that is checked: a script that finished right at the
+    // deadline has its whole output there.
+    if (conn.active_handler != NULL &&
+        conn.active_handler->getMonitorFd() >= 0) {
+      cgi_pipe_fds.push_back(conn.active_handler->getMonitorFd());
+      continue;
+    }
+
     // Check for CGI handler timeouts first
     if (conn.active_handler != NULL &&
         conn.active_handler->checkTimeout(conn)) {
@@ -572,22 +821,31 @@ void ServerManager::checkConnectionTimeouts() {
       continue;
     }
 
-    // Check for read phase timeouts (connections waiting for client data)
-    if (conn.isReadTimedOut(READ_TIMEOUT_SECONDS)) {
+    // Check for read phase timeouts (connections waiting for client data);
+    // once the request is in, CGI and write timeouts take over
+    if (!conn.request_complete && conn.isReadTimedOut(READ_TIMEOUT_SECONDS)) {
       LOG(INFO) << "Read timeout on fd " << conn_fd
                 << " (idle for >= " << READ_TIMEOUT_SECONDS << "s)";
       timed_out_fds.push_back(conn_fd);
       continue;
     }
 
-    // Check for write phase timeouts (connections stuck sending responses)
-    if (conn.isWriteTimedOut(WRITE_TIMEOUT_SECONDS)) {
-      LOG(INFO) << "Write timeout on fd " << conn_fd
-                << " (sending for >= " << WRITE_TIMEOUT_SECONDS << "s)";
+    // Check for write phase timeouts (no progress sending the response);
+    // limit_rate pauses are not the client's doing
+    if (conn.write_paused_until == 0 &&
+        conn.isWriteTimedOut(WRITE_TIMEOUT_SECONDS)) {
+      LOG(INFO) << "Write timeout on fd " << conn_fd << " (no progress for >= "
+                << WRITE_TIMEOUT_SECONDS << "s)";
       timed_out_fds.push_back(conn_fd);
     }
   }
 
+  for (std::size_t i = 0; i < cgi_pipe_fds.size(); ++i) {
+    if (cgi_pipe_to_conn_.find(cgi_pipe_fds[i]) != cgi_pipe_to_conn_.end()) {
+      handleCgiPipeEvent(cgi_pipe_fds[i]);
+    }
+  }
+
   // Handle CGI timeouts - cleanup handler and send response
   for (std::size_t i = 0; i < cgi_timed_out_fds.size(); ++i) {
     int conn_fd = cgi_timed_out_fds[i];
@@ -614,6 +872,10 @@ void ServerManager::checkConnectionTimeouts() {
     updateEvents(conn_fd, EPOLLOUT);
   }
 
+  for (std::size_t i = 0; i < linger_done_fds.size(); ++i) {
+    closeAndRemoveConnection(linger_done_fds[i]);
+  }
+
   // Second pass: close timed out connections
   for (std::size_t i = 0; i < timed_out_fds.size(); ++i) {
     int conn_fd = timed_out_fds[i];
@@ -651,6 +913,8 @@ void ServerManager::closeAndRemoveConnection(int fd) {
 
   Connection& c = it->second;
   cleanupHandlerResources(c);
+  // Whatever the handler is still doing is for nobody now
+  c.cancelHandler();
   close(fd);
   connections_.erase(it);
 }
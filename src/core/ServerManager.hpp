@@ -3,10 +3,16 @@
 #include <sys/types.h>
 
 #include <map>
+#include <set>
 #include <vector>
 
 #include "Connection.hpp"
+#include "GzipCache.hpp"
+#include "HeaderBufferPool.hpp"
+#include "OpenFileCache.hpp"
 #include "Server.hpp"
+#include "StaticCache.hpp"
+#include "VirtualHosts.hpp"
 
 class ServerManager {
  private:
@@ -16,10 +22,28 @@ class ServerManager {
   int efd_;
   int sfd_;
   bool stop_requested_;
-  std::map<int, Server> servers_;
+  // Servers sharing each listening fd, selected per request by Host
+  std::map<int, VirtualHosts> servers_;
+  // Listening fds taken over from a supervisor (socket activation); their
+  // Unix socket files belong to the supervisor and are not removed
+  std::set<int> inherited_fds_;
+  // Large request-header buffers per listening fd; declared before
+  // connections_ so connections return their buffers before it is destroyed
+  std::map<int, HeaderBufferPool> header_pools_;
+  // Open file cache per listening fd, shared by its servers; declared before
+  // connections_ for the same reason (connections give back lent fds)
+  std::map<int, OpenFileCache> file_caches_;
+  // In-memory static files of every location with cache_max_size, kept
+  // fresh through its inotify fd in the event loop
+  StaticCache static_cache_;
+  // Compressed static files of every location with gzip_cache_size
+  GzipCache gzip_cache_;
   std::map<int, Connection> connections_;
   // Mapping of CGI pipe FDs to connection FDs for epoll event handling
   std::map<int, int> cgi_pipe_to_conn_;
+  // Connections whose output is paused (Connection::write_paused_until),
+  // by the monotonic time in ms they are due at
+  std::multimap<long long, int> write_timers_;
 
   // Register a CGI pipe FD with epoll for monitoring
   // Returns true on success, false on error
@@ -38,12 +62,21 @@ class ServerManager {
   void prepareResponses();
   // Check all connections for timeout and close stale ones
   void checkConnectionTimeouts();
+  // Stop watching `c` for EPOLLOUT until its write_paused_until
+  void pauseWrites(int fd, const Connection& c);
+  // Watch the paused connections that are due for EPOLLOUT again
+  void resumePausedWrites();
+  // epoll_wait timeout: `max_ms`, or less when a paused connection is due
+  // sooner
+  int nextEventTimeout(int max_ms) const;
 
  public:
   ServerManager();
   ~ServerManager();
 
-  // Initializes all servers from configuration
+  // Initializes all servers from configuration. Listening sockets passed in
+  // with LISTEN_FDS/LISTEN_PID (systemd socket activation) are used for the
+  // addresses they are bound to; the others are opened here.
   void initServers(std::vector<Server>& servers);
 
   // Accepts new client connection on given listening socket
@@ -59,3 +59,23 @@ TEST(ServerTests, ErrorPageMapIsEmpty) {
   Server s;
   EXPECT_TRUE(s.error_page.empty());
 }
+
+TEST(ServerTests, MatchLocationServesInheritedLocations) {
+  Server s;
+  s.root = "/srv/www";
+  s.error_page[http::S_404_NOT_FOUND] = "/404.html";
+  s.locations["/api"] = Location("/api");
+  s.compileLocations();
+
+  const Location& api = s.matchLocation("/api/users");
+  EXPECT_EQ(api.path, "/api");
+  EXPECT_EQ(api.root, "/srv/www");
+  EXPECT_EQ(api.error_page.find(http::S_404_NOT_FOUND)->second,
+            "/srv/www/404.html");
+  // Lookups hand out the same resolved object instead of a fresh copy
+  EXPECT_EQ(&api, &s.matchLocation("/api"));
+
+  const Location& other = s.matchLocation("/other");
+  EXPECT_EQ(other.path, "/");
+  EXPECT_EQ(other.root, "/srv/www");
+}
@@ -0,0 +1,177 @@
+#include "VirtualHosts.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+
+#include "Logger.hpp"
+
+namespace {
+
+// Split "a.b.example.com" into labels, last label first.
+std::vector<std::string> reversedLabels(const std::string& name) {
+  std::vector<std::string> labels;
+  std::size_t start = 0;
+  while (true) {
+    std::size_t dot = name.find('.', start);
+    labels.push_back(name.substr(start, dot - start));
+    if (dot == std::string::npos) {
+      break;
+    }
+    start = dot + 1;
+  }
+  std::reverse(labels.begin(), labels.end());
+  return labels;
+}
+
+}  // namespace
+
+VirtualHosts::VirtualHosts()
+    : servers_(),
+      default_(-1),
+      explicit_default_(false),
+      exact_(),
+      wildcard_(1) {
+  wildcard_[0].server = -1;
+}
+
+VirtualHosts::VirtualHosts(const VirtualHosts& other)
+    : servers_(other.servers_),
+      default_(other.default_),
+      explicit_default_(other.explicit_default_),
+      exact_(other.exact_),
+      wildcard_(other.wildcard_) {}
+
+VirtualHosts& VirtualHosts::operator=(const VirtualHosts& other) {
+  if (this != &other) {
+    servers_ = other.servers_;
+    default_ = other.default_;
+    explicit_default_ = other.explicit_default_;
+    exact_ = other.exact_;
+    wildcard_ = other.wildcard_;
+  }
+  return *this;
+}
+
+VirtualHosts::~VirtualHosts() {}
+
+void VirtualHosts::add(const Server& srv) {
+  if (srv.default_server && explicit_default_) {
+    std::ostringstream oss;
+    oss << "Duplicate default_server for port " << srv.port;
+    LOG(ERROR) << oss.str();
+    throw std::runtime_error(oss.str());
+  }
+
+  int index = static_cast<int>(servers_.size());
+  servers_.push_back(srv);
+  if (default_ < 0 || srv.default_server) {
+    default_ = index;
+    explicit_default_ = srv.default_server;
+  }
+
+  for (std::size_t i = 0; i < srv.server_names.size(); ++i) {
+    const std::string& name = srv.server_names[i];
+    if (name[0] == '*') {
+      addWildcard_(name.substr(2), index);
+    } else if (name[0] == '.') {
+      addExact_(name.substr(1), index);
+      addWildcard_(name.substr(1), index);
+    } else {
+      addExact_(name, index);
+    }
+  }
+}
+
+const Server& VirtualHosts::select(const std::string& host) const {
+  std::string name = normalizeHost(host);
+  if (!name.empty()) {
+    int found = exact_.find(name);
+    if (found < 0) {
+      found = findWildcard_(name);
+    }
+    if (found >= 0) {
+      return servers_[found];
+    }
+  }
+  return servers_[default_];
+}
+
+const Server& VirtualHosts::defaultServer() const {
+  return servers_[default_];
+}
+
+std::size_t VirtualHosts::size() const {
+  return servers_.size();
+}
+
+std::string VirtualHosts::normalizeHost(const std::string& host) {
+  std::string name;
+  if (!host.empty() && host[0] == '[') {
+    // IPv6 literal: keep the brackets, drop the port after them
+    std::size_t close = host.find(']');
+    name = host.substr(0, close == std::string::npos ? host.size() : close + 1);
+  } else {
+    name = host.substr(0, host.find(':'));
+  }
+  if (!name.empty() && name[name.size() - 1] == '.') {
+    name.erase(name.size() - 1);
+  }
+  for (std::size_t i = 0; i < name.size(); ++i) {
+    name[i] =
+        static_cast<char>(std::tolower(static_cast<unsigned char>(name[i])));
+  }
+  return name;
+}
+
+void VirtualHosts::addExact_(const std::string& name, int server) {
+  if (!exact_.insert(name, server)) {
+    LOG(INFO) << "Conflicting server_name \"" << name << "\" on port "
+              << servers_[server].port << ", ignored";
+  }
+}
+
+void VirtualHosts::addWildcard_(const std::string& suffix, int server) {
+  std::vector<std::string> labels = reversedLabels(suffix);
+  std::size_t node = 0;
+  for (std::size_t i = 0; i < labels.size(); ++i) {
+    std::map<std::string, std::size_t>::const_iterator it =
+        wildcard_[node].children.find(labels[i]);
+    if (it != wildcard_[node].children.end()) {
+      node = it->second;
+      continue;
+    }
+    std::size_t child = wildcard_.size();
+    wildcard_.push_back(TrieNode());
+    wildcard_[child].server = -1;
+    wildcard_[node].children[labels[i]] = child;
+    node = child;
+  }
+  if (wildcard_[node].server >= 0) {
+    LOG(INFO) << "Conflicting server_name \"*." << suffix << "\" on port "
+              << servers_[server].port << ", ignored";
+    return;
+  }
+  wildcard_[node].server = server;
+}
+
+// Walk the trie from the last label; every node passed with labels still
+// left over is a wildcard match, and the deepest one is the longest.
+int VirtualHosts::findWildcard_(const std::string& name) const {
+  std::vector<std::string> labels = reversedLabels(name);
+  int best = -1;
+  std::size_t node = 0;
+  for (std::size_t i = 0; i + 1 < labels.size(); ++i) {
+    std::map<std::string, std::size_t>::const_iterator it =
+        wildcard_[node].children.find(labels[i]);
+    if (it == wildcard_[node].children.end()) {
+      break;
+    }
+    node = it->second;
+    if (wildcard_[node].server >= 0) {
+      best = wildcard_[node].server;
+    }
+  }
+  return best;
+}
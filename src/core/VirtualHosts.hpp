@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Server.hpp"
+#include "StringIndex.hpp"
+
+// The servers configured on one listening host:port and the lookup that
+// picks one of them for a request from its Host header.
+//
+// Names are indexed once at startup: exact names go into a StringIndex hash
+// table, wildcard names ("*.example.com") into a trie keyed by labels
+// from the right, so a lookup costs one hash probe plus one walk over the
+// labels of the host. Resolution order follows the usual virtual-host rules:
+//   1. exact name,
+//   2. longest matching wildcard,
+//   3. the default server (the one marked `default_server`, otherwise the
+//      first one configured for the address).
+class VirtualHosts {
+ public:
+  VirtualHosts();
+  VirtualHosts(const VirtualHosts& other);
+  VirtualHosts& operator=(const VirtualHosts& other);
+  ~VirtualHosts();
+
+  // Register a server and index its names. The first server added becomes
+  // the default unless a later one is marked default_server. A name already
+  // claimed by an earlier server is ignored with a warning; a second
+  // default_server throws std::runtime_error.
+  void add(const Server& srv);
+
+  // Server that should answer a request carrying `host` (a Host header
+  // value, port and trailing dot allowed). Must not be called when empty.
+  const Server& select(const std::string& host) const;
+
+  const Server& defaultServer() const;
+  std::size_t size() const;
+
+  // Lowercase `host` and strip any ":port" suffix, IPv6 brackets and a
+  // trailing dot, so it can be compared with configured names.
+  static std::string normalizeHost(const std::string& host);
+
+ private:
+  struct TrieNode {
+    std::map<std::string, std::size_t> children;  // label -> node index
+    int server;  // server owning "*.<labels to here>", -1 when none
+  };
+
+  void addExact_(const std::string& name, int server);
+  void addWildcard_(const std::string& suffix, int server);
+  int findWildcard_(const std::string& name) const;
+
+  std::vector<Server> servers_;
+  int default_;
+  bool explicit_default_;
+  StringIndex exact_;               // name -> index into servers_
+  std::vector<TrieNode> wildcard_;  // node 0 is the root
+};
@@ -0,0 +1,124 @@
+#include "VirtualHosts.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Server identified by its root so tests can tell which one was selected
+Server namedServer(const std::string& root, const std::string& names) {
+  Server srv;
+  srv.root = root;
+  std::istringstream in(names);
+  std::string name;
+  while (in >> name) {
+    srv.server_names.push_back(name);
+  }
+  return srv;
+}
+
+}  // namespace
+
+TEST(VirtualHostsTests, ExactNameIsMatched) {
+  VirtualHosts vh;
+  vh.add(namedServer("a", "a.example www.a.example"));
+  vh.add(namedServer("b", "b.example"));
+  EXPECT_EQ(vh.select("b.example").root, "b");
+  EXPECT_EQ(vh.select("www.a.example").root, "a");
+  EXPECT_EQ(vh.size(), 2u);
+}
+
+TEST(VirtualHostsTests, HostIsNormalizedBeforeLookup) {
+  VirtualHosts vh;
+  vh.add(namedServer("a", "a.example"));
+  vh.add(namedServer("b", "b.example"));
+  EXPECT_EQ(vh.select("B.Example:8080").root, "b");
+  EXPECT_EQ(vh.select("b.example.").root, "b");
+  EXPECT_EQ(VirtualHosts::normalizeHost("[::1]:8080"), "[::1]");
+  EXPECT_EQ(VirtualHosts::normalizeHost("Example.COM."), "example.com");
+}
+
+TEST(VirtualHostsTests, UnknownOrEmptyHostFallsBackToFirstServer) {
+  VirtualHosts vh;
+  vh.add(namedServer("a", "a.example"));
+  vh.add(namedServer("b", "b.example"));
+  EXPECT_EQ(vh.select("c.example").root, "a");
+  EXPECT_EQ(vh.select("").root, "a");
+  EXPECT_EQ(vh.defaultServer().root, "a");
+}
+
+TEST(VirtualHostsTests, DefaultServerOverridesConfigurationOrder) {
+  VirtualHosts vh;
+  vh.add(namedServer("a", "a.example"));
+  Server b = namedServer("b", "b.example");
+  b.default_server = true;
+  vh.add(b);
+  vh.add(namedServer("c", "c.example"));
+  EXPECT_EQ(vh.select("unknown").root, "b");
+  EXPECT_EQ(vh.select("a.example").root, "a");
+}
+
+TEST(VirtualHostsTests, SecondDefaultServerIsRejected) {
+  VirtualHosts vh;
+  Server a = namedServer("a", "a.example");
+  a.default_server = true;
+  vh.add(a);
+  Server b = namedServer("b", "b.example");
+  b.default_server = true;
+  EXPECT_THROW(vh.add(b), std::runtime_error);
+}
+
+TEST(VirtualHostsTests, WildcardNeedsAtLeastOneMoreLabel) {
+  VirtualHosts vh;
+  vh.add(namedServer("default", "default.example"));
+  vh.add(namedServer("w", "*.example.com"));
+  EXPECT_EQ(vh.select("www.example.com").root, "w");
+  EXPECT_EQ(vh.select("a.b.example.com").root, "w");
+  EXPECT_EQ(vh.select("example.com").root, "default");
+  EXPECT_EQ(vh.select("badexample.com").root, "default");
+}
+
+TEST(VirtualHostsTests, LongestWildcardWinsAndExactBeatsWildcard) {
+  VirtualHosts vh;
+  vh.add(namedServer("short", "*.example.com"));
+  vh.add(namedServer("long", "*.api.example.com"));
+  vh.add(namedServer("exact", "v1.api.example.com"));
+  EXPECT_EQ(vh.select("www.example.com").root, "short");
+  EXPECT_EQ(vh.select("v2.api.example.com").root, "long");
+  EXPECT_EQ(vh.select("v1.api.example.com").root, "exact");
+  EXPECT_EQ(vh.select("api.example.com").root, "short");
+}
+
+TEST(VirtualHostsTests, LeadingDotCoversNameAndSubdomains) {
+  VirtualHosts vh;
+  vh.add(namedServer("default", "other"));
+  vh.add(namedServer("d", ".example.org"));
+  EXPECT_EQ(vh.select("example.org").root, "d");
+  EXPECT_EQ(vh.select("mail.example.org").root, "d");
+}
+
+TEST(VirtualHostsTests, FirstServerKeepsAConflictingName) {
+  VirtualHosts vh;
+  vh.add(namedServer("a", "same.example *.wild.example"));
+  vh.add(namedServer("b", "same.example *.wild.example"));
+  EXPECT_EQ(vh.select("same.example").root, "a");
+  EXPECT_EQ(vh.select("x.wild.example").root, "a");
+}
+
+TEST(VirtualHostsTests, ManyNamesSurviveRehashing) {
+  VirtualHosts vh;
+  for (int i = 0; i < 100; ++i) {
+    std::ostringstream name;
+    name << "host" << i << ".example";
+    vh.add(namedServer(name.str(), name.str()));
+  }
+  for (int i = 0; i < 100; ++i) {
+    std::ostringstream name;
+    name << "host" << i << ".example";
+    EXPECT_EQ(vh.select(name.str()).root, name.str());
+  }
+  EXPECT_EQ(vh.select("host100.example").root, "host0.example");
+}
@@ -9,11 +9,13 @@
 #include <vector>
 
 #include "Connection.hpp"
+#include "HttpMethod.hpp"
 #include "HttpStatus.hpp"
 #include "Logger.hpp"
 #include "Uri.hpp"
 #include "constants.hpp"
 #include "http_utils.hpp"
+#include "utils.hpp"
 
 // Small RAII guard for DIR* since project targets C++98 (no unique_ptr)
 namespace {
@@ -36,18 +38,23 @@ struct DirGuard {
 }  // namespace
 
 AutoindexHandler::AutoindexHandler(const std::string& dirpath,
-                                   const std::string& display_path)
-    : dirpath_(dirpath), uri_path_(display_path) {}
+                                   const std::string& display_path,
+                                   const Location* location)
+    : dirpath_(dirpath), uri_path_(display_path), location_(location) {}
 
 AutoindexHandler::~AutoindexHandler() {}
 
 HandlerResult AutoindexHandler::start(Connection& conn) {
-  const std::string& method = conn.request.request_line.method;
+  http::Method method = conn.request.request_line.method;
   // Only GET and HEAD are allowed for autoindex
-  if (method != "GET" && method != "HEAD") {
-    conn.response.addHeader("Allow", "GET, HEAD");
-    conn.prepareErrorResponse(http::S_405_METHOD_NOT_ALLOWED);
-    return HR_DONE;
+  switch (method) {
+    case http::GET:
+    case http::HEAD:
+      break;
+    default:
+      conn.response.addHeader("Allow", "GET, HEAD");
+      conn.prepareErrorResponse(http::S_405_METHOD_NOT_ALLOWED);
+      return HR_DONE;
   }
   DIR* raw_d = opendir(dirpath_.c_str());
   if (!raw_d) {
@@ -155,17 +162,21 @@ HandlerResult AutoindexHandler::start(Connection& conn) {
   std::string body_str = body.str();
 
   conn.response.setStatus(http::S_200_OK, conn.getHttpVersion());
-  if (method == "HEAD") {
+  if (method == http::HEAD) {
     // For HEAD requests avoid allocating the full body; set headers only
     conn.response.addHeader("Content-Type", "text/html; charset=utf-8");
-    std::ostringstream oss;
-    oss << body_str.size();
-    conn.response.addHeader("Content-Length", oss.str());
+    conn.response.addHeader(
+        "Content-Length",
+        toDecimalString(static_cast<long long>(body_str.size())));
   } else {
     conn.response.setBodyWithContentType(body_str, "text/html; charset=utf-8");
+    conn.gzipBody(conn.response.getBody().data);
   }
 
-  conn.write_buffer = conn.response.serialize();
+  if (location_ != NULL && !location_->response_headers.empty()) {
+    conn.response.extra_headers = &location_->response_headers;
+  }
+  conn.response.serializeInto(conn.write_buffer);
   conn.write_offset = 0;
 
   return HR_DONE;
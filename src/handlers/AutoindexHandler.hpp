@@ -5,14 +5,17 @@
 #include <string>
 
 #include "IHandler.hpp"
+#include "Location.hpp"
 
 class AutoindexHandler : public IHandler {
  public:
   // dirpath: filesystem path to the directory
   // display_path: user-facing URI path to show in the listing (e.g.
   // "/autoindex/")
+  // location: adds its "expires" and "add_header" lines to the listing
   explicit AutoindexHandler(const std::string& dirpath,
-                            const std::string& display_path);
+                            const std::string& display_path,
+                            const Location* location = NULL);
   virtual ~AutoindexHandler();
 
   virtual HandlerResult start(Connection& conn);
@@ -21,4 +24,5 @@ class AutoindexHandler : public IHandler {
  private:
   std::string dirpath_;
   std::string uri_path_;
+  const Location* location_;
 };
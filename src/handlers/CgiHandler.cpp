@@ -13,6 +13,7 @@
 #include <sstream>
 
 #include "Connection.hpp"
+#include "HttpMethod.hpp"
 #include "HttpStatus.hpp"
 #include "Logger.hpp"
 #include "constants.hpp"
@@ -53,6 +54,17 @@ void CgiHandler::cleanupProcess() {
   }
 }
 
+void CgiHandler::cancel(Connection& conn) {
+  (void)conn;
+  if (script_pid_ > 0) {
+    LOG(INFO) << "CGI client went away, killing pid " << script_pid_;
+    if (kill(-script_pid_, SIGKILL) < 0) {
+      kill(script_pid_, SIGKILL);
+    }
+  }
+  cleanupProcess();
+}
+
 int CgiHandler::getMonitorFd() const {
   return pipe_read_fd_;
 }
@@ -110,6 +122,23 @@ HandlerResult CgiHandler::start(Connection& conn) {
     return HR_DONE;
   }
 
+  // A body spooled to disk is handed to the script as its stdin directly;
+  // only in-memory bodies are written through the pipe.
+  const Body& body = conn.request.getBody();
+  int stdin_fd = pipe_to_cgi[0];
+  if (body.isSpooled()) {
+    if (lseek(body.fd, 0, SEEK_SET) < 0) {
+      LOG_PERROR(ERROR, "CgiHandler: lseek on spooled body failed");
+      close(pipe_to_cgi[0]);
+      close(pipe_to_cgi[1]);
+      close(pipe_from_cgi[0]);
+      close(pipe_from_cgi[1]);
+      conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+      return HR_DONE;
+    }
+    stdin_fd = body.fd;
+  }
+
   // Fork CGI process
   script_pid_ = fork();
   if (script_pid_ == -1) {
@@ -123,12 +152,14 @@ HandlerResult CgiHandler::start(Connection& conn) {
   }
 
   if (script_pid_ == 0) {
-    // Child process - execute CGI script
+    // Child process - execute CGI script in its own process group so that
+    // cancel() can kill whatever the script starts along with it
+    setpgid(0, 0);
     close(pipe_to_cgi[1]);    // Close write end
     close(pipe_from_cgi[0]);  // Close read end
 
     // Redirect stdin/stdout
-    dup2(pipe_to_cgi[0], STDIN_FILENO);
+    dup2(stdin_fd, STDIN_FILENO);
     dup2(pipe_from_cgi[1], STDOUT_FILENO);
     dup2(pipe_from_cgi[1], STDERR_FILENO);
 
@@ -172,7 +203,8 @@ HandlerResult CgiHandler::start(Connection& conn) {
     exit(EXIT_NOT_FOUND);
   }
 
-  // Parent process
+  // Parent process; set the group here too so cancel() cannot race the child
+  setpgid(script_pid_, script_pid_);
   close(pipe_to_cgi[0]);    // Close read end
   close(pipe_from_cgi[1]);  // Close write end
 
@@ -189,12 +221,11 @@ HandlerResult CgiHandler::start(Connection& conn) {
     return HR_DONE;
   }
 
-  // Send request body to CGI if present
-  const std::string& body = conn.request.getBody().data;
-  if (!body.empty()) {
+  // Send an in-memory request body to CGI if present
+  if (!body.isSpooled() && !body.empty()) {
     size_t total_written = 0;
-    const char* buf = body.c_str();
-    size_t remaining = body.length();
+    const char* buf = body.data.c_str();
+    size_t remaining = body.data.length();
     while (remaining > 0) {
       ssize_t written = write(pipe_write_fd_, buf + total_written, remaining);
       if (written == -1) {
@@ -246,11 +277,6 @@ bool CgiHandler::checkTimeout(Connection& conn) {
 }
 
 HandlerResult CgiHandler::readCgiOutput(Connection& conn) {
-  // Check for timeout before reading
-  if (checkTimeout(conn)) {
-    return HR_DONE;
-  }
-
   char buffer[WRITE_BUF_SIZE];
   ssize_t bytes_read;
 
@@ -282,6 +308,13 @@ HandlerResult CgiHandler::readCgiOutput(Connection& conn) {
   waitpid(script_pid_, &status, 0);
   script_pid_ = -1;
 
+  if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) {
+    // Ended by its own alarm(CGI_TIMEOUT_SECONDS)
+    LOG(ERROR) << "CGI script timed out after " << CGI_TIMEOUT_SECONDS
+               << " seconds: " << script_path_;
+    conn.prepareErrorResponse(http::S_504_GATEWAY_TIMEOUT);
+    return HR_DONE;
+  }
   if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
     int exit_code = WEXITSTATUS(status);
     if (exit_code == EXIT_NOT_FOUND) {
@@ -304,14 +337,10 @@ HandlerResult CgiHandler::readCgiOutput(Connection& conn) {
     conn.response.status_line.status_code = http::S_200_OK;
     conn.response.status_line.reason = "OK";
     conn.response.addHeader("Content-Type", "text/plain");
+    conn.gzipBody(accumulated_output_);
 
-    std::ostringstream response_stream;
-    response_stream << conn.response.startLine() << CRLF;
-    response_stream << conn.response.serializeHeadersWithConnection();
-    response_stream << CRLF;
-    response_stream << accumulated_output_;
-
-    conn.write_buffer = response_stream.str();
+    conn.response.serializeHeadInto(conn.write_buffer);
+    conn.write_buffer += accumulated_output_;
   }
 
   LOG(DEBUG) << "CGI finished, response size: " << conn.write_buffer.size();
@@ -380,13 +409,17 @@ HandlerResult CgiHandler::parseOutput(Connection& conn,
     headers_parsed_ = true;
     remaining_data_ = body_part;
 
-    // Build response headers
-    std::ostringstream response_stream;
-    response_stream << conn.response.startLine() << CRLF;
-    response_stream << conn.response.serializeHeadersWithConnection();
-    response_stream << CRLF;
+    // The whole output is in hand here, so it can be compressed as one
+    // body; a Content-Encoding from the script leaves it alone. Like nginx,
+    // only a whole 200 body is compressed.
+    std::string content_range;
+    if (conn.response.status_line.status_code == http::S_200_OK &&
+        !conn.response.getHeader("Content-Range", content_range)) {
+      conn.gzipBody(body_part);
+    }
 
-    conn.write_buffer = response_stream.str();
+    // Build response headers
+    conn.response.serializeHeadInto(conn.write_buffer);
 
     if (!body_part.empty()) {
       conn.write_buffer += body_part;
@@ -411,7 +444,8 @@ void CgiHandler::setupEnvironment(Connection& conn) {
   setenv("REDIRECT_STATUS", "200", 1);
 
   // Standard CGI environment variables
-  setenv("REQUEST_METHOD", conn.request.request_line.method.c_str(), 1);
+  setenv("REQUEST_METHOD",
+         http::methodToString(conn.request.request_line.method).c_str(), 1);
   setenv("REQUEST_URI", conn.request.request_line.uri.c_str(), 1);
   setenv("SERVER_PROTOCOL", conn.request.request_line.version.c_str(), 1);
   setenv("GATEWAY_INTERFACE", "CGI/1.1", 1);
@@ -454,15 +488,18 @@ void CgiHandler::setupEnvironment(Connection& conn) {
   if (conn.request.getHeader("Content-Length", content_length_str)) {
     setenv("CONTENT_LENGTH", content_length_str.c_str(), 1);
   } else {
-    std::ostringstream len_ss;
-    len_ss << conn.request.getBody().data.length();
-    setenv("CONTENT_LENGTH", len_ss.str().c_str(), 1);
+    std::string len = toDecimalString(
+        static_cast<long long>(conn.request.getBody().size()));
+    setenv("CONTENT_LENGTH", len.c_str(), 1);
   }
 
   // Export Cookie headers to HTTP_COOKIE environment variable for CGI.
-  // If multiple Cookie headers are present, join them with "; " per RFC.
+  // The common single-header case is forwarded as-is; only when a client
+  // split its cookies over several headers are they joined with "; ".
   std::vector<std::string> cookie_headers = conn.request.getHeaders("Cookie");
-  if (!cookie_headers.empty()) {
+  if (cookie_headers.size() == 1) {
+    setenv("HTTP_COOKIE", cookie_headers[0].c_str(), 1);
+  } else if (!cookie_headers.empty()) {
     std::string joined;
     for (std::vector<std::string>::const_iterator it = cookie_headers.begin();
          it != cookie_headers.end(); ++it) {
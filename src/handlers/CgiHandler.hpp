@@ -18,6 +18,7 @@ class CgiHandler : public IHandler {
   virtual HandlerResult resume(Connection& conn);
   virtual int getMonitorFd() const;
   virtual bool checkTimeout(Connection& conn);
+  virtual void cancel(Connection& conn);
 
  private:
   void setupEnvironment(Connection& conn);
@@ -14,7 +14,7 @@ HandlerResult EchoHandler::start(Connection& conn) {
                                        "text/plain; charset=utf-8");
 
   // Serialize entire response into write_buffer
-  conn.write_buffer = conn.response.serialize();
+  conn.response.serializeInto(conn.write_buffer);
   conn.write_offset = 0;
 
   return HR_DONE;
@@ -3,8 +3,10 @@
 #include <unistd.h>
 
 #include "Connection.hpp"
+#include "HttpMethod.hpp"
 #include "Logger.hpp"
 #include "constants.hpp"
+#include "utils.hpp"
 
 ErrorFileHandler::ErrorFileHandler(const std::string& path)
     : path_(path), fi_(), offset_(0), end_offset_(-1), active_(false) {
@@ -17,39 +19,53 @@ ErrorFileHandler::~ErrorFileHandler() {
   }
 }
 
+void ErrorFileHandler::cancel(Connection& conn) {
+  (void)conn;
+  if (fi_.fd >= 0) {
+    file_utils::closeFile(fi_);
+  }
+  active_ = false;
+}
+
 HandlerResult ErrorFileHandler::start(Connection& conn) {
-  // Probe the file to get size and content type without keeping it open.
-  FileInfo probe;
-  if (!file_utils::openFile(path_, probe)) {
+  // Open once and keep the fd for resume(); through the open file cache a
+  // frequently served error page costs no open() at all
+  if (!file_utils::openFile(path_, fi_, conn.file_cache)) {
     LOG(ERROR) << "ErrorFileHandler: openFile failed for " << path_;
     return HR_ERROR;
   }
-  // Store metadata; close the probe fd so we don't hold it across event loop
-  fi_.fd = -1;
-  fi_.size = probe.size;
-  fi_.content_type = probe.content_type;
-  file_utils::closeFile(probe);
 
   offset_ = 0;
   end_offset_ = fi_.size - 1;
   active_ = true;
+
+  // A compressed copy is sent from memory instead of streaming the file
+  std::string coding = conn.negotiateGzip(fi_.content_type, fi_.size);
+  std::string scratch;
+  const std::string* gz =
+      coding.empty() ? NULL : conn.gzipFile(path_, fi_, coding, scratch);
+  if (gz != NULL) {
+    conn.response.addHeader("Content-Type", fi_.content_type);
+    conn.response.addHeader("Content-Encoding", coding);
+    conn.response.addHeader(
+        "Content-Length", toDecimalString(static_cast<long long>(gz->size())));
+    conn.response.serializeHeadInto(conn.write_buffer);
+    conn.write_buffer.append(*gz);
+    conn.write_offset = 0;
+    file_utils::closeFile(fi_);
+    active_ = false;
+    return HR_WOULD_BLOCK;  // resume() finishes once the buffer is sent
+  }
+
   // Prepare headers with error status already set by Connection
   conn.response.addHeader("Content-Type", fi_.content_type);
-  {
-    std::ostringstream tmp;
-    tmp << fi_.size;
-    conn.response.addHeader("Content-Length", tmp.str());
-  }
-  std::ostringstream header_stream;
-  header_stream << conn.response.startLine() << CRLF;
-  header_stream << conn.response.serializeHeadersWithConnection();
-  header_stream << CRLF;
-  conn.write_buffer = header_stream.str();
+  conn.response.addHeader("Content-Length",
+                          toDecimalString(static_cast<long long>(fi_.size)));
+  conn.response.serializeHeadInto(conn.write_buffer);
   conn.write_offset = 0;
 
   // If the request was a HEAD, send only headers and do not stream body.
-  const std::string& method = conn.request.request_line.method;
-  if (method == "HEAD") {
+  if (conn.request.request_line.method == http::HEAD) {
     // Do not mark active for streaming; resume() will immediately finish.
     active_ = false;
     return HR_WOULD_BLOCK;  // handler installed so Connection will call
@@ -64,17 +80,15 @@ HandlerResult ErrorFileHandler::resume(Connection& conn) {
     return HR_DONE;
   }
 
-  // Ensure file is opened for streaming
   if (fi_.fd < 0) {
-    if (!file_utils::openFile(path_, fi_)) {
-      LOG(ERROR) << "ErrorFileHandler: openFile failed in resume for " << path_;
-      return HR_ERROR;
-    }
+    LOG(ERROR) << "ErrorFileHandler: no open file in resume for " << path_;
+    return HR_ERROR;
   }
   LOG(DEBUG) << "ErrorFileHandler: streaming " << path_ << " fd=" << fi_.fd
              << " offset=" << offset_ << " end=" << end_offset_;
 
-  int r = file_utils::streamToSocket(conn.fd, fi_.fd, offset_, end_offset_ + 1);
+  int r = file_utils::streamToSocket(conn.fd, fi_.fd, offset_, end_offset_ + 1,
+                                     &conn.send_quota);
   LOG(DEBUG) << "ErrorFileHandler: streamToSocket returned " << r
              << " new offset=" << offset_;
   if (r < 0) {
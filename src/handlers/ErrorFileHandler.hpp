@@ -12,6 +12,7 @@ class ErrorFileHandler : public IHandler {
 
   virtual HandlerResult start(Connection& conn);
   virtual HandlerResult resume(Connection& conn);
+  virtual void cancel(Connection& conn);
   virtual int getMonitorFd() const;
 
  private:
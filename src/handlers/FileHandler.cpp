@@ -9,20 +9,35 @@
 #include <cstring>
 #include <ctime>
 #include <sstream>
+#include <vector>
 
+#include "ByteBuilder.hpp"
 #include "Connection.hpp"
+#include "HttpMethod.hpp"
 #include "HttpStatus.hpp"
 #include "Logger.hpp"
 #include "Request.hpp"
 #include "constants.hpp"
 #include "file_utils.hpp"
+#include "http_utils.hpp"
+#include "utils.hpp"
 
-FileHandler::FileHandler(const std::string& path, const std::string& uri)
+FileHandler::FileHandler(const std::string& path, const std::string& uri,
+                         const Location* location)
     : path_(path),
       uri_(uri),
+      location_(location),
+      send_path_(path),
+      encoding_(),
+      content_type_(),
       fi_(),
       start_offset_(0),
       end_offset_(-1),
+      multipart_(),
+      part_segment_(0),
+      part_offset_(0),
+      body_sent_(0),
+      body_start_ms_(0),
       active_(false) {
   fi_.fd = -1;
 }
@@ -34,21 +49,24 @@ FileHandler::~FileHandler() {
 }
 
 HandlerResult FileHandler::start(Connection& conn) {
-  const std::string& method = conn.request.request_line.method;
+  http::Method method = conn.request.request_line.method;
 
-  LOG(DEBUG) << "FileHandler: processing " << method
+  LOG(DEBUG) << "FileHandler: processing " << http::methodToString(method)
              << " request for fd=" << conn.fd << " path=" << path_;
 
-  if (method == "GET") {
-    return handleGet(conn);
-  } else if (method == "HEAD") {
-    return handleHead(conn);
-  } else if (method == "POST") {
-    return handlePost(conn);
-  } else if (method == "PUT") {
-    return handlePut(conn);
-  } else if (method == "DELETE") {
-    return handleDelete(conn);
+  switch (method) {
+    case http::GET:
+      return handleGet(conn);
+    case http::HEAD:
+      return handleHead(conn);
+    case http::POST:
+      return handlePost(conn);
+    case http::PUT:
+      return handlePut(conn);
+    case http::DELETE:
+      return handleDelete(conn);
+    default:
+      break;
   }
 
   // Unsupported method for file resources
@@ -62,8 +80,20 @@ HandlerResult FileHandler::resume(Connection& conn) {
   }
 
   // Only GET needs streaming (HEAD/PUT/DELETE complete in start())
-  int r = file_utils::streamToSocket(conn.fd, fi_.fd, start_offset_,
-                                     end_offset_ + 1);
+  if (!applyRateLimit(conn)) {
+    return HR_WOULD_BLOCK;
+  }
+  std::size_t budget = conn.send_quota.budget;
+  int r = 0;
+  if (!multipart_.ranges.empty()) {
+    r = file_utils::streamMultipartToSocket(conn.fd, fi_.fd, multipart_,
+                                            part_segment_, part_offset_,
+                                            &conn.send_quota);
+  } else {
+    r = file_utils::streamToSocket(conn.fd, fi_.fd, start_offset_,
+                                   end_offset_ + 1, &conn.send_quota);
+  }
+  body_sent_ += static_cast<long long>(budget - conn.send_quota.budget);
   if (r < 0) {
     file_utils::closeFile(fi_);
     active_ = false;
@@ -77,6 +107,14 @@ HandlerResult FileHandler::resume(Connection& conn) {
   return HR_DONE;
 }
 
+void FileHandler::cancel(Connection& conn) {
+  (void)conn;
+  if (fi_.fd >= 0) {
+    file_utils::closeFile(fi_);
+  }
+  active_ = false;
+}
+
 HandlerResult FileHandler::handleGet(Connection& conn) {
   std::string range;
   const std::string* rangePtr = NULL;
@@ -84,34 +122,86 @@ HandlerResult FileHandler::handleGet(Connection& conn) {
     rangePtr = &range;
   }
 
+  selectVariant(conn);
+  const StaticCache::File* hit = NULL;
+  if (useStaticCache(conn, NULL)) {
+    hit = conn.static_cache->find(send_path_);
+  }
+  // Conditional headers are settled before the body is opened
+  FileStat st;
+  if (currentValidators(conn, hit, st)) {
+    addGzipVary(conn, st);
+    if (notModified(conn, st)) {
+      return sendNotModified(conn, st);
+    }
+    if (rangePtr != NULL && !ifRangeMatches(conn, st)) {
+      rangePtr = NULL;
+    }
+    // Ranges are served from the identity file; precompressed variants
+    // are already encoded
+    if (rangePtr == NULL && encoding_.empty()) {
+      std::string coding =
+          conn.negotiateGzip(file_utils::guessMime(send_path_), st.size);
+      if (!coding.empty() && sendGzipped(conn, coding)) {
+        return HR_DONE;
+      }
+    }
+  }
+
+  bool cacheable = useStaticCache(conn, rangePtr);
+  if (cacheable && hit != NULL) {
+    LOG(DEBUG) << "FileHandler: static cache hit for " << send_path_;
+    off_t size = static_cast<off_t>(hit->data.size());
+    file_utils::prepareFullResponse(conn.response, size, hit->content_type,
+                                    conn.getHttpVersion());
+    file_utils::addValidators(conn.response, hit->inode, size, hit->mtime);
+    addLocationHeaders(conn);
+    return sendFromMemory(conn, *hit);
+  }
+
   off_t out_start = 0, out_end = 0;
-  int r = file_utils::prepareFileResponse(path_, rangePtr, conn.response, fi_,
-                                          out_start, out_end,
-                                          conn.getHttpVersion());
+  int r = file_utils::prepareFileResponse(
+      send_path_, rangePtr, conn.response, fi_, out_start, out_end,
+      conn.getHttpVersion(), conn.file_cache,
+      encoding_.empty() ? NULL : &content_type_, &multipart_);
   if (r == -1) {
     conn.prepareErrorResponse(http::S_404_NOT_FOUND);
     return HR_DONE;
   }
   if (r == -2) {
     // Invalid range: caller should prepare a 416 response using Connection
-    std::ostringstream cr;
-    cr << "bytes */" << out_end;  // out_end carries file_size on -2
-    conn.response.addHeader("Content-Range", cr.str());
+    // out_end carries file_size on -2
+    conn.response.addHeader(
+        "Content-Range",
+        "bytes */" + toDecimalString(static_cast<long long>(out_end)));
     conn.prepareErrorResponse(http::S_416_RANGE_NOT_SATISFIABLE);
     return HR_DONE;
   }
+  addLocationHeaders(conn);
+
+  if (cacheable) {
+    const StaticCache::File* stored = storeInStaticCache(conn);
+    if (stored != NULL) {
+      file_utils::closeFile(fi_);
+      return sendFromMemory(conn, *stored);
+    }
+  }
 
   start_offset_ = out_start;
   end_offset_ = out_end;
+  body_sent_ = 0;
+  body_start_ms_ = monotonicMillis();
   active_ = true;
 
   // Write only headers to connection so we can stream body
-  std::ostringstream header_stream;
-  header_stream << conn.response.startLine() << CRLF;
-  header_stream << conn.response.serializeHeadersWithConnection();
-  header_stream << CRLF;
-  conn.write_buffer = header_stream.str();
+  conn.response.serializeHeadInto(conn.write_buffer);
   conn.write_offset = 0;
+  if (!multipart_.ranges.empty()) {
+    // The first part's headers go out with the response head
+    conn.write_buffer.append(multipart_.heads[0]);
+    part_segment_ = 1;
+    part_offset_ = 0;
+  }
 
   return HR_WOULD_BLOCK;  // Body streaming will occur via resume/sendfile
 }
@@ -120,6 +210,7 @@ HandlerResult FileHandler::handleHead(Connection& conn) {
   // HEAD is like GET but without the response body
   FileInfo fi;
   off_t start = 0, end = 0;
+  MultipartBody multipart;
 
   std::string range;
   const std::string* rangePtr = NULL;
@@ -127,8 +218,22 @@ HandlerResult FileHandler::handleHead(Connection& conn) {
     rangePtr = &range;
   }
 
-  int r = file_utils::prepareFileResponse(path_, rangePtr, conn.response, fi,
-                                          start, end, conn.getHttpVersion());
+  selectVariant(conn);
+  FileStat st;
+  if (currentValidators(conn, NULL, st)) {
+    addGzipVary(conn, st);
+    if (notModified(conn, st)) {
+      return sendNotModified(conn, st);
+    }
+    if (rangePtr != NULL && !ifRangeMatches(conn, st)) {
+      rangePtr = NULL;
+    }
+  }
+
+  int r = file_utils::prepareFileResponse(
+      send_path_, rangePtr, conn.response, fi, start, end,
+      conn.getHttpVersion(), conn.file_cache,
+      encoding_.empty() ? NULL : &content_type_, &multipart);
 
   if (r == -1) {
     conn.prepareErrorResponse(http::S_404_NOT_FOUND);
@@ -136,40 +241,249 @@ HandlerResult FileHandler::handleHead(Connection& conn) {
   }
   if (r == -2) {
     // Invalid range: caller should prepare a 416 response using Connection
-    std::ostringstream cr;
-    cr << "bytes */" << end;  // end carries file_size on -2
-    conn.response.addHeader("Content-Range", cr.str());
+    // end carries file_size on -2
+    conn.response.addHeader(
+        "Content-Range",
+        "bytes */" + toDecimalString(static_cast<long long>(end)));
     conn.prepareErrorResponse(http::S_416_RANGE_NOT_SATISFIABLE);
     return HR_DONE;
   }
 
   // Success - close the file since we don't need to send body
   file_utils::closeFile(fi);
+  addLocationHeaders(conn);
 
   // HEAD response has headers but no body
   conn.response.getBody().data = "";
 
-  std::ostringstream header_stream;
-  header_stream << conn.response.startLine() << CRLF;
-  header_stream << conn.response.serializeHeadersWithConnection();
-  header_stream << CRLF;
-  conn.write_buffer = header_stream.str();
+  conn.response.serializeHeadInto(conn.write_buffer);
+
+  return HR_DONE;
+}
+
+bool FileHandler::currentValidators(Connection& conn,
+                                    const StaticCache::File* hit,
+                                    FileStat& out) {
+  if (hit != NULL) {
+    out.is_reg = true;
+    out.size = static_cast<off_t>(hit->data.size());
+    out.mtime = hit->mtime;
+    out.inode = hit->inode;
+    return true;
+  }
+  return file_utils::statPath(send_path_, out, conn.file_cache) &&
+         out.is_reg;
+}
+
+bool FileHandler::notModified(const Connection& conn,
+                              const FileStat& st) const {
+  // If-None-Match takes precedence: If-Modified-Since is then ignored
+  std::vector<std::string> tags = conn.request.getHeaders("If-None-Match");
+  if (!tags.empty()) {
+    std::string etag = http::makeETag(st.inode, st.size, st.mtime);
+    for (std::size_t i = 0; i < tags.size(); ++i) {
+      if (http::etagListMatches(tags[i], etag)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  std::string value;
+  time_t since = 0;
+  return conn.request.getHeader("If-Modified-Since", value) &&
+         http::parseHttpDate(value, since) && st.mtime <= since;
+}
+
+bool FileHandler::ifRangeMatches(const Connection& conn,
+                                 const FileStat& st) const {
+  std::string value;
+  if (!conn.request.getHeader("If-Range", value)) {
+    return true;
+  }
+  value = trim_copy(value);
+  if (!value.empty() && (value[0] == '"' || value.compare(0, 2, "W/") == 0)) {
+    // If-Range needs a strong match and our entity tags are weak
+    return false;
+  }
+  time_t date = 0;
+  return http::parseHttpDate(value, date) && date == st.mtime;
+}
+
+void FileHandler::addGzipVary(Connection& conn, const FileStat& st) const {
+  // A 304 or 206 carries the Vary of the 200 it stands for. Precompressed
+  // variants get theirs from gzip_static.
+  if (encoding_.empty()) {
+    conn.addGzipVary(file_utils::guessMime(send_path_), st.size);
+  }
+}
+
+HandlerResult FileHandler::sendNotModified(Connection& conn,
+                                           const FileStat& st) {
+  LOG(DEBUG) << "FileHandler: " << send_path_ << " not modified";
+  conn.response.setStatus(http::S_304_NOT_MODIFIED, conn.getHttpVersion());
+  file_utils::addValidators(conn.response, st.inode, st.size, st.mtime);
+  addLocationHeaders(conn);
+  conn.response.serializeHeadInto(conn.write_buffer);
+  conn.write_offset = 0;
+  return HR_DONE;
+}
+
+void FileHandler::selectVariant(Connection& conn) {
+  static const char* const kVariants[][2] = {{"br", ".br"}, {"gzip", ".gz"}};
+
+  send_path_ = path_;
+  encoding_.clear();
+  if (location_ == NULL || location_->gzip_static != ON) {
+    return;
+  }
+  std::vector<std::string> values = conn.request.getHeaders("Accept-Encoding");
+  if (values.empty()) {
+    return;
+  }
+  std::string accept = values[0];
+  for (std::size_t i = 1; i < values.size(); ++i) {
+    accept += ", " + values[i];
+  }
+  for (std::size_t i = 0; i < sizeof(kVariants) / sizeof(kVariants[0]); ++i) {
+    if (!http::acceptsEncoding(accept, kVariants[i][0])) {
+      continue;
+    }
+    std::string candidate = path_ + kVariants[i][1];
+    FileStat st;
+    if (file_utils::statPath(candidate, st, conn.file_cache) && st.is_reg) {
+      LOG(DEBUG) << "FileHandler: sending " << candidate << " for " << path_;
+      send_path_ = candidate;
+      encoding_ = kVariants[i][0];
+      content_type_ = file_utils::guessMime(path_);
+      return;
+    }
+  }
+}
+
+bool FileHandler::applyRateLimit(Connection& conn) {
+  if (location_ == NULL || location_->limit_rate == 0 ||
+      location_->limit_rate == kLimitRateUnset) {
+    return true;
+  }
+  std::size_t after = location_->limit_rate_after == kLimitRateUnset
+                          ? 0
+                          : location_->limit_rate_after;
+  long long now = monotonicMillis();
+  long long wait_ms = 0;
+  long long allowance =
+      file_utils::rateAllowance(location_->limit_rate, after,
+                                now - body_start_ms_, body_sent_, wait_ms);
+  if (allowance == 0) {
+    LOG(DEBUG) << "FileHandler: limit_rate pauses fd=" << conn.fd << " for "
+               << wait_ms << "ms";
+    conn.write_paused_until = now + wait_ms;
+    return false;
+  }
+  if (static_cast<unsigned long long>(allowance) < conn.send_quota.budget) {
+    conn.send_quota.budget = static_cast<std::size_t>(allowance);
+  }
+  return true;
+}
 
+bool FileHandler::sendGzipped(Connection& conn, const std::string& coding) {
+  if (!file_utils::openFile(send_path_, fi_, conn.file_cache)) {
+    return false;
+  }
+  std::string scratch;
+  const std::string* data = conn.gzipFile(send_path_, fi_, coding, scratch);
+  if (data == NULL) {
+    file_utils::closeFile(fi_);
+    return false;
+  }
+  file_utils::prepareFullResponse(conn.response,
+                                  static_cast<off_t>(data->size()),
+                                  fi_.content_type, conn.getHttpVersion());
+  file_utils::addValidators(conn.response, fi_.inode, fi_.size, fi_.mtime);
+  file_utils::closeFile(fi_);
+  encoding_ = coding;
+  addLocationHeaders(conn);
+  conn.response.serializeHeadInto(conn.write_buffer);
+  conn.write_buffer.append(*data);
+  conn.write_offset = 0;
+  return true;
+}
+
+void FileHandler::addLocationHeaders(Connection& conn) const {
+  if (!encoding_.empty()) {
+    conn.response.addHeader("Content-Encoding", encoding_);
+  }
+  if (location_ != NULL && location_->gzip_static == ON) {
+    conn.response.addVary("Accept-Encoding");
+  }
+  if (location_ != NULL && !location_->response_headers.empty()) {
+    conn.response.extra_headers = &location_->response_headers;
+  }
+}
+
+void FileHandler::invalidateCached(Connection& conn, const std::string& path) {
+  if (conn.file_cache != NULL) {
+    conn.file_cache->invalidate(path);
+  }
+  if (conn.static_cache != NULL) {
+    conn.static_cache->invalidate(path);
+  }
+  if (conn.gzip_cache != NULL) {
+    conn.gzip_cache->invalidate(path);
+  }
+}
+
+bool FileHandler::useStaticCache(const Connection& conn,
+                                 const std::string* range) const {
+  return range == NULL && location_ != NULL && location_->cache_max_size > 0 &&
+         conn.static_cache != NULL && conn.static_cache->enabled();
+}
+
+const StaticCache::File* FileHandler::storeInStaticCache(Connection& conn) {
+  if (fi_.size > static_cast<off_t>(location_->max_file_size)) {
+    return NULL;
+  }
+  StaticCache::File file;
+  if (!file_utils::readFileData(fi_.fd, fi_.size, file.data)) {
+    return NULL;
+  }
+  file.content_type = fi_.content_type;
+  file.mtime = fi_.mtime;
+  file.inode = fi_.inode;
+  return conn.static_cache->store(send_path_, location_,
+                                  location_->cache_max_size, file);
+}
+
+HandlerResult FileHandler::sendFromMemory(Connection& conn,
+                                          const StaticCache::File& f) {
+  conn.response.serializeHeadInto(conn.write_buffer);
+  conn.write_buffer.append(f.data);
+  conn.write_offset = 0;
   return HR_DONE;
 }
 
-bool FileHandler::writeBodyToFile(int fd, const std::string& body,
+bool FileHandler::writeBodyToFile(int fd, const Body& body,
                                   size_t& bytes_written) {
   bytes_written = 0;
+  if (body.isSpooled()) {
+    // Spool file that could not be linked into place: copy it in-kernel
+    if (!file_utils::copyFileData(body.fd, fd,
+                                  static_cast<off_t>(body.size()))) {
+      return false;
+    }
+    bytes_written = body.size();
+    return true;
+  }
+
+  const std::string& data = body.data;
   ssize_t n = 0;
-  while (bytes_written < body.size()) {
-    n = write(fd, body.c_str() + bytes_written, body.size() - bytes_written);
+  while (bytes_written < data.size()) {
+    n = write(fd, data.c_str() + bytes_written, data.size() - bytes_written);
     if (n < 0) {
       break;
     }
     bytes_written += static_cast<size_t>(n);
   }
-  return n >= 0 && bytes_written == body.size();
+  return n >= 0 && bytes_written == data.size();
 }
 
 void FileHandler::prepareUploadResponse(Connection& conn, http::Status status,
@@ -184,23 +498,25 @@ void FileHandler::prepareUploadResponse(Connection& conn, http::Status status,
     conn.response.addHeader("Location", *location_uri);
   }
 
-  std::ostringstream resp_body;
+  std::string& resp_body = conn.response.getBody().data;
+  resp_body.clear();
+  ByteBuilder b(resp_body);
   if (status == http::S_201_CREATED) {
-    resp_body << "Resource created successfully" << CRLF;
+    b.append("Resource created successfully" CRLF);
   } else {
-    resp_body << "Resource updated successfully" << CRLF;
+    b.append("Resource updated successfully" CRLF);
   }
-  resp_body << "Resource: " << resource_path << CRLF;
-  resp_body << "Size: " << bytes_written << " bytes" << CRLF;
+  b.append("Resource: ").append(resource_path).appendCrlf();
+  b.append("Size: ")
+      .appendNumber(static_cast<long long>(bytes_written))
+      .append(" bytes" CRLF);
 
-  conn.response.getBody().data = resp_body.str();
   conn.response.addHeader("Content-Type", "text/plain; charset=utf-8");
+  conn.response.addHeader(
+      "Content-Length",
+      toDecimalString(static_cast<long long>(resp_body.size())));
 
-  std::ostringstream len;
-  len << conn.response.getBody().size();
-  conn.response.addHeader("Content-Length", len.str());
-
-  conn.write_buffer = conn.response.serialize();
+  conn.response.serializeInto(conn.write_buffer);
 }
 
 HandlerResult FileHandler::handlePost(Connection& conn) {
@@ -255,32 +571,51 @@ HandlerResult FileHandler::handlePost(Connection& conn) {
     resource_uri = uri_;
   }
 
-  // Create the new file with O_EXCL to ensure atomicity
-  int fd =
-      open(target_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, FILE_UPLOAD_MODE);
-  if (fd < 0) {
-    if (errno == EEXIST) {
-      // File exists - 409 Conflict
+  const Body& body = conn.request.getBody();
+  size_t total_written = 0;
+
+  // A spooled body is already on disk: link the temp file into place
+  // (linkat fails with EEXIST just like O_EXCL) instead of copying it.
+  bool linked = false;
+  if (body.isSpooled()) {
+    if (file_utils::linkTempFile(body.fd, target_path) == 0) {
+      linked = true;
+      total_written = body.size();
+    } else if (errno == EEXIST) {
       conn.prepareErrorResponse(http::S_409_CONFLICT);
+      return HR_DONE;
     } else {
-      LOG_PERROR(ERROR, "FileHandler: Failed to create file for POST");
-      conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+      LOG_PERROR(DEBUG, "FileHandler: cannot link spooled body, copying");
     }
-    return HR_DONE;
   }
 
-  const std::string& body = conn.request.getBody().data;
-  size_t total_written = 0;
-  bool success = writeBodyToFile(fd, body, total_written);
-  close(fd);
+  if (!linked) {
+    // Create the new file with O_EXCL to ensure atomicity
+    int fd = open(target_path.c_str(), O_WRONLY | O_CREAT | O_EXCL,
+                  FILE_UPLOAD_MODE);
+    if (fd < 0) {
+      if (errno == EEXIST) {
+        // File exists - 409 Conflict
+        conn.prepareErrorResponse(http::S_409_CONFLICT);
+      } else {
+        LOG_PERROR(ERROR, "FileHandler: Failed to create file for POST");
+        conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+      }
+      return HR_DONE;
+    }
 
-  if (!success) {
-    LOG_PERROR(ERROR, "FileHandler: Failed to write file for POST");
-    unlink(target_path.c_str());
-    conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
-    return HR_DONE;
+    bool success = writeBodyToFile(fd, body, total_written);
+    close(fd);
+
+    if (!success) {
+      LOG_PERROR(ERROR, "FileHandler: Failed to write file for POST");
+      unlink(target_path.c_str());
+      conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+      return HR_DONE;
+    }
   }
 
+  invalidateCached(conn, target_path);
   prepareUploadResponse(conn, http::S_201_CREATED, target_path, total_written,
                         &resource_uri);
 
@@ -290,37 +625,54 @@ HandlerResult FileHandler::handlePost(Connection& conn) {
 }
 
 HandlerResult FileHandler::handlePut(Connection& conn) {
-  // Atomically determine if file is being created or overwritten using O_EXCL.
-  // First attempt to create exclusively (O_CREAT | O_EXCL), which fails if file
-  // exists. If it fails with EEXIST, the file already exists and we overwrite.
+  const Body& body = conn.request.getBody();
   bool created = false;
-  int fd = open(path_.c_str(), O_WRONLY | O_CREAT | O_EXCL, FILE_UPLOAD_MODE);
-  if (fd >= 0) {
-    // File was created (did not exist before)
-    created = true;
-  } else if (errno == EEXIST) {
-    // File already exists, open for overwriting (include O_CREAT for
-    // robustness in case file is deleted between the two open calls)
-    fd = open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, FILE_UPLOAD_MODE);
-  }
-  if (fd < 0) {
-    LOG_PERROR(ERROR, "FileHandler: Failed to open file for PUT");
-    conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
-    return HR_DONE;
+  size_t total_written = 0;
+
+  // A spooled body is linked into place, replacing an existing file with a
+  // single rename(); copying is only the fallback.
+  bool committed = false;
+  if (body.isSpooled()) {
+    if (file_utils::commitTempFile(body.fd, path_, created) == 0) {
+      committed = true;
+      total_written = body.size();
+    } else {
+      LOG_PERROR(DEBUG, "FileHandler: cannot link spooled body, copying");
+    }
   }
 
-  const std::string& body = conn.request.getBody().data;
-  size_t total_written = 0;
-  bool success = writeBodyToFile(fd, body, total_written);
-  close(fd);
+  if (!committed) {
+    // Atomically determine if file is being created or overwritten using
+    // O_EXCL. First attempt to create exclusively (O_CREAT | O_EXCL), which
+    // fails if file exists. If it fails with EEXIST, the file already exists
+    // and we overwrite.
+    int fd = open(path_.c_str(), O_WRONLY | O_CREAT | O_EXCL, FILE_UPLOAD_MODE);
+    if (fd >= 0) {
+      // File was created (did not exist before)
+      created = true;
+    } else if (errno == EEXIST) {
+      // File already exists, open for overwriting (include O_CREAT for
+      // robustness in case file is deleted between the two open calls)
+      fd = open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, FILE_UPLOAD_MODE);
+    }
+    if (fd < 0) {
+      LOG_PERROR(ERROR, "FileHandler: Failed to open file for PUT");
+      conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+      return HR_DONE;
+    }
 
-  if (!success) {
-    LOG_PERROR(ERROR, "FileHandler: Failed to write file for PUT");
-    unlink(path_.c_str());
-    conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
-    return HR_DONE;
+    bool success = writeBodyToFile(fd, body, total_written);
+    close(fd);
+
+    if (!success) {
+      LOG_PERROR(ERROR, "FileHandler: Failed to write file for PUT");
+      unlink(path_.c_str());
+      conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+      return HR_DONE;
+    }
   }
 
+  invalidateCached(conn, path_);
   http::Status status = created ? http::S_201_CREATED : http::S_200_OK;
   prepareUploadResponse(conn, status, path_, total_written);
 
@@ -351,6 +703,7 @@ HandlerResult FileHandler::handleDelete(Connection& conn) {
     conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
     return HR_DONE;
   }
+  invalidateCached(conn, path_);
 
   // 204 No Content is the standard response for successful DELETE
   conn.response.status_line.version = conn.getHttpVersion();
@@ -360,7 +713,7 @@ HandlerResult FileHandler::handleDelete(Connection& conn) {
   conn.response.getBody().data = "";
   conn.response.addHeader("Content-Length", "0");
 
-  conn.write_buffer = conn.response.serialize();
+  conn.response.serializeInto(conn.write_buffer);
 
   LOG(INFO) << "FileHandler: Deleted resource " << path_;
   return HR_DONE;
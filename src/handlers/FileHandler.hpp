@@ -1,22 +1,29 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 
+#include "Body.hpp"
 #include "IHandler.hpp"
+#include "Location.hpp"
+#include "StaticCache.hpp"
 #include "file_utils.hpp"
 
 class Connection;
 
 // FileHandler handles static file operations for GET, HEAD, POST, PUT, DELETE.
 // This is a resource-based handler that manages all HTTP methods for static
-// files.
+// files. With the `location` it was routed to, whole-file GETs use the
+// location's in-memory static cache (cache_max_size, max_file_size).
 class FileHandler : public IHandler {
  public:
-  explicit FileHandler(const std::string& path, const std::string& uri = "");
+  explicit FileHandler(const std::string& path, const std::string& uri = "",
+                       const Location* location = NULL);
   virtual ~FileHandler();
 
   virtual HandlerResult start(Connection& conn);
   virtual HandlerResult resume(Connection& conn);
+  virtual void cancel(Connection& conn);
 
  private:
   // Internal method handlers
@@ -26,8 +33,52 @@ class FileHandler : public IHandler {
   HandlerResult handlePut(Connection& conn);
   HandlerResult handleDelete(Connection& conn);
 
+  // With gzip_static, send "<path>.br" or "<path>.gz" instead when it
+  // exists and the client accepts that encoding (sets send_path_,
+  // encoding_ and content_type_)
+  void selectVariant(Connection& conn);
+  // Validators (inode, size, mtime) of the file as it would be served:
+  // from the static cache entry `hit` if there is one, otherwise from a
+  // stat() through the open file cache. False if it is not a regular file.
+  bool currentValidators(Connection& conn, const StaticCache::File* hit,
+                         FileStat& out);
+  // If-None-Match, or failing that If-Modified-Since, says the client's
+  // copy is current
+  bool notModified(const Connection& conn, const FileStat& st) const;
+  // If-Range, when present, still names the current file
+  bool ifRangeMatches(const Connection& conn, const FileStat& st) const;
+  // "Vary: Accept-Encoding" when the identity file could be gzipped, for
+  // every response about it (gzip)
+  void addGzipVary(Connection& conn, const FileStat& st) const;
+  // 304 with the validators and no body
+  HandlerResult sendNotModified(Connection& conn, const FileStat& st);
+
+  // Whole-file GET compressed on the fly in `coding` (see
+  // Connection::gzipFile) and sent from memory; false if it could not be
+  // compressed and the file should be sent as is
+  bool sendGzipped(Connection& conn, const std::string& coding);
+
+  // limit_rate: cap the connection's send quota to what the location's
+  // rate allows by now. False, with the connection paused until more is
+  // allowed, when nothing may be sent yet.
+  bool applyRateLimit(Connection& conn);
+
+  // Content-Encoding and Vary for gzip_static, and the location's
+  // "expires" and "add_header" lines, on success
+  void addLocationHeaders(Connection& conn) const;
+
+  // Drop `path` from the connection's file caches after writing it
+  void invalidateCached(Connection& conn, const std::string& path);
+  // Whole-file GET answered from the static cache when this location
+  // uses one
+  bool useStaticCache(const Connection& conn, const std::string* range) const;
+  // Copy the open file fi_ into the static cache; NULL if it is not kept
+  const StaticCache::File* storeInStaticCache(Connection& conn);
+  // Headers and body of a cached file, written in one go
+  HandlerResult sendFromMemory(Connection& conn, const StaticCache::File& f);
+
   // Helper methods for POST/PUT
-  bool writeBodyToFile(int fd, const std::string& body, size_t& bytes_written);
+  bool writeBodyToFile(int fd, const Body& body, size_t& bytes_written);
   void prepareUploadResponse(Connection& conn, http::Status status,
                              const std::string& resource_path,
                              size_t bytes_written,
@@ -35,8 +86,24 @@ class FileHandler : public IHandler {
 
   std::string path_;
   std::string uri_;
+  const Location* location_;
+  // File actually sent for GET and HEAD: path_ or a precompressed variant
+  // in `encoding_`, sent as `content_type_`. `encoding_` is also set when
+  // the file is compressed on the fly.
+  std::string send_path_;
+  std::string encoding_;
+  std::string content_type_;
   FileInfo fi_;
   off_t start_offset_;
   off_t end_offset_;
+  // Multi-range GET: the multipart/byteranges body and how far resume()
+  // got through it (see file_utils::streamMultipartToSocket)
+  MultipartBody multipart_;
+  std::size_t part_segment_;
+  off_t part_offset_;
+  // Body bytes streamed by resume() and when that started (monotonic ms),
+  // for limit_rate
+  long long body_sent_;
+  long long body_start_ms_;
   bool active_;
 };
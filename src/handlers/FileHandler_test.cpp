@@ -1,6 +1,18 @@
 #include "FileHandler.hpp"
 
+#include <fcntl.h>
 #include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "Connection.hpp"
+#include "Location.hpp"
+#include "OpenFileCache.hpp"
+#include "StaticCache.hpp"
+#include "file_utils.hpp"
 
 TEST(FileHandlerTests, ConstructorAcceptsPath) {
   FileHandler handler("/tmp/test.txt");
@@ -11,3 +23,63 @@ TEST(FileHandlerTests, GetMonitorFdReturnsMinusOne) {
   FileHandler handler("/var/www/index.html");
   EXPECT_EQ(handler.getMonitorFd(), -1);
 }
+
+TEST(FileHandlerTests, CancelStopsStreaming) {
+  char path[] = "/tmp/filehandler_cancel_XXXXXX";
+  int tmp = mkstemp(path);
+  ASSERT_GE(tmp, 0);
+  ASSERT_EQ(write(tmp, "hello", 5), 5);
+  close(tmp);
+
+  Connection conn;
+  conn.request.request_line.method = http::GET;
+  FileHandler handler(path);
+  ASSERT_EQ(handler.start(conn), HR_WOULD_BLOCK);
+  handler.cancel(conn);
+  // Nothing is left to stream; conn.fd (-1) is never written to
+  EXPECT_EQ(handler.resume(conn), HR_DONE);
+  unlink(path);
+}
+
+static void writeFile(const std::string& path, const std::string& data) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, data.data(), data.size()),
+            static_cast<ssize_t>(data.size()));
+  close(fd);
+}
+
+TEST(FileHandlerTests, FileReplacedInOpenFileCacheIsNotStaticCached) {
+  char dir[] = "/tmp/filehandler_replace_XXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != NULL);
+  std::string path = std::string(dir) + "/page.html";
+  std::string tmp = path + ".new";
+  writeFile(path, "old version");
+
+  OpenFileCache file_cache(16, 60, 60);
+  StaticCache static_cache;
+  ASSERT_TRUE(static_cache.init());
+  // A Range request or HEAD leaves the fd in the open file cache only
+  FileInfo fi;
+  ASSERT_TRUE(file_utils::openFile(path, fi, &file_cache));
+  file_utils::closeFile(fi);
+
+  writeFile(tmp, "new version");
+  ASSERT_EQ(rename(tmp.c_str(), path.c_str()), 0);
+
+  Location loc;
+  loc.cache_max_size = 1024;
+  loc.max_file_size = 1024;
+  Connection conn;
+  conn.request.request_line.method = http::GET;
+  conn.file_cache = &file_cache;
+  conn.static_cache = &static_cache;
+  FileHandler handler(path, "/page.html", &loc);
+  handler.start(conn);
+  handler.cancel(conn);
+  // The old inode's contents must not outlive the open file cache entry
+  EXPECT_TRUE(static_cache.find(path) == NULL);
+
+  unlink(path.c_str());
+  rmdir(dir);
+}
@@ -8,3 +8,7 @@ bool IHandler::checkTimeout(Connection& conn) {
   (void)conn;
   return false;
 }
+
+void IHandler::cancel(Connection& conn) {
+  (void)conn;
+}
@@ -31,4 +31,10 @@ class IHandler {
   // Returns true if timed out and connection should be cleaned up.
   // Default implementation returns false (no timeout check).
   virtual bool checkTimeout(Connection& conn);
+
+  // Abandon the request because the client went away. Release expensive
+  // resources (child processes, open files) immediately; the handler is
+  // deleted afterwards without further resume() calls.
+  // Default implementation does nothing.
+  virtual void cancel(Connection& conn);
 };
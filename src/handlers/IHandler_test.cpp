@@ -2,6 +2,8 @@
 
 #include <gtest/gtest.h>
 
+#include "Connection.hpp"
+
 // Concrete test handler for testing IHandler interface
 class TestHandler : public IHandler {
  public:
@@ -31,3 +33,11 @@ TEST(IHandlerTests, HandlerResultEnumValues) {
   EXPECT_EQ(HR_WOULD_BLOCK, 1);
   EXPECT_EQ(HR_ERROR, -1);
 }
+
+TEST(IHandlerTests, DefaultCancelDoesNothing) {
+  TestHandler handler;
+  Connection conn;
+  handler.cancel(conn);
+  EXPECT_FALSE(handler.start_called);
+  EXPECT_FALSE(handler.resume_called);
+}
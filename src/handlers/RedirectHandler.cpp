@@ -13,7 +13,7 @@ HandlerResult RedirectHandler::start(Connection& conn) {
   conn.response.addHeader("Location", location_.redirect_location);
   conn.response.addHeader("Content-Length", "0");
 
-  conn.write_buffer = conn.response.serialize();
+  conn.response.serializeInto(conn.write_buffer);
   conn.write_offset = 0;
   return HR_DONE;
 }
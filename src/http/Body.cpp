@@ -1,28 +1,104 @@
 #include "Body.hpp"
 
-Body::Body() : data() {}
+#include <unistd.h>
 
-Body::Body(const std::string& d) : data(d) {}
+#include <cerrno>
 
-Body::Body(const Body& other) : data(other.data) {}
+namespace {
+
+bool writeAll(int fd, const char* p, std::size_t n) {
+  while (n > 0) {
+    ssize_t w = write(fd, p, n);
+    if (w < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (w == 0) {
+      // No progress and no error: give up rather than spin
+      errno = ENOSPC;
+      return false;
+    }
+    p += w;
+    n -= static_cast<std::size_t>(w);
+  }
+  return true;
+}
+
+int dupSpool(int fd) {
+  return fd >= 0 ? dup(fd) : -1;
+}
+
+}  // namespace
+
+Body::Body() : data(), fd(-1), spooled_size(0) {}
+
+Body::Body(const std::string& d) : data(d), fd(-1), spooled_size(0) {}
+
+Body::Body(const Body& other)
+    : data(other.data),
+      fd(dupSpool(other.fd)),
+      spooled_size(other.spooled_size) {}
 
 Body& Body::operator=(const Body& other) {
   if (this != &other) {
+    clear();
     data = other.data;
+    fd = dupSpool(other.fd);
+    spooled_size = other.spooled_size;
   }
   return *this;
 }
 
-Body::~Body() {}
+Body::~Body() {
+  clear();
+}
 
 void Body::clear() {
   data.clear();
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+  spooled_size = 0;
 }
 
 bool Body::empty() const {
-  return data.empty();
+  return size() == 0;
 }
 
 std::size_t Body::size() const {
-  return data.size();
+  return fd >= 0 ? spooled_size : data.size();
+}
+
+bool Body::append(const char* p, std::size_t n) {
+  if (fd < 0) {
+    data.append(p, n);
+    return true;
+  }
+  if (!writeAll(fd, p, n)) {
+    return false;
+  }
+  spooled_size += n;
+  return true;
+}
+
+bool Body::spoolTo(int spool_fd) {
+  if (!writeAll(spool_fd, data.data(), data.size())) {
+    close(spool_fd);
+    return false;
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+  fd = spool_fd;
+  spooled_size = data.size();
+  // Release the memory rather than just clearing the contents
+  std::string().swap(data);
+  return true;
+}
+
+bool Body::isSpooled() const {
+  return fd >= 0;
 }
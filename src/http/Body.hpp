@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 
+// Message body. Small bodies live in `data`; a large request body can instead
+// be spooled to a file (see spoolTo), in which case `data` stays empty and
+// `fd` refers to the file holding the bytes. Copies dup() the spool fd, so
+// every Body closes only its own descriptor.
 struct Body {
   Body();
   explicit Body(const std::string& d);
@@ -13,5 +18,16 @@ struct Body {
   bool empty() const;
   std::size_t size() const;
 
+  // Append bytes to the body, writing them to the spool file once the body
+  // has been spooled. Returns false if writing to the spool file failed.
+  bool append(const char* p, std::size_t n);
+  // Take ownership of the open file `spool_fd` and move the in-memory data
+  // into it; further appends go to the file. Returns false (closing
+  // `spool_fd` and keeping the body in memory) if the data cannot be written.
+  bool spoolTo(int spool_fd);
+  bool isSpooled() const;
+
   std::string data;
+  int fd;                    // spool file, or -1 when the body is in `data`
+  std::size_t spooled_size;  // bytes written to `fd`
 };
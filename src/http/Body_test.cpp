@@ -0,0 +1,70 @@
+#include "Body.hpp"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+int makeSpoolFile() {
+  char tmpl[] = "/tmp/webserv_body_test_XXXXXX";
+  int fd = mkstemp(tmpl);
+  if (fd >= 0) {
+    unlink(tmpl);
+  }
+  return fd;
+}
+
+std::string readSpool(const Body& body) {
+  std::string out(body.size(), '\0');
+  ssize_t n = pread(body.fd, &out[0], out.size(), 0);
+  out.resize(n < 0 ? 0 : static_cast<std::size_t>(n));
+  return out;
+}
+
+}  // namespace
+
+TEST(BodyTests, AppendsInMemoryByDefault) {
+  Body body;
+  EXPECT_TRUE(body.empty());
+  ASSERT_TRUE(body.append("abc", 3));
+  EXPECT_FALSE(body.isSpooled());
+  EXPECT_EQ(body.data, "abc");
+  EXPECT_EQ(body.size(), 3u);
+}
+
+TEST(BodyTests, SpoolToMovesDataToFile) {
+  Body body;
+  ASSERT_TRUE(body.append("hello ", 6));
+  int fd = makeSpoolFile();
+  ASSERT_GE(fd, 0);
+
+  ASSERT_TRUE(body.spoolTo(fd));
+  EXPECT_TRUE(body.isSpooled());
+  EXPECT_TRUE(body.data.empty());
+  ASSERT_TRUE(body.append("world", 5));
+  EXPECT_EQ(body.size(), 11u);
+  EXPECT_FALSE(body.empty());
+  EXPECT_EQ(readSpool(body), "hello world");
+}
+
+TEST(BodyTests, CopiesOwnTheirSpoolDescriptor) {
+  Body body;
+  int fd = makeSpoolFile();
+  ASSERT_GE(fd, 0);
+  ASSERT_TRUE(body.spoolTo(fd));
+  ASSERT_TRUE(body.append("data", 4));
+
+  Body copy(body);
+  EXPECT_TRUE(copy.isSpooled());
+  EXPECT_NE(copy.fd, body.fd);
+  EXPECT_EQ(copy.size(), 4u);
+
+  body.clear();
+  EXPECT_FALSE(body.isSpooled());
+  EXPECT_EQ(body.size(), 0u);
+  // The copy's descriptor is still valid after the original closed its own
+  EXPECT_EQ(readSpool(copy), "data");
+}
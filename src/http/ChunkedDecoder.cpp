@@ -0,0 +1,218 @@
+#include "ChunkedDecoder.hpp"
+
+#include "constants.hpp"
+
+namespace {
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+}  // namespace
+
+ChunkedDecoder::ChunkedDecoder()
+    : state_(S_SIZE),
+      max_body_(static_cast<std::size_t>(-1)),
+      decoded_(0),
+      chunk_size_(0),
+      chunk_left_(0),
+      size_digits_(0),
+      line_len_(0),
+      trailer_len_(0),
+      error_(CHUNKED_BAD) {}
+
+ChunkedDecoder::ChunkedDecoder(const ChunkedDecoder& other)
+    : state_(other.state_),
+      max_body_(other.max_body_),
+      decoded_(other.decoded_),
+      chunk_size_(other.chunk_size_),
+      chunk_left_(other.chunk_left_),
+      size_digits_(other.size_digits_),
+      line_len_(other.line_len_),
+      trailer_len_(other.trailer_len_),
+      error_(other.error_) {}
+
+ChunkedDecoder& ChunkedDecoder::operator=(const ChunkedDecoder& other) {
+  if (this != &other) {
+    state_ = other.state_;
+    max_body_ = other.max_body_;
+    decoded_ = other.decoded_;
+    chunk_size_ = other.chunk_size_;
+    chunk_left_ = other.chunk_left_;
+    size_digits_ = other.size_digits_;
+    line_len_ = other.line_len_;
+    trailer_len_ = other.trailer_len_;
+    error_ = other.error_;
+  }
+  return *this;
+}
+
+ChunkedDecoder::~ChunkedDecoder() {}
+
+void ChunkedDecoder::reset(std::size_t max_body) {
+  state_ = S_SIZE;
+  max_body_ = max_body;
+  decoded_ = 0;
+  chunk_size_ = 0;
+  chunk_left_ = 0;
+  size_digits_ = 0;
+  line_len_ = 0;
+  trailer_len_ = 0;
+  error_ = CHUNKED_BAD;
+}
+
+bool ChunkedDecoder::done() const {
+  return state_ == S_DONE;
+}
+
+std::size_t ChunkedDecoder::decodedSize() const {
+  return decoded_;
+}
+
+ChunkedDecoder::Result ChunkedDecoder::fail_(Result r) {
+  state_ = S_ERROR;
+  error_ = r;
+  return r;
+}
+
+ChunkedDecoder::Result ChunkedDecoder::feed(const char* data, std::size_t len,
+                                            std::string& out,
+                                            std::size_t& consumed) {
+  std::size_t i = 0;
+  consumed = 0;
+  if (state_ == S_ERROR) {
+    return error_;
+  }
+
+  while (i < len && state_ != S_DONE) {
+    // Copy payload in bulk; everything else is handled one byte at a time.
+    if (state_ == S_DATA) {
+      std::size_t n = len - i;
+      if (n > chunk_left_) {
+        n = chunk_left_;
+      }
+      out.append(data + i, n);
+      i += n;
+      chunk_left_ -= n;
+      if (chunk_left_ == 0) {
+        state_ = S_DATA_CR;
+      }
+      continue;
+    }
+
+    char c = data[i++];
+    switch (state_) {
+      case S_SIZE: {
+        int v = hexValue(c);
+        if (v >= 0) {
+          // Reject sizes that cannot be represented instead of wrapping.
+          if (chunk_size_ > (static_cast<std::size_t>(-1) >> 4)) {
+            consumed = i;
+            return fail_(CHUNKED_TOO_LARGE);
+          }
+          chunk_size_ = (chunk_size_ << 4) | static_cast<std::size_t>(v);
+          ++size_digits_;
+          if (++line_len_ > CHUNKED_LINE_LIMIT) {
+            consumed = i;
+            return fail_(CHUNKED_BAD);
+          }
+          break;
+        }
+        if (size_digits_ == 0) {
+          consumed = i;
+          return fail_(CHUNKED_BAD);
+        }
+        if (c == ';' || c == ' ' || c == '\t') {
+          ++line_len_;
+          state_ = S_EXT;
+        } else if (c == '\r') {
+          state_ = S_SIZE_LF;
+        } else {
+          consumed = i;
+          return fail_(CHUNKED_BAD);
+        }
+        break;
+      }
+      case S_EXT:
+        // chunk-ext = *( BWS ";" BWS ext-name [ BWS "=" BWS ext-val ] )
+        // Extensions carry nothing we act on, so only their length matters.
+        if (c == '\r') {
+          state_ = S_SIZE_LF;
+        } else if (c == '\n' || ++line_len_ > CHUNKED_LINE_LIMIT) {
+          consumed = i;
+          return fail_(CHUNKED_BAD);
+        }
+        break;
+      case S_SIZE_LF:
+        if (c != '\n') {
+          consumed = i;
+          return fail_(CHUNKED_BAD);
+        }
+        if (chunk_size_ > max_body_ - decoded_) {
+          consumed = i;
+          return fail_(CHUNKED_TOO_LARGE);
+        }
+        line_len_ = 0;
+        if (chunk_size_ == 0) {
+          state_ = S_TRAILER;
+          break;
+        }
+        decoded_ += chunk_size_;
+        chunk_left_ = chunk_size_;
+        chunk_size_ = 0;
+        size_digits_ = 0;
+        state_ = S_DATA;
+        break;
+      case S_DATA_CR:
+        if (c != '\r') {
+          consumed = i;
+          return fail_(CHUNKED_BAD);
+        }
+        state_ = S_DATA_LF;
+        break;
+      case S_DATA_LF:
+        if (c != '\n') {
+          consumed = i;
+          return fail_(CHUNKED_BAD);
+        }
+        state_ = S_SIZE;
+        break;
+      case S_TRAILER:
+        if (c == '\r') {
+          state_ = S_TRAILER_LF;
+        } else if (c == '\n' || ++trailer_len_ > CHUNKED_LINE_LIMIT) {
+          consumed = i;
+          return fail_(CHUNKED_BAD);
+        } else {
+          ++line_len_;
+        }
+        break;
+      case S_TRAILER_LF:
+        if (c != '\n') {
+          consumed = i;
+          return fail_(CHUNKED_BAD);
+        }
+        if (line_len_ == 0) {
+          state_ = S_DONE;
+        } else {
+          line_len_ = 0;
+          state_ = S_TRAILER;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  consumed = i;
+  return state_ == S_DONE ? CHUNKED_DONE : CHUNKED_NEED_MORE;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Incremental decoder for "Transfer-Encoding: chunked" request bodies
+// (RFC 9112, section 7.1). Input may be fed in arbitrary slices as it is
+// read from the socket; decoded payload bytes are appended to the caller's
+// buffer so the encoded stream never has to be held in full.
+//
+// Chunk extensions are skipped. Trailer fields are read and discarded, which
+// RFC 9112 7.1.2 allows for a recipient that removes the chunked coding.
+class ChunkedDecoder {
+ public:
+  enum Result {
+    CHUNKED_NEED_MORE,  // input exhausted, body not finished yet
+    CHUNKED_DONE,       // last chunk and trailer section fully read
+    CHUNKED_BAD,        // malformed framing -> 400
+    CHUNKED_TOO_LARGE   // decoded size would exceed max_body -> 413
+  };
+
+  ChunkedDecoder();
+  ChunkedDecoder(const ChunkedDecoder& other);
+  ChunkedDecoder& operator=(const ChunkedDecoder& other);
+  ~ChunkedDecoder();
+
+  // Start a new body. `max_body` bounds the total decoded size; it is checked
+  // against each chunk-size line, before any of that chunk's data arrives.
+  void reset(std::size_t max_body);
+
+  // Decode as much of [data, data + len) as possible, appending payload to
+  // `out`. `consumed` receives the number of input bytes used; once the body
+  // is complete any following bytes are left unconsumed.
+  Result feed(const char* data, std::size_t len, std::string& out,
+              std::size_t& consumed);
+
+  bool done() const;
+  std::size_t decodedSize() const;
+
+ private:
+  enum State {
+    S_SIZE,        // chunk-size hex digits
+    S_EXT,         // chunk extensions up to CR
+    S_SIZE_LF,     // LF ending the chunk-size line
+    S_DATA,        // chunk payload
+    S_DATA_CR,     // CR after payload
+    S_DATA_LF,     // LF after payload
+    S_TRAILER,     // trailer field line (or the final empty line)
+    S_TRAILER_LF,  // LF ending a trailer line
+    S_DONE,
+    S_ERROR
+  };
+
+  Result fail_(Result r);
+
+  State state_;
+  std::size_t max_body_;
+  std::size_t decoded_;
+  std::size_t chunk_size_;   // size of the current chunk
+  std::size_t chunk_left_;   // payload bytes still expected for it
+  std::size_t size_digits_;  // hex digits seen on the size line
+  std::size_t line_len_;     // bytes seen on the current size/trailer line
+  std::size_t trailer_len_;  // total trailer section bytes
+  Result error_;
+};
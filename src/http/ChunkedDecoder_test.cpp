@@ -0,0 +1,175 @@
+#include "ChunkedDecoder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+ChunkedDecoder::Result feedAll(ChunkedDecoder& d, const std::string& in,
+                               std::string& out, std::size_t& consumed) {
+  return d.feed(in.data(), in.size(), out, consumed);
+}
+
+}  // namespace
+
+TEST(ChunkedDecoderTests, DecodesSimpleBody) {
+  ChunkedDecoder d;
+  d.reset(1024);
+  std::string out;
+  std::size_t consumed = 0;
+  std::string in = "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n";
+  EXPECT_EQ(feedAll(d, in, out, consumed), ChunkedDecoder::CHUNKED_DONE);
+  EXPECT_EQ(consumed, in.size());
+  EXPECT_EQ(out, "hello world");
+  EXPECT_EQ(d.decodedSize(), 11u);
+  EXPECT_TRUE(d.done());
+}
+
+TEST(ChunkedDecoderTests, DecodesOneByteAtATime) {
+  ChunkedDecoder d;
+  d.reset(1024);
+  std::string out;
+  std::string in = "a\r\n0123456789\r\n0\r\n\r\n";
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    std::size_t consumed = 0;
+    ChunkedDecoder::Result r = d.feed(in.data() + i, 1, out, consumed);
+    EXPECT_EQ(consumed, 1u);
+    if (i + 1 < in.size()) {
+      ASSERT_EQ(r, ChunkedDecoder::CHUNKED_NEED_MORE) << "at byte " << i;
+    } else {
+      EXPECT_EQ(r, ChunkedDecoder::CHUNKED_DONE);
+    }
+  }
+  EXPECT_EQ(out, "0123456789");
+}
+
+TEST(ChunkedDecoderTests, AcceptsUppercaseHexSizes) {
+  ChunkedDecoder d;
+  d.reset(1024);
+  std::string out;
+  std::size_t consumed = 0;
+  std::string payload(0x1F, 'x');
+  std::string in = "1F\r\n" + payload + "\r\n0\r\n\r\n";
+  EXPECT_EQ(feedAll(d, in, out, consumed), ChunkedDecoder::CHUNKED_DONE);
+  EXPECT_EQ(out, payload);
+}
+
+TEST(ChunkedDecoderTests, SkipsChunkExtensions) {
+  ChunkedDecoder d;
+  d.reset(1024);
+  std::string out;
+  std::size_t consumed = 0;
+  std::string in =
+      "4;name=value\r\nWiki\r\n5 ; quoted=\"a;b\"\r\npedia\r\n0;last\r\n\r\n";
+  EXPECT_EQ(feedAll(d, in, out, consumed), ChunkedDecoder::CHUNKED_DONE);
+  EXPECT_EQ(out, "Wikipedia");
+}
+
+TEST(ChunkedDecoderTests, DiscardsTrailerFields) {
+  ChunkedDecoder d;
+  d.reset(1024);
+  std::string out;
+  std::size_t consumed = 0;
+  std::string in =
+      "3\r\nabc\r\n0\r\nExpires: never\r\nX-Checksum: 1234\r\n\r\n";
+  EXPECT_EQ(feedAll(d, in, out, consumed), ChunkedDecoder::CHUNKED_DONE);
+  EXPECT_EQ(consumed, in.size());
+  EXPECT_EQ(out, "abc");
+}
+
+TEST(ChunkedDecoderTests, LeavesBytesAfterBodyUnconsumed) {
+  ChunkedDecoder d;
+  d.reset(1024);
+  std::string out;
+  std::size_t consumed = 0;
+  std::string body = "2\r\nok\r\n0\r\n\r\n";
+  std::string in = body + "GET / HTTP/1.1\r\n";
+  EXPECT_EQ(feedAll(d, in, out, consumed), ChunkedDecoder::CHUNKED_DONE);
+  EXPECT_EQ(consumed, body.size());
+
+  // Further input after completion is not consumed either
+  EXPECT_EQ(feedAll(d, "x", out, consumed), ChunkedDecoder::CHUNKED_DONE);
+  EXPECT_EQ(consumed, 0u);
+  EXPECT_EQ(out, "ok");
+}
+
+TEST(ChunkedDecoderTests, RejectsChunkOverLimitBeforeItsData) {
+  ChunkedDecoder d;
+  d.reset(8);
+  std::string out;
+  std::size_t consumed = 0;
+  EXPECT_EQ(feedAll(d, "5\r\nhello\r\n", out, consumed),
+            ChunkedDecoder::CHUNKED_NEED_MORE);
+  // The second chunk pushes the total to 10 > 8; none of it is decoded.
+  std::string in = "5\r\n";
+  EXPECT_EQ(feedAll(d, in, out, consumed), ChunkedDecoder::CHUNKED_TOO_LARGE);
+  EXPECT_EQ(out, "hello");
+
+  // The decoder stays failed
+  EXPECT_EQ(feedAll(d, "world\r\n", out, consumed),
+            ChunkedDecoder::CHUNKED_TOO_LARGE);
+  EXPECT_EQ(consumed, 0u);
+}
+
+TEST(ChunkedDecoderTests, AcceptsBodyExactlyAtLimit) {
+  ChunkedDecoder d;
+  d.reset(5);
+  std::string out;
+  std::size_t consumed = 0;
+  EXPECT_EQ(feedAll(d, "5\r\nhello\r\n0\r\n\r\n", out, consumed),
+            ChunkedDecoder::CHUNKED_DONE);
+  EXPECT_EQ(out, "hello");
+}
+
+TEST(ChunkedDecoderTests, RejectsOverflowingChunkSize) {
+  ChunkedDecoder d;
+  d.reset(static_cast<std::size_t>(-1));
+  std::string out;
+  std::size_t consumed = 0;
+  EXPECT_EQ(feedAll(d, "1ffffffffffffffffffff\r\n", out, consumed),
+            ChunkedDecoder::CHUNKED_TOO_LARGE);
+}
+
+TEST(ChunkedDecoderTests, RejectsMalformedFraming) {
+  const char* cases[] = {
+      "\r\n",                   // empty size
+      "zz\r\nhello\r\n",        // non-hex size
+      "-1\r\n",                 // sign
+      "5\nhello\r\n",           // bare LF after size
+      "5\r\nhelloXX",           // payload not followed by CRLF
+      "0\r\nTrailer: x\n\r\n",  // bare LF in trailer
+      NULL};
+  for (int i = 0; cases[i] != NULL; ++i) {
+    ChunkedDecoder d;
+    d.reset(1024);
+    std::string out;
+    std::size_t consumed = 0;
+    EXPECT_EQ(feedAll(d, cases[i], out, consumed), ChunkedDecoder::CHUNKED_BAD)
+        << "input: " << cases[i];
+  }
+}
+
+TEST(ChunkedDecoderTests, RejectsOverlongExtensions) {
+  ChunkedDecoder d;
+  d.reset(1024);
+  std::string out;
+  std::size_t consumed = 0;
+  std::string in = "1;" + std::string(8192, 'e') + "\r\n";
+  EXPECT_EQ(feedAll(d, in, out, consumed), ChunkedDecoder::CHUNKED_BAD);
+}
+
+TEST(ChunkedDecoderTests, ResetStartsANewBody) {
+  ChunkedDecoder d;
+  d.reset(1024);
+  std::string out;
+  std::size_t consumed = 0;
+  EXPECT_EQ(feedAll(d, "zz", out, consumed), ChunkedDecoder::CHUNKED_BAD);
+
+  d.reset(1024);
+  EXPECT_FALSE(d.done());
+  EXPECT_EQ(d.decodedSize(), 0u);
+  EXPECT_EQ(feedAll(d, "1\r\nx\r\n0\r\n\r\n", out, consumed),
+            ChunkedDecoder::CHUNKED_DONE);
+  EXPECT_EQ(out, "x");
+}
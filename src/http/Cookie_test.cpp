@@ -27,6 +27,35 @@ TEST(CookieTests, ParseCookieHeader) {
   EXPECT_FALSE(req.getCookie("d", v));
 }
 
+TEST(CookieTests, MultipleCookieHeadersLastValueWins) {
+  Request req;
+  std::string buf =
+      "GET / HTTP/1.1\r\nCookie: a=1;  b = spaced ;c=\r\n"
+      "cookie: a=2; noval\r\n\r\n";
+  std::size_t headers_pos = buf.find("\r\n\r\n");
+  ASSERT_TRUE(req.parseStartAndHeaders(buf, headers_pos));
+
+  std::string v;
+  EXPECT_TRUE(req.getCookie("a", v));
+  EXPECT_EQ(v, "2");
+  EXPECT_TRUE(req.getCookie("b", v));
+  EXPECT_EQ(v, "spaced");
+  EXPECT_TRUE(req.getCookie("c", v));
+  EXPECT_EQ(v, "");
+  EXPECT_FALSE(req.getCookie("noval", v));
+}
+
+TEST(CookieTests, CopiedRequestKeepsCookies) {
+  Request req;
+  std::string buf = "GET / HTTP/1.1\r\nCookie: sess=abc\r\n\r\n";
+  ASSERT_TRUE(req.parseStartAndHeaders(buf, buf.find("\r\n\r\n")));
+
+  Request copy(req);
+  std::string v;
+  EXPECT_TRUE(copy.getCookie("sess", v));
+  EXPECT_EQ(v, "abc");
+}
+
 TEST(CookieTests, ResponseAddCookie) {
   Response resp;
   resp.setStatus(http::S_200_OK, HTTP_VERSION);
@@ -21,23 +21,42 @@ std::string methodToString(Method m) {
   }
 }
 
-Method stringToMethod(const std::string& s) {
-  if (s == "GET") {
-    return GET;
-  }
-  if (s == "POST") {
-    return POST;
-  }
-  if (s == "PUT") {
-    return PUT;
-  }
-  if (s == "DELETE") {
-    return DELETE;
+Method parseMethod(const std::string& s) {
+  // Dispatch on length first so each token costs at most two compares.
+  switch (s.size()) {
+    case 3:
+      if (s == "GET") {
+        return GET;
+      }
+      if (s == "PUT") {
+        return PUT;
+      }
+      break;
+    case 4:
+      if (s == "POST") {
+        return POST;
+      }
+      if (s == "HEAD") {
+        return HEAD;
+      }
+      break;
+    case 6:
+      if (s == "DELETE") {
+        return DELETE;
+      }
+      break;
+    default:
+      break;
   }
-  if (s == "HEAD") {
-    return HEAD;
+  return UNKNOWN;
+}
+
+Method stringToMethod(const std::string& s) {
+  Method m = parseMethod(s);
+  if (m == UNKNOWN) {
+    throw std::invalid_argument(std::string("Unknown HTTP method: ") + s);
   }
-  throw std::invalid_argument(std::string("Unknown HTTP method: ") + s);
+  return m;
 }
 
 }  // namespace http
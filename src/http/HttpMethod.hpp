@@ -3,9 +3,14 @@
 #include <string>
 
 namespace http {
-enum Method { GET, POST, PUT, DELETE, HEAD };
+enum Method { GET, POST, PUT, DELETE, HEAD, UNKNOWN };
 
 std::string methodToString(Method m);
+// Map a request-line method token to its enum value. Never throws:
+// unrecognized tokens yield UNKNOWN so bogus requests stay cheap to reject.
+Method parseMethod(const std::string& s);
+// Like parseMethod() but throws std::invalid_argument for unknown methods
+// (used by the configuration parser).
 Method stringToMethod(const std::string& s);
 
 }  // namespace http
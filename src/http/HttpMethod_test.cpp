@@ -25,3 +25,19 @@ TEST(HttpMethodTests, StringToMethodInvalidMethodThrows) {
   EXPECT_THROW(http::stringToMethod("get"), std::invalid_argument);
   EXPECT_THROW(http::stringToMethod(""), std::invalid_argument);
 }
+
+TEST(HttpMethodTests, ParseMethodValidMethods) {
+  EXPECT_EQ(http::parseMethod("GET"), http::GET);
+  EXPECT_EQ(http::parseMethod("POST"), http::POST);
+  EXPECT_EQ(http::parseMethod("PUT"), http::PUT);
+  EXPECT_EQ(http::parseMethod("DELETE"), http::DELETE);
+  EXPECT_EQ(http::parseMethod("HEAD"), http::HEAD);
+}
+
+TEST(HttpMethodTests, ParseMethodUnknownDoesNotThrow) {
+  EXPECT_NO_THROW(http::parseMethod("INVALID"));
+  EXPECT_EQ(http::parseMethod("INVALID"), http::UNKNOWN);
+  EXPECT_EQ(http::parseMethod("get"), http::UNKNOWN);
+  EXPECT_EQ(http::parseMethod("GETS"), http::UNKNOWN);
+  EXPECT_EQ(http::parseMethod(""), http::UNKNOWN);
+}
@@ -1,97 +1,122 @@
 #include "HttpStatus.hpp"
 
-#include <sstream>
 #include <stdexcept>
 
+#include "ByteBuilder.hpp"
+#include "constants.hpp"
+
 namespace http {
 
-std::string reasonPhrase(Status status) {
-  switch (status) {
-    case S_200_OK:
-      return "OK";
-    case S_201_CREATED:
-      return "Created";
-    case S_204_NO_CONTENT:
-      return "No Content";
-    case S_206_PARTIAL_CONTENT:
-      return "Partial Content";
-    case S_301_MOVED_PERMANENTLY:
-      return "Moved Permanently";
-    case S_302_FOUND:
-      return "Found";
-    case S_303_SEE_OTHER:
-      return "See Other";
-    case S_307_TEMPORARY_REDIRECT:
-      return "Temporary Redirect";
-    case S_308_PERMANENT_REDIRECT:
-      return "Permanent Redirect";
-    case S_400_BAD_REQUEST:
-      return "Bad Request";
-    case S_401_UNAUTHORIZED:
-      return "Unauthorized";
-    case S_402_PAYMENT_REQUIRED:
-      return "Payment Required";
-    case S_403_FORBIDDEN:
-      return "Forbidden";
-    case S_404_NOT_FOUND:
-      return "Not Found";
-    case S_405_METHOD_NOT_ALLOWED:
-      return "Method Not Allowed";
-    case S_406_NOT_ACCEPTABLE:
-      return "Not Acceptable";
-    case S_408_REQUEST_TIMEOUT:
-      return "Request Timeout";
-    case S_409_CONFLICT:
-      return "Conflict";
-    case S_410_GONE:
-      return "Gone";
-    case S_411_LENGTH_REQUIRED:
-      return "Length Required";
-    case S_413_PAYLOAD_TOO_LARGE:
-      return "Payload Too Large";
-    case S_414_URI_TOO_LONG:
-      return "URI Too Long";
-    case S_415_UNSUPPORTED_MEDIA_TYPE:
-      return "Unsupported Media Type";
-    case S_416_RANGE_NOT_SATISFIABLE:
-      return "Range Not Satisfiable";
-    case S_417_EXPECTATION_FAILED:
-      return "Expectation Failed";
-    case S_418_IM_A_TEAPOT:
-      return "I'm a teapot";
-    case S_426_UPGRADE_REQUIRED:
-      return "Upgrade Required";
-    case S_428_PRECONDITION_REQUIRED:
-      return "Precondition Required";
-    case S_429_TOO_MANY_REQUESTS:
-      return "Too Many Requests";
-    case S_431_REQUEST_HEADER_FIELDS_TOO_LARGE:
-      return "Header Fields Too Large";
-    case S_451_UNAVAILABLE_FOR_LEGAL_REASONS:
-      return "Legal Reasons";
-    case S_500_INTERNAL_SERVER_ERROR:
-      return "Internal Server Error";
-    case S_501_NOT_IMPLEMENTED:
-      return "Not Implemented";
-    case S_502_BAD_GATEWAY:
-      return "Bad Gateway";
-    case S_503_SERVICE_UNAVAILABLE:
-      return "Service Unavailable";
-    case S_504_GATEWAY_TIMEOUT:
-      return "Gateway Timeout";
-    case S_505_HTTP_VERSION_NOT_SUPPORTED:
-      return "HTTP Version Not Supported";
-    case S_507_INSUFFICIENT_STORAGE:
-      return "Insufficient Storage";
-    case S_509_BANDWIDTH_LIMIT_EXCEEDED:
-      return "Bandwidth Limit Exceeded";
-    case S_510_NOT_EXTENDED:
-      return "Not Extended";
-    case S_511_NETWORK_AUTHENTICATION_REQUIRED:
-      return "Network Authentication Required";
-    default:
-      return "";
+namespace {
+
+struct StatusEntry {
+  Status code;
+  const char* reason;
+};
+
+const StatusEntry kStatusEntries[] = {
+    {S_100_CONTINUE, "Continue"},
+    {S_200_OK, "OK"},
+    {S_201_CREATED, "Created"},
+    {S_204_NO_CONTENT, "No Content"},
+    {S_206_PARTIAL_CONTENT, "Partial Content"},
+    {S_301_MOVED_PERMANENTLY, "Moved Permanently"},
+    {S_302_FOUND, "Found"},
+    {S_303_SEE_OTHER, "See Other"},
+    {S_304_NOT_MODIFIED, "Not Modified"},
+    {S_307_TEMPORARY_REDIRECT, "Temporary Redirect"},
+    {S_308_PERMANENT_REDIRECT, "Permanent Redirect"},
+    {S_400_BAD_REQUEST, "Bad Request"},
+    {S_401_UNAUTHORIZED, "Unauthorized"},
+    {S_402_PAYMENT_REQUIRED, "Payment Required"},
+    {S_403_FORBIDDEN, "Forbidden"},
+    {S_404_NOT_FOUND, "Not Found"},
+    {S_405_METHOD_NOT_ALLOWED, "Method Not Allowed"},
+    {S_406_NOT_ACCEPTABLE, "Not Acceptable"},
+    {S_408_REQUEST_TIMEOUT, "Request Timeout"},
+    {S_409_CONFLICT, "Conflict"},
+    {S_410_GONE, "Gone"},
+    {S_411_LENGTH_REQUIRED, "Length Required"},
+    {S_413_PAYLOAD_TOO_LARGE, "Payload Too Large"},
+    {S_414_URI_TOO_LONG, "URI Too Long"},
+    {S_415_UNSUPPORTED_MEDIA_TYPE, "Unsupported Media Type"},
+    {S_416_RANGE_NOT_SATISFIABLE, "Range Not Satisfiable"},
+    {S_417_EXPECTATION_FAILED, "Expectation Failed"},
+    {S_418_IM_A_TEAPOT, "I'm a teapot"},
+    {S_426_UPGRADE_REQUIRED, "Upgrade Required"},
+    {S_428_PRECONDITION_REQUIRED, "Precondition Required"},
+    {S_429_TOO_MANY_REQUESTS, "Too Many Requests"},
+    {S_431_REQUEST_HEADER_FIELDS_TOO_LARGE, "Header Fields Too Large"},
+    {S_451_UNAVAILABLE_FOR_LEGAL_REASONS, "Legal Reasons"},
+    {S_500_INTERNAL_SERVER_ERROR, "Internal Server Error"},
+    {S_501_NOT_IMPLEMENTED, "Not Implemented"},
+    {S_502_BAD_GATEWAY, "Bad Gateway"},
+    {S_503_SERVICE_UNAVAILABLE, "Service Unavailable"},
+    {S_504_GATEWAY_TIMEOUT, "Gateway Timeout"},
+    {S_505_HTTP_VERSION_NOT_SUPPORTED, "HTTP Version Not Supported"},
+    {S_507_INSUFFICIENT_STORAGE, "Insufficient Storage"},
+    {S_509_BANDWIDTH_LIMIT_EXCEEDED, "Bandwidth Limit Exceeded"},
+    {S_510_NOT_EXTENDED, "Not Extended"},
+    {S_511_NETWORK_AUTHENTICATION_REQUIRED, "Network Authentication Required"},
+};
+
+// Codes are < 600, so a flat array indexed by code gives O(1) lookups.
+const int kStatusTableSize = 600;
+
+// Reason phrases and full status lines, built once on first use so that
+// serializing a response never formats or allocates them again.
+struct StatusTable {
+  std::string reason[kStatusTableSize];
+  std::string line_http10[kStatusTableSize];
+  std::string line_http11[kStatusTableSize];
+
+  StatusTable() {
+    const std::size_t n = sizeof(kStatusEntries) / sizeof(kStatusEntries[0]);
+    for (std::size_t i = 0; i < n; ++i) {
+      int code = kStatusEntries[i].code;
+      char digits[4];
+      digits[0] = static_cast<char>('0' + code / 100);
+      digits[1] = static_cast<char>('0' + (code / 10) % 10);
+      digits[2] = static_cast<char>('0' + code % 10);
+      digits[3] = '\0';
+      reason[code] = kStatusEntries[i].reason;
+      std::string tail = std::string(" ") + digits + " " + reason[code] + CRLF;
+      line_http10[code] = "HTTP/1.0" + tail;
+      line_http11[code] = "HTTP/1.1" + tail;
+    }
+  }
+};
+
+const StatusTable& statusTable() {
+  static const StatusTable instance;
+  return instance;
+}
+
+bool inTable(Status s) {
+  return static_cast<int>(s) > 0 && static_cast<int>(s) < kStatusTableSize;
+}
+
+}  // namespace
+
+const std::string& reasonPhrase(Status status) {
+  static const std::string kEmpty;
+  if (!inTable(status)) {
+    return kEmpty;
+  }
+  return statusTable().reason[status];
+}
+
+const std::string* statusLine(Status status, const std::string& version) {
+  if (!inTable(status) || statusTable().reason[status].empty()) {
+    return NULL;
+  }
+  if (version == "HTTP/1.1") {
+    return &statusTable().line_http11[status];
+  }
+  if (version == "HTTP/1.0") {
+    return &statusTable().line_http10[status];
   }
+  return NULL;
 }
 
 Status intToStatus(int status) {
@@ -110,6 +135,8 @@ Status intToStatus(int status) {
       return S_302_FOUND;
     case 303:
       return S_303_SEE_OTHER;
+    case 304:
+      return S_304_NOT_MODIFIED;
     case 307:
       return S_307_TEMPORARY_REDIRECT;
     case 308:
@@ -184,13 +211,14 @@ Status intToStatus(int status) {
 }
 
 std::string statusWithReason(Status s) {
-  std::ostringstream oss;
-  oss << s;
-  std::string reason = reasonPhrase(s);
-  if (!reason.empty()) {
-    oss << " " << reason;
+  const std::string* line = statusLine(s, "HTTP/1.1");
+  if (line != NULL) {
+    // Strip the leading "HTTP/1.1 " and the trailing CRLF
+    return line->substr(9, line->size() - 11);
   }
-  return oss.str();
+  std::string out;
+  ByteBuilder(out).appendNumber(static_cast<long long>(s));
+  return out;
 }
 
 bool isSuccess(Status s) {
@@ -6,6 +6,8 @@ namespace http {
 
 enum Status {
   S_0_UNKNOWN = 0,
+  // 1xx Informational
+  S_100_CONTINUE = 100,
   // 2xx Success
   S_200_OK = 200,
   S_201_CREATED = 201,
@@ -15,6 +17,7 @@ enum Status {
   S_301_MOVED_PERMANENTLY = 301,
   S_302_FOUND = 302,
   S_303_SEE_OTHER = 303,
+  S_304_NOT_MODIFIED = 304,
   S_307_TEMPORARY_REDIRECT = 307,
   S_308_PERMANENT_REDIRECT = 308,
   // 4xx Client Errors
@@ -56,7 +59,13 @@ enum Status {
 // Convert int to Status enum; throws std::invalid_argument on unknown code
 Status intToStatus(int status);
 
-std::string reasonPhrase(Status s);
+// Reason phrase from a table built once; empty string for unknown codes.
+const std::string& reasonPhrase(Status s);
+
+// Precomputed status line including the trailing CRLF, e.g.
+// "HTTP/1.1 404 Not Found\r\n". Returns NULL for unknown codes or versions
+// other than HTTP/1.0 and HTTP/1.1.
+const std::string* statusLine(Status s, const std::string& version);
 
 // Return a single string containing the numeric status and reason phrase,
 // e.g. "404 Not Found". Accept only the enum to avoid casts.
@@ -18,6 +18,7 @@ TEST(HttpStatusTests, IntToStatusValidCodes) {
   EXPECT_EQ(http::intToStatus(404), http::S_404_NOT_FOUND);
   EXPECT_EQ(http::intToStatus(500), http::S_500_INTERNAL_SERVER_ERROR);
   EXPECT_EQ(http::intToStatus(301), http::S_301_MOVED_PERMANENTLY);
+  EXPECT_EQ(http::intToStatus(304), http::S_304_NOT_MODIFIED);
 }
 
 TEST(HttpStatusTests, IntToStatusInvalidCodeThrows) {
@@ -75,3 +76,22 @@ TEST(HttpStatusTests, IsValidStatusCode) {
   EXPECT_FALSE(http::isValidStatusCode(100));
   EXPECT_FALSE(http::isValidStatusCode(0));
 }
+
+TEST(HttpStatusTests, StatusLineIsPrecomputedPerVersion) {
+  const std::string* l11 = http::statusLine(http::S_404_NOT_FOUND, "HTTP/1.1");
+  ASSERT_TRUE(l11 != NULL);
+  EXPECT_EQ(*l11, "HTTP/1.1 404 Not Found\r\n");
+
+  const std::string* l10 = http::statusLine(http::S_200_OK, "HTTP/1.0");
+  ASSERT_TRUE(l10 != NULL);
+  EXPECT_EQ(*l10, "HTTP/1.0 200 OK\r\n");
+
+  // Same pointer on every call: no per-call formatting
+  EXPECT_EQ(l11, http::statusLine(http::S_404_NOT_FOUND, "HTTP/1.1"));
+}
+
+TEST(HttpStatusTests, StatusLineRejectsUnknownInputs) {
+  EXPECT_TRUE(http::statusLine(http::S_200_OK, "HTTP/2.0") == NULL);
+  EXPECT_TRUE(http::statusLine(http::S_0_UNKNOWN, "HTTP/1.1") == NULL);
+  EXPECT_EQ(http::reasonPhrase(http::S_0_UNKNOWN), "");
+}
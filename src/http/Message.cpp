@@ -66,6 +66,17 @@ std::vector<std::string> Message::getHeaders(const std::string& name) const {
   return res;
 }
 
+void Message::removeHeader(const std::string& name) {
+  std::vector<Header>::iterator out = headers.begin();
+  for (std::vector<Header>::iterator it = headers.begin(); it != headers.end();
+       ++it) {
+    if (!ci_equal_copy(it->name, name)) {
+      *out++ = *it;
+    }
+  }
+  headers.erase(out, headers.end());
+}
+
 void Message::setBody(const Body& b) {
   body = b;
 }
@@ -16,6 +16,8 @@ class Message {
   void addHeader(const std::string& name, const std::string& value);
   bool getHeader(const std::string& name, std::string& out) const;
   std::vector<std::string> getHeaders(const std::string& name) const;
+  // Drop every header called `name` (case-insensitive)
+  void removeHeader(const std::string& name);
 
   void setBody(const Body& b);
   Body& getBody();
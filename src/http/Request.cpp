@@ -1,17 +1,24 @@
 #include "Request.hpp"
 
-#include "utils.hpp"
+#include <strings.h>
 
-Request::Request() : Message(), request_line(), uri() {}
+Request::Request()
+    : Message(), request_line(), uri(), cookies_(), cookies_parsed_(false) {}
 
 Request::Request(const Request& other)
-    : Message(other), request_line(other.request_line), uri(other.uri) {}
+    : Message(other),
+      request_line(other.request_line),
+      uri(other.uri),
+      cookies_(other.cookies_),
+      cookies_parsed_(other.cookies_parsed_) {}
 
 Request& Request::operator=(const Request& other) {
   if (this != &other) {
     Message::operator=(other);
     request_line = other.request_line;
     uri = other.uri;
+    cookies_ = other.cookies_;
+    cookies_parsed_ = other.cookies_parsed_;
   }
   return *this;
 }
@@ -61,27 +68,55 @@ bool Request::parseStartAndHeaders(const std::string& buffer,
   }
 
   parseHeaders(lines, 1);
-  // Parse Cookie headers into the cookies map
-  std::vector<std::string> cookie_headers = getHeaders("Cookie");
-  for (std::vector<std::string>::const_iterator it = cookie_headers.begin();
-       it != cookie_headers.end(); ++it) {
-    const std::string& ch = *it;
+  // Cookie headers are parsed on demand by getCookie()
+  cookies_.clear();
+  cookies_parsed_ = false;
+  return true;
+}
+
+namespace {
+bool isCookieSpace(char c) {
+  return c == ' ' || c == '\t';
+}
+}  // namespace
+
+void Request::parseCookies_() const {
+  cookies_parsed_ = true;
+  for (std::vector<Header>::const_iterator it = headers.begin();
+       it != headers.end(); ++it) {
+    if (it->name.size() != 6 ||
+        strncasecmp(it->name.c_str(), "Cookie", 6) != 0) {
+      continue;
+    }
+    const std::string& ch = it->value;
     std::string::size_type start = 0;
     while (start < ch.size()) {
       std::string::size_type sep = ch.find(';', start);
-      std::string pair = (sep == std::string::npos)
-                             ? ch.substr(start)
-                             : ch.substr(start, sep - start);
-      pair = trim_copy(pair);
-      std::string::size_type eq = pair.find('=');
-      if (eq != std::string::npos) {
-        std::string k = trim_copy(pair.substr(0, eq));
-        std::string v = trim_copy(pair.substr(eq + 1));
-        if (!k.empty()) {
+      std::string::size_type stop =
+          (sep == std::string::npos) ? ch.size() : sep;
+      std::string::size_type eq = ch.find('=', start);
+      if (eq != std::string::npos && eq < stop) {
+        // Trim whitespace around the name and value in place instead of
+        // allocating intermediate substrings.
+        std::string::size_type kb = start, ke = eq;
+        while (kb < ke && isCookieSpace(ch[kb])) {
+          ++kb;
+        }
+        while (ke > kb && isCookieSpace(ch[ke - 1])) {
+          --ke;
+        }
+        std::string::size_type vb = eq + 1, ve = stop;
+        while (vb < ve && isCookieSpace(ch[vb])) {
+          ++vb;
+        }
+        while (ve > vb && isCookieSpace(ch[ve - 1])) {
+          --ve;
+        }
+        if (ke > kb) {
           // If multiple cookies share the same name, the last occurrence
           // overwrites the previous value ("last value wins" policy as defined
           // by the application).
-          cookies[k] = v;
+          cookies_[ch.substr(kb, ke - kb)] = ch.substr(vb, ve - vb);
         }
       }
       if (sep == std::string::npos) {
@@ -90,12 +125,14 @@ bool Request::parseStartAndHeaders(const std::string& buffer,
       start = sep + 1;
     }
   }
-  return true;
 }
 
 bool Request::getCookie(const std::string& name, std::string& out) const {
-  std::map<std::string, std::string>::const_iterator it = cookies.find(name);
-  if (it == cookies.end()) {
+  if (!cookies_parsed_) {
+    parseCookies_();
+  }
+  std::map<std::string, std::string>::const_iterator it = cookies_.find(name);
+  if (it == cookies_.end()) {
     return false;
   }
   out = it->second;
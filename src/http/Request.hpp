@@ -16,12 +16,18 @@ class Request : public Message {
 
   RequestLine request_line;
   http::Uri uri;  // Parsed URI from request_line.uri
-  // Parsed cookies from Cookie headers (name -> value)
-  std::map<std::string, std::string> cookies;
 
-  // Retrieve a cookie value by name. Returns true if found.
+  // Retrieve a cookie value by name. Returns true if found. Cookie headers
+  // are only split into name/value pairs on the first call.
   bool getCookie(const std::string& name, std::string& out) const;
 
   virtual std::string startLine() const;
   bool parseStartAndHeaders(const std::string& buffer, std::size_t headers_pos);
+
+ private:
+  void parseCookies_() const;
+
+  // Parsed cookies from Cookie headers (name -> value), filled lazily
+  mutable std::map<std::string, std::string> cookies_;
+  mutable bool cookies_parsed_;
 };
@@ -1,15 +1,41 @@
 #include "RequestLine.hpp"
 
-#include <sstream>
+namespace {
+bool isLineSpace(char c) {
+  return c == ' ' || c == '\t';
+}
+
+// Extract the next whitespace-separated token starting at `pos`.
+bool nextToken(const std::string& line, std::string::size_type& pos,
+               std::string& out) {
+  while (pos < line.size() && isLineSpace(line[pos])) {
+    ++pos;
+  }
+  std::string::size_type start = pos;
+  while (pos < line.size() && !isLineSpace(line[pos])) {
+    ++pos;
+  }
+  if (pos == start) {
+    return false;
+  }
+  out.assign(line, start, pos - start);
+  return true;
+}
+}  // namespace
 
-RequestLine::RequestLine() : method(), uri(), version() {}
+RequestLine::RequestLine()
+    : method(http::UNKNOWN), method_name(), uri(), version() {}
 
 RequestLine::RequestLine(const RequestLine& other)
-    : method(other.method), uri(other.uri), version(other.version) {}
+    : method(other.method),
+      method_name(other.method_name),
+      uri(other.uri),
+      version(other.version) {}
 
 RequestLine& RequestLine::operator=(const RequestLine& other) {
   if (this != &other) {
     method = other.method;
+    method_name = other.method_name;
     uri = other.uri;
     version = other.version;
   }
@@ -19,15 +45,21 @@ RequestLine& RequestLine::operator=(const RequestLine& other) {
 RequestLine::~RequestLine() {}
 
 std::string RequestLine::toString() const {
-  std::ostringstream o;
-  o << method << " " << uri << " " << version;
-  return o.str();
+  std::string out =
+      (method != http::UNKNOWN) ? http::methodToString(method) : method_name;
+  out += ' ';
+  out += uri;
+  out += ' ';
+  out += version;
+  return out;
 }
 
 bool RequestLine::parse(const std::string& line) {
-  std::istringstream in(line);
-  if (!(in >> method >> uri >> version)) {
+  std::string::size_type pos = 0;
+  if (!nextToken(line, pos, method_name) || !nextToken(line, pos, uri) ||
+      !nextToken(line, pos, version)) {
     return false;
   }
+  method = http::parseMethod(method_name);
   return true;
 }
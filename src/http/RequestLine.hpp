@@ -2,6 +2,8 @@
 
 #include <string>
 
+#include "HttpMethod.hpp"
+
 class RequestLine {
  public:
   RequestLine();
@@ -9,7 +11,10 @@ class RequestLine {
   RequestLine& operator=(const RequestLine& other);
   ~RequestLine();
 
-  std::string method;
+  // Method parsed once from the request line; http::UNKNOWN if unrecognized.
+  http::Method method;
+  // Raw method token as received (kept for logging unknown methods).
+  std::string method_name;
   std::string uri;
   std::string version;
 
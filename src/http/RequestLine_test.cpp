@@ -4,39 +4,40 @@
 
 TEST(RequestLineTests, DefaultConstructorCreatesEmptyRequestLine) {
   RequestLine rl;
-  EXPECT_EQ(rl.method, "");
+  EXPECT_EQ(rl.method, http::UNKNOWN);
+  EXPECT_EQ(rl.method_name, "");
   EXPECT_EQ(rl.uri, "");
   EXPECT_EQ(rl.version, "");
 }
 
 TEST(RequestLineTests, CopyConstructorCopiesFields) {
   RequestLine rl1;
-  rl1.method = "GET";
+  rl1.method = http::GET;
   rl1.uri = "/index.html";
   rl1.version = "HTTP/1.1";
 
   RequestLine rl2(rl1);
-  EXPECT_EQ(rl2.method, "GET");
+  EXPECT_EQ(rl2.method, http::GET);
   EXPECT_EQ(rl2.uri, "/index.html");
   EXPECT_EQ(rl2.version, "HTTP/1.1");
 }
 
 TEST(RequestLineTests, AssignmentOperatorCopiesFields) {
   RequestLine rl1;
-  rl1.method = "POST";
+  rl1.method = http::POST;
   rl1.uri = "/api/users";
   rl1.version = "HTTP/1.1";
 
   RequestLine rl2;
   rl2 = rl1;
-  EXPECT_EQ(rl2.method, "POST");
+  EXPECT_EQ(rl2.method, http::POST);
   EXPECT_EQ(rl2.uri, "/api/users");
   EXPECT_EQ(rl2.version, "HTTP/1.1");
 }
 
 TEST(RequestLineTests, ToStringFormatsCorrectly) {
   RequestLine rl;
-  rl.method = "GET";
+  rl.method = http::GET;
   rl.uri = "/test";
   rl.version = "HTTP/1.1";
 
@@ -46,7 +47,8 @@ TEST(RequestLineTests, ToStringFormatsCorrectly) {
 TEST(RequestLineTests, ParseValidRequestLine) {
   RequestLine rl;
   EXPECT_TRUE(rl.parse("GET /index.html HTTP/1.1"));
-  EXPECT_EQ(rl.method, "GET");
+  EXPECT_EQ(rl.method, http::GET);
+  EXPECT_EQ(rl.method_name, "GET");
   EXPECT_EQ(rl.uri, "/index.html");
   EXPECT_EQ(rl.version, "HTTP/1.1");
 }
@@ -54,7 +56,8 @@ TEST(RequestLineTests, ParseValidRequestLine) {
 TEST(RequestLineTests, ParseValidPostRequest) {
   RequestLine rl;
   EXPECT_TRUE(rl.parse("POST /api/data HTTP/1.0"));
-  EXPECT_EQ(rl.method, "POST");
+  EXPECT_EQ(rl.method, http::POST);
+  EXPECT_EQ(rl.method_name, "POST");
   EXPECT_EQ(rl.uri, "/api/data");
   EXPECT_EQ(rl.version, "HTTP/1.0");
 }
@@ -65,3 +68,17 @@ TEST(RequestLineTests, ParseInvalidRequestLineReturnsFalse) {
   EXPECT_FALSE(rl.parse("GET /path"));
   EXPECT_FALSE(rl.parse(""));
 }
+
+TEST(RequestLineTests, ParseUnknownMethodDoesNotFail) {
+  RequestLine rl;
+  EXPECT_TRUE(rl.parse("BREW /pot HTTP/1.1"));
+  EXPECT_EQ(rl.method, http::UNKNOWN);
+  EXPECT_EQ(rl.method_name, "BREW");
+  EXPECT_EQ(rl.toString(), "BREW /pot HTTP/1.1");
+}
+
+TEST(RequestLineTests, ParseMethodIsCaseSensitive) {
+  RequestLine rl;
+  EXPECT_TRUE(rl.parse("get / HTTP/1.1"));
+  EXPECT_EQ(rl.method, http::UNKNOWN);
+}
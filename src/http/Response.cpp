@@ -1,19 +1,24 @@
 #include "Response.hpp"
 
-#include <sstream>
+#include <strings.h>
 
+#include "ByteBuilder.hpp"
 #include "HttpStatus.hpp"
 #include "constants.hpp"
+#include "utils.hpp"
 
-Response::Response() : Message(), status_line() {}
+Response::Response() : Message(), status_line(), extra_headers(NULL) {}
 
 Response::Response(const Response& other)
-    : Message(other), status_line(other.status_line) {}
+    : Message(other),
+      status_line(other.status_line),
+      extra_headers(other.extra_headers) {}
 
 Response& Response::operator=(const Response& other) {
   if (this != &other) {
     Message::operator=(other);
     status_line = other.status_line;
+    extra_headers = other.extra_headers;
   }
 
   return *this;
@@ -46,31 +51,78 @@ void Response::setBodyWithContentType(const std::string& data,
                                       const std::string& contentType) {
   body.data = data;
   addHeader("Content-Type", contentType);
-  std::ostringstream oss;
-  oss << body.size();
-  addHeader("Content-Length", oss.str());
+  addHeader("Content-Length",
+            toDecimalString(static_cast<long long>(body.size())));
 }
+
 std::string Response::serialize() const {
-  std::ostringstream o;
-  o << startLine() << CRLF;
-  std::string headers_str = serializeHeaders();
-  std::string tmp;
-  if (!getHeader("Connection", tmp)) {
-    headers_str += std::string("Connection: close") + CRLF;
+  std::string out;
+  serializeInto(out);
+  return out;
+}
+
+void Response::serializeHeadInto(std::string& out) const {
+  out.clear();
+  ByteBuilder b(out);
+
+  // Use the precomputed status line unless a handler (e.g. CGI) supplied a
+  // custom reason phrase or an unusual version.
+  const std::string* line =
+      http::statusLine(status_line.status_code, status_line.version);
+  if (line != NULL &&
+      status_line.reason == http::reasonPhrase(status_line.status_code)) {
+    b.append(*line);
+  } else {
+    b.append(status_line.version)
+        .append(' ')
+        .appendNumber(static_cast<long long>(status_line.status_code))
+        .append(' ')
+        .append(status_line.reason)
+        .appendCrlf();
+  }
+
+  // Emit headers and look for Connection in the same pass
+  bool has_connection = false;
+  for (std::vector<Header>::const_iterator it = headers.begin();
+       it != headers.end(); ++it) {
+    if (!has_connection && it->name.size() == 10 &&
+        strncasecmp(it->name.c_str(), "Connection", 10) == 0) {
+      has_connection = true;
+    }
+    b.appendHeader(it->name, it->value);
+  }
+  if (extra_headers != NULL) {
+    b.append(*extra_headers);
+  }
+  if (!has_connection) {
+    b.append("Connection: close" CRLF);
   }
-  o << headers_str;
-  o << CRLF;
-  o << body.data;
-  return o.str();
+  b.appendCrlf();
+}
+
+void Response::serializeInto(std::string& out) const {
+  serializeHeadInto(out);
+  out.append(body.data);
 }
 
-std::string Response::serializeHeadersWithConnection() const {
-  std::string headers_str = serializeHeaders();
-  std::string tmp;
-  if (!getHeader("Connection", tmp)) {
-    headers_str += std::string("Connection: close") + CRLF;
+void Response::addVary(const std::string& field) {
+  std::vector<std::string> values = getHeaders("Vary");
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    std::string::size_type start = 0;
+    while (start <= values[i].size()) {
+      std::string::size_type comma = values[i].find(',', start);
+      if (comma == std::string::npos) {
+        comma = values[i].size();
+      }
+      std::string listed = trim_copy(values[i].substr(start, comma - start));
+      if (listed == "*" ||
+          strcasecmp(listed.c_str(), field.c_str()) == 0) {
+        return;
+      }
+      start = comma + 1;
+    }
   }
-  return headers_str;
+  addHeader("Vary", field);
 }
 
 void Response::addCookie(const std::string& name, const std::string& value,
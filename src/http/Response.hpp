@@ -11,18 +11,27 @@ class Response : public Message {
   virtual ~Response();
 
   StatusLine status_line;
+  // Header lines serialized ahead of time (a location's "expires" and
+  // "add_header"), written after `headers`. Not owned; NULL when none.
+  const std::string* extra_headers;
 
   virtual std::string startLine() const;
   virtual std::string serialize() const;
   bool parseStartAndHeaders(const std::vector<std::string>& lines);
 
-  // Serialize including implicit Connection header when absent
-  std::string serializeHeadersWithConnection() const;
+  // Write the status line, headers and extra_headers (adding
+  // "Connection: close" when absent) and the blank line into `out`,
+  // replacing its contents but reusing its capacity. serializeInto() also
+  // appends the body.
+  void serializeHeadInto(std::string& out) const;
+  void serializeInto(std::string& out) const;
 
   // Helper methods to reduce boilerplate when constructing responses
   void setStatus(http::Status status, const std::string& version);
   void setBodyWithContentType(const std::string& data,
                               const std::string& contentType);
+  // Add "Vary: <field>" unless a Vary header already lists `field`
+  void addVary(const std::string& field);
   // Add a Set-Cookie header. `attrs` can contain semicolon-separated
   // attributes like "Path=/; HttpOnly".
   void addCookie(const std::string& name, const std::string& value,
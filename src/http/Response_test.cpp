@@ -0,0 +1,83 @@
+#include "Response.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "HttpStatus.hpp"
+
+TEST(ResponseTests, SerializeHeadAddsImplicitConnectionClose) {
+  Response resp;
+  resp.setStatus(http::S_404_NOT_FOUND, "HTTP/1.1");
+  resp.addHeader("Content-Length", "0");
+
+  std::string out = "stale bytes";
+  resp.serializeHeadInto(out);
+  EXPECT_EQ(out,
+            "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n"
+            "Connection: close\r\n\r\n");
+}
+
+TEST(ResponseTests, SerializeHeadKeepsExplicitConnectionHeader) {
+  Response resp;
+  resp.setStatus(http::S_200_OK, "HTTP/1.0");
+  resp.addHeader("connection", "keep-alive");
+
+  std::string out;
+  resp.serializeHeadInto(out);
+  EXPECT_EQ(out, "HTTP/1.0 200 OK\r\nconnection: keep-alive\r\n\r\n");
+}
+
+TEST(ResponseTests, SerializeUsesCustomReasonPhrase) {
+  Response resp;
+  resp.setStatus(http::S_200_OK, "HTTP/1.1");
+  resp.status_line.reason = "Fine";
+  resp.setBodyWithContentType("hi", "text/plain");
+
+  EXPECT_EQ(resp.serialize(),
+            "HTTP/1.1 200 Fine\r\nContent-Type: text/plain\r\n"
+            "Content-Length: 2\r\nConnection: close\r\n\r\nhi");
+}
+
+TEST(ResponseTests, SerializeHeadAppendsExtraHeaders) {
+  std::string extra = "Cache-Control: max-age=60\r\n";
+  Response resp;
+  resp.setStatus(http::S_200_OK, "HTTP/1.1");
+  resp.addHeader("Content-Length", "0");
+  resp.extra_headers = &extra;
+
+  std::string out;
+  resp.serializeHeadInto(out);
+  EXPECT_EQ(out,
+            "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n"
+            "Cache-Control: max-age=60\r\nConnection: close\r\n\r\n");
+}
+
+TEST(ResponseTests, AddVaryListsEachFieldOnce) {
+  Response resp;
+  resp.addVary("Accept-Encoding");
+  resp.addVary("accept-encoding");
+  resp.addHeader("Vary", "Origin, Cookie");
+  resp.addVary("Cookie");
+  resp.addVary("User-Agent");
+
+  std::vector<std::string> vary = resp.getHeaders("Vary");
+  ASSERT_EQ(vary.size(), 3u);
+  EXPECT_EQ(vary[0], "Accept-Encoding");
+  EXPECT_EQ(vary[1], "Origin, Cookie");
+  EXPECT_EQ(vary[2], "User-Agent");
+}
+
+TEST(ResponseTests, RemoveHeaderDropsEveryCopy) {
+  Response resp;
+  resp.addHeader("Content-Length", "10");
+  resp.addHeader("Content-Type", "text/plain");
+  resp.addHeader("content-length", "10");
+  resp.removeHeader("Content-Length");
+
+  std::string value;
+  EXPECT_FALSE(resp.getHeader("Content-Length", value));
+  ASSERT_TRUE(resp.getHeader("Content-Type", value));
+  EXPECT_EQ(value, "text/plain");
+}
@@ -1,5 +1,37 @@
 #include "http_utils.hpp"
 
+#include <strings.h>
+
+#include <cstring>
+
+#include "ByteBuilder.hpp"
+#include "utils.hpp"
+
+namespace {
+
+// Opaque part of an entity tag, without the W/ prefix
+std::string opaqueTag(const std::string& tag) {
+  if (tag.size() >= 2 && tag[0] == 'W' && tag[1] == '/') {
+    return tag.substr(2);
+  }
+  return tag;
+}
+
+// Whether a "q=<qvalue>" weight is above zero; a missing weight is 1
+bool nonZeroWeight(const std::string& params) {
+  std::string::size_type q = params.find("q=");
+  if (q == std::string::npos) {
+    q = params.find("Q=");
+  }
+  if (q == std::string::npos) {
+    return true;
+  }
+  std::string value = trim_copy(params.substr(q + 2));
+  return value.find_first_of("123456789") != std::string::npos;
+}
+
+}  // namespace
+
 namespace http {
 
 std::string escapeHtml(const std::string& s) {
@@ -31,4 +63,94 @@ std::string escapeHtml(const std::string& s) {
   return out;
 }
 
+std::string formatHttpDate(time_t t) {
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  char buf[64];
+  std::size_t n = strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+  return std::string(buf, n);
+}
+
+bool parseHttpDate(const std::string& s, time_t& out) {
+  static const char* const kFormats[] = {
+      "%a, %d %b %Y %H:%M:%S GMT",  // IMF-fixdate
+      "%A, %d-%b-%y %H:%M:%S GMT",  // RFC 850
+      "%a %b %e %H:%M:%S %Y",       // asctime
+      NULL};
+  std::string value = trim_copy(s);
+  for (int i = 0; kFormats[i] != NULL; ++i) {
+    struct tm tm;
+    std::memset(&tm, 0, sizeof(tm));
+    const char* end = strptime(value.c_str(), kFormats[i], &tm);
+    if (end != NULL && *end == '\0') {
+      out = timegm(&tm);
+      return out != static_cast<time_t>(-1);
+    }
+  }
+  return false;
+}
+
+std::string makeETag(ino_t inode, off_t size, time_t mtime) {
+  std::string tag;
+  ByteBuilder(tag)
+      .append("W/\"")
+      .appendHex(static_cast<unsigned long long>(inode))
+      .append('-')
+      .appendHex(static_cast<unsigned long long>(size))
+      .append('-')
+      .appendHex(static_cast<unsigned long long>(mtime))
+      .append('"');
+  return tag;
+}
+
+bool etagListMatches(const std::string& header, const std::string& etag) {
+  std::string value = trim_copy(header);
+  if (value == "*") {
+    return true;
+  }
+  std::string want = opaqueTag(etag);
+  std::string::size_type pos = 0;
+  while (pos <= value.size()) {
+    std::string::size_type comma = value.find(',', pos);
+    if (comma == std::string::npos) {
+      comma = value.size();
+    }
+    if (opaqueTag(trim_copy(value.substr(pos, comma - pos))) == want) {
+      return true;
+    }
+    pos = comma + 1;
+  }
+  return false;
+}
+
+bool acceptsEncoding(const std::string& header, const std::string& coding) {
+  bool listed = false;
+  bool accepted = false;
+  bool wildcard = false;
+  std::string::size_type pos = 0;
+  while (pos < header.size()) {
+    std::string::size_type comma = header.find(',', pos);
+    if (comma == std::string::npos) {
+      comma = header.size();
+    }
+    std::string item = header.substr(pos, comma - pos);
+    pos = comma + 1;
+
+    std::string::size_type semi = item.find(';');
+    std::string name = trim_copy(item.substr(0, semi));
+    std::string params =
+        semi == std::string::npos ? std::string() : item.substr(semi + 1);
+    if (strcasecmp(name.c_str(), "x-gzip") == 0) {
+      name = "gzip";
+    }
+    if (strcasecmp(name.c_str(), coding.c_str()) == 0) {
+      listed = true;
+      accepted = nonZeroWeight(params);
+    } else if (name == "*") {
+      wildcard = nonZeroWeight(params);
+    }
+  }
+  return listed ? accepted : wildcard;
+}
+
 }  // namespace http
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <sys/types.h>
+
+#include <ctime>
 #include <string>
 
 namespace http {
@@ -18,4 +21,24 @@ namespace http {
  */
 std::string escapeHtml(const std::string& s);
 
+// IMF-fixdate form of `t` ("Sun, 06 Nov 1994 08:49:37 GMT")
+std::string formatHttpDate(time_t t);
+
+// Parse an HTTP-date in any of the three forms recipients must accept
+// (IMF-fixdate, RFC 850, asctime). Returns false if `s` is none of them.
+bool parseHttpDate(const std::string& s, time_t& out);
+
+// Weak entity tag for a file, from its inode, size and modification time:
+// W/"<inode>-<size>-<mtime>" in hex
+std::string makeETag(ino_t inode, off_t size, time_t mtime);
+
+// Whether an If-None-Match value ("*" or a comma-separated list of entity
+// tags) matches `etag`, using the weak comparison
+bool etagListMatches(const std::string& header, const std::string& etag);
+
+// Whether an Accept-Encoding value allows the content coding `coding`
+// ("gzip", "br"): listed with a non-zero q, or covered by a non-zero "*"
+// without being listed. "x-gzip" counts as "gzip".
+bool acceptsEncoding(const std::string& header, const std::string& coding);
+
 }  // namespace http
@@ -0,0 +1,65 @@
+#include "http_utils.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(HttpUtilsTests, EscapeHtmlEscapesMarkup) {
+  EXPECT_EQ(http::escapeHtml("<a href=\"x\">&'"),
+            "&lt;a href=&quot;x&quot;&gt;&amp;&#39;");
+}
+
+TEST(HttpUtilsTests, FormatHttpDateUsesImfFixdate) {
+  EXPECT_EQ(http::formatHttpDate(784111777), "Sun, 06 Nov 1994 08:49:37 GMT");
+}
+
+TEST(HttpUtilsTests, ParseHttpDateAcceptsAllThreeForms) {
+  time_t t = 0;
+  ASSERT_TRUE(http::parseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT", t));
+  EXPECT_EQ(t, 784111777);
+  t = 0;
+  ASSERT_TRUE(http::parseHttpDate("Sunday, 06-Nov-94 08:49:37 GMT", t));
+  EXPECT_EQ(t, 784111777);
+  t = 0;
+  ASSERT_TRUE(http::parseHttpDate("Sun Nov  6 08:49:37 1994", t));
+  EXPECT_EQ(t, 784111777);
+}
+
+TEST(HttpUtilsTests, ParseHttpDateRejectsGarbage) {
+  time_t t = 0;
+  EXPECT_FALSE(http::parseHttpDate("", t));
+  EXPECT_FALSE(http::parseHttpDate("yesterday", t));
+  EXPECT_FALSE(http::parseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT junk", t));
+}
+
+TEST(HttpUtilsTests, MakeETagIsWeakAndHex) {
+  EXPECT_EQ(http::makeETag(0x1f, 4096, 0x5f5e100), "W/\"1f-1000-5f5e100\"");
+}
+
+TEST(HttpUtilsTests, EtagListMatchesUsesWeakComparison) {
+  std::string tag = "W/\"1f-1000-5\"";
+  EXPECT_TRUE(http::etagListMatches("*", tag));
+  EXPECT_TRUE(http::etagListMatches(tag, tag));
+  EXPECT_TRUE(http::etagListMatches("\"1f-1000-5\"", tag));
+  EXPECT_TRUE(http::etagListMatches("\"a\", W/\"1f-1000-5\" ,\"b\"", tag));
+  EXPECT_FALSE(http::etagListMatches("\"1f-1000-6\"", tag));
+  EXPECT_FALSE(http::etagListMatches("", tag));
+}
+
+TEST(HttpUtilsTests, AcceptsEncodingHonoursWeights) {
+  EXPECT_TRUE(http::acceptsEncoding("gzip, deflate, br", "br"));
+  EXPECT_TRUE(http::acceptsEncoding("GZIP;q=0.5", "gzip"));
+  EXPECT_TRUE(http::acceptsEncoding("x-gzip", "gzip"));
+  EXPECT_FALSE(http::acceptsEncoding("gzip;q=0", "gzip"));
+  EXPECT_FALSE(http::acceptsEncoding("br;q=0.000, gzip", "br"));
+  EXPECT_FALSE(http::acceptsEncoding("deflate", "gzip"));
+  EXPECT_FALSE(http::acceptsEncoding("", "gzip"));
+  EXPECT_FALSE(http::acceptsEncoding("identity", "br"));
+}
+
+TEST(HttpUtilsTests, AcceptsEncodingWildcardCoversUnlistedCodings) {
+  EXPECT_TRUE(http::acceptsEncoding("*", "br"));
+  EXPECT_FALSE(http::acceptsEncoding("*;q=0", "br"));
+  EXPECT_FALSE(http::acceptsEncoding("br;q=0, *", "br"));
+  EXPECT_TRUE(http::acceptsEncoding("gzip;q=0, *", "br"));
+}
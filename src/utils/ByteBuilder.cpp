@@ -0,0 +1,83 @@
+#include "ByteBuilder.hpp"
+
+#include <cstring>
+
+#include "constants.hpp"
+
+ByteBuilder::ByteBuilder(std::string& out) : out_(out) {}
+
+ByteBuilder::~ByteBuilder() {}
+
+ByteBuilder& ByteBuilder::append(const char* data, std::size_t len) {
+  out_.append(data, len);
+  return *this;
+}
+
+ByteBuilder& ByteBuilder::append(const char* cstr) {
+  out_.append(cstr, std::strlen(cstr));
+  return *this;
+}
+
+ByteBuilder& ByteBuilder::append(const std::string& s) {
+  out_.append(s);
+  return *this;
+}
+
+ByteBuilder& ByteBuilder::append(char c) {
+  out_.push_back(c);
+  return *this;
+}
+
+ByteBuilder& ByteBuilder::appendNumber(long long n) {
+  // 20 digits cover the full range of a 64-bit value, plus one for the sign
+  char buf[24];
+  char* end = buf + sizeof(buf);
+  char* p = end;
+  // Work on the unsigned magnitude so LLONG_MIN does not overflow
+  unsigned long long v = (n < 0) ? 0ULL - static_cast<unsigned long long>(n)
+                                 : static_cast<unsigned long long>(n);
+  do {
+    *--p = static_cast<char>('0' + (v % 10));
+    v /= 10;
+  } while (v != 0);
+  if (n < 0) {
+    *--p = '-';
+  }
+  out_.append(p, static_cast<std::size_t>(end - p));
+  return *this;
+}
+
+ByteBuilder& ByteBuilder::appendHex(unsigned long long n) {
+  static const char kDigits[] = "0123456789abcdef";
+  char buf[16];
+  char* end = buf + sizeof(buf);
+  char* p = end;
+  do {
+    *--p = kDigits[n & 0xf];
+    n >>= 4;
+  } while (n != 0);
+  out_.append(p, static_cast<std::size_t>(end - p));
+  return *this;
+}
+
+ByteBuilder& ByteBuilder::appendCrlf() {
+  out_.append(CRLF, 2);
+  return *this;
+}
+
+ByteBuilder& ByteBuilder::appendHeader(const std::string& name,
+                                       const std::string& value) {
+  out_.append(name);
+  out_.append(": ", 2);
+  out_.append(value);
+  out_.append(CRLF, 2);
+  return *this;
+}
+
+void ByteBuilder::reserve(std::size_t n) {
+  out_.reserve(out_.size() + n);
+}
+
+std::size_t ByteBuilder::size() const {
+  return out_.size();
+}
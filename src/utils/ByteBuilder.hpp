@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Append-only byte builder that writes into a caller-owned std::string
+// (typically Connection::write_buffer). Reusing the target keeps its capacity
+// across responses, and integers are formatted without iostreams.
+class ByteBuilder {
+ public:
+  explicit ByteBuilder(std::string& out);
+  ~ByteBuilder();
+
+  ByteBuilder& append(const char* data, std::size_t len);
+  ByteBuilder& append(const char* cstr);
+  ByteBuilder& append(const std::string& s);
+  ByteBuilder& append(char c);
+  ByteBuilder& appendNumber(long long n);
+  // Lowercase hexadecimal, no prefix
+  ByteBuilder& appendHex(unsigned long long n);
+  ByteBuilder& appendCrlf();
+  // Append a full header line: "<name>: <value>\r\n"
+  ByteBuilder& appendHeader(const std::string& name, const std::string& value);
+
+  void reserve(std::size_t n);
+  std::size_t size() const;
+
+ private:
+  ByteBuilder(const ByteBuilder& other);
+  ByteBuilder& operator=(const ByteBuilder& other);
+
+  std::string& out_;
+};
@@ -0,0 +1,47 @@
+#include "ByteBuilder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <climits>
+#include <string>
+
+TEST(ByteBuilderTests, AppendsIntoTargetString) {
+  std::string out = "pre:";
+  ByteBuilder b(out);
+  b.append("abc").append(' ').append(std::string("def")).append("xyz", 2);
+  EXPECT_EQ(out, "pre:abc defxy");
+  EXPECT_EQ(b.size(), out.size());
+}
+
+TEST(ByteBuilderTests, AppendNumberFormatsIntegers) {
+  std::string out;
+  ByteBuilder b(out);
+  b.appendNumber(0).append(',').appendNumber(42).append(',').appendNumber(-7);
+  EXPECT_EQ(out, "0,42,-7");
+}
+
+TEST(ByteBuilderTests, AppendNumberHandlesExtremes) {
+  std::string out;
+  ByteBuilder(out).appendNumber(LLONG_MAX);
+  EXPECT_EQ(out, "9223372036854775807");
+  out.clear();
+  ByteBuilder(out).appendNumber(LLONG_MIN);
+  EXPECT_EQ(out, "-9223372036854775808");
+}
+
+TEST(ByteBuilderTests, AppendHeaderAddsCrlf) {
+  std::string out;
+  ByteBuilder b(out);
+  b.appendHeader("Content-Length", "12").appendCrlf();
+  EXPECT_EQ(out, "Content-Length: 12\r\n\r\n");
+}
+
+TEST(ByteBuilderTests, AppendHexFormatsLowercase) {
+  std::string out;
+  ByteBuilder(out).appendHex(0).append(',').appendHex(255).append(',')
+      .appendHex(0x1a2b3c);
+  EXPECT_EQ(out, "0,ff,1a2b3c");
+  out.clear();
+  ByteBuilder(out).appendHex(ULLONG_MAX);
+  EXPECT_EQ(out, "ffffffffffffffff");
+}
@@ -0,0 +1,87 @@
+#include "GzipCache.hpp"
+
+#include "Logger.hpp"
+
+GzipCache::Zone::Zone() : used(0), lru() {}
+
+GzipCache::GzipCache() : entries_(), zones_() {}
+
+GzipCache::~GzipCache() {}
+
+const std::string* GzipCache::find(const std::string& path,
+                                   const std::string& coding, ino_t inode,
+                                   off_t size, time_t mtime) {
+  std::map<Key, Entry>::iterator it = entries_.find(Key(path, coding));
+  if (it == entries_.end()) {
+    return NULL;
+  }
+  Entry& e = it->second;
+  if (e.inode != inode || e.size != size || e.mtime != mtime) {
+    LOG(DEBUG) << "GzipCache: '" << path << "' changed, dropping " << coding;
+    drop_(it);
+    return NULL;
+  }
+  LruList& lru = zones_[e.zone].lru;
+  lru.splice(lru.begin(), lru, e.lru);
+  return &e.data;
+}
+
+const std::string* GzipCache::store(const std::string& path,
+                                    const std::string& coding, ino_t inode,
+                                    off_t size, time_t mtime,
+                                    const void* zone, std::size_t zone_max,
+                                    std::string& data) {
+  if (data.size() > zone_max) {
+    return NULL;
+  }
+  Key key(path, coding);
+  std::map<Key, Entry>::iterator old = entries_.find(key);
+  if (old != entries_.end()) {
+    drop_(old);
+  }
+  Zone& z = zones_[zone];
+  while (!z.lru.empty() && z.used + data.size() > zone_max) {
+    drop_(entries_.find(z.lru.back()));
+  }
+
+  Entry& e = entries_[key];
+  e.data.swap(data);
+  e.inode = inode;
+  e.size = size;
+  e.mtime = mtime;
+  e.zone = zone;
+  z.lru.push_front(key);
+  e.lru = z.lru.begin();
+  z.used += e.data.size();
+  LOG(DEBUG) << "GzipCache: stored '" << path << "' as " << coding << " ("
+             << e.data.size() << " bytes, zone now " << z.used << "/"
+             << zone_max << ")";
+  return &e.data;
+}
+
+void GzipCache::invalidate(const std::string& path) {
+  std::map<Key, Entry>::iterator it = entries_.lower_bound(Key(path, ""));
+  while (it != entries_.end() && it->first.first == path) {
+    std::map<Key, Entry>::iterator next = it;
+    ++next;
+    drop_(it);
+    it = next;
+  }
+}
+
+std::size_t GzipCache::size() const {
+  return entries_.size();
+}
+
+std::size_t GzipCache::bytes(const void* zone) const {
+  std::map<const void*, Zone>::const_iterator it = zones_.find(zone);
+  return it == zones_.end() ? 0 : it->second.used;
+}
+
+void GzipCache::drop_(std::map<Key, Entry>::iterator it) {
+  Entry& e = it->second;
+  Zone& z = zones_[e.zone];
+  z.used -= e.data.size();
+  z.lru.erase(e.lru);
+  entries_.erase(it);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <ctime>
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+
+// Compressed copies of static files ("gzip_cache_size" in a location), so a
+// file asked for with the same content coding again is not run through
+// deflate a second time.
+//
+// Entries are keyed by (path, coding) and remember the inode, size and
+// mtime of the file they were made from: a lookup with other values drops
+// the entry, so a file replaced on disk is compressed afresh. Memory is
+// budgeted per zone like StaticCache: each location passes its address and
+// its gzip_cache_size, and evicts only its own least recently used entries.
+class GzipCache {
+ public:
+  GzipCache();
+  ~GzipCache();
+
+  // Compressed `path` in `coding`, or NULL if there is none for the file
+  // with this inode, size and mtime
+  const std::string* find(const std::string& path, const std::string& coding,
+                          ino_t inode, off_t size, time_t mtime);
+
+  // Cache `data` as `path` compressed in `coding`, in the zone `zone`
+  // limited to `zone_max` bytes, taking its contents (data is left empty).
+  // Returns the cached copy, or NULL (leaving `data` alone) if it does not
+  // fit.
+  const std::string* store(const std::string& path, const std::string& coding,
+                           ino_t inode, off_t size, time_t mtime,
+                           const void* zone, std::size_t zone_max,
+                           std::string& data);
+
+  // Drop every coding of `path`, e.g. after it changed on disk
+  void invalidate(const std::string& path);
+
+  std::size_t size() const;
+  // Bytes of compressed data held in `zone`
+  std::size_t bytes(const void* zone) const;
+
+ private:
+  GzipCache(const GzipCache& other);
+  GzipCache& operator=(const GzipCache& other);
+
+  typedef std::pair<std::string, std::string> Key;  // path, coding
+  typedef std::list<Key> LruList;
+
+  struct Entry {
+    std::string data;
+    ino_t inode;
+    off_t size;
+    time_t mtime;
+    const void* zone;
+    LruList::iterator lru;
+  };
+  struct Zone {
+    Zone();
+
+    std::size_t used;
+    LruList lru;  // most recently used first
+  };
+
+  void drop_(std::map<Key, Entry>::iterator it);
+
+  std::map<Key, Entry> entries_;
+  std::map<const void*, Zone> zones_;
+};
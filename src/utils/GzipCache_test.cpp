@@ -0,0 +1,92 @@
+#include "GzipCache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+const int kZoneA = 0;
+const int kZoneB = 1;
+
+}  // namespace
+
+TEST(GzipCacheTests, StoreTakesTheDataAndFindReturnsIt) {
+  GzipCache cache;
+  std::string data = "compressed";
+  const std::string* stored =
+      cache.store("/www/a.css", "gzip", 7, 100, 1000, &kZoneA, 64, data);
+  ASSERT_TRUE(stored != NULL);
+  EXPECT_TRUE(data.empty());
+  EXPECT_EQ(*stored, "compressed");
+
+  const std::string* hit = cache.find("/www/a.css", "gzip", 7, 100, 1000);
+  ASSERT_TRUE(hit != NULL);
+  EXPECT_EQ(*hit, "compressed");
+  EXPECT_TRUE(cache.find("/www/a.css", "deflate", 7, 100, 1000) == NULL);
+  EXPECT_EQ(cache.bytes(&kZoneA), 10u);
+}
+
+TEST(GzipCacheTests, ChangedFileIsDropped) {
+  GzipCache cache;
+  std::string data = "v1";
+  ASSERT_TRUE(cache.store("/www/a", "gzip", 7, 100, 1000, &kZoneA, 64,
+                          data) != NULL);
+  EXPECT_TRUE(cache.find("/www/a", "gzip", 7, 100, 1001) == NULL);
+  EXPECT_EQ(cache.size(), 0u);
+  EXPECT_EQ(cache.bytes(&kZoneA), 0u);
+
+  data = "v2";
+  ASSERT_TRUE(cache.store("/www/a", "gzip", 7, 100, 1000, &kZoneA, 64,
+                          data) != NULL);
+  EXPECT_TRUE(cache.find("/www/a", "gzip", 8, 100, 1000) == NULL);
+  data = "v3";
+  ASSERT_TRUE(cache.store("/www/a", "gzip", 7, 100, 1000, &kZoneA, 64,
+                          data) != NULL);
+  EXPECT_TRUE(cache.find("/www/a", "gzip", 7, 101, 1000) == NULL);
+}
+
+TEST(GzipCacheTests, DataLargerThanTheZoneIsRefused) {
+  GzipCache cache;
+  std::string data = "0123456789";
+  EXPECT_TRUE(cache.store("/www/big", "gzip", 1, 1, 1, &kZoneA, 9, data) ==
+              NULL);
+  EXPECT_EQ(data, "0123456789");
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(GzipCacheTests, LeastRecentlyUsedOfTheSameZoneIsEvicted) {
+  GzipCache cache;
+  std::string data = "oooo";
+  ASSERT_TRUE(cache.store("/o", "gzip", 1, 1, 1, &kZoneB, 4, data) != NULL);
+  data = "aaaa";
+  ASSERT_TRUE(cache.store("/a", "gzip", 1, 1, 1, &kZoneA, 8, data) != NULL);
+  data = "bbbb";
+  ASSERT_TRUE(cache.store("/b", "gzip", 1, 1, 1, &kZoneA, 8, data) != NULL);
+  ASSERT_TRUE(cache.find("/a", "gzip", 1, 1, 1) != NULL);
+  data = "cccc";
+  ASSERT_TRUE(cache.store("/c", "gzip", 1, 1, 1, &kZoneA, 8, data) != NULL);
+
+  EXPECT_TRUE(cache.find("/a", "gzip", 1, 1, 1) != NULL);
+  EXPECT_TRUE(cache.find("/b", "gzip", 1, 1, 1) == NULL);
+  EXPECT_TRUE(cache.find("/c", "gzip", 1, 1, 1) != NULL);
+  EXPECT_TRUE(cache.find("/o", "gzip", 1, 1, 1) != NULL);
+  EXPECT_EQ(cache.bytes(&kZoneA), 8u);
+  EXPECT_EQ(cache.bytes(&kZoneB), 4u);
+}
+
+TEST(GzipCacheTests, InvalidateDropsEveryCoding) {
+  GzipCache cache;
+  std::string data = "g";
+  ASSERT_TRUE(cache.store("/a", "gzip", 1, 1, 1, &kZoneA, 64, data) != NULL);
+  data = "d";
+  ASSERT_TRUE(cache.store("/a", "deflate", 1, 1, 1, &kZoneA, 64, data) !=
+              NULL);
+  data = "other";
+  ASSERT_TRUE(cache.store("/a2", "gzip", 1, 1, 1, &kZoneA, 64, data) != NULL);
+  cache.invalidate("/a");
+  EXPECT_TRUE(cache.find("/a", "gzip", 1, 1, 1) == NULL);
+  EXPECT_TRUE(cache.find("/a", "deflate", 1, 1, 1) == NULL);
+  EXPECT_TRUE(cache.find("/a2", "gzip", 1, 1, 1) != NULL);
+  EXPECT_EQ(cache.bytes(&kZoneA), 5u);
+}
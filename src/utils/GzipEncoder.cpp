@@ -0,0 +1,112 @@
+#include "GzipEncoder.hpp"
+
+#ifdef WEBSERV_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "Logger.hpp"
+
+namespace {
+
+const std::size_t kDefaultBufferSize = 4096;
+
+}  // namespace
+
+GzipEncoder::GzipEncoder() : stream_(NULL), buffer_() {}
+
+GzipEncoder::~GzipEncoder() {
+  end_();
+}
+
+bool GzipEncoder::available() {
+#ifdef WEBSERV_HAVE_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool GzipEncoder::init(Format format, int level, std::size_t buffer_size) {
+  end_();
+#ifdef WEBSERV_HAVE_ZLIB
+  z_stream* zs = new z_stream();
+  // 15 = 32K window; +16 asks zlib for a gzip header and trailer
+  int window_bits = format == GZIP ? 15 + 16 : 15;
+  if (deflateInit2(zs, level, Z_DEFLATED, window_bits, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    LOG(ERROR) << "GzipEncoder: deflateInit2 failed at level " << level;
+    delete zs;
+    return false;
+  }
+  stream_ = zs;
+  buffer_.resize(buffer_size > 0 ? buffer_size : kDefaultBufferSize);
+  return true;
+#else
+  (void)format;
+  (void)level;
+  (void)buffer_size;
+  return false;
+#endif
+}
+
+bool GzipEncoder::update(const char* data, std::size_t len,
+                         std::string& out) {
+  return run_(data, len, false, out);
+}
+
+bool GzipEncoder::finish(std::string& out) {
+  bool ok = run_(NULL, 0, true, out);
+  end_();
+  return ok;
+}
+
+bool GzipEncoder::compress(const std::string& in, Format format, int level,
+                           std::size_t buffer_size, std::string& out) {
+  out.clear();
+  GzipEncoder encoder;
+  return encoder.init(format, level, buffer_size) &&
+         encoder.update(in.data(), in.size(), out) && encoder.finish(out);
+}
+
+bool GzipEncoder::run_(const char* data, std::size_t len, bool finish,
+                       std::string& out) {
+#ifdef WEBSERV_HAVE_ZLIB
+  z_stream* zs = static_cast<z_stream*>(stream_);
+  if (zs == NULL) {
+    return false;
+  }
+  zs->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  zs->avail_in = static_cast<uInt>(len);
+  while (true) {
+    zs->next_out = reinterpret_cast<Bytef*>(&buffer_[0]);
+    zs->avail_out = static_cast<uInt>(buffer_.size());
+    int r = deflate(zs, finish ? Z_FINISH : Z_NO_FLUSH);
+    if (r == Z_STREAM_ERROR) {
+      LOG(ERROR) << "GzipEncoder: deflate failed";
+      return false;
+    }
+    out.append(&buffer_[0], buffer_.size() - zs->avail_out);
+    if (finish ? r == Z_STREAM_END
+               : zs->avail_in == 0 && zs->avail_out != 0) {
+      return true;
+    }
+  }
+#else
+  (void)data;
+  (void)len;
+  (void)finish;
+  (void)out;
+  return false;
+#endif
+}
+
+void GzipEncoder::end_() {
+#ifdef WEBSERV_HAVE_ZLIB
+  z_stream* zs = static_cast<z_stream*>(stream_);
+  if (zs != NULL) {
+    deflateEnd(zs);
+    delete zs;
+  }
+#endif
+  stream_ = NULL;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Streaming deflate compressor for response bodies (the "gzip"
+// directives). Input is fed in pieces with update() and the stream is
+// closed with finish(); compressed output is produced buffer_size bytes at
+// a time and appended to the caller's string.
+//
+// zlib is a build option (WEBSERV_HAVE_ZLIB). Without it available() is
+// false and init() fails, so callers simply send bodies uncompressed.
+class GzipEncoder {
+ public:
+  // Container around the deflate stream: "gzip" or zlib ("deflate")
+  enum Format { GZIP, DEFLATE };
+
+  GzipEncoder();
+  ~GzipEncoder();
+
+  static bool available();
+
+  // Start a stream at compression `level` (1-9). Returns false if zlib is
+  // not built in or the stream cannot be set up.
+  bool init(Format format, int level, std::size_t buffer_size);
+  // Compress `len` bytes of `data`, appending any output to `out`
+  bool update(const char* data, std::size_t len, std::string& out);
+  // Flush the rest of the stream and its trailer into `out`
+  bool finish(std::string& out);
+
+  // Compress all of `in` into `out` (replacing its contents)
+  static bool compress(const std::string& in, Format format, int level,
+                       std::size_t buffer_size, std::string& out);
+
+ private:
+  GzipEncoder(const GzipEncoder& other);
+  GzipEncoder& operator=(const GzipEncoder& other);
+
+  bool run_(const char* data, std::size_t len, bool finish,
+            std::string& out);
+  void end_();
+
+  // z_stream, kept opaque so this header does not need zlib.h
+  void* stream_;
+  std::vector<char> buffer_;
+};
@@ -0,0 +1,108 @@
+#include "GzipEncoder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+
+#ifdef WEBSERV_HAVE_ZLIB
+#include <zlib.h>
+
+namespace {
+
+// Inflate `in` (gzip or zlib, detected from the header) into `out`
+bool inflateAll(const std::string& in, std::string& out) {
+  z_stream zs = z_stream();
+  if (inflateInit2(&zs, 15 + 32) != Z_OK) {
+    return false;
+  }
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+  zs.avail_in = static_cast<uInt>(in.size());
+  char buf[256];
+  int r = Z_OK;
+  while (r == Z_OK) {
+    zs.next_out = reinterpret_cast<Bytef*>(buf);
+    zs.avail_out = sizeof(buf);
+    r = inflate(&zs, Z_NO_FLUSH);
+    out.append(buf, sizeof(buf) - zs.avail_out);
+  }
+  inflateEnd(&zs);
+  return r == Z_STREAM_END;
+}
+
+std::string sampleText() {
+  std::string s;
+  for (int i = 0; i < 200; ++i) {
+    s += "<li><a href=\"file.txt\">file.txt</a></li>\r\n";
+  }
+  return s;
+}
+
+}  // namespace
+
+TEST(GzipEncoderTests, CompressRoundTripsAsGzip) {
+  std::string in = sampleText();
+  std::string out;
+  ASSERT_TRUE(GzipEncoder::compress(in, GzipEncoder::GZIP, 1, 4096, out));
+  ASSERT_GE(out.size(), 2u);
+  EXPECT_EQ(static_cast<unsigned char>(out[0]), 0x1f);
+  EXPECT_EQ(static_cast<unsigned char>(out[1]), 0x8b);
+  EXPECT_LT(out.size(), in.size());
+  std::string back;
+  ASSERT_TRUE(inflateAll(out, back));
+  EXPECT_EQ(back, in);
+}
+
+TEST(GzipEncoderTests, DeflateIsZlibWrapped) {
+  std::string in = sampleText();
+  std::string out;
+  ASSERT_TRUE(GzipEncoder::compress(in, GzipEncoder::DEFLATE, 9, 4096, out));
+  ASSERT_GE(out.size(), 2u);
+  // CMF/FLG header check bits: a multiple of 31
+  unsigned int header = (static_cast<unsigned char>(out[0]) << 8) |
+                        static_cast<unsigned char>(out[1]);
+  EXPECT_EQ(header % 31, 0u);
+  std::string back;
+  ASSERT_TRUE(inflateAll(out, back));
+  EXPECT_EQ(back, in);
+}
+
+TEST(GzipEncoderTests, StreamsPiecesThroughASmallBuffer) {
+  std::string in = sampleText();
+  GzipEncoder encoder;
+  ASSERT_TRUE(encoder.init(GzipEncoder::GZIP, 6, 16));
+  std::string out;
+  for (std::size_t i = 0; i < in.size(); i += 100) {
+    std::size_t n = std::min<std::size_t>(100, in.size() - i);
+    ASSERT_TRUE(encoder.update(in.data() + i, n, out));
+  }
+  ASSERT_TRUE(encoder.finish(out));
+  std::string back;
+  ASSERT_TRUE(inflateAll(out, back));
+  EXPECT_EQ(back, in);
+}
+
+TEST(GzipEncoderTests, EmptyInputIsAValidStream) {
+  std::string out;
+  ASSERT_TRUE(GzipEncoder::compress("", GzipEncoder::GZIP, 1, 4096, out));
+  std::string back;
+  ASSERT_TRUE(inflateAll(out, back));
+  EXPECT_TRUE(back.empty());
+}
+
+TEST(GzipEncoderTests, UpdateFailsWithoutInit) {
+  GzipEncoder encoder;
+  std::string out;
+  EXPECT_FALSE(encoder.update("abc", 3, out));
+  EXPECT_FALSE(encoder.finish(out));
+}
+
+#else
+
+TEST(GzipEncoderTests, UnavailableWithoutZlib) {
+  EXPECT_FALSE(GzipEncoder::available());
+  std::string out;
+  EXPECT_FALSE(GzipEncoder::compress("abc", GzipEncoder::GZIP, 1, 4096, out));
+}
+
+#endif
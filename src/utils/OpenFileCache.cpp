@@ -0,0 +1,255 @@
+#include "OpenFileCache.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "Logger.hpp"
+
+namespace {
+
+bool sameFile(const FileStat& a, const FileStat& b) {
+  return a.inode == b.inode && a.dev == b.dev && a.size == b.size &&
+         a.mtime == b.mtime && a.is_dir == b.is_dir && a.is_reg == b.is_reg;
+}
+
+// Failures that say the path does not exist, as opposed to transient or
+// permission errors that should be retried
+bool isMissing(int err) {
+  return err == ENOENT || err == ENOTDIR;
+}
+
+}  // namespace
+
+OpenFileCache::OpenFileCache()
+    : max_(0),
+      inactive_(0),
+      valid_(0),
+      cache_errors_(false),
+      entries_(),
+      lru_(),
+      lent_(),
+      retired_() {}
+
+OpenFileCache::OpenFileCache(std::size_t max_entries, time_t inactive,
+                             time_t valid, bool cache_errors)
+    : max_(max_entries),
+      inactive_(inactive),
+      valid_(valid),
+      cache_errors_(cache_errors),
+      entries_(),
+      lru_(),
+      lent_(),
+      retired_() {}
+
+OpenFileCache::OpenFileCache(const OpenFileCache& other)
+    : max_(other.max_),
+      inactive_(other.inactive_),
+      valid_(other.valid_),
+      cache_errors_(other.cache_errors_),
+      entries_(),
+      lru_(),
+      lent_(),
+      retired_() {}
+
+OpenFileCache& OpenFileCache::operator=(const OpenFileCache& other) {
+  if (this != &other) {
+    clear_();
+    max_ = other.max_;
+    inactive_ = other.inactive_;
+    valid_ = other.valid_;
+    cache_errors_ = other.cache_errors_;
+  }
+  return *this;
+}
+
+OpenFileCache::~OpenFileCache() {
+  clear_();
+}
+
+bool OpenFileCache::stat(const std::string& path, FileStat& out) {
+  if (!enabled()) {
+    return file_utils::statPath(path, out, NULL);
+  }
+  EntryMap::iterator it = lookup_(path, time(NULL));
+  if (it == entries_.end()) {
+    return false;
+  }
+  out = it->second.st;
+  return true;
+}
+
+bool OpenFileCache::open(const std::string& path, FileInfo& out) {
+  if (!enabled()) {
+    return file_utils::openFile(path, out);
+  }
+  out = FileInfo();
+  EntryMap::iterator it = lookup_(path, time(NULL));
+  if (it == entries_.end()) {
+    return false;
+  }
+  Entry& e = it->second;
+  if (!e.st.is_reg) {
+    errno = EISDIR;
+    return false;
+  }
+
+  if (e.fd < 0) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) < 0) {
+      close(fd);
+      fd = -1;
+    }
+    if (fd < 0) {
+      LOG_PERROR(DEBUG, "OpenFileCache: open failed for '" << path << "'");
+      drop_(it);
+      return false;
+    }
+    // Trust what was opened, in case the file changed since the stat()
+    e.fd = fd;
+    e.st = file_utils::toFileStat(st);
+    e.content_type = file_utils::guessMime(path);
+    LOG(DEBUG) << "OpenFileCache: opened '" << path << "' fd=" << fd;
+  }
+
+  ++lent_[e.fd];
+  out.fd = e.fd;
+  out.size = e.st.size;
+  out.mtime = e.st.mtime;
+  out.inode = e.st.inode;
+  out.content_type = e.content_type;
+  out.cache = this;
+  return true;
+}
+
+void OpenFileCache::release(int fd) {
+  std::map<int, int>::iterator it = lent_.find(fd);
+  if (it == lent_.end()) {
+    LOG(ERROR) << "OpenFileCache: fd " << fd << " was not lent";
+    return;
+  }
+  if (--it->second > 0) {
+    return;
+  }
+  lent_.erase(it);
+  if (retired_.erase(fd) > 0) {
+    close(fd);
+  }
+}
+
+void OpenFileCache::invalidate(const std::string& path) {
+  EntryMap::iterator it = entries_.find(path);
+  if (it != entries_.end()) {
+    LOG(DEBUG) << "OpenFileCache: invalidated '" << path << "'";
+    drop_(it);
+  }
+}
+
+bool OpenFileCache::enabled() const {
+  return max_ > 0;
+}
+
+std::size_t OpenFileCache::size() const {
+  return entries_.size();
+}
+
+std::size_t OpenFileCache::lent() const {
+  return lent_.size();
+}
+
+// Valid entry for `path`, (re)validated and moved to the front of the LRU
+// list, or entries_.end() with errno set if `path` cannot be stat'ed (a
+// cached "does not exist" entry is touched the same way first)
+OpenFileCache::EntryMap::iterator OpenFileCache::lookup_(
+    const std::string& path, time_t now) {
+  expire_(now);
+
+  FileStat current;
+  int error = 0;
+  bool checked = false;
+  EntryMap::iterator it = entries_.find(path);
+  if (it != entries_.end() && now - it->second.validated >= valid_) {
+    checked = true;
+    if (!file_utils::statPath(path, current, NULL)) {
+      error = errno;
+    }
+    if (error == it->second.error &&
+        (error != 0 || sameFile(current, it->second.st))) {
+      it->second.validated = now;
+    } else {
+      LOG(DEBUG) << "OpenFileCache: '" << path << "' changed, reloading";
+      drop_(it);
+      it = entries_.end();
+    }
+  }
+
+  if (it == entries_.end()) {
+    if (!checked && !file_utils::statPath(path, current, NULL)) {
+      error = errno;
+    }
+    if (error != 0 && !(cache_errors_ && isMissing(error))) {
+      errno = error;
+      return entries_.end();
+    }
+    if (entries_.size() >= max_) {
+      drop_(lru_.back());
+    }
+    it = entries_.insert(std::make_pair(path, Entry())).first;
+    Entry& e = it->second;
+    e.st = current;
+    e.error = error;
+    e.fd = -1;
+    e.validated = now;
+    lru_.push_front(it);
+    e.lru = lru_.begin();
+  } else {
+    lru_.splice(lru_.begin(), lru_, it->second.lru);
+  }
+  it->second.used = now;
+  if (it->second.error != 0) {
+    errno = it->second.error;
+    return entries_.end();
+  }
+  return it;
+}
+
+void OpenFileCache::drop_(EntryMap::iterator it) {
+  if (it->second.fd >= 0) {
+    closeOrRetire_(it->second.fd);
+  }
+  lru_.erase(it->second.lru);
+  entries_.erase(it);
+}
+
+void OpenFileCache::closeOrRetire_(int fd) {
+  if (lent_.find(fd) != lent_.end()) {
+    retired_.insert(fd);
+  } else {
+    close(fd);
+  }
+}
+
+void OpenFileCache::expire_(time_t now) {
+  while (!lru_.empty() && now - lru_.back()->second.used >= inactive_) {
+    drop_(lru_.back());
+  }
+}
+
+void OpenFileCache::clear_() {
+  for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->second.fd >= 0) {
+      close(it->second.fd);
+    }
+  }
+  for (std::set<int>::iterator it = retired_.begin(); it != retired_.end();
+       ++it) {
+    close(*it);
+  }
+  entries_.clear();
+  lru_.clear();
+  lent_.clear();
+  retired_.clear();
+}
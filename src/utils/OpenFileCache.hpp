@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <ctime>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+#include "file_utils.hpp"
+
+// Bounded LRU cache of stat() results and open read-only fds, keyed by the
+// resolved filesystem path ("open_file_cache max=<n> inactive=<time>").
+// With `cache_errors` ("open_file_cache_errors on") paths that do not exist
+// are cached too, so repeated requests for missing files and missing index
+// candidates stop reaching the filesystem.
+//
+// Static requests stat the path, stat each index candidate and then open
+// and fstat the file; with the cache a hot file costs none of these. An
+// entry is trusted for `valid` seconds, after which a single stat() checks
+// that the path still names the same file (inode, device, size, mtime)
+// before it is used again. Entries unused for `inactive` seconds are
+// dropped, and the least recently used one makes room when the cache is
+// full.
+//
+// Open fds are lent, not handed over: several responses may stream from
+// the same fd at once (sendfile() is given explicit offsets), and a lent fd
+// dropped from the cache is only closed once the last borrower returns it
+// with release(). A cache with no capacity passes everything through to
+// the filesystem.
+class OpenFileCache {
+ public:
+  OpenFileCache();
+  OpenFileCache(std::size_t max_entries, time_t inactive, time_t valid,
+                bool cache_errors = false);
+  // Copies get the settings but none of the entries; fds are not shared
+  OpenFileCache(const OpenFileCache& other);
+  OpenFileCache& operator=(const OpenFileCache& other);
+  // Closes every fd, including lent ones
+  ~OpenFileCache();
+
+  // stat() `path`. Returns false with errno set if it cannot be stat'ed;
+  // only "does not exist" failures (ENOENT, ENOTDIR) are cached, and only
+  // with cache_errors.
+  bool stat(const std::string& path, FileStat& out);
+
+  // Open the regular file `path` for reading and lend its fd in `out`
+  // (out.cache points here, so file_utils::closeFile() gives it back).
+  // Returns false if it cannot be opened or is not a regular file.
+  bool open(const std::string& path, FileInfo& out);
+
+  // Give back an fd lent by open()
+  void release(int fd);
+
+  // Forget `path`, e.g. after the server wrote or deleted it
+  void invalidate(const std::string& path);
+
+  bool enabled() const;
+  std::size_t size() const;
+  // Number of fds currently lent out
+  std::size_t lent() const;
+
+ private:
+  struct Entry;
+  typedef std::map<std::string, Entry> EntryMap;
+  typedef std::list<EntryMap::iterator> LruList;
+
+  struct Entry {
+    FileStat st;
+    int error;  // errno of a cached failed lookup, 0 if the path exists
+    int fd;     // -1 until the file is opened
+    std::string content_type;
+    time_t validated;  // when st was last checked against the filesystem
+    time_t used;
+    LruList::iterator lru;
+  };
+
+  EntryMap::iterator lookup_(const std::string& path, time_t now);
+  void drop_(EntryMap::iterator it);
+  void closeOrRetire_(int fd);
+  void expire_(time_t now);
+  void clear_();
+
+  std::size_t max_;
+  time_t inactive_;
+  time_t valid_;
+  bool cache_errors_;
+  EntryMap entries_;
+  LruList lru_;                // most recently used first
+  std::map<int, int> lent_;    // fd -> number of borrowers
+  std::set<int> retired_;      // lent fds no longer in entries_
+};
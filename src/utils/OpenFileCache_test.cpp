@@ -0,0 +1,262 @@
+#include "OpenFileCache.hpp"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+// Scratch directory removed with everything in it at the end of a test
+class TempDir {
+ public:
+  TempDir() {
+    char tmpl[] = "/tmp/webserv_ofc_XXXXXX";
+    path_ = mkdtemp(tmpl) != NULL ? tmpl : "";
+  }
+  ~TempDir() {
+    std::string cmd = "rm -rf '" + path_ + "'";
+    if (!path_.empty() && std::system(cmd.c_str()) != 0) {
+      std::perror("rm");
+    }
+  }
+  std::string file(const std::string& name, const std::string& content) {
+    std::string p = path_ + "/" + name;
+    int fd = ::open(p.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+      ssize_t n = write(fd, content.data(), content.size());
+      (void)n;
+      close(fd);
+    }
+    return p;
+  }
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+bool isOpen(int fd) {
+  return fcntl(fd, F_GETFD) != -1;
+}
+
+// Files must not leak into CGI processes
+bool isCloseOnExec(int fd) {
+  int flags = fcntl(fd, F_GETFD);
+  return flags != -1 && (flags & FD_CLOEXEC) != 0;
+}
+
+}  // namespace
+
+TEST(OpenFileCacheTests, DisabledCachePassesThrough) {
+  TempDir dir;
+  std::string p = dir.file("a.txt", "hello");
+  OpenFileCache cache;
+  EXPECT_FALSE(cache.enabled());
+
+  FileInfo fi;
+  ASSERT_TRUE(cache.open(p, fi));
+  EXPECT_EQ(fi.size, 5);
+  EXPECT_TRUE(fi.cache == NULL);
+  EXPECT_TRUE(isCloseOnExec(fi.fd));
+  EXPECT_EQ(cache.size(), 0u);
+  file_utils::closeFile(fi);
+
+  FileStat st;
+  ASSERT_TRUE(cache.stat(dir.path(), st));
+  EXPECT_TRUE(st.is_dir);
+}
+
+TEST(OpenFileCacheTests, RepeatedOpensShareOneFd) {
+  TempDir dir;
+  std::string p = dir.file("style.css", "body{}");
+  OpenFileCache cache(10, 60, 60);
+
+  FileInfo a;
+  FileInfo b;
+  ASSERT_TRUE(cache.open(p, a));
+  ASSERT_TRUE(cache.open(p, b));
+  EXPECT_EQ(a.fd, b.fd);
+  EXPECT_TRUE(isCloseOnExec(a.fd));
+  EXPECT_EQ(a.size, 6);
+  EXPECT_EQ(a.content_type, "text/css");
+  EXPECT_TRUE(a.cache == &cache);
+  EXPECT_EQ(cache.lent(), 1u);
+
+  int fd = a.fd;
+  file_utils::closeFile(a);
+  file_utils::closeFile(b);
+  EXPECT_EQ(cache.lent(), 0u);
+  // Still cached and open for the next request
+  EXPECT_TRUE(isOpen(fd));
+  FileInfo c;
+  ASSERT_TRUE(cache.open(p, c));
+  EXPECT_EQ(c.fd, fd);
+  file_utils::closeFile(c);
+}
+
+TEST(OpenFileCacheTests, StatIsCachedAndDirectoriesCannotBeOpened) {
+  TempDir dir;
+  OpenFileCache cache(10, 60, 60);
+  FileStat st;
+  ASSERT_TRUE(cache.stat(dir.path(), st));
+  EXPECT_TRUE(st.is_dir);
+  EXPECT_EQ(cache.size(), 1u);
+
+  FileInfo fi;
+  EXPECT_FALSE(cache.open(dir.path(), fi));
+  EXPECT_EQ(fi.fd, -1);
+}
+
+TEST(OpenFileCacheTests, MissingPathsAreNotCached) {
+  TempDir dir;
+  OpenFileCache cache(10, 60, 60);
+  FileStat st;
+  errno = 0;
+  EXPECT_FALSE(cache.stat(dir.path() + "/missing", st));
+  EXPECT_EQ(errno, ENOENT);
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(OpenFileCacheTests, MissingPathsAreCachedWithErrors) {
+  TempDir dir;
+  std::string p = dir.path() + "/later.html";
+  OpenFileCache cache(10, 60, 60, true);
+  FileStat st;
+  EXPECT_FALSE(cache.stat(p, st));
+  EXPECT_EQ(cache.size(), 1u);
+
+  // Still missing as far as the cache knows until the entry is rechecked
+  dir.file("later.html", "now here");
+  errno = 0;
+  EXPECT_FALSE(cache.stat(p, st));
+  EXPECT_EQ(errno, ENOENT);
+  FileInfo fi;
+  EXPECT_FALSE(cache.open(p, fi));
+
+  // The server's own writes invalidate the path
+  cache.invalidate(p);
+  ASSERT_TRUE(cache.stat(p, st));
+  EXPECT_TRUE(st.is_reg);
+}
+
+TEST(OpenFileCacheTests, CachedMissingPathIsRecheckedAfterValidity) {
+  TempDir dir;
+  std::string p = dir.path() + "/index.html";
+  std::string under_file = dir.file("plain", "x") + "/index.html";
+  OpenFileCache cache(10, 60, 0, true);
+  FileStat st;
+  EXPECT_FALSE(cache.stat(p, st));
+  EXPECT_FALSE(cache.stat(under_file, st));
+  EXPECT_EQ(errno, ENOTDIR);
+  EXPECT_EQ(cache.size(), 2u);
+
+  dir.file("index.html", "hi");
+  ASSERT_TRUE(cache.stat(p, st));
+  EXPECT_EQ(st.size, 2);
+}
+
+TEST(OpenFileCacheTests, ChangedFileIsReopenedAfterValidity) {
+  TempDir dir;
+  std::string p = dir.file("index.html", "v1");
+  // valid = 0: every use checks the path again
+  OpenFileCache cache(10, 60, 0);
+
+  FileInfo old_fi;
+  ASSERT_TRUE(cache.open(p, old_fi));
+  EXPECT_EQ(old_fi.size, 2);
+
+  // Replace the file the way uploads do (a new inode)
+  std::string tmp = dir.file("index.html.new", "version 2");
+  ASSERT_EQ(rename(tmp.c_str(), p.c_str()), 0);
+
+  FileInfo new_fi;
+  ASSERT_TRUE(cache.open(p, new_fi));
+  EXPECT_EQ(new_fi.size, 9);
+  EXPECT_NE(new_fi.fd, old_fi.fd);
+
+  // The old fd is still lent: it stays open until given back
+  int old_fd = old_fi.fd;
+  EXPECT_TRUE(isOpen(old_fd));
+  file_utils::closeFile(old_fi);
+  EXPECT_FALSE(isOpen(old_fd));
+  file_utils::closeFile(new_fi);
+}
+
+TEST(OpenFileCacheTests, DeletedFileIsDroppedAfterValidity) {
+  TempDir dir;
+  std::string p = dir.file("gone.txt", "x");
+  OpenFileCache cache(10, 60, 0);
+  FileStat st;
+  ASSERT_TRUE(cache.stat(p, st));
+  ASSERT_EQ(unlink(p.c_str()), 0);
+  EXPECT_FALSE(cache.stat(p, st));
+  EXPECT_EQ(errno, ENOENT);
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(OpenFileCacheTests, LeastRecentlyUsedIsEvicted) {
+  TempDir dir;
+  std::string a = dir.file("a", "a");
+  std::string b = dir.file("b", "b");
+  std::string c = dir.file("c", "c");
+  OpenFileCache cache(2, 60, 60);
+
+  FileInfo fa;
+  ASSERT_TRUE(cache.open(a, fa));
+  int fd_a = fa.fd;
+  file_utils::closeFile(fa);
+  FileStat st;
+  ASSERT_TRUE(cache.stat(b, st));
+  ASSERT_TRUE(cache.stat(a, st));  // a is now the most recent
+  ASSERT_TRUE(cache.stat(c, st));  // evicts b
+  EXPECT_EQ(cache.size(), 2u);
+  EXPECT_TRUE(isOpen(fd_a));
+
+  ASSERT_TRUE(cache.stat(b, st));  // evicts a and closes its fd
+  EXPECT_FALSE(isOpen(fd_a));
+}
+
+TEST(OpenFileCacheTests, InactiveEntriesExpire) {
+  TempDir dir;
+  std::string a = dir.file("a", "a");
+  std::string b = dir.file("b", "b");
+  // inactive = 0: anything not used in the current second is dropped
+  OpenFileCache cache(10, 0, 60);
+  FileStat st;
+  ASSERT_TRUE(cache.stat(a, st));
+  ASSERT_TRUE(cache.stat(b, st));
+  EXPECT_EQ(cache.size(), 1u);
+}
+
+TEST(OpenFileCacheTests, InvalidateDropsEntry) {
+  TempDir dir;
+  std::string p = dir.file("upload.bin", "1234");
+  OpenFileCache cache(10, 60, 60);
+  FileInfo fi;
+  ASSERT_TRUE(cache.open(p, fi));
+  int fd = fi.fd;
+  cache.invalidate(p);
+  EXPECT_EQ(cache.size(), 0u);
+  EXPECT_TRUE(isOpen(fd));
+  file_utils::closeFile(fi);
+  EXPECT_FALSE(isOpen(fd));
+}
+
+TEST(OpenFileCacheTests, CopiesStartEmpty) {
+  TempDir dir;
+  std::string p = dir.file("a", "a");
+  OpenFileCache cache(10, 60, 60);
+  FileStat st;
+  ASSERT_TRUE(cache.stat(p, st));
+  OpenFileCache copy(cache);
+  EXPECT_TRUE(copy.enabled());
+  EXPECT_EQ(copy.size(), 0u);
+  copy = cache;
+  EXPECT_EQ(copy.size(), 0u);
+}
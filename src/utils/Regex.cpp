@@ -0,0 +1,69 @@
+#include "Regex.hpp"
+
+Regex::Regex() : compiled_(NULL), pattern_() {}
+
+Regex::Regex(const Regex& other)
+    : compiled_(other.compiled_), pattern_(other.pattern_) {
+  if (compiled_ != NULL) {
+    ++compiled_->refs;
+  }
+}
+
+Regex& Regex::operator=(const Regex& other) {
+  if (this != &other) {
+    if (other.compiled_ != NULL) {
+      ++other.compiled_->refs;
+    }
+    release_();
+    compiled_ = other.compiled_;
+    pattern_ = other.pattern_;
+  }
+  return *this;
+}
+
+Regex::~Regex() {
+  release_();
+}
+
+bool Regex::compile(const std::string& pattern, bool icase,
+                    std::string& error) {
+  release_();
+  pattern_.clear();
+  Compiled* c = new Compiled;
+  int flags = REG_EXTENDED | REG_NOSUB | (icase ? REG_ICASE : 0);
+  int rc = regcomp(&c->re, pattern.c_str(), flags);
+  if (rc != 0) {
+    char buf[256];
+    regerror(rc, &c->re, buf, sizeof(buf));
+    error = buf;
+    delete c;
+    return false;
+  }
+  c->refs = 1;
+  compiled_ = c;
+  pattern_ = pattern;
+  return true;
+}
+
+bool Regex::matches(const std::string& subject) const {
+  if (compiled_ == NULL) {
+    return false;
+  }
+  return regexec(&compiled_->re, subject.c_str(), 0, NULL, 0) == 0;
+}
+
+bool Regex::empty() const {
+  return compiled_ == NULL;
+}
+
+const std::string& Regex::pattern() const {
+  return pattern_;
+}
+
+void Regex::release_() {
+  if (compiled_ != NULL && --compiled_->refs == 0) {
+    regfree(&compiled_->re);
+    delete compiled_;
+  }
+  compiled_ = NULL;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <regex.h>
+
+#include <string>
+
+// POSIX extended regular expression compiled once and shared by copies.
+//
+// regex_t cannot be copied, and configuration objects holding a pattern are
+// copied freely while servers are built, so copies share one compiled
+// expression through a reference count instead of compiling it again.
+class Regex {
+ public:
+  Regex();
+  Regex(const Regex& other);
+  Regex& operator=(const Regex& other);
+  ~Regex();
+
+  // Compile `pattern`, replacing any previous one. On failure returns false,
+  // stores regerror()'s message in `error` and leaves the object empty.
+  bool compile(const std::string& pattern, bool icase, std::string& error);
+  // True if the expression matches anywhere in `subject`; always false
+  // while empty.
+  bool matches(const std::string& subject) const;
+
+  bool empty() const;
+  const std::string& pattern() const;
+
+ private:
+  struct Compiled {
+    regex_t re;
+    int refs;
+  };
+
+  void release_();
+
+  Compiled* compiled_;
+  std::string pattern_;
+};
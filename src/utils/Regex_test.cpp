@@ -0,0 +1,50 @@
+#include "Regex.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(RegexTests, MatchesAnywhereInSubject) {
+  Regex re;
+  std::string error;
+  ASSERT_TRUE(re.compile("\\.php$", false, error));
+  EXPECT_TRUE(re.matches("/index.php"));
+  EXPECT_TRUE(re.matches("/a/b.php"));
+  EXPECT_FALSE(re.matches("/index.php.txt"));
+  EXPECT_FALSE(re.matches("/index.PHP"));
+  EXPECT_EQ(re.pattern(), "\\.php$");
+}
+
+TEST(RegexTests, CaseInsensitiveFlag) {
+  Regex re;
+  std::string error;
+  ASSERT_TRUE(re.compile("\\.(jpe?g|png)$", true, error));
+  EXPECT_TRUE(re.matches("/img/A.JPG"));
+  EXPECT_TRUE(re.matches("/img/b.png"));
+  EXPECT_FALSE(re.matches("/img/c.gif"));
+}
+
+TEST(RegexTests, InvalidPatternReportsError) {
+  Regex re;
+  std::string error;
+  EXPECT_FALSE(re.compile("(unclosed", false, error));
+  EXPECT_FALSE(error.empty());
+  EXPECT_TRUE(re.empty());
+  EXPECT_FALSE(re.matches("(unclosed"));
+}
+
+TEST(RegexTests, CopiesShareTheCompiledExpression) {
+  std::string error;
+  Regex copy;
+  {
+    Regex re;
+    ASSERT_TRUE(re.compile("^/api/", false, error));
+    copy = re;
+    Regex second(re);
+    EXPECT_TRUE(second.matches("/api/x"));
+  }
+  // Still usable after the original and another copy are gone
+  EXPECT_FALSE(copy.empty());
+  EXPECT_TRUE(copy.matches("/api/users"));
+  EXPECT_FALSE(copy.matches("/static/api/"));
+}
@@ -0,0 +1,257 @@
+#include "StaticCache.hpp"
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "Logger.hpp"
+
+namespace {
+
+// Changes to a directory entry that make a cached copy stale
+const uint32_t kWatchMask = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+                            IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                            IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+                            IN_ONLYDIR;
+
+}  // namespace
+
+StaticCache::File::File() : data(), content_type(), mtime(0), inode(0) {}
+
+StaticCache::Zone::Zone() : used(0), lru() {}
+
+StaticCache::StaticCache()
+    : fd_(-1), entries_(), zones_(), watches_(), dir_wds_() {}
+
+StaticCache::~StaticCache() {
+  clear_();
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool StaticCache::init() {
+  if (fd_ >= 0) {
+    return true;
+  }
+  fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd_ < 0) {
+    LOG_PERROR(INFO, "StaticCache: inotify_init1 failed, cache disabled");
+    return false;
+  }
+  return true;
+}
+
+int StaticCache::fd() const {
+  return fd_;
+}
+
+bool StaticCache::enabled() const {
+  return fd_ >= 0;
+}
+
+const StaticCache::File* StaticCache::find(const std::string& path) {
+  std::map<std::string, Entry>::iterator it = entries_.find(path);
+  if (it == entries_.end()) {
+    return NULL;
+  }
+  LruList& lru = zones_[it->second.zone].lru;
+  lru.splice(lru.begin(), lru, it->second.lru);
+  return &it->second.file;
+}
+
+const StaticCache::File* StaticCache::store(const std::string& path,
+                                            const void* zone,
+                                            std::size_t zone_max, File& file) {
+  if (!enabled() || file.data.size() > zone_max) {
+    return NULL;
+  }
+  invalidate(path);
+
+  std::string::size_type slash = path.rfind('/');
+  if (slash == std::string::npos || slash == 0) {
+    return NULL;  // resolved paths always name a file under a root
+  }
+  std::string dir = path.substr(0, slash);
+  // Make room first: evicting may remove the watch on `dir` itself
+  Zone& z = zones_[zone];
+  while (!z.lru.empty() && z.used + file.data.size() > zone_max) {
+    drop_(entries_.find(z.lru.back()));
+  }
+  int wd = watch_(dir);
+  if (wd < 0) {
+    return NULL;
+  }
+  // Changes from now on are reported by the watch, but `file` was read
+  // before: from a file changed meanwhile, or through an fd the open file
+  // cache kept after the name was replaced. Keep it only if it still
+  // matches what the name refers to.
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0 || st.st_ino != file.inode ||
+      st.st_mtime != file.mtime ||
+      static_cast<std::size_t>(st.st_size) != file.data.size()) {
+    LOG(DEBUG) << "StaticCache: '" << path << "' changed, not stored";
+    if (watches_[wd].entries == 0) {
+      inotify_rm_watch(fd_, wd);
+      dir_wds_.erase(dir);
+      watches_.erase(wd);
+    }
+    return NULL;
+  }
+
+  Entry& e = entries_[path];
+  e.file.data.swap(file.data);
+  e.file.content_type = file.content_type;
+  e.file.mtime = file.mtime;
+  e.file.inode = file.inode;
+  e.zone = zone;
+  e.wd = wd;
+  z.lru.push_front(path);
+  e.lru = z.lru.begin();
+  z.used += e.file.data.size();
+  ++watches_[wd].entries;
+  LOG(DEBUG) << "StaticCache: stored '" << path << "' ("
+             << e.file.data.size() << " bytes, zone now " << z.used << "/"
+             << zone_max << ")";
+  return &e.file;
+}
+
+void StaticCache::invalidate(const std::string& path) {
+  std::map<std::string, Entry>::iterator it = entries_.find(path);
+  if (it != entries_.end()) {
+    LOG(DEBUG) << "StaticCache: invalidated '" << path << "'";
+    drop_(it);
+  }
+}
+
+std::vector<std::string> StaticCache::handleEvents() {
+  std::vector<std::string> dropped;
+  if (fd_ < 0) {
+    return dropped;
+  }
+  // Aligned for struct inotify_event
+  long buf[1024];
+  while (true) {
+    ssize_t n = read(fd_, buf, sizeof(buf));
+    if (n <= 0) {
+      if (n < 0 && errno != EAGAIN && errno != EINTR) {
+        LOG_PERROR(ERROR, "StaticCache: read from inotify fd");
+      }
+      return dropped;
+    }
+    const char* p = reinterpret_cast<const char*>(buf);
+    const char* end = p + n;
+    while (p < end) {
+      const struct inotify_event* ev =
+          reinterpret_cast<const struct inotify_event*>(p);
+      p += sizeof(struct inotify_event) + ev->len;
+
+      if (ev->mask & IN_Q_OVERFLOW) {
+        LOG(INFO) << "StaticCache: inotify queue overflow, dropping all";
+        for (std::map<std::string, Entry>::iterator it = entries_.begin();
+             it != entries_.end(); ++it) {
+          dropped.push_back(it->first);
+        }
+        clear_();
+        continue;
+      }
+      if (ev->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+        dropDir_(ev->wd, dropped);
+        continue;
+      }
+      std::map<int, Watch>::iterator w = watches_.find(ev->wd);
+      if (w == watches_.end() || ev->len == 0) {
+        continue;
+      }
+      std::map<std::string, Entry>::iterator it =
+          entries_.find(w->second.dir + "/" + ev->name);
+      if (it != entries_.end()) {
+        LOG(DEBUG) << "StaticCache: '" << it->first << "' changed on disk";
+        dropped.push_back(it->first);
+        drop_(it);
+      }
+    }
+  }
+}
+
+std::size_t StaticCache::size() const {
+  return entries_.size();
+}
+
+std::size_t StaticCache::bytes(const void* zone) const {
+  std::map<const void*, Zone>::const_iterator it = zones_.find(zone);
+  return it == zones_.end() ? 0 : it->second.used;
+}
+
+// Watch descriptor for `dir`, adding the watch if needed; -1 on failure
+int StaticCache::watch_(const std::string& dir) {
+  std::map<std::string, int>::iterator it = dir_wds_.find(dir);
+  if (it != dir_wds_.end()) {
+    return it->second;
+  }
+  int wd = inotify_add_watch(fd_, dir.c_str(), kWatchMask);
+  if (wd < 0) {
+    LOG_PERROR(DEBUG, "StaticCache: cannot watch '" << dir << "'");
+    return -1;
+  }
+  if (watches_.find(wd) != watches_.end()) {
+    // The same directory under another name ("www" and "./www"): event
+    // names could not be mapped back to both, so do not cache here
+    LOG(DEBUG) << "StaticCache: '" << dir << "' is already watched as '"
+               << watches_[wd].dir << "'";
+    return -1;
+  }
+  Watch& w = watches_[wd];
+  w.dir = dir;
+  w.entries = 0;
+  dir_wds_[dir] = wd;
+  return wd;
+}
+
+void StaticCache::drop_(std::map<std::string, Entry>::iterator it) {
+  Entry& e = it->second;
+  Zone& z = zones_[e.zone];
+  z.used -= e.file.data.size();
+  z.lru.erase(e.lru);
+
+  std::map<int, Watch>::iterator w = watches_.find(e.wd);
+  if (w != watches_.end() && --w->second.entries == 0) {
+    inotify_rm_watch(fd_, w->first);
+    dir_wds_.erase(w->second.dir);
+    watches_.erase(w);
+  }
+  entries_.erase(it);
+}
+
+// Drop every entry under the watch `wd`, whose directory went away
+void StaticCache::dropDir_(int wd, std::vector<std::string>& dropped) {
+  std::map<int, Watch>::iterator w = watches_.find(wd);
+  if (w == watches_.end()) {
+    return;
+  }
+  std::string prefix = w->second.dir + "/";
+  std::map<std::string, Entry>::iterator it = entries_.lower_bound(prefix);
+  while (it != entries_.end() && it->first.compare(0, prefix.size(),
+                                                   prefix) == 0) {
+    std::map<std::string, Entry>::iterator next = it;
+    ++next;
+    if (it->second.wd == wd) {
+      dropped.push_back(it->first);
+      drop_(it);
+    }
+    it = next;
+  }
+}
+
+void StaticCache::clear_() {
+  for (std::map<int, Watch>::iterator it = watches_.begin();
+       it != watches_.end(); ++it) {
+    inotify_rm_watch(fd_, it->first);
+  }
+  entries_.clear();
+  zones_.clear();
+  watches_.clear();
+  dir_wds_.clear();
+}
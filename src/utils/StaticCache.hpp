@@ -0,0 +1,101 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <ctime>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+// In-memory copies of small, hot static files ("cache_max_size" and
+// "max_file_size" in a location), so a hit is answered from memory with a
+// single write of headers and body instead of open/fstat/sendfile/close.
+//
+// Memory is budgeted per zone: each location passes an opaque key (its
+// address) and its cache_max_size, and files of one location only ever
+// evict the least recently used files of the same location.
+//
+// Entries are invalidated through inotify: the directory of every cached
+// file is watched, and any change to a name in it (write, truncate,
+// rename, delete, attribute change) drops the matching entry once
+// handleEvents() drains the notification fd. Without inotify the cache
+// stays disabled rather than serving stale content.
+class StaticCache {
+ public:
+  struct File {
+    File();
+
+    std::string data;
+    std::string content_type;
+    time_t mtime;
+    ino_t inode;
+  };
+
+  StaticCache();
+  ~StaticCache();
+
+  // Create the inotify instance. Returns false (and leaves the cache
+  // disabled) if that fails.
+  bool init();
+  // Notification fd to poll for EPOLLIN, -1 when disabled
+  int fd() const;
+  bool enabled() const;
+
+  // Cached copy of `path`, or NULL
+  const File* find(const std::string& path);
+
+  // Cache `file` for `path` in the zone `zone` limited to `zone_max` bytes,
+  // taking its data (file.data is left empty). Returns the cached copy, or
+  // NULL if it does not fit, its directory cannot be watched or `path` no
+  // longer has the inode, mtime and size of `file`; `file` is left
+  // untouched then.
+  const File* store(const std::string& path, const void* zone,
+                    std::size_t zone_max, File& file);
+
+  // Drop `path`, e.g. after the server wrote or deleted it
+  void invalidate(const std::string& path);
+
+  // Read pending inotify events and drop the entries they name. Returns
+  // the paths dropped, so other caches of the same files can follow.
+  std::vector<std::string> handleEvents();
+
+  std::size_t size() const;
+  // Bytes of file data held in `zone`
+  std::size_t bytes(const void* zone) const;
+
+ private:
+  StaticCache(const StaticCache& other);
+  StaticCache& operator=(const StaticCache& other);
+
+  typedef std::list<std::string> LruList;
+
+  struct Entry {
+    File file;
+    const void* zone;
+    int wd;
+    LruList::iterator lru;
+  };
+  struct Zone {
+    Zone();
+
+    std::size_t used;
+    LruList lru;  // most recently used first
+  };
+  struct Watch {
+    std::string dir;
+    std::size_t entries;
+  };
+
+  int watch_(const std::string& dir);
+  void drop_(std::map<std::string, Entry>::iterator it);
+  void dropDir_(int wd, std::vector<std::string>& dropped);
+  void clear_();
+
+  int fd_;
+  std::map<std::string, Entry> entries_;
+  std::map<const void*, Zone> zones_;
+  std::map<int, Watch> watches_;        // inotify wd -> watched directory
+  std::map<std::string, int> dir_wds_;  // watched directory -> wd
+};
@@ -0,0 +1,203 @@
+#include "StaticCache.hpp"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Scratch directory removed with everything in it at the end of a test
+class TempDir {
+ public:
+  TempDir() {
+    char tmpl[] = "/tmp/webserv_sc_XXXXXX";
+    path_ = mkdtemp(tmpl) != NULL ? tmpl : "";
+  }
+  ~TempDir() {
+    std::string cmd = "rm -rf '" + path_ + "'";
+    if (!path_.empty() && std::system(cmd.c_str()) != 0) {
+      std::perror("rm");
+    }
+  }
+  std::string file(const std::string& name, const std::string& content) {
+    std::string p = path_ + "/" + name;
+    int fd = ::open(p.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+      ssize_t n = write(fd, content.data(), content.size());
+      (void)n;
+      close(fd);
+    }
+    return p;
+  }
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+// `data` as read from `path`, with the file's inode and mtime
+StaticCache::File makeFile(const std::string& path, const std::string& data) {
+  StaticCache::File f;
+  f.data = data;
+  f.content_type = "text/plain";
+  struct stat st;
+  if (stat(path.c_str(), &st) == 0) {
+    f.mtime = st.st_mtime;
+    f.inode = st.st_ino;
+  }
+  return f;
+}
+
+const int kZoneA = 0;
+const int kZoneB = 1;
+
+}  // namespace
+
+TEST(StaticCacheTests, DisabledUntilInit) {
+  TempDir dir;
+  std::string p = dir.file("a.txt", "hello");
+  StaticCache cache;
+  EXPECT_FALSE(cache.enabled());
+  EXPECT_EQ(cache.fd(), -1);
+  StaticCache::File f = makeFile(p, "hello");
+  EXPECT_TRUE(cache.store(p, &kZoneA, 100, f) == NULL);
+  EXPECT_TRUE(cache.find(p) == NULL);
+}
+
+TEST(StaticCacheTests, StoreTakesTheDataAndFindReturnsIt) {
+  TempDir dir;
+  std::string p = dir.file("a.css", "body{}");
+  StaticCache cache;
+  ASSERT_TRUE(cache.init());
+  EXPECT_GE(cache.fd(), 0);
+
+  StaticCache::File f = makeFile(p, "body{}");
+  f.content_type = "text/css";
+  const StaticCache::File* stored = cache.store(p, &kZoneA, 100, f);
+  ASSERT_TRUE(stored != NULL);
+  EXPECT_TRUE(f.data.empty());
+  EXPECT_EQ(stored->data, "body{}");
+
+  const StaticCache::File* hit = cache.find(p);
+  ASSERT_TRUE(hit != NULL);
+  EXPECT_EQ(hit->content_type, "text/css");
+  EXPECT_EQ(cache.bytes(&kZoneA), 6u);
+}
+
+TEST(StaticCacheTests, FilesLargerThanTheZoneAreRefused) {
+  TempDir dir;
+  std::string p = dir.file("big", "0123456789");
+  StaticCache cache;
+  ASSERT_TRUE(cache.init());
+  StaticCache::File f = makeFile(p, "0123456789");
+  EXPECT_TRUE(cache.store(p, &kZoneA, 9, f) == NULL);
+  EXPECT_EQ(f.data, "0123456789");
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(StaticCacheTests, LeastRecentlyUsedOfTheSameZoneIsEvicted) {
+  TempDir dir;
+  std::string a = dir.file("a", "aaaa");
+  std::string b = dir.file("b", "bbbb");
+  std::string c = dir.file("c", "cccc");
+  std::string other = dir.file("other", "oooo");
+  StaticCache cache;
+  ASSERT_TRUE(cache.init());
+
+  StaticCache::File f = makeFile(other, "oooo");
+  ASSERT_TRUE(cache.store(other, &kZoneB, 4, f) != NULL);
+  f = makeFile(a, "aaaa");
+  ASSERT_TRUE(cache.store(a, &kZoneA, 8, f) != NULL);
+  f = makeFile(b, "bbbb");
+  ASSERT_TRUE(cache.store(b, &kZoneA, 8, f) != NULL);
+  ASSERT_TRUE(cache.find(a) != NULL);  // b is now the least recent
+  f = makeFile(c, "cccc");
+  ASSERT_TRUE(cache.store(c, &kZoneA, 8, f) != NULL);
+
+  EXPECT_TRUE(cache.find(a) != NULL);
+  EXPECT_TRUE(cache.find(b) == NULL);
+  EXPECT_TRUE(cache.find(c) != NULL);
+  EXPECT_TRUE(cache.find(other) != NULL);
+  EXPECT_EQ(cache.bytes(&kZoneA), 8u);
+  EXPECT_EQ(cache.bytes(&kZoneB), 4u);
+}
+
+TEST(StaticCacheTests, ChangesOnDiskInvalidateThroughInotify) {
+  TempDir dir;
+  std::string a = dir.file("index.html", "v1");
+  std::string b = dir.file("gone.txt", "x");
+  std::string c = dir.file("moved.txt", "y");
+  StaticCache cache;
+  ASSERT_TRUE(cache.init());
+  StaticCache::File f = makeFile(a, "v1");
+  ASSERT_TRUE(cache.store(a, &kZoneA, 100, f) != NULL);
+  f = makeFile(b, "x");
+  ASSERT_TRUE(cache.store(b, &kZoneA, 100, f) != NULL);
+  f = makeFile(c, "y");
+  ASSERT_TRUE(cache.store(c, &kZoneA, 100, f) != NULL);
+
+  cache.handleEvents();
+  EXPECT_EQ(cache.size(), 3u);
+
+  dir.file("index.html", "version 2");
+  ASSERT_EQ(unlink(b.c_str()), 0);
+  ASSERT_EQ(rename(c.c_str(), (dir.path() + "/elsewhere").c_str()), 0);
+  std::vector<std::string> dropped = cache.handleEvents();
+  EXPECT_EQ(dropped.size(), 3u);
+  EXPECT_TRUE(cache.find(a) == NULL);
+  EXPECT_TRUE(cache.find(b) == NULL);
+  EXPECT_TRUE(cache.find(c) == NULL);
+  EXPECT_EQ(cache.bytes(&kZoneA), 0u);
+}
+
+TEST(StaticCacheTests, MovedDirectoryDropsItsEntries) {
+  TempDir dir;
+  std::string sub = dir.path() + "/sub";
+  ASSERT_EQ(mkdir(sub.c_str(), 0755), 0);
+  std::string p = dir.file("sub/a", "a");
+  StaticCache cache;
+  ASSERT_TRUE(cache.init());
+  StaticCache::File f = makeFile(p, "a");
+  ASSERT_TRUE(cache.store(p, &kZoneA, 100, f) != NULL);
+
+  // Nothing happens to the file's name in the directory itself
+  ASSERT_EQ(rename(sub.c_str(), (dir.path() + "/sub2").c_str()), 0);
+  cache.handleEvents();
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(StaticCacheTests, InvalidateDropsEntry) {
+  TempDir dir;
+  std::string p = dir.file("upload.bin", "1234");
+  StaticCache cache;
+  ASSERT_TRUE(cache.init());
+  StaticCache::File f = makeFile(p, "1234");
+  ASSERT_TRUE(cache.store(p, &kZoneA, 100, f) != NULL);
+  cache.invalidate(p);
+  EXPECT_TRUE(cache.find(p) == NULL);
+  EXPECT_EQ(cache.bytes(&kZoneA), 0u);
+}
+
+TEST(StaticCacheTests, FileReplacedBeforeStoreIsNotKept) {
+  TempDir dir;
+  std::string p = dir.file("page.html", "old");
+  StaticCache cache;
+  ASSERT_TRUE(cache.init());
+  // Read before the directory is watched, then replaced by a rename
+  StaticCache::File f = makeFile(p, "old");
+  std::string tmp = dir.file("page.html.new", "new");
+  ASSERT_EQ(rename(tmp.c_str(), p.c_str()), 0);
+
+  EXPECT_TRUE(cache.store(p, &kZoneA, 100, f) == NULL);
+  EXPECT_EQ(f.data, "old");
+  EXPECT_EQ(cache.size(), 0u);
+
+  f = makeFile(p, "new");
+  EXPECT_TRUE(cache.store(p, &kZoneA, 100, f) != NULL);
+}
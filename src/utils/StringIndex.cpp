@@ -0,0 +1,91 @@
+#include "StringIndex.hpp"
+
+namespace {
+
+const std::size_t kInitialBuckets = 8;
+
+}  // namespace
+
+StringIndex::StringIndex() : slots_(), count_(0) {}
+
+StringIndex::StringIndex(const StringIndex& other)
+    : slots_(other.slots_), count_(other.count_) {}
+
+StringIndex& StringIndex::operator=(const StringIndex& other) {
+  if (this != &other) {
+    slots_ = other.slots_;
+    count_ = other.count_;
+  }
+  return *this;
+}
+
+StringIndex::~StringIndex() {}
+
+bool StringIndex::insert(const std::string& key, int value) {
+  if (find(key) >= 0) {
+    return false;
+  }
+  if ((count_ + 1) * 2 > slots_.size()) {
+    rehash_(slots_.empty() ? kInitialBuckets : slots_.size() * 2);
+  }
+  std::size_t mask = slots_.size() - 1;
+  std::size_t i = hash(key) & mask;
+  while (slots_[i].value >= 0) {
+    i = (i + 1) & mask;
+  }
+  slots_[i].key = key;
+  slots_[i].value = value;
+  ++count_;
+  return true;
+}
+
+int StringIndex::find(const std::string& key) const {
+  if (slots_.empty()) {
+    return -1;
+  }
+  std::size_t mask = slots_.size() - 1;
+  for (std::size_t i = hash(key) & mask; slots_[i].value >= 0;
+       i = (i + 1) & mask) {
+    if (slots_[i].key == key) {
+      return slots_[i].value;
+    }
+  }
+  return -1;
+}
+
+std::size_t StringIndex::size() const {
+  return count_;
+}
+
+void StringIndex::clear() {
+  slots_.clear();
+  count_ = 0;
+}
+
+std::size_t StringIndex::hash(const std::string& key) {
+  std::size_t h = 2166136261u;
+  for (std::size_t i = 0; i < key.size(); ++i) {
+    h ^= static_cast<unsigned char>(key[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+void StringIndex::rehash_(std::size_t buckets) {
+  std::vector<Slot> old;
+  old.swap(slots_);
+  Slot empty;
+  empty.value = -1;
+  slots_.assign(buckets, empty);
+  std::size_t mask = buckets - 1;
+  for (std::size_t j = 0; j < old.size(); ++j) {
+    if (old[j].value < 0) {
+      continue;
+    }
+    std::size_t i = hash(old[j].key) & mask;
+    while (slots_[i].value >= 0) {
+      i = (i + 1) & mask;
+    }
+    slots_[i] = old[j];
+  }
+}
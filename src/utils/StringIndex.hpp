@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Open-addressing hash table from strings to non-negative ints (typically
+// indexes into a vector owned by the caller). Built once at startup and then
+// only read, so lookups are a hash and a short linear probe with no
+// allocation. The table is kept at most half full.
+class StringIndex {
+ public:
+  StringIndex();
+  StringIndex(const StringIndex& other);
+  StringIndex& operator=(const StringIndex& other);
+  ~StringIndex();
+
+  // Map `key` to `value` (>= 0). Returns false, leaving the table as it was,
+  // if `key` is already present.
+  bool insert(const std::string& key, int value);
+  // Value stored for `key`, or -1 if there is none
+  int find(const std::string& key) const;
+
+  std::size_t size() const;
+  void clear();
+
+  // 32-bit FNV-1a
+  static std::size_t hash(const std::string& key);
+
+ private:
+  struct Slot {
+    std::string key;
+    int value;  // -1 when the slot is empty
+  };
+
+  void rehash_(std::size_t buckets);
+
+  std::vector<Slot> slots_;
+  std::size_t count_;
+};
@@ -0,0 +1,48 @@
+#include "StringIndex.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+TEST(StringIndexTests, FindsInsertedKeys) {
+  StringIndex idx;
+  EXPECT_EQ(idx.find("missing"), -1);
+  EXPECT_TRUE(idx.insert("/exact", 3));
+  EXPECT_TRUE(idx.insert("", 0));
+  EXPECT_EQ(idx.find("/exact"), 3);
+  EXPECT_EQ(idx.find(""), 0);
+  EXPECT_EQ(idx.find("/exac"), -1);
+  EXPECT_EQ(idx.size(), 2u);
+}
+
+TEST(StringIndexTests, DuplicateKeyKeepsFirstValue) {
+  StringIndex idx;
+  EXPECT_TRUE(idx.insert("a", 1));
+  EXPECT_FALSE(idx.insert("a", 2));
+  EXPECT_EQ(idx.find("a"), 1);
+  EXPECT_EQ(idx.size(), 1u);
+}
+
+TEST(StringIndexTests, GrowsPastInitialBuckets) {
+  StringIndex idx;
+  for (int i = 0; i < 500; ++i) {
+    std::ostringstream key;
+    key << "key" << i;
+    ASSERT_TRUE(idx.insert(key.str(), i));
+  }
+  for (int i = 0; i < 500; ++i) {
+    std::ostringstream key;
+    key << "key" << i;
+    EXPECT_EQ(idx.find(key.str()), i);
+  }
+  idx.clear();
+  EXPECT_EQ(idx.size(), 0u);
+  EXPECT_EQ(idx.find("key1"), -1);
+}
+
+TEST(StringIndexTests, HashIsFnv1a) {
+  // Reference values for 32-bit FNV-1a
+  EXPECT_EQ(StringIndex::hash("") & 0xffffffffu, 0x811c9dc5u);
+  EXPECT_EQ(StringIndex::hash("a") & 0xffffffffu, 0xe40c292cu);
+}
@@ -9,8 +9,23 @@
 #define MAX_EVENTS 64
 #define WRITE_BUF_SIZE 4096
 
-// Maximum bytes to scan while searching for end of headers
-#define HEADERS_SEARCH_LIMIT 4096
+// Fair write scheduling: a connection sends at most SEND_BUDGET_PER_WAKEUP
+// bytes each time the event loop finds it writable, then waits for its next
+// turn so the other ready connections are served in between. File data goes
+// out with sendfile() in chunks that start at SENDFILE_CHUNK_MIN, double
+// while the socket takes whole chunks and halve when it fills up, up to
+// SENDFILE_CHUNK_MAX.
+#define SEND_BUDGET_PER_WAKEUP (1024 * 1024)
+#define SENDFILE_CHUNK_MIN (64 * 1024)
+#define SENDFILE_CHUNK_MAX (512 * 1024)
+
+// Most specs a Range header may list; a longer list is ignored and the
+// whole file is sent
+#define MAX_RANGES 16
+
+// Maximum length of a chunk-size line (with extensions) and of the trailer
+// section of a chunked request body
+#define CHUNKED_LINE_LIMIT 4096
 
 #define EXIT_NOT_FOUND 127  // Standard shell exit code for "command not found"
 #define FILE_UPLOAD_MODE \
@@ -24,3 +39,10 @@
 // Connection timeout in seconds for writing responses to client
 // If response cannot be fully sent within this time, close the connection
 #define WRITE_TIMEOUT_SECONDS 10
+
+// Lingering close: after answering a request whose body was not read, the
+// write side is shut down and further input is discarded for at most this
+// many seconds and bytes before the socket is closed, so the unread data
+// does not make the kernel reset the connection under the response.
+#define LINGERING_TIME_SECONDS 5
+#define LINGERING_DISCARD_LIMIT (1024 * 1024)
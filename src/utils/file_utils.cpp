@@ -2,21 +2,75 @@
 
 #include <fcntl.h>
 #include <sys/sendfile.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <map>
-#include <sstream>
 
+#include "ByteBuilder.hpp"
 #include "HttpStatus.hpp"
 #include "Logger.hpp"
+#include "OpenFileCache.hpp"
 #include "Response.hpp"
 #include "constants.hpp"
+#include "http_utils.hpp"
 #include "utils.hpp"
 
+FileInfo::FileInfo()
+    : fd(-1), size(0), mtime(0), inode(0), content_type(), cache(NULL) {}
+
+FileStat::FileStat()
+    : is_dir(false), is_reg(false), size(0), mtime(0), inode(0), dev(0) {}
+
+SendQuota::SendQuota()
+    : budget(SEND_BUDGET_PER_WAKEUP), chunk(SENDFILE_CHUNK_MIN), sent(0) {}
+
+void SendQuota::refill(std::size_t bytes) {
+  budget = bytes;
+  sent = 0;
+}
+
+void SendQuota::consume(std::size_t sent, std::size_t asked) {
+  budget -= std::min(budget, sent);
+  this->sent += sent;
+  if (sent < asked) {
+    // The socket buffer filled up: ask for less next time
+    chunk = std::max<std::size_t>(chunk / 2, SENDFILE_CHUNK_MIN);
+  } else if (asked >= chunk) {
+    chunk = std::min<std::size_t>(chunk * 2, SENDFILE_CHUNK_MAX);
+  }
+}
+
+ByteRange::ByteRange() : start(0), end(-1) {}
+
+ByteRange::ByteRange(off_t start, off_t end) : start(start), end(end) {}
+
+MultipartBody::MultipartBody() : boundary(), ranges(), heads(), trailer() {}
+
+off_t MultipartBody::length() const {
+  off_t total = static_cast<off_t>(trailer.size());
+  for (std::size_t i = 0; i < ranges.size(); ++i) {
+    total += static_cast<off_t>(heads[i].size());
+    total += ranges[i].end - ranges[i].start + 1;
+  }
+  return total;
+}
+
+namespace {
+
+bool startsBefore(const ByteRange& a, const ByteRange& b) {
+  return a.start < b.start;
+}
+
+}  // namespace
+
 namespace file_utils {
 
 // Static MIME type mappings
@@ -132,11 +186,9 @@ std::string mimeToExtension(const std::string& mime_type) {
 }
 
 bool openFile(const std::string& path, FileInfo& out) {
-  out.fd = -1;
-  out.size = 0;
-  out.content_type.clear();
+  out = FileInfo();
 
-  int fd = open(path.c_str(), O_RDONLY);
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
   if (fd < 0) {
     LOG_PERROR(DEBUG, "file_utils: openFile failed for '" << path << "'");
     return false;
@@ -151,23 +203,56 @@ bool openFile(const std::string& path, FileInfo& out) {
 
   out.fd = fd;
   out.size = st.st_size;
+  out.mtime = st.st_mtime;
+  out.inode = st.st_ino;
   out.content_type = guessMime(path);
   LOG(DEBUG) << "file_utils: opened '" << path << "' fd=" << out.fd
              << " size=" << out.size << " type=" << out.content_type;
   return true;
 }
 
+bool openFile(const std::string& path, FileInfo& out, OpenFileCache* cache) {
+  if (cache == NULL) {
+    return openFile(path, out);
+  }
+  return cache->open(path, out);
+}
+
 void closeFile(FileInfo& fi) {
-  if (fi.fd >= 0) {
+  if (fi.fd >= 0 && fi.cache != NULL) {
+    fi.cache->release(fi.fd);
+  } else if (fi.fd >= 0) {
     LOG(DEBUG) << "file_utils: closing fd=" << fi.fd;
     close(fi.fd);
-    fi.fd = -1;
   }
-  fi.size = 0;
-  fi.content_type.clear();
+  fi = FileInfo();
 }
 
-int streamToSocket(int sock_fd, int file_fd, off_t& offset, off_t max_offset) {
+FileStat toFileStat(const struct stat& st) {
+  FileStat out;
+  out.is_dir = S_ISDIR(st.st_mode);
+  out.is_reg = S_ISREG(st.st_mode);
+  out.size = st.st_size;
+  out.mtime = st.st_mtime;
+  out.inode = st.st_ino;
+  out.dev = st.st_dev;
+  return out;
+}
+
+bool statPath(const std::string& path, FileStat& out, OpenFileCache* cache) {
+  if (cache != NULL) {
+    return cache->stat(path, out);
+  }
+  struct stat st;
+  if (::stat(path.c_str(), &st) < 0) {
+    return false;
+  }
+  out = toFileStat(st);
+  return true;
+}
+
+int streamToSocket(int sock_fd, int file_fd, off_t& offset, off_t max_offset,
+                   SendQuota* quota) {
   if (offset >= max_offset) {
     return 0;  // nothing to send
   }
@@ -176,13 +261,27 @@ int streamToSocket(int sock_fd, int file_fd, off_t& offset, off_t max_offset) {
              << " to sock=" << sock_fd << " offset=" << offset
              << " max=" << max_offset;
   while (offset < max_offset) {
+    size_t chunk = SENDFILE_CHUNK_MIN;
+    if (quota != NULL) {
+      chunk = std::min(quota->chunk, quota->budget);
+    }
+    if (chunk == 0) {
+      LOG(DEBUG) << "file_utils: send budget used up at offset=" << offset;
+      return 1;
+    }
     size_t to_send = static_cast<size_t>(max_offset - offset);
-    if (to_send > WRITE_BUF_SIZE) {
-      to_send = WRITE_BUF_SIZE;
+    if (to_send > chunk) {
+      to_send = chunk;
     }
 
     ssize_t s = sendfile(sock_fd, file_fd, &offset, to_send);
     if (s < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        if (quota != NULL) {
+          quota->consume(0, to_send);
+        }
+        return 1;
+      }
       LOG_PERROR(ERROR, "file_utils: sendfile error");
       return -1;
     }
@@ -194,11 +293,58 @@ int streamToSocket(int sock_fd, int file_fd, off_t& offset, off_t max_offset) {
 
     LOG(DEBUG) << "file_utils: sendfile wrote " << s
                << " bytes, new offset=" << offset;
+    if (quota != NULL) {
+      quota->consume(static_cast<size_t>(s), to_send);
+    }
+    if (static_cast<size_t>(s) < to_send) {
+      break;  // the socket buffer is full
+    }
   }
 
   return (offset >= max_offset) ? 0 : 1;
 }
 
+int streamMultipartToSocket(int sock_fd, int file_fd,
+                            const MultipartBody& body, std::size_t& segment,
+                            off_t& offset, SendQuota* quota) {
+  const std::size_t trailer = body.ranges.size() * 2;
+  while (segment <= trailer) {
+    if (segment % 2 == 0) {
+      const std::string& text =
+          segment == trailer ? body.trailer : body.heads[segment / 2];
+      while (offset < static_cast<off_t>(text.size())) {
+        if (quota != NULL && quota->budget == 0) {
+          return 1;
+        }
+        std::size_t len = text.size() - static_cast<std::size_t>(offset);
+        ssize_t w = send(sock_fd, text.data() + offset, len, 0);
+        if (w < 0) {
+          if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 1;
+          }
+          LOG_PERROR(ERROR, "file_utils: send error");
+          return -1;
+        }
+        offset += w;
+        if (quota != NULL) {
+          quota->consume(static_cast<std::size_t>(w), len);
+        }
+      }
+    } else {
+      const ByteRange& range = body.ranges[segment / 2];
+      off_t pos = range.start + offset;
+      int r = streamToSocket(sock_fd, file_fd, pos, range.end + 1, quota);
+      offset = pos - range.start;
+      if (r != 0) {
+        return r;
+      }
+    }
+    ++segment;
+    offset = 0;
+  }
+  return 0;
+}
+
 bool parseRange(const std::string& rangeHeader, off_t file_size,
                 off_t& out_start, off_t& out_end) {
   const std::string prefix = "bytes=";
@@ -263,27 +409,143 @@ bool parseRange(const std::string& rangeHeader, off_t file_size,
   return true;
 }
 
+long long rateAllowance(std::size_t rate, std::size_t rate_after,
+                        long long elapsed_ms, long long sent,
+                        long long& wait_ms) {
+  long long per_second = static_cast<long long>(rate);
+  long long slice = std::min<long long>(per_second, SENDFILE_CHUNK_MIN);
+  long long allowance = static_cast<long long>(rate_after) +
+                        per_second * elapsed_ms / 1000 + slice - sent;
+  if (allowance > 0) {
+    wait_ms = 0;
+    return allowance;
+  }
+  // Until the allowance is back up to a whole slice
+  wait_ms = ((slice - allowance) * 1000 + per_second - 1) / per_second;
+  return 0;
+}
+
+int parseRanges(const std::string& rangeHeader, off_t file_size,
+                std::size_t max_ranges, std::vector<ByteRange>& out) {
+  out.clear();
+  const std::string prefix = "bytes=";
+  if (rangeHeader.compare(0, prefix.size(), prefix) != 0) {
+    return 0;
+  }
+
+  std::vector<ByteRange> ranges;
+  std::size_t count = 0;
+  std::size_t pos = prefix.size();
+  while (pos <= rangeHeader.size()) {
+    std::size_t comma = rangeHeader.find(',', pos);
+    if (comma == std::string::npos) {
+      comma = rangeHeader.size();
+    }
+    std::string spec = trim_copy(rangeHeader.substr(pos, comma - pos));
+    pos = comma + 1;
+    if (spec.empty()) {
+      continue;  // empty list elements are allowed
+    }
+    if (++count > max_ranges) {
+      return -1;
+    }
+    off_t s = 0, e = 0;
+    if (parseRange(prefix + spec, file_size, s, e)) {
+      ranges.push_back(ByteRange(s, e));
+    }
+  }
+
+  std::sort(ranges.begin(), ranges.end(), startsBefore);
+  for (std::size_t i = 0; i < ranges.size(); ++i) {
+    if (!out.empty() && ranges[i].start <= out.back().end + 1) {
+      out.back().end = std::max(out.back().end, ranges[i].end);
+    } else {
+      out.push_back(ranges[i]);
+    }
+  }
+  return out.empty() ? 0 : 1;
+}
+
+std::string makeBoundary() {
+  static unsigned long counter = 0;
+  std::string boundary;
+  ByteBuilder(boundary)
+      .append("webserv-")
+      .appendHex(static_cast<unsigned long long>(time(NULL)))
+      .append('-')
+      .appendHex(++counter);
+  return boundary;
+}
+
+void prepareMultipart(const std::vector<ByteRange>& ranges, off_t file_size,
+                      const std::string& content_type,
+                      const std::string& boundary, MultipartBody& out) {
+  out.boundary = boundary;
+  out.ranges = ranges;
+  out.heads.assign(ranges.size(), std::string());
+  for (std::size_t i = 0; i < ranges.size(); ++i) {
+    ByteBuilder b(out.heads[i]);
+    if (i > 0) {
+      b.appendCrlf();  // ends the previous part's data
+    }
+    b.append("--").append(boundary).appendCrlf();
+    if (!content_type.empty()) {
+      b.appendHeader("Content-Type", content_type);
+    }
+    b.append("Content-Range: bytes ")
+        .appendNumber(static_cast<long long>(ranges[i].start))
+        .append('-')
+        .appendNumber(static_cast<long long>(ranges[i].end))
+        .append('/')
+        .appendNumber(static_cast<long long>(file_size))
+        .appendCrlf()
+        .appendCrlf();
+  }
+  out.trailer.clear();
+  ByteBuilder(out.trailer)
+      .appendCrlf()
+      .append("--")
+      .append(boundary)
+      .append("--" CRLF);
+}
+
 int prepareFileResponse(const std::string& path, const std::string* rangeHeader,
                         ::Response& outResponse, FileInfo& outFile,
                         off_t& out_start, off_t& out_end,
-                        const std::string& httpVersion) {
-  outFile.fd = -1;
-  outFile.size = 0;
-  outFile.content_type.clear();
+                        const std::string& httpVersion,
+                        OpenFileCache* cache,
+                        const std::string* content_type,
+                        MultipartBody* multipart) {
+  outFile = FileInfo();
 
-  if (!openFile(path, outFile)) {
+  if (!openFile(path, outFile, cache)) {
     LOG(DEBUG)
         << "file_utils: prepareFileResponse - openFile returned false for '"
         << path << "'";
     return -1;  // not found
   }
+  if (content_type != NULL) {
+    outFile.content_type = *content_type;
+  }
 
   off_t file_size = outFile.size;
   bool is_partial = false;
+  if (multipart != NULL) {
+    *multipart = MultipartBody();
+  }
 
+  std::vector<ByteRange> ranges;
+  int parsed = 0;
   if (rangeHeader) {
-    off_t s = 0, e = 0;
-    if (!parseRange(*rangeHeader, file_size, s, e)) {
+    parsed = parseRanges(*rangeHeader, file_size, MAX_RANGES, ranges);
+    if (parsed < 0) {
+      LOG(DEBUG) << "file_utils: prepareFileResponse - more than "
+                 << MAX_RANGES << " ranges, sending the whole file";
+    }
+  }
+
+  if (rangeHeader && parsed >= 0) {
+    if (parsed == 0) {
       LOG(DEBUG) << "file_utils: prepareFileResponse - invalid range '"
                  << *rangeHeader << "' for file=" << path
                  << " size=" << file_size;
@@ -297,42 +559,50 @@ int prepareFileResponse(const std::string& path, const std::string* rangeHeader,
       closeFile(outFile);
       return -2;
     }
-    LOG(DEBUG) << "file_utils: prepareFileResponse - parsed range start=" << s
-               << " end=" << e;
-    out_start = s;
-    out_end = e;
+    out_start = ranges.front().start;
+    out_end = ranges.back().end;
+    LOG(DEBUG) << "file_utils: prepareFileResponse - " << ranges.size()
+               << " range(s) from " << out_start << " to " << out_end;
     is_partial = true;
   } else {
     out_start = 0;
     out_end = file_size - 1;
   }
 
-  if (is_partial) {
+  if (is_partial && ranges.size() > 1 && multipart != NULL) {
+    prepareMultipart(ranges, file_size, outFile.content_type, makeBoundary(),
+                     *multipart);
+    outResponse.setStatus(http::S_206_PARTIAL_CONTENT, httpVersion);
+    outResponse.addHeader(
+        "Content-Length",
+        toDecimalString(static_cast<long long>(multipart->length())));
+    outResponse.addHeader(
+        "Content-Type",
+        "multipart/byteranges; boundary=" + multipart->boundary);
+  } else if (is_partial) {
     outResponse.status_line.version = httpVersion;
     outResponse.status_line.status_code = http::S_206_PARTIAL_CONTENT;
     outResponse.status_line.reason =
         http::reasonPhrase(http::S_206_PARTIAL_CONTENT);
     off_t len = out_end - out_start + 1;
-    {
-      std::ostringstream tmp;
-      tmp << len;
-      outResponse.addHeader("Content-Length", tmp.str());
-    }
-    std::ostringstream cr;
-    cr << "bytes " << out_start << "-" << out_end << "/" << file_size;
-    outResponse.addHeader("Content-Range", cr.str());
+    outResponse.addHeader("Content-Length",
+                          toDecimalString(static_cast<long long>(len)));
+    std::string cr;
+    ByteBuilder(cr)
+        .append("bytes ")
+        .appendNumber(static_cast<long long>(out_start))
+        .append('-')
+        .appendNumber(static_cast<long long>(out_end))
+        .append('/')
+        .appendNumber(static_cast<long long>(file_size));
+    outResponse.addHeader("Content-Range", cr);
+    outResponse.addHeader("Content-Type", outFile.content_type);
   } else {
-    outResponse.status_line.version = httpVersion;
-    outResponse.status_line.status_code = http::S_200_OK;
-    outResponse.status_line.reason = http::reasonPhrase(http::S_200_OK);
-    {
-      std::ostringstream tmp;
-      tmp << file_size;
-      outResponse.addHeader("Content-Length", tmp.str());
-    }
+    prepareFullResponse(outResponse, file_size, outFile.content_type,
+                        httpVersion);
   }
+  addValidators(outResponse, outFile.inode, file_size, outFile.mtime);
 
-  outResponse.addHeader("Content-Type", outFile.content_type);
   LOG(DEBUG) << "file_utils: prepareFileResponse prepared response code="
              << outResponse.status_line.status_code
              << " content-type=" << outFile.content_type
@@ -340,4 +610,124 @@ int prepareFileResponse(const std::string& path, const std::string* rangeHeader,
   return 0;
 }
 
+int createTempFile(const std::string& dir) {
+  if (!dir.empty()) {
+    int fd = open(dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC,
+                  FILE_UPLOAD_MODE);
+    if (fd >= 0) {
+      return fd;
+    }
+    LOG_PERROR(DEBUG, "file_utils: O_TMPFILE failed in '" << dir << "'");
+  }
+
+  // Fallback: an already unlinked mkstemp() file. It cannot be linked back
+  // into the filesystem, so consumers copy from it instead.
+  char tmpl[] = "/tmp/webserv_body_XXXXXX";
+  int fd = mkstemp(tmpl);
+  if (fd < 0) {
+    LOG_PERROR(ERROR, "file_utils: mkstemp failed");
+    return -1;
+  }
+  unlink(tmpl);
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  return fd;
+}
+
+int linkTempFile(int fd, const std::string& path) {
+  // linkat(fd, "", ..., AT_EMPTY_PATH) needs CAP_DAC_READ_SEARCH; linking
+  // the /proc/self/fd entry works for any O_TMPFILE opened without O_EXCL.
+  char proc_path[64];
+  snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d", fd);
+  return linkat(AT_FDCWD, proc_path, AT_FDCWD, path.c_str(),
+                AT_SYMLINK_FOLLOW);
+}
+
+int commitTempFile(int fd, const std::string& path, bool& created) {
+  created = false;
+  if (linkTempFile(fd, path) == 0) {
+    created = true;
+    return 0;
+  }
+  if (errno != EEXIST) {
+    return -1;
+  }
+
+  // The target exists: link under a unique sibling name, then rename() it
+  // over the target so readers never observe a partially written file.
+  static unsigned int counter = 0;
+  for (int attempt = 0; attempt < 8; ++attempt) {
+    std::string tmp;
+    ByteBuilder b(tmp);
+    b.append(path)
+        .append(".upload-")
+        .appendNumber(static_cast<long long>(getpid()))
+        .append('-')
+        .appendNumber(static_cast<long long>(++counter));
+    if (linkTempFile(fd, tmp) != 0) {
+      if (errno == EEXIST) {
+        continue;
+      }
+      return -1;
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+      int saved_errno = errno;
+      unlink(tmp.c_str());
+      errno = saved_errno;
+      return -1;
+    }
+    return 0;
+  }
+  errno = EEXIST;
+  return -1;
+}
+
+bool copyFileData(int src_fd, int dst_fd, off_t len) {
+  off_t offset = 0;
+  while (offset < len) {
+    ssize_t s =
+        sendfile(dst_fd, src_fd, &offset, static_cast<size_t>(len - offset));
+    if (s <= 0) {
+      LOG_PERROR(ERROR, "file_utils: copyFileData sendfile error");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool readFileData(int fd, off_t len, std::string& out) {
+  out.resize(static_cast<std::size_t>(len));
+  off_t offset = 0;
+  while (offset < len) {
+    ssize_t n = pread(fd, &out[static_cast<std::size_t>(offset)],
+                      static_cast<std::size_t>(len - offset), offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      LOG_PERROR(DEBUG, "file_utils: readFileData pread error or short file");
+      out.clear();
+      return false;
+    }
+    offset += n;
+  }
+  return true;
+}
+
+void prepareFullResponse(::Response& outResponse, off_t size,
+                         const std::string& content_type,
+                         const std::string& httpVersion) {
+  outResponse.status_line.version = httpVersion;
+  outResponse.status_line.status_code = http::S_200_OK;
+  outResponse.status_line.reason = http::reasonPhrase(http::S_200_OK);
+  outResponse.addHeader("Content-Length",
+                        toDecimalString(static_cast<long long>(size)));
+  outResponse.addHeader("Content-Type", content_type);
+}
+
+void addValidators(::Response& outResponse, ino_t inode, off_t size,
+                   time_t mtime) {
+  outResponse.addHeader("ETag", http::makeETag(inode, size, mtime));
+  outResponse.addHeader("Last-Modified", http::formatHttpDate(mtime));
+}
+
 }  // namespace file_utils
@@ -1,30 +1,124 @@
 #pragma once
 
+#include <sys/stat.h>
 #include <sys/types.h>
 
+#include <cstddef>
+#include <ctime>
 #include <string>
+#include <vector>
 
 #include "Response.hpp"
 #include "constants.hpp"
 
+class OpenFileCache;
+
 struct FileInfo {
+  FileInfo();
+
   int fd;
   off_t size;
+  time_t mtime;
+  ino_t inode;
   std::string content_type;
+  // Set when `fd` is lent by an OpenFileCache: closeFile() gives it back
+  // instead of closing it
+  OpenFileCache* cache;
+};
+
+// What stat() says about a path
+struct FileStat {
+  FileStat();
+
+  bool is_dir;
+  bool is_reg;
+  off_t size;
+  time_t mtime;
+  ino_t inode;
+  dev_t dev;
+};
+
+// What a connection may still send in the current event loop turn, and the
+// sendfile() chunk size that suits its socket so far
+struct SendQuota {
+  SendQuota();
+
+  // Start a turn with `bytes` to send
+  void refill(std::size_t bytes);
+  // `sent` of the `asked` bytes went out: use up budget and adapt the chunk
+  void consume(std::size_t sent, std::size_t asked);
+
+  std::size_t budget;
+  std::size_t chunk;
+  // Bytes sent in the current turn
+  std::size_t sent;
+};
+
+// One byte range of a file, both ends inclusive
+struct ByteRange {
+  ByteRange();
+  ByteRange(off_t start, off_t end);
+
+  off_t start;
+  off_t end;
+};
+
+// multipart/byteranges body of a response to a multi-range request. The
+// part headers are built up front so the Content-Length is known before
+// anything is sent; the ranges themselves are sent from the file. On the
+// wire it is heads[0], ranges[0], heads[1], ranges[1], ..., trailer.
+struct MultipartBody {
+  MultipartBody();
+
+  // Bytes of the whole body
+  off_t length() const;
+
+  std::string boundary;
+  std::vector<ByteRange> ranges;
+  // Delimiter and part headers before each range
+  std::vector<std::string> heads;
+  // Closing delimiter
+  std::string trailer;
 };
 
 namespace file_utils {
 bool openFile(const std::string& path, FileInfo& out);
+// Through `cache` when it is not NULL
+bool openFile(const std::string& path, FileInfo& out, OpenFileCache* cache);
 void closeFile(FileInfo& fi);
+FileStat toFileStat(const struct stat& st);
+// stat() `path`, through `cache` when it is not NULL. Returns false with
+// errno set if it cannot be stat'ed.
+bool statPath(const std::string& path, FileStat& out, OpenFileCache* cache);
 std::string guessMime(const std::string& path);
 
 // Get file extension from MIME type (e.g., "text/plain" -> ".txt")
 // Returns ".bin" if MIME type is not recognized
 std::string mimeToExtension(const std::string& mime_type);
 
-// stream file contents (uses sendfile). Returns:
-//  0 = finished sending up to max_offset, 1 = would block (EAGAIN), -1 = error
-int streamToSocket(int sock_fd, int file_fd, off_t& offset, off_t max_offset);
+// stream file contents (uses sendfile), within `quota` when it is not NULL.
+// Returns:
+//  0 = finished sending up to max_offset, 1 = would block (EAGAIN) or the
+//  quota is used up, -1 = error
+int streamToSocket(int sock_fd, int file_fd, off_t& offset, off_t max_offset,
+                   SendQuota* quota = NULL);
+
+// limit_rate: bytes a body sent at `rate` bytes per second may still send
+// `elapsed_ms` after it started, with `sent` bytes gone and the first
+// `rate_after` bytes free. Up to min(rate, SENDFILE_CHUNK_MIN) bytes may go
+// at once. When nothing may be sent, returns 0 and sets `wait_ms` to the
+// pause until that much is allowed again.
+long long rateAllowance(std::size_t rate, std::size_t rate_after,
+                        long long elapsed_ms, long long sent,
+                        long long& wait_ms);
+
+// stream a multipart/byteranges body: the part headers with send(), the
+// ranges with sendfile(). `segment` counts the pieces sent so far (even:
+// heads[segment / 2] or the trailer, odd: ranges[segment / 2]) and
+// `offset` the bytes sent of the current one. Returns like streamToSocket.
+int streamMultipartToSocket(int sock_fd, int file_fd,
+                            const MultipartBody& body, std::size_t& segment,
+                            off_t& offset, SendQuota* quota = NULL);
 
 // parse a single-byte range header (only supports one range):
 // input like "bytes=start-end" or "bytes=start-" or "bytes=-suffix"
@@ -32,6 +126,23 @@ int streamToSocket(int sock_fd, int file_fd, off_t& offset, off_t max_offset);
 bool parseRange(const std::string& rangeHeader, off_t file_size,
                 off_t& out_start, off_t& out_end);
 
+// parse a Range header with any number of comma separated specs. Specs
+// that cannot be satisfied are dropped; the rest are sorted and those that
+// overlap or touch are merged into `out`. Returns 1 on success, 0 if no
+// spec is satisfiable (416), and -1 if the header lists more than
+// `max_ranges` specs and should be ignored.
+int parseRanges(const std::string& rangeHeader, off_t file_size,
+                std::size_t max_ranges, std::vector<ByteRange>& out);
+
+// A new boundary for a multipart/byteranges body
+std::string makeBoundary();
+
+// Fill `out` with `ranges` of a file of `file_size` bytes, each part
+// labelled with `content_type` (left out when empty)
+void prepareMultipart(const std::vector<ByteRange>& ranges, off_t file_size,
+                      const std::string& content_type,
+                      const std::string& boundary, MultipartBody& out);
+
 // Prepare a Response and FileInfo for serving a file (handles Range header).
 // Parameters:
 // - path: filesystem path
@@ -40,10 +151,52 @@ bool parseRange(const std::string& rangeHeader, off_t file_size,
 // response prepared on error)
 // - outFile: FileInfo to fill (fd and size)
 // - out_start/out_end: byte range to serve (inclusive)
+// - cache: open the file through this cache when not NULL
+// - content_type: Content-Type to send instead of the one guessed from
+// `path` (a precompressed variant is sent as the type of the original)
+// - multipart: when not NULL, a request for several disjoint ranges gets a
+// multipart/byteranges response described here (left with no ranges
+// otherwise); when NULL the span from the first to the last range is sent
 // Return: 0 = success (response prepared), -1 = file not found, -2 = invalid
 // range
 int prepareFileResponse(const std::string& path, const std::string* rangeHeader,
                         ::Response& outResponse, FileInfo& outFile,
                         off_t& out_start, off_t& out_end,
-                        const std::string& httpVersion = HTTP_VERSION);
+                        const std::string& httpVersion = HTTP_VERSION,
+                        OpenFileCache* cache = NULL,
+                        const std::string* content_type = NULL,
+                        MultipartBody* multipart = NULL);
+
+// Create an anonymous file for spooling a request body. It is opened with
+// O_TMPFILE in `dir` so it can later be linked into that filesystem; when
+// that fails an unlinked mkstemp() file under /tmp is used instead.
+// Returns the fd, or -1 on error.
+int createTempFile(const std::string& dir);
+
+// Give a file from createTempFile() the name `path` (linkat). Fails with
+// EEXIST if `path` exists. Returns 0 on success, -1 with errno set.
+int linkTempFile(int fd, const std::string& path);
+
+// Like linkTempFile(), but atomically replaces an existing `path` through a
+// rename(). `created` reports whether `path` did not exist before.
+// Returns 0 on success, -1 with errno set.
+int commitTempFile(int fd, const std::string& path, bool& created);
+
+// Copy the first `len` bytes of `src_fd` to `dst_fd` with sendfile(),
+// without moving the source file offset. Returns true on success.
+bool copyFileData(int src_fd, int dst_fd, off_t len);
+
+// Read the first `len` bytes of `fd` into `out` with pread(), without
+// moving the file offset. Returns false on error or if the file is shorter.
+bool readFileData(int fd, off_t len, std::string& out);
+
+// Status line, Content-Length and Content-Type of a 200 response carrying a
+// whole file of `size` bytes
+void prepareFullResponse(::Response& outResponse, off_t size,
+                         const std::string& content_type,
+                         const std::string& httpVersion = HTTP_VERSION);
+
+// ETag and Last-Modified of a file with the given inode, size and mtime
+void addValidators(::Response& outResponse, ino_t inode, off_t size,
+                   time_t mtime);
 }  // namespace file_utils
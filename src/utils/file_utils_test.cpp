@@ -2,9 +2,13 @@
 
 #include <fcntl.h>
 #include <gtest/gtest.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
+#include <cerrno>
+#include <cstdlib>
 #include <string>
+#include <vector>
 
 TEST(GuessMimeTests, CommonExtensions) {
   using namespace file_utils;
@@ -101,6 +105,211 @@ TEST(ParseRangeTests, SuffixRange) {
   EXPECT_EQ(e, 9);
 }
 
+TEST(ParseRangesTests, SortsAndKeepsDisjointRanges) {
+  std::vector<ByteRange> r;
+  EXPECT_EQ(file_utils::parseRanges("bytes=50-59, 0-9,-5", 100, 16, r), 1);
+  ASSERT_EQ(r.size(), 3u);
+  EXPECT_EQ(r[0].start, 0);
+  EXPECT_EQ(r[0].end, 9);
+  EXPECT_EQ(r[1].start, 50);
+  EXPECT_EQ(r[1].end, 59);
+  EXPECT_EQ(r[2].start, 95);
+  EXPECT_EQ(r[2].end, 99);
+}
+
+TEST(ParseRangesTests, MergesOverlappingAndAdjacentRanges) {
+  std::vector<ByteRange> r;
+  EXPECT_EQ(file_utils::parseRanges("bytes=0-9,5-19,20-29,40-", 50, 16, r), 1);
+  ASSERT_EQ(r.size(), 2u);
+  EXPECT_EQ(r[0].start, 0);
+  EXPECT_EQ(r[0].end, 29);
+  EXPECT_EQ(r[1].start, 40);
+  EXPECT_EQ(r[1].end, 49);
+}
+
+TEST(ParseRangesTests, DropsUnsatisfiableSpecs) {
+  std::vector<ByteRange> r;
+  EXPECT_EQ(file_utils::parseRanges("bytes=200-300, 2-3, x-y", 10, 16, r), 1);
+  ASSERT_EQ(r.size(), 1u);
+  EXPECT_EQ(r[0].start, 2);
+  EXPECT_EQ(r[0].end, 3);
+
+  EXPECT_EQ(file_utils::parseRanges("bytes=200-300,50-", 10, 16, r), 0);
+  EXPECT_TRUE(r.empty());
+  EXPECT_EQ(file_utils::parseRanges("bytes=", 10, 16, r), 0);
+  EXPECT_EQ(file_utils::parseRanges("items=0-1", 10, 16, r), 0);
+}
+
+TEST(ParseRangesTests, TooManySpecsAreIgnored) {
+  std::vector<ByteRange> r;
+  EXPECT_EQ(file_utils::parseRanges("bytes=0-0,2-2,4-4", 10, 3, r), 1);
+  EXPECT_EQ(file_utils::parseRanges("bytes=0-0,2-2,4-4,6-6", 10, 3, r), -1);
+  // Empty list elements do not count
+  EXPECT_EQ(file_utils::parseRanges("bytes=0-0,,2-2, ,4-4", 10, 3, r), 1);
+}
+
+TEST(MultipartBodyTests, LengthCoversHeadsRangesAndTrailer) {
+  std::vector<ByteRange> ranges;
+  ranges.push_back(ByteRange(0, 4));
+  ranges.push_back(ByteRange(10, 19));
+  MultipartBody body;
+  file_utils::prepareMultipart(ranges, 100, "text/plain", "BOUND", body);
+  ASSERT_EQ(body.heads.size(), 2u);
+  EXPECT_EQ(body.heads[0],
+            "--BOUND\r\nContent-Type: text/plain\r\n"
+            "Content-Range: bytes 0-4/100\r\n\r\n");
+  EXPECT_EQ(body.heads[1],
+            "\r\n--BOUND\r\nContent-Type: text/plain\r\n"
+            "Content-Range: bytes 10-19/100\r\n\r\n");
+  EXPECT_EQ(body.trailer, "\r\n--BOUND--\r\n");
+  EXPECT_EQ(body.length(),
+            static_cast<off_t>(body.heads[0].size() + 5 +
+                               body.heads[1].size() + 10 +
+                               body.trailer.size()));
+}
+
+TEST(MultipartBodyTests, StreamsPartsAndFileData) {
+  char tmpl[] = "/tmp/webserv_test_XXXXXX";
+  int fd = mkstemp(tmpl);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, "0123456789abcdef", 16), 16);
+  std::vector<ByteRange> ranges;
+  ranges.push_back(ByteRange(1, 2));
+  ranges.push_back(ByteRange(10, 15));
+  MultipartBody body;
+  file_utils::prepareMultipart(ranges, 16, "", "B", body);
+
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+  std::size_t segment = 0;
+  off_t offset = 0;
+  EXPECT_EQ(
+      file_utils::streamMultipartToSocket(sv[0], fd, body, segment, offset),
+      0);
+  close(sv[0]);
+  std::string got;
+  char buf[256];
+  ssize_t n;
+  while ((n = read(sv[1], buf, sizeof(buf))) > 0) {
+    got.append(buf, static_cast<size_t>(n));
+  }
+  close(sv[1]);
+  close(fd);
+  unlink(tmpl);
+
+  EXPECT_EQ(got,
+            "--B\r\nContent-Range: bytes 1-2/16\r\n\r\n12"
+            "\r\n--B\r\nContent-Range: bytes 10-15/16\r\n\r\nabcdef"
+            "\r\n--B--\r\n");
+  EXPECT_EQ(static_cast<off_t>(got.size()), body.length());
+}
+
+TEST(SendQuotaTests, ChunkGrowsWhileWholeChunksAreTaken) {
+  SendQuota quota;
+  EXPECT_EQ(quota.chunk, static_cast<std::size_t>(SENDFILE_CHUNK_MIN));
+  quota.refill(10 * SENDFILE_CHUNK_MAX);
+  for (int i = 0; i < 10; ++i) {
+    quota.consume(quota.chunk, quota.chunk);
+  }
+  EXPECT_EQ(quota.chunk, static_cast<std::size_t>(SENDFILE_CHUNK_MAX));
+
+  // A short write halves it again, never below the minimum
+  quota.consume(10, quota.chunk);
+  EXPECT_EQ(quota.chunk, static_cast<std::size_t>(SENDFILE_CHUNK_MAX / 2));
+  for (int i = 0; i < 10; ++i) {
+    quota.consume(0, quota.chunk);
+  }
+  EXPECT_EQ(quota.chunk, static_cast<std::size_t>(SENDFILE_CHUNK_MIN));
+
+  // The tail of a file, shorter than a chunk, does not grow it
+  quota.consume(100, 100);
+  EXPECT_EQ(quota.chunk, static_cast<std::size_t>(SENDFILE_CHUNK_MIN));
+}
+
+TEST(SendQuotaTests, StreamStopsWhenTheBudgetIsUsedUp) {
+  char tmpl[] = "/tmp/webserv_test_XXXXXX";
+  int fd = mkstemp(tmpl);
+  ASSERT_GE(fd, 0);
+  std::string data(1000, 'x');
+  ASSERT_EQ(write(fd, data.data(), data.size()),
+            static_cast<ssize_t>(data.size()));
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+
+  SendQuota quota;
+  quota.refill(300);
+  off_t offset = 0;
+  EXPECT_EQ(file_utils::streamToSocket(sv[0], fd, offset, 1000, &quota), 1);
+  EXPECT_EQ(offset, 300);
+  EXPECT_EQ(quota.budget, 0u);
+
+  quota.refill(SEND_BUDGET_PER_WAKEUP);
+  EXPECT_EQ(file_utils::streamToSocket(sv[0], fd, offset, 1000, &quota), 0);
+  EXPECT_EQ(offset, 1000);
+  EXPECT_EQ(quota.budget, static_cast<std::size_t>(SEND_BUDGET_PER_WAKEUP) -
+                              700);
+  close(sv[0]);
+  close(sv[1]);
+  close(fd);
+  unlink(tmpl);
+}
+
+TEST(SendQuotaTests, FullSocketWouldBlock) {
+  char tmpl[] = "/tmp/webserv_test_XXXXXX";
+  int fd = mkstemp(tmpl);
+  ASSERT_GE(fd, 0);
+  std::string data(4 * 1024 * 1024, 'x');
+  ASSERT_EQ(write(fd, data.data(), data.size()),
+            static_cast<ssize_t>(data.size()));
+  int sv[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+
+  // Nobody reads sv[1]: the socket fills up long before 4 MB
+  SendQuota quota;
+  quota.refill(data.size());
+  off_t offset = 0;
+  int r = 0;
+  for (int i = 0; i < 100 && r == 0; ++i) {
+    r = file_utils::streamToSocket(sv[0], fd, offset, data.size(), &quota);
+  }
+  EXPECT_EQ(r, 1);
+  EXPECT_LT(offset, static_cast<off_t>(data.size()));
+  EXPECT_GT(quota.budget, 0u);
+  close(sv[0]);
+  close(sv[1]);
+  close(fd);
+  unlink(tmpl);
+}
+
+TEST(RateAllowanceTests, FirstSliceGoesAtOnce) {
+  long long wait_ms = -1;
+  EXPECT_EQ(file_utils::rateAllowance(1000, 0, 0, 0, wait_ms), 1000);
+  EXPECT_EQ(wait_ms, 0);
+  // Fast links get a sendfile chunk, not a whole second's worth
+  EXPECT_EQ(file_utils::rateAllowance(10 * 1024 * 1024, 0, 0, 0, wait_ms),
+            SENDFILE_CHUNK_MIN);
+}
+
+TEST(RateAllowanceTests, PausesUntilTheNextSlice) {
+  long long wait_ms = 0;
+  // 1000 B/s, 1000 sent at t=0: the next 1000 are due a second later
+  EXPECT_EQ(file_utils::rateAllowance(1000, 0, 0, 1000, wait_ms), 0);
+  EXPECT_EQ(wait_ms, 1000);
+  EXPECT_EQ(file_utils::rateAllowance(1000, 0, 250, 1250, wait_ms), 0);
+  EXPECT_EQ(wait_ms, 1000);
+  EXPECT_EQ(file_utils::rateAllowance(1000, 0, 250, 1000, wait_ms), 250);
+  EXPECT_EQ(file_utils::rateAllowance(1000, 0, 1000, 1000, wait_ms), 1000);
+  // Credit accrues while the client is slow to read
+  EXPECT_EQ(file_utils::rateAllowance(1000, 0, 3000, 1000, wait_ms), 3000);
+}
+
+TEST(RateAllowanceTests, RateAfterBytesAreFree) {
+  long long wait_ms = 0;
+  EXPECT_EQ(file_utils::rateAllowance(1000, 50000, 0, 0, wait_ms), 51000);
+  EXPECT_EQ(file_utils::rateAllowance(1000, 50000, 0, 51000, wait_ms), 0);
+  EXPECT_EQ(wait_ms, 1000);
+}
+
 TEST(PrepareFileResponseTests, NoRange) {
   using namespace file_utils;
   // create a temporary file
@@ -129,3 +338,160 @@ TEST(PrepareFileResponseTests, NoRange) {
   file_utils::closeFile(fi);
   unlink(path.c_str());
 }
+
+TEST(PrepareFileResponseTests, MultipleRangesAreMultipart) {
+  char tmpl[] = "/tmp/webserv_test_XXXXXX";
+  int fd = mkstemp(tmpl);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, "0123456789", 10), 10);
+  close(fd);
+
+  std::string path(tmpl);
+  std::string range = "bytes=0-1,5-6";
+  ::Response resp;
+  FileInfo fi;
+  MultipartBody body;
+  off_t s, e;
+  ASSERT_EQ(file_utils::prepareFileResponse(path, &range, resp, fi, s, e,
+                                            HTTP_VERSION, NULL, NULL, &body),
+            0);
+  EXPECT_EQ(resp.status_line.status_code, http::S_206_PARTIAL_CONTENT);
+  ASSERT_EQ(body.ranges.size(), 2u);
+  std::string value;
+  EXPECT_TRUE(resp.getHeader("Content-Type", value));
+  EXPECT_EQ(value, "multipart/byteranges; boundary=" + body.boundary);
+  EXPECT_TRUE(resp.getHeader("Content-Length", value));
+  EXPECT_EQ(std::stoll(value), static_cast<long long>(body.length()));
+  EXPECT_FALSE(resp.getHeader("Content-Range", value));
+  file_utils::closeFile(fi);
+
+  // Ranges that merge into one are an ordinary 206
+  range = "bytes=0-3,2-5";
+  ::Response single;
+  ASSERT_EQ(file_utils::prepareFileResponse(path, &range, single, fi, s, e,
+                                            HTTP_VERSION, NULL, NULL, &body),
+            0);
+  EXPECT_TRUE(body.ranges.empty());
+  EXPECT_TRUE(single.getHeader("Content-Range", value));
+  EXPECT_EQ(value, "bytes 0-5/10");
+  file_utils::closeFile(fi);
+  unlink(path.c_str());
+}
+
+// ==================== TEMP FILE SPOOLING ====================
+
+static std::string readWholeFile(const std::string& path) {
+  std::string out;
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return out;
+  }
+  char buf[256];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    out.append(buf, static_cast<size_t>(n));
+  }
+  close(fd);
+  return out;
+}
+
+TEST(TempFileTests, LinkTempFileGivesItAName) {
+  char dir_tmpl[] = "/tmp/webserv_spool_XXXXXX";
+  ASSERT_NE(mkdtemp(dir_tmpl), nullptr);
+  std::string dir(dir_tmpl);
+
+  int fd = file_utils::createTempFile(dir);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, "spooled", 7), 7);
+
+  std::string target = dir + "/linked.txt";
+  if (file_utils::linkTempFile(fd, target) != 0) {
+    // Filesystems without O_TMPFILE fall back to an unlinkable file
+    close(fd);
+    rmdir(dir.c_str());
+    GTEST_SKIP() << "O_TMPFILE not supported here";
+  }
+  EXPECT_EQ(readWholeFile(target), "spooled");
+
+  // Linking onto an existing name fails like O_EXCL
+  EXPECT_EQ(file_utils::linkTempFile(fd, target), -1);
+  EXPECT_EQ(errno, EEXIST);
+
+  close(fd);
+  unlink(target.c_str());
+  rmdir(dir.c_str());
+}
+
+TEST(TempFileTests, CommitTempFileReplacesExistingFile) {
+  char dir_tmpl[] = "/tmp/webserv_spool_XXXXXX";
+  ASSERT_NE(mkdtemp(dir_tmpl), nullptr);
+  std::string dir(dir_tmpl);
+  std::string target = dir + "/existing.txt";
+  int old_fd = open(target.c_str(), O_WRONLY | O_CREAT, 0600);
+  ASSERT_GE(old_fd, 0);
+  ASSERT_EQ(write(old_fd, "old contents", 12), 12);
+  close(old_fd);
+
+  int fd = file_utils::createTempFile(dir);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, "new", 3), 3);
+
+  bool created = true;
+  if (file_utils::commitTempFile(fd, target, created) != 0) {
+    close(fd);
+    unlink(target.c_str());
+    rmdir(dir.c_str());
+    GTEST_SKIP() << "O_TMPFILE not supported here";
+  }
+  EXPECT_FALSE(created);
+  EXPECT_EQ(readWholeFile(target), "new");
+
+  close(fd);
+  unlink(target.c_str());
+  // No stray ".upload-" sibling is left behind
+  EXPECT_EQ(rmdir(dir.c_str()), 0);
+}
+
+TEST(TempFileTests, FallbackWhenDirectoryIsUnusable) {
+  int fd = file_utils::createTempFile("/nonexistent/webserv/dir");
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, "abc", 3), 3);
+
+  // The fallback file has no name and must be copied instead of linked
+  int out_fd = open("/dev/null", O_WRONLY);
+  ASSERT_GE(out_fd, 0);
+  EXPECT_TRUE(file_utils::copyFileData(fd, out_fd, 3));
+  close(out_fd);
+  close(fd);
+}
+
+TEST(TempFileTests, CopyFileDataCopiesFromStart) {
+  int src = file_utils::createTempFile("");
+  ASSERT_GE(src, 0);
+  ASSERT_EQ(write(src, "0123456789", 10), 10);
+
+  char tmpl[] = "/tmp/webserv_copy_XXXXXX";
+  int dst = mkstemp(tmpl);
+  ASSERT_GE(dst, 0);
+  EXPECT_TRUE(file_utils::copyFileData(src, dst, 10));
+  close(dst);
+  close(src);
+
+  EXPECT_EQ(readWholeFile(tmpl), "0123456789");
+  unlink(tmpl);
+}
+
+TEST(TempFileTests, ReadFileDataReadsWithoutMovingOffset) {
+  int fd = file_utils::createTempFile("");
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, "0123456789", 10), 10);
+
+  std::string data;
+  EXPECT_TRUE(file_utils::readFileData(fd, 4, data));
+  EXPECT_EQ(data, "0123");
+  EXPECT_EQ(lseek(fd, 0, SEEK_CUR), 10);
+  // Asking for more than the file holds fails
+  EXPECT_FALSE(file_utils::readFileData(fd, 11, data));
+  EXPECT_TRUE(data.empty());
+  close(fd);
+}
@@ -0,0 +1,168 @@
+#include "net_utils.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/un.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include "utils.hpp"
+
+namespace net_utils {
+
+const char kUnixPrefix[] = "unix:";
+
+bool isUnixHost(const std::string& host) {
+  return host.compare(0, sizeof(kUnixPrefix) - 1, kUnixPrefix) == 0;
+}
+
+std::string unixPath(const std::string& host) {
+  if (!isUnixHost(host)) {
+    return std::string();
+  }
+  return host.substr(sizeof(kUnixPrefix) - 1);
+}
+
+bool makeSockAddr(const std::string& host, int port, sockaddr_storage& out,
+                  socklen_t& len) {
+  std::memset(&out, 0, sizeof(out));
+  if (isUnixHost(host)) {
+    std::string path = unixPath(host);
+    sockaddr_un* un = reinterpret_cast<sockaddr_un*>(&out);
+    // Needs room for the terminating NUL; abstract names are not supported
+    if (path.empty() || path.size() >= sizeof(un->sun_path) ||
+        path.find('\0') != std::string::npos) {
+      return false;
+    }
+    un->sun_family = AF_UNIX;
+    std::memcpy(un->sun_path, path.c_str(), path.size() + 1);
+    len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) +
+                                 path.size() + 1);
+    return true;
+  }
+  sockaddr_in* in4 = reinterpret_cast<sockaddr_in*>(&out);
+  if (inet_pton(AF_INET, host.c_str(), &in4->sin_addr) == 1) {
+    in4->sin_family = AF_INET;
+    in4->sin_port = htons(static_cast<unsigned short>(port));
+    len = sizeof(sockaddr_in);
+    return true;
+  }
+  sockaddr_in6* in6 = reinterpret_cast<sockaddr_in6*>(&out);
+  if (inet_pton(AF_INET6, host.c_str(), &in6->sin6_addr) == 1) {
+    in6->sin6_family = AF_INET6;
+    in6->sin6_port = htons(static_cast<unsigned short>(port));
+    len = sizeof(sockaddr_in6);
+    return true;
+  }
+  return false;
+}
+
+std::string canonicalHost(const std::string& host) {
+  sockaddr_storage addr;
+  socklen_t len;
+  if (isUnixHost(host) || !makeSockAddr(host, 0, addr, len)) {
+    return std::string();
+  }
+  return sockAddrHost(addr);
+}
+
+std::string sockAddrHost(const sockaddr_storage& addr) {
+  char buf[INET6_ADDRSTRLEN];
+  if (addr.ss_family == AF_INET) {
+    const sockaddr_in* in4 = reinterpret_cast<const sockaddr_in*>(&addr);
+    if (inet_ntop(AF_INET, &in4->sin_addr, buf, sizeof(buf)) != NULL) {
+      return buf;
+    }
+  } else if (addr.ss_family == AF_INET6) {
+    const sockaddr_in6* in6 = reinterpret_cast<const sockaddr_in6*>(&addr);
+    if (IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr)) {
+      // The last four bytes hold the IPv4 address
+      if (inet_ntop(AF_INET, &in6->sin6_addr.s6_addr[12], buf, sizeof(buf)) !=
+          NULL) {
+        return buf;
+      }
+    } else if (inet_ntop(AF_INET6, &in6->sin6_addr, buf, sizeof(buf)) !=
+               NULL) {
+      return buf;
+    }
+  } else if (addr.ss_family == AF_UNIX) {
+    return kUnixPrefix;
+  }
+  return std::string();
+}
+
+bool sameSockAddr(const sockaddr_storage& a, const sockaddr_storage& b) {
+  if (a.ss_family != b.ss_family) {
+    return false;
+  }
+  if (a.ss_family == AF_INET) {
+    const sockaddr_in* x = reinterpret_cast<const sockaddr_in*>(&a);
+    const sockaddr_in* y = reinterpret_cast<const sockaddr_in*>(&b);
+    return x->sin_port == y->sin_port &&
+           x->sin_addr.s_addr == y->sin_addr.s_addr;
+  }
+  if (a.ss_family == AF_INET6) {
+    const sockaddr_in6* x = reinterpret_cast<const sockaddr_in6*>(&a);
+    const sockaddr_in6* y = reinterpret_cast<const sockaddr_in6*>(&b);
+    return x->sin6_port == y->sin6_port &&
+           IN6_ARE_ADDR_EQUAL(&x->sin6_addr, &y->sin6_addr);
+  }
+  if (a.ss_family == AF_UNIX) {
+    const sockaddr_un* x = reinterpret_cast<const sockaddr_un*>(&a);
+    const sockaddr_un* y = reinterpret_cast<const sockaddr_un*>(&b);
+    return std::strncmp(x->sun_path, y->sun_path, sizeof(x->sun_path)) == 0;
+  }
+  return false;
+}
+
+namespace {
+
+// Strictly positive decimal, or -1
+long parsePositive(const char* s) {
+  if (s == NULL || *s < '0' || *s > '9') {
+    return -1;
+  }
+  errno = 0;
+  char* end = NULL;
+  long n = std::strtol(s, &end, 10);
+  if (errno != 0 || *end != '\0' || n <= 0) {
+    return -1;
+  }
+  return n;
+}
+
+}  // namespace
+
+std::vector<int> listenFdsFromEnv(const char* listen_pid,
+                                  const char* listen_fds, pid_t self) {
+  std::vector<int> fds;
+  long pid = parsePositive(listen_pid);
+  long count = parsePositive(listen_fds);
+  if (pid != static_cast<long>(self) || count <= 0 ||
+      count > INT_MAX - kListenFdsStart) {
+    return fds;
+  }
+  for (long i = 0; i < count; ++i) {
+    fds.push_back(kListenFdsStart + static_cast<int>(i));
+  }
+  return fds;
+}
+
+std::string formatHostPort(const std::string& host, int port) {
+  if (isUnixHost(host)) {
+    return host;
+  }
+  std::string out;
+  if (host.find(':') != std::string::npos) {
+    out = "[" + host + "]";
+  } else {
+    out = host;
+  }
+  return out + ":" + toDecimalString(port);
+}
+
+}  // namespace net_utils
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+namespace net_utils {
+
+// Listen hosts naming a Unix domain socket carry this prefix
+// ("unix:/run/webserv.sock"); their port is unused.
+extern const char kUnixPrefix[];
+
+bool isUnixHost(const std::string& host);
+
+// Socket path of a Unix host ("unix:/a.sock" -> "/a.sock")
+std::string unixPath(const std::string& host);
+
+// Fill `out` with the numeric IPv4 ("0.0.0.0") or IPv6 ("::1", no brackets)
+// address `host` and `port`, or with the socket path of a Unix host; `len`
+// receives the size of the address. Returns false if `host` is neither a
+// numeric address nor a Unix path that fits in sockaddr_un.
+bool makeSockAddr(const std::string& host, int port, sockaddr_storage& out,
+                  socklen_t& len);
+
+// Canonical text of the numeric address `host` ("0:0::1" -> "::1"), or an
+// empty string if it is not one.
+std::string canonicalHost(const std::string& host);
+
+// Numeric host of an AF_INET or AF_INET6 address, formatted with
+// inet_ntop. IPv4-mapped IPv6 peers of a dual-stack socket
+// ("::ffff:10.0.0.1") are shown as plain IPv4, AF_UNIX peers (which are
+// unnamed) as "unix:". Empty for other families.
+std::string sockAddrHost(const sockaddr_storage& addr);
+
+// True if `a` and `b` are the same IPv4, IPv6 or Unix socket address
+bool sameSockAddr(const sockaddr_storage& a, const sockaddr_storage& b);
+
+// First fd handed over by a socket-activating supervisor (systemd's
+// SD_LISTEN_FDS_START)
+const int kListenFdsStart = 3;
+
+// Listening fds passed to process `self` under the systemd
+// socket-activation protocol, given the values of LISTEN_PID and
+// LISTEN_FDS (either may be NULL): kListenFdsStart and the fds after it.
+// Empty when the variables are absent, malformed or meant for another
+// process.
+std::vector<int> listenFdsFromEnv(const char* listen_pid,
+                                  const char* listen_fds, pid_t self);
+
+// "host:port", with IPv6 hosts in brackets ("[::1]:8080"); Unix hosts are
+// returned as they are
+std::string formatHostPort(const std::string& host, int port);
+
+}  // namespace net_utils
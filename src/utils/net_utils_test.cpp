@@ -0,0 +1,135 @@
+#include "net_utils.hpp"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/un.h>
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+TEST(NetUtilsTests, MakeSockAddrIpv4) {
+  sockaddr_storage addr;
+  socklen_t len = 0;
+  ASSERT_TRUE(net_utils::makeSockAddr("127.0.0.1", 8080, addr, len));
+  EXPECT_EQ(addr.ss_family, AF_INET);
+  EXPECT_EQ(len, sizeof(sockaddr_in));
+  const sockaddr_in* in4 = reinterpret_cast<const sockaddr_in*>(&addr);
+  EXPECT_EQ(ntohs(in4->sin_port), 8080);
+  EXPECT_EQ(ntohl(in4->sin_addr.s_addr), 0x7f000001u);
+}
+
+TEST(NetUtilsTests, MakeSockAddrIpv6) {
+  sockaddr_storage addr;
+  socklen_t len = 0;
+  ASSERT_TRUE(net_utils::makeSockAddr("::", 443, addr, len));
+  EXPECT_EQ(addr.ss_family, AF_INET6);
+  EXPECT_EQ(len, sizeof(sockaddr_in6));
+  const sockaddr_in6* in6 = reinterpret_cast<const sockaddr_in6*>(&addr);
+  EXPECT_EQ(ntohs(in6->sin6_port), 443);
+  EXPECT_TRUE(IN6_IS_ADDR_UNSPECIFIED(&in6->sin6_addr));
+}
+
+TEST(NetUtilsTests, MakeSockAddrRejectsNames) {
+  sockaddr_storage addr;
+  socklen_t len = 0;
+  EXPECT_FALSE(net_utils::makeSockAddr("localhost", 80, addr, len));
+  EXPECT_FALSE(net_utils::makeSockAddr("[::1]", 80, addr, len));
+  EXPECT_FALSE(net_utils::makeSockAddr("", 80, addr, len));
+}
+
+TEST(NetUtilsTests, CanonicalHost) {
+  EXPECT_EQ(net_utils::canonicalHost("127.0.0.1"), "127.0.0.1");
+  EXPECT_EQ(net_utils::canonicalHost("0:0:0:0:0:0:0:1"), "::1");
+  EXPECT_EQ(net_utils::canonicalHost("FE80::0001"), "fe80::1");
+  EXPECT_EQ(net_utils::canonicalHost("not.an.address"), "");
+}
+
+TEST(NetUtilsTests, SockAddrHostShowsMappedIpv4AsIpv4) {
+  sockaddr_storage addr;
+  socklen_t len = 0;
+  ASSERT_TRUE(net_utils::makeSockAddr("::ffff:10.0.0.1", 0, addr, len));
+  EXPECT_EQ(net_utils::sockAddrHost(addr), "10.0.0.1");
+  ASSERT_TRUE(net_utils::makeSockAddr("2001:db8::5", 0, addr, len));
+  EXPECT_EQ(net_utils::sockAddrHost(addr), "2001:db8::5");
+
+  std::memset(&addr, 0, sizeof(addr));
+  addr.ss_family = AF_UNIX;
+  EXPECT_EQ(net_utils::sockAddrHost(addr), "unix:");
+}
+
+TEST(NetUtilsTests, FormatHostPortBracketsIpv6) {
+  EXPECT_EQ(net_utils::formatHostPort("0.0.0.0", 8080), "0.0.0.0:8080");
+  EXPECT_EQ(net_utils::formatHostPort("::1", 8080), "[::1]:8080");
+}
+
+TEST(NetUtilsTests, UnixHosts) {
+  EXPECT_TRUE(net_utils::isUnixHost("unix:/run/webserv.sock"));
+  EXPECT_FALSE(net_utils::isUnixHost("127.0.0.1"));
+  EXPECT_EQ(net_utils::unixPath("unix:/run/webserv.sock"),
+            "/run/webserv.sock");
+  EXPECT_EQ(net_utils::unixPath("::1"), "");
+  EXPECT_EQ(net_utils::formatHostPort("unix:/a.sock", 0), "unix:/a.sock");
+  // Not a numeric address
+  EXPECT_EQ(net_utils::canonicalHost("unix:/a.sock"), "");
+}
+
+TEST(NetUtilsTests, MakeSockAddrUnix) {
+  sockaddr_storage addr;
+  socklen_t len = 0;
+  ASSERT_TRUE(net_utils::makeSockAddr("unix:/tmp/w.sock", 0, addr, len));
+  EXPECT_EQ(addr.ss_family, AF_UNIX);
+  const sockaddr_un* un = reinterpret_cast<const sockaddr_un*>(&addr);
+  EXPECT_STREQ(un->sun_path, "/tmp/w.sock");
+  EXPECT_EQ(len, offsetof(sockaddr_un, sun_path) + 12);
+
+  EXPECT_FALSE(net_utils::makeSockAddr("unix:", 0, addr, len));
+  std::string too_long = "unix:/" + std::string(sizeof(un->sun_path), 'a');
+  EXPECT_FALSE(net_utils::makeSockAddr(too_long, 0, addr, len));
+}
+
+TEST(NetUtilsTests, SameSockAddr) {
+  sockaddr_storage a, b;
+  socklen_t len = 0;
+  ASSERT_TRUE(net_utils::makeSockAddr("127.0.0.1", 8080, a, len));
+  ASSERT_TRUE(net_utils::makeSockAddr("127.0.0.1", 8080, b, len));
+  EXPECT_TRUE(net_utils::sameSockAddr(a, b));
+  ASSERT_TRUE(net_utils::makeSockAddr("127.0.0.1", 8081, b, len));
+  EXPECT_FALSE(net_utils::sameSockAddr(a, b));
+  ASSERT_TRUE(net_utils::makeSockAddr("0.0.0.0", 8080, b, len));
+  EXPECT_FALSE(net_utils::sameSockAddr(a, b));
+  // Dual-stack [::] is not the IPv4 wildcard
+  ASSERT_TRUE(net_utils::makeSockAddr("::", 8080, b, len));
+  EXPECT_FALSE(net_utils::sameSockAddr(a, b));
+  ASSERT_TRUE(net_utils::makeSockAddr("::", 8080, a, len));
+  EXPECT_TRUE(net_utils::sameSockAddr(a, b));
+
+  ASSERT_TRUE(net_utils::makeSockAddr("unix:/tmp/a.sock", 0, a, len));
+  ASSERT_TRUE(net_utils::makeSockAddr("unix:/tmp/a.sock", 0, b, len));
+  EXPECT_TRUE(net_utils::sameSockAddr(a, b));
+  ASSERT_TRUE(net_utils::makeSockAddr("unix:/tmp/b.sock", 0, b, len));
+  EXPECT_FALSE(net_utils::sameSockAddr(a, b));
+}
+
+TEST(NetUtilsTests, ListenFdsFromEnv) {
+  std::vector<int> fds = net_utils::listenFdsFromEnv("42", "2", 42);
+  ASSERT_EQ(fds.size(), 2u);
+  EXPECT_EQ(fds[0], net_utils::kListenFdsStart);
+  EXPECT_EQ(fds[1], net_utils::kListenFdsStart + 1);
+}
+
+TEST(NetUtilsTests, ListenFdsFromEnvIgnoresOtherProcessesAndGarbage) {
+  // Meant for another process (e.g. inherited through a shell)
+  EXPECT_TRUE(net_utils::listenFdsFromEnv("41", "2", 42).empty());
+  EXPECT_TRUE(net_utils::listenFdsFromEnv(NULL, "2", 42).empty());
+  EXPECT_TRUE(net_utils::listenFdsFromEnv("42", NULL, 42).empty());
+  EXPECT_TRUE(net_utils::listenFdsFromEnv("42", "0", 42).empty());
+  EXPECT_TRUE(net_utils::listenFdsFromEnv("42", "-1", 42).empty());
+  EXPECT_TRUE(net_utils::listenFdsFromEnv("42", "2x", 42).empty());
+  EXPECT_TRUE(net_utils::listenFdsFromEnv("42x", "2", 42).empty());
+  EXPECT_TRUE(net_utils::listenFdsFromEnv(" 42", "2", 42).empty());
+  EXPECT_TRUE(
+      net_utils::listenFdsFromEnv("42", "99999999999999999999", 42).empty());
+}
@@ -1,6 +1,7 @@
 #include "utils.hpp"
 
 #include <fcntl.h>
+#include <time.h>
 
 #include <cerrno>
 #include <cstdlib>
@@ -8,6 +9,7 @@
 #include <stdexcept>
 #include <string>
 
+#include "ByteBuilder.hpp"
 #include "Logger.hpp"
 #include "constants.hpp"
 
@@ -115,3 +117,15 @@ bool safeStrtoll(const std::string& s, long long& out) {
   out = num;
   return true;
 }
+
+std::string toDecimalString(long long n) {
+  std::string out;
+  ByteBuilder(out).appendNumber(n);
+  return out;
+}
+
+long long monotonicMillis() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<long long>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
@@ -25,6 +25,13 @@ int parseLogLevelFlag(const std::string& arg);
 // failure (empty string, invalid characters, or out of range).
 bool safeStrtoll(const std::string& s, long long& out);
 
+// Format an integer as a decimal string without going through iostreams.
+std::string toDecimalString(long long n);
+
+// Milliseconds on the monotonic clock, for timers that must not jump with
+// the wall clock
+long long monotonicMillis();
+
 // Parse program arguments and fill `path` and `logLevel`.
 // This was moved out of main to keep main shorter and clearer.
 void processArgs(int argc, char** argv, std::string& path, int& logLevel);
@@ -118,3 +118,17 @@ TEST(SafeStrtollTests, HandlesLeadingSpaces) {
   EXPECT_TRUE(safeStrtoll(" 123", result));
   EXPECT_EQ(result, 123);
 }
+
+TEST(ToDecimalStringTests, FormatsSignedValues) {
+  EXPECT_EQ(toDecimalString(0), "0");
+  EXPECT_EQ(toDecimalString(1234567890123LL), "1234567890123");
+  EXPECT_EQ(toDecimalString(-15), "-15");
+}
+
+TEST(MonotonicMillisTests, NeverGoesBackwards) {
+  long long a = monotonicMillis();
+  usleep(2000);
+  long long b = monotonicMillis();
+  EXPECT_GT(a, 0);
+  EXPECT_GE(b - a, 2);
+}
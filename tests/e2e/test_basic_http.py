@@ -6,9 +6,15 @@ These tests start the webserv server and make real HTTP requests to verify
 that the server is working correctly.
 """
 
+import gzip
+import http.client
 import os
+import socket
+import stat
 import sys
+import time
 import unittest
+import zlib
 
 from webserv_test_base import WebservTestCase
 
@@ -54,6 +60,80 @@ class TestBasicHTTP(WebservTestCase):
         self.assertIsNotNone(content_length)
         self.assertGreater(int(content_length), 0)
 
+    def test_large_request_headers(self):
+        """Test that a head over client_header_buffer_size is served."""
+        headers = {"Authorization": "Bearer " + "t" * 6000}
+        response, body = self.make_request("GET", "/", headers=headers)
+        self.assertEqual(response.status, 200)
+
+    def test_slow_large_heads_do_not_starve_others(self):
+        """Test that clients holding large partial heads open do not make
+        other large heads fail (large_client_header_buffers is 4)."""
+        partial = (b"GET / HTTP/1.1\r\nHost: localhost\r\n"
+                   b"Authorization: Bearer " + b"t" * 6000 + b"\r\n")
+        slow = []
+        try:
+            for _ in range(5):
+                sock = socket.create_connection(
+                    (self.server_host, self.server_port), timeout=5)
+                slow.append(sock)
+                sock.sendall(partial)
+            time.sleep(0.2)
+            headers = {"Authorization": "Bearer " + "t" * 6000}
+            response, body = self.make_request("GET", "/", headers=headers)
+            self.assertEqual(response.status, 200)
+
+            # The slow clients are still served once their heads complete
+            slow[0].sendall(b"\r\n")
+            self.assertTrue(slow[0].recv(4096).startswith(b"HTTP/1.1 200"))
+        finally:
+            for sock in slow:
+                sock.close()
+
+
+class TestLocationModifiers(WebservTestCase):
+    """Test exact and regex location matching."""
+
+    config_file = "default.conf"
+
+    def test_exact_location_matches_whole_path_only(self):
+        """Test that "location = /home" matches /home but not below it."""
+        response, body = self.make_request("GET", "/home")
+        self.assertEqual(response.status, 301)
+        self.assertEqual(response.getheader("Location"), "/index.html")
+        response, body = self.make_request("GET", "/home/index.html")
+        self.assertEqual(response.status, 404)
+
+    def test_regex_location_overrides_prefix(self):
+        """Test that a case-insensitive regex location applies by suffix."""
+        response, body = self.make_request("GET", "/test.txt.BAK")
+        self.assertEqual(response.status, 405)
+        response, body = self.make_request("GET", "/test.txt")
+        self.assertEqual(response.status, 200)
+
+
+class TestVirtualHosts(WebservTestCase):
+    """Test server_name selection between servers sharing a port."""
+
+    config_file = "default.conf"
+
+    def test_host_header_selects_named_server(self):
+        """Test that a matching Host is served from that server's root."""
+        for host in ("mime.localhost", "MIME.localhost:8080",
+                     "www.mime.localhost"):
+            response, body = self.make_request(
+                "GET", "/sample.csv", headers={"Host": host})
+            self.assertEqual(response.status, 200, host)
+
+    def test_unknown_host_uses_default_server(self):
+        """Test that an unmatched Host falls back to the first server."""
+        response, body = self.make_request(
+            "GET", "/sample.csv", headers={"Host": "other.localhost"})
+        self.assertEqual(response.status, 404)
+        response, body = self.make_request(
+            "GET", "/test.txt", headers={"Host": "other.localhost"})
+        self.assertEqual(response.status, 200)
+
 
 class TestAutoindex(WebservTestCase):
     """Test directory autoindex functionality."""
@@ -69,6 +149,652 @@ class TestAutoindex(WebservTestCase):
         self.assertIn(b"index", body.lower())
 
 
+class TestStaticCache(WebservTestCase):
+    """Test the in-memory static cache (cache_max_size in default.conf)."""
+
+    config_file = "default.conf"
+
+    def setUp(self):
+        # One file per test: a path found missing stays missing for
+        # open_file_cache_valid when created behind the server's back
+        self.file_name = "static-cache-%s.txt" % self._testMethodName
+        project_root = os.path.join(os.path.dirname(__file__), "..", "..")
+        self.file_path = os.path.join(project_root, "www", self.file_name)
+        self.write_file(b"first version\n")
+
+    def tearDown(self):
+        if os.path.exists(self.file_path):
+            os.unlink(self.file_path)
+
+    def write_file(self, data):
+        with open(self.file_path, "wb") as f:
+            f.write(data)
+
+    def test_changes_on_disk_are_served(self):
+        """A cached file edited in place or replaced is served fresh."""
+        for _ in range(2):
+            response, body = self.make_request("GET", "/" + self.file_name)
+            self.assertEqual(response.status, 200)
+            self.assertEqual(body, b"first version\n")
+            self.assertIn("text/plain", response.getheader("Content-Type"))
+
+        self.write_file(b"second, longer version\n")
+        response, body = self.make_request("GET", "/" + self.file_name)
+        self.assertEqual(body, b"second, longer version\n")
+        self.assertEqual(response.getheader("Content-Length"), "23")
+
+        tmp = self.file_path + ".new"
+        with open(tmp, "wb") as f:
+            f.write(b"third\n")
+        os.rename(tmp, self.file_path)
+        response, body = self.make_request("GET", "/" + self.file_name)
+        self.assertEqual(body, b"third\n")
+
+        os.unlink(self.file_path)
+        response, body = self.make_request("GET", "/" + self.file_name)
+        self.assertEqual(response.status, 404)
+
+    def test_ranges_bypass_the_cache(self):
+        """A Range request on a cached file still gets a 206."""
+        self.make_request("GET", "/" + self.file_name)
+        response, body = self.make_request(
+            "GET", "/" + self.file_name, headers={"Range": "bytes=0-4"})
+        self.assertEqual(response.status, 206)
+        self.assertEqual(body, b"first")
+
+
+class TestConditionalGet(WebservTestCase):
+    """Test ETag, Last-Modified and the conditional request headers."""
+
+    config_file = "default.conf"
+
+    def validators(self):
+        response, _ = self.make_request("GET", "/index.html")
+        self.assertEqual(response.status, 200)
+        etag = response.getheader("ETag")
+        last_modified = response.getheader("Last-Modified")
+        self.assertTrue(etag.startswith('W/"'))
+        self.assertTrue(last_modified.endswith(" GMT"))
+        return etag, last_modified
+
+    def test_if_none_match_gives_304(self):
+        """A matching If-None-Match is answered with 304 and no body."""
+        etag, last_modified = self.validators()
+        for method in ("GET", "HEAD"):
+            response, body = self.make_request(
+                method, "/index.html", headers={"If-None-Match": etag})
+            self.assertEqual(response.status, 304)
+            self.assertEqual(body, b"")
+            self.assertEqual(response.getheader("ETag"), etag)
+            self.assertEqual(response.getheader("Last-Modified"),
+                             last_modified)
+
+    def test_if_modified_since(self):
+        """If-Modified-Since is used only without If-None-Match."""
+        _, last_modified = self.validators()
+        response, _ = self.make_request(
+            "GET", "/index.html",
+            headers={"If-Modified-Since": last_modified})
+        self.assertEqual(response.status, 304)
+
+        response, body = self.make_request(
+            "GET", "/index.html",
+            headers={"If-None-Match": '"other"',
+                     "If-Modified-Since": last_modified})
+        self.assertEqual(response.status, 200)
+        self.assertTrue(len(body) > 0)
+
+        response, _ = self.make_request(
+            "GET", "/index.html",
+            headers={"If-Modified-Since": "Thu, 01 Jan 1970 00:00:00 GMT"})
+        self.assertEqual(response.status, 200)
+
+    def test_if_range(self):
+        """A Range is served only while If-Range matches the file."""
+        etag, last_modified = self.validators()
+        response, body = self.make_request(
+            "GET", "/index.html",
+            headers={"Range": "bytes=0-3", "If-Range": last_modified})
+        self.assertEqual(response.status, 206)
+        self.assertEqual(len(body), 4)
+
+        # Weak entity tags never satisfy If-Range
+        response, body = self.make_request(
+            "GET", "/index.html",
+            headers={"Range": "bytes=0-3", "If-Range": etag})
+        self.assertEqual(response.status, 200)
+        self.assertTrue(len(body) > 4)
+
+
+class TestMultiRange(WebservTestCase):
+    """Test Range headers listing several ranges (multipart/byteranges)."""
+
+    config_file = "default.conf"
+
+    def setUp(self):
+        self.file_name = "multi-range-%s.txt" % self._testMethodName
+        project_root = os.path.join(os.path.dirname(__file__), "..", "..")
+        self.file_path = os.path.join(project_root, "www", self.file_name)
+        self.data = b"".join(b"%02d" % i for i in range(60))
+        with open(self.file_path, "wb") as f:
+            f.write(self.data)
+
+    def tearDown(self):
+        if os.path.exists(self.file_path):
+            os.unlink(self.file_path)
+
+    def get(self, method, range_header):
+        return self.make_request(method, "/" + self.file_name,
+                                 headers={"Range": range_header})
+
+    def parse_parts(self, response, body):
+        content_type = response.getheader("Content-Type")
+        prefix = "multipart/byteranges; boundary="
+        self.assertTrue(content_type.startswith(prefix))
+        delimiter = b"--" + content_type[len(prefix):].encode()
+        self.assertTrue(body.endswith(b"\r\n" + delimiter + b"--\r\n"))
+        parts = []
+        for chunk in body.split(delimiter)[1:-1]:
+            head, data = chunk.split(b"\r\n\r\n", 1)
+            if data.endswith(b"\r\n"):
+                data = data[:-2]
+            fields = dict(line.split(b": ", 1)
+                          for line in head.strip().split(b"\r\n"))
+            parts.append((fields[b"Content-Range"], data))
+        return parts
+
+    def test_disjoint_ranges_are_multipart(self):
+        """Each range is sent as its own part, in file order."""
+        response, body = self.get("GET", "bytes=100-109, 0-9,-5")
+        self.assertEqual(response.status, 206)
+        self.assertEqual(int(response.getheader("Content-Length")), len(body))
+        self.assertIsNone(response.getheader("Content-Range"))
+        size = len(self.data)
+        expected = [(0, 9), (100, 109), (size - 5, size - 1)]
+        parts = self.parse_parts(response, body)
+        self.assertEqual(len(parts), len(expected))
+        for (content_range, data), (start, end) in zip(parts, expected):
+            self.assertEqual(content_range,
+                             b"bytes %d-%d/%d" % (start, end, size))
+            self.assertEqual(data, self.data[start:end + 1])
+
+        response, head_body = self.get("HEAD", "bytes=100-109, 0-9,-5")
+        self.assertEqual(response.status, 206)
+        self.assertEqual(head_body, b"")
+        self.assertEqual(int(response.getheader("Content-Length")), len(body))
+
+    def test_overlapping_ranges_are_merged(self):
+        """Ranges that overlap or touch become one ordinary 206."""
+        response, body = self.get("GET", "bytes=10-19,0-9,15-29")
+        self.assertEqual(response.status, 206)
+        self.assertEqual(response.getheader("Content-Range"),
+                         "bytes 0-29/%d" % len(self.data))
+        self.assertEqual(body, self.data[:30])
+
+    def test_unsatisfiable_ranges(self):
+        """Unsatisfiable specs are dropped; with none left it is a 416."""
+        response, body = self.get("GET", "bytes=5000-6000,2-3")
+        self.assertEqual(response.status, 206)
+        self.assertEqual(body, self.data[2:4])
+
+        response, _ = self.get("GET", "bytes=5000-6000,7000-")
+        self.assertEqual(response.status, 416)
+
+    def test_too_many_ranges_send_the_whole_file(self):
+        """A Range header with too many specs is ignored."""
+        specs = ",".join("%d-%d" % (i * 4, i * 4) for i in range(17))
+        response, body = self.get("GET", "bytes=" + specs)
+        self.assertEqual(response.status, 200)
+        self.assertEqual(body, self.data)
+
+
+class TestFairWrites(WebservTestCase):
+    """A large download must not hold up the other connections."""
+
+    config_file = "default.conf"
+    large_size = 64 * 1024 * 1024
+
+    def setUp(self):
+        project_root = os.path.join(os.path.dirname(__file__), "..", "..")
+        self.file_path = os.path.join(project_root, "www",
+                                      "fair-write-large.bin")
+        with open(self.file_path, "wb") as f:
+            f.truncate(self.large_size)
+
+    def tearDown(self):
+        if os.path.exists(self.file_path):
+            os.unlink(self.file_path)
+
+    def test_stalled_download_does_not_block_others(self):
+        """A client that stops reading only waits for its own socket."""
+        sock = socket.create_connection((self.server_host, self.server_port),
+                                        timeout=10)
+        try:
+            sock.sendall(b"GET /fair-write-large.bin HTTP/1.1\r\n"
+                         b"Host: localhost\r\n\r\n")
+            first = sock.recv(4096)
+            self.assertTrue(first.startswith(b"HTTP/1.1 200"))
+
+            # The download is stuck on a full socket buffer meanwhile
+            conn = http.client.HTTPConnection(self.server_host,
+                                              self.server_port, timeout=5)
+            try:
+                conn.request("GET", "/index.html")
+                response = conn.getresponse()
+                self.assertEqual(response.status, 200)
+                self.assertTrue(len(response.read()) > 0)
+            finally:
+                conn.close()
+
+            received = len(first)
+            while True:
+                data = sock.recv(1024 * 1024)
+                if not data:
+                    break
+                received += len(data)
+            head_len = first.index(b"\r\n\r\n") + 4
+            self.assertEqual(received - head_len, self.large_size)
+        finally:
+            sock.close()
+
+    def test_half_closed_client_gets_whole_body(self):
+        """A client that shuts down its sending side still gets the file."""
+        sock = socket.create_connection((self.server_host, self.server_port),
+                                        timeout=10)
+        try:
+            sock.sendall(b"GET /fair-write-large.bin HTTP/1.1\r\n"
+                         b"Host: localhost\r\n\r\n")
+            sock.shutdown(socket.SHUT_WR)
+            data = b""
+            while b"\r\n\r\n" not in data:
+                chunk = sock.recv(4096)
+                self.assertTrue(chunk)
+                data += chunk
+            self.assertTrue(data.startswith(b"HTTP/1.1 200"))
+            received = len(data) - (data.index(b"\r\n\r\n") + 4)
+            while True:
+                chunk = sock.recv(1024 * 1024)
+                if not chunk:
+                    break
+                received += len(chunk)
+            self.assertEqual(received, self.large_size)
+        finally:
+            sock.close()
+
+
+class TestLimitRate(WebservTestCase):
+    """Test limit_rate (location /limited/ in default.conf: 128 KB/s after
+    the first 64 KB)."""
+
+    config_file = "default.conf"
+    rate = 128 * 1024
+    rate_after = 64 * 1024
+
+    def setUp(self):
+        project_root = os.path.join(os.path.dirname(__file__), "..", "..")
+        self.dir_path = os.path.join(project_root, "www", "limited")
+        os.makedirs(self.dir_path, exist_ok=True)
+        self.file_name = "limited-%s.bin" % self._testMethodName
+        self.file_path = os.path.join(self.dir_path, self.file_name)
+        self.data = os.urandom(self.rate_after + 2 * self.rate)
+        with open(self.file_path, "wb") as f:
+            f.write(self.data)
+
+    def tearDown(self):
+        if os.path.exists(self.file_path):
+            os.unlink(self.file_path)
+        if os.path.isdir(self.dir_path) and not os.listdir(self.dir_path):
+            os.rmdir(self.dir_path)
+
+    def timed_get(self, path, headers=None):
+        start = time.monotonic()
+        response, body = self.make_request("GET", path, headers=headers)
+        return response, body, time.monotonic() - start
+
+    def test_download_is_throttled(self):
+        """Past limit_rate_after the body goes out at about limit_rate."""
+        response, body, elapsed = self.timed_get("/limited/" + self.file_name)
+        self.assertEqual(response.status, 200)
+        self.assertEqual(body, self.data)
+        # Two seconds' worth past limit_rate_after, the first slice free
+        self.assertGreater(elapsed, 1.0)
+        self.assertLess(elapsed, 6.0)
+
+    def test_rate_after_bytes_are_not_throttled(self):
+        """The first limit_rate_after bytes go out at full speed."""
+        response, body, elapsed = self.timed_get(
+            "/limited/" + self.file_name,
+            headers={"Range": "bytes=0-%d" % (self.rate_after - 1)})
+        self.assertEqual(response.status, 206)
+        self.assertEqual(body, self.data[:self.rate_after])
+        self.assertLess(elapsed, 0.5)
+
+    def test_paused_download_does_not_hold_up_others(self):
+        """A throttled connection waits on a timer, not in the event loop."""
+        sock = socket.create_connection((self.server_host, self.server_port),
+                                        timeout=10)
+        try:
+            sock.sendall(b"GET /limited/" + self.file_name.encode() +
+                         b" HTTP/1.1\r\nHost: localhost\r\n\r\n")
+            received = sock.recv(65536)
+            self.assertTrue(received.startswith(b"HTTP/1.1 200"))
+
+            response, body, elapsed = self.timed_get("/index.html")
+            self.assertEqual(response.status, 200)
+            self.assertLess(elapsed, 0.5)
+
+            while True:
+                data = sock.recv(65536)
+                if not data:
+                    break
+                received += data
+            head_len = received.index(b"\r\n\r\n") + 4
+            self.assertEqual(received[head_len:], self.data)
+        finally:
+            sock.close()
+
+
+class TestCachePolicy(WebservTestCase):
+    """Test expires and add_header (location /image/ in default.conf)."""
+
+    config_file = "default.conf"
+
+    def assert_policy(self, response):
+        self.assertEqual(response.getheader("Cache-Control"), "max-age=604800")
+        self.assertEqual(response.getheader("X-Content-Type-Options"),
+                         "nosniff")
+
+    def test_static_files_and_304s_carry_the_policy(self):
+        """Files, their 304s and listings get the location's headers."""
+        response, _ = self.make_request("GET", "/image/bird.png")
+        self.assertEqual(response.status, 200)
+        self.assert_policy(response)
+
+        response, _ = self.make_request(
+            "GET", "/image/bird.png",
+            headers={"If-None-Match": response.getheader("ETag")})
+        self.assertEqual(response.status, 304)
+        self.assert_policy(response)
+
+        response, _ = self.make_request("GET", "/image/")
+        self.assertEqual(response.status, 200)
+        self.assert_policy(response)
+
+    def test_other_locations_and_errors_do_not(self):
+        """Only successful responses of that location are affected."""
+        response, _ = self.make_request("GET", "/index.html")
+        self.assertIsNone(response.getheader("Cache-Control"))
+        response, _ = self.make_request("GET", "/image/missing.png")
+        self.assertEqual(response.status, 404)
+        self.assertIsNone(response.getheader("Cache-Control"))
+
+
+class TestGzipStatic(WebservTestCase):
+    """Test precompressed siblings (gzip_static on /css/ in default.conf)."""
+
+    config_file = "default.conf"
+
+    def setUp(self):
+        project_root = os.path.join(os.path.dirname(__file__), "..", "..")
+        self.name = "gzip-static-%s.css" % self._testMethodName
+        self.path = os.path.join(project_root, "www", "css", self.name)
+        self.original = b"body { color: red; }\n" * 20
+        self.created = []
+        self.write(self.path, self.original)
+        self.encoded = gzip.compress(self.original)
+        self.write(self.path + ".gz", self.encoded)
+
+    def tearDown(self):
+        for path in self.created:
+            if os.path.exists(path):
+                os.unlink(path)
+
+    def write(self, path, data):
+        with open(path, "wb") as f:
+            f.write(data)
+        self.created.append(path)
+
+    def get(self, accept_encoding=None, extra=None):
+        headers = dict(extra or {})
+        if accept_encoding is not None:
+            headers["Accept-Encoding"] = accept_encoding
+        return self.make_request("GET", "/css/" + self.name, headers=headers)
+
+    def test_gzip_variant_is_negotiated(self):
+        """The .gz sibling is sent only to clients accepting gzip."""
+        response, body = self.get("gzip, deflate")
+        self.assertEqual(response.status, 200)
+        self.assertEqual(response.getheader("Content-Encoding"), "gzip")
+        self.assertEqual(response.getheader("Vary"), "Accept-Encoding")
+        self.assertIn("text/css", response.getheader("Content-Type"))
+        self.assertEqual(gzip.decompress(body), self.original)
+
+        for accept in (None, "identity", "gzip;q=0"):
+            response, body = self.get(accept)
+            self.assertIsNone(response.getheader("Content-Encoding"))
+            self.assertEqual(response.getheader("Vary"), "Accept-Encoding")
+            self.assertEqual(body, self.original)
+
+    def test_brotli_is_preferred(self):
+        """A .br sibling wins over .gz when both are accepted."""
+        self.write(self.path + ".br", b"not really brotli")
+        response, body = self.get("gzip, br")
+        self.assertEqual(response.getheader("Content-Encoding"), "br")
+        self.assertEqual(body, b"not really brotli")
+        response, body = self.get("gzip")
+        self.assertEqual(response.getheader("Content-Encoding"), "gzip")
+
+    def test_ranges_apply_to_the_variant(self):
+        """Range requests address the bytes of the encoded file."""
+        response, body = self.get("gzip", {"Range": "bytes=0-9"})
+        self.assertEqual(response.status, 206)
+        self.assertEqual(response.getheader("Content-Encoding"), "gzip")
+        self.assertEqual(response.getheader("Content-Range"),
+                         "bytes 0-9/%d" % len(self.encoded))
+        self.assertEqual(body, self.encoded[:10])
+
+
+class TestGzip(WebservTestCase):
+    """Test on-the-fly compression (gzip in default.conf)."""
+
+    config_file = "default.conf"
+
+    def setUp(self):
+        project_root = os.path.join(os.path.dirname(__file__), "..", "..")
+        self.name = "gzip-%s.txt" % self._testMethodName
+        self.path = os.path.join(project_root, "www", self.name)
+        self.original = b"compress me, compress me again\n" * 50
+        with open(self.path, "wb") as f:
+            f.write(self.original)
+
+    def tearDown(self):
+        if os.path.exists(self.path):
+            os.unlink(self.path)
+
+    def get(self, path, accept_encoding=None, extra=None):
+        headers = dict(extra or {})
+        if accept_encoding is not None:
+            headers["Accept-Encoding"] = accept_encoding
+        return self.make_request("GET", path, headers=headers)
+
+    def test_static_file_is_compressed(self):
+        """A listed type is gzipped, repeatedly, for clients accepting it."""
+        for _ in range(2):
+            response, body = self.get("/" + self.name, "gzip, deflate")
+            self.assertEqual(response.status, 200)
+            self.assertEqual(response.getheader("Content-Encoding"), "gzip")
+            self.assertEqual(response.getheader("Vary"), "Accept-Encoding")
+            self.assertEqual(int(response.getheader("Content-Length")),
+                             len(body))
+            self.assertIsNotNone(response.getheader("ETag"))
+            self.assertEqual(gzip.decompress(body), self.original)
+            self.assertLess(len(body), len(self.original))
+
+    def test_deflate_when_gzip_is_not_accepted(self):
+        """deflate is used when it is the only coding accepted."""
+        response, body = self.get("/" + self.name, "deflate")
+        self.assertEqual(response.getheader("Content-Encoding"), "deflate")
+        self.assertEqual(zlib.decompress(body), self.original)
+
+    def test_identity_without_accept_encoding(self):
+        """Clients not asking for compression get the file as is."""
+        for accept in (None, "identity", "br", "gzip;q=0"):
+            response, body = self.get("/" + self.name, accept)
+            self.assertIsNone(response.getheader("Content-Encoding"))
+            self.assertEqual(response.getheader("Vary"), "Accept-Encoding")
+            self.assertEqual(body, self.original)
+
+    def test_ranges_and_head_are_not_compressed(self):
+        """Range requests address the file itself; HEAD is left alone."""
+        response, body = self.get("/" + self.name, "gzip",
+                                  {"Range": "bytes=0-7"})
+        self.assertEqual(response.status, 206)
+        self.assertIsNone(response.getheader("Content-Encoding"))
+        self.assertEqual(body, self.original[:8])
+
+        response, body = self.make_request(
+            "HEAD", "/" + self.name, headers={"Accept-Encoding": "gzip"})
+        self.assertIsNone(response.getheader("Content-Encoding"))
+        self.assertEqual(response.getheader("Content-Length"),
+                         str(len(self.original)))
+
+    def test_conditional_and_range_responses_vary(self):
+        """A 304 or 206 carries the Vary of the 200 it stands for."""
+        response, _ = self.get("/" + self.name, "gzip")
+        etag = response.getheader("ETag")
+        self.assertIsNotNone(etag)
+
+        response, body = self.get("/" + self.name, None,
+                                  {"If-None-Match": etag})
+        self.assertEqual(response.status, 304)
+        self.assertEqual(body, b"")
+        self.assertEqual(response.getheader("Vary"), "Accept-Encoding")
+
+        for ranges in ("bytes=0-7", "bytes=0-3,8-11"):
+            response, _ = self.get("/" + self.name, "gzip", {"Range": ranges})
+            self.assertEqual(response.status, 206)
+            self.assertEqual(response.getheader("Vary"), "Accept-Encoding")
+
+    def test_body_over_max_length_is_not_compressed(self):
+        """Bodies over gzip_max_length (1 MB by default) are sent as is."""
+        self.original = b"x" * (1048576 + 1)
+        with open(self.path, "wb") as f:
+            f.write(self.original)
+        response, body = self.get("/" + self.name, "gzip")
+        self.assertEqual(response.status, 200)
+        self.assertIsNone(response.getheader("Content-Encoding"))
+        self.assertIsNone(response.getheader("Vary"))
+        self.assertEqual(body, self.original)
+
+    def test_unlisted_type_is_not_compressed(self):
+        """Types not in gzip_types are sent as is."""
+        response, body = self.get("/favicon.ico", "gzip")
+        self.assertEqual(response.status, 200)
+        self.assertIsNone(response.getheader("Content-Encoding"))
+        self.assertIsNone(response.getheader("Vary"))
+
+    def test_listing_and_error_page_are_compressed(self):
+        """Generated HTML and error pages are compressed too."""
+        response, body = self.get("/uploads/", "gzip")
+        self.assertEqual(response.status, 200)
+        self.assertEqual(response.getheader("Content-Encoding"), "gzip")
+        self.assertIn(b"<html", gzip.decompress(body).lower())
+
+        response, body = self.get("/no-such-%s.html" % self.name, "gzip")
+        self.assertEqual(response.status, 404)
+        self.assertEqual(response.getheader("Content-Encoding"), "gzip")
+        self.assertIn(b"404", gzip.decompress(body))
+
+
+class TestIpv6Listen(WebservTestCase):
+    """Test IPv6 and dual-stack listeners."""
+
+    config_file = "ipv6.conf"
+
+    def get_response(self, host, port):
+        conn = http.client.HTTPConnection(host, port, timeout=5)
+        try:
+            conn.request("GET", "/index.html")
+            response = conn.getresponse()
+            response.read()
+            return response
+        finally:
+            conn.close()
+
+    def get_status(self, host, port):
+        return self.get_response(host, port).status
+
+    def test_dual_stack_accepts_both_families(self):
+        """A [::] listener answers over IPv6 and IPv4."""
+        self.assertEqual(self.get_status("::1", 8080), 200)
+        self.assertEqual(self.get_status("127.0.0.1", 8080), 200)
+
+    def test_ipv6_loopback_listener(self):
+        """A [::1] listener answers over IPv6 only."""
+        self.assertEqual(self.get_status("::1", 8082), 200)
+        with self.assertRaises(OSError):
+            self.get_status("127.0.0.1", 8082)
+
+    def test_ipv4_and_ipv6_wildcards_share_a_port(self):
+        """"listen 8083;" and "listen [::]:8083;" are separate servers."""
+        response = self.get_response("127.0.0.1", 8083)
+        self.assertEqual(response.status, 200)
+        self.assertEqual(response.getheader("X-Listener"), "ipv4")
+        response = self.get_response("::1", 8083)
+        self.assertEqual(response.status, 200)
+        self.assertEqual(response.getheader("X-Listener"), "ipv6")
+
+
+class TestUnixSocketListen(WebservTestCase):
+    """Test Unix domain socket listeners."""
+
+    config_file = "unix.conf"
+    socket_path = "/tmp/webserv-e2e.sock"
+
+    @classmethod
+    def setUpClass(cls):
+        # Leave a stale socket file behind, as a crashed server would
+        if os.path.exists(cls.socket_path):
+            os.unlink(cls.socket_path)
+        stale = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        stale.bind(cls.socket_path)
+        stale.close()
+        super().setUpClass()
+
+    def unix_get(self, path):
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.settimeout(5)
+        try:
+            sock.connect(self.socket_path)
+            sock.sendall(("GET %s HTTP/1.1\r\nHost: localhost\r\n"
+                          "\r\n" % path).encode())
+            data = b""
+            while True:
+                chunk = sock.recv(4096)
+                if not chunk:
+                    break
+                data += chunk
+            return data
+        finally:
+            sock.close()
+
+    def test_serves_over_unix_socket(self):
+        """The stale file is replaced and requests are answered."""
+        data = self.unix_get("/index.html")
+        self.assertTrue(data.startswith(b"HTTP/1.1 200"), data[:80])
+
+    def test_socket_is_world_accessible(self):
+        """The socket file is created with mode 0666."""
+        mode = os.stat(self.socket_path).st_mode
+        self.assertTrue(stat.S_ISSOCK(mode))
+        self.assertEqual(stat.S_IMODE(mode), 0o666)
+
+    def test_tcp_listener_still_works(self):
+        """TCP and Unix listeners coexist."""
+        response, _ = self.make_request("GET", "/index.html")
+        self.assertEqual(response.status, 200)
+
+
 if __name__ == "__main__":
     # Check if webserv is built (try both locations)
     webserv_path = os.path.join(
@@ -5,7 +5,9 @@ CGI end-to-end tests for the webserv HTTP server.
 These tests verify CGI script execution functionality.
 """
 
+import gzip
 import os
+import socket
 import sys
 import unittest
 
@@ -31,6 +33,22 @@ class TestCGI(WebservTestCase):
         # Simple script should output content
         self.assertGreater(len(body), 0)
 
+    def test_only_whole_200_cgi_bodies_are_compressed(self):
+        """A CGI 200 is compressed; a 206 or 404 passes through as is."""
+        headers = {"Accept-Encoding": "gzip"}
+        response, body = self.make_request(
+            "GET", "/cgi-bin/gzip_status.sh", headers=headers)
+        self.assertEqual(response.status, 200)
+        self.assertEqual(response.getheader("Content-Encoding"), "gzip")
+        self.assertEqual(gzip.decompress(body), b"x" * 1500)
+
+        for status in (206, 404):
+            response, body = self.make_request(
+                "GET", "/cgi-bin/gzip_status.sh?%d" % status, headers=headers)
+            self.assertEqual(response.status, status)
+            self.assertIsNone(response.getheader("Content-Encoding"))
+            self.assertEqual(body, b"x" * 1500)
+
     def test_cgi_post_request(self):
         """Test POST request to CGI script."""
         post_data = "test=value&foo=bar"
@@ -43,6 +61,90 @@ class TestCGI(WebservTestCase):
         )
         self.assertEqual(response.status, 200)
 
+    def test_cgi_chunked_post_request(self):
+        """Test that a chunked POST body reaches the CGI script decoded."""
+        # An iterable body without Content-Length makes http.client send
+        # Transfer-Encoding: chunked, one chunk per item.
+        chunks = iter([b"test=", b"value&", b"foo=bar"])
+        headers = {"Content-Type": "application/x-www-form-urlencoded"}
+        response, body = self.make_request(
+            "POST", "/cgi-bin/test.sh", headers=headers, body=chunks
+        )
+        self.assertEqual(response.status, 200)
+        self.assertIn(b"test=value&foo=bar", body)
+
+    def test_cgi_chunked_post_over_limit(self):
+        """Test that a chunked body over max_request_body is rejected."""
+        chunks = iter([b"x" * 4000, b"x" * 4000])
+        response, _ = self.make_request(
+            "POST", "/cgi-bin/test.sh", body=chunks
+        )
+        self.assertEqual(response.status, 413)
+
+    def _send_expect_head(self, content_length):
+        sock = socket.create_connection(
+            (self.server_host, self.server_port), timeout=5
+        )
+        sock.sendall(
+            b"POST /cgi-bin/test.sh HTTP/1.1\r\n"
+            b"Host: localhost\r\n"
+            b"Connection: close\r\n"
+            b"Expect: 100-continue\r\n"
+            b"Content-Length: %d\r\n\r\n" % content_length
+        )
+        return sock
+
+    def test_cgi_expect_continue(self):
+        """Test that the body is only sent after a 100 Continue."""
+        post_data = b"test=value&foo=bar"
+        sock = self._send_expect_head(len(post_data))
+        try:
+            interim = sock.recv(4096)
+            self.assertEqual(interim, b"HTTP/1.1 100 Continue\r\n\r\n")
+            sock.sendall(post_data)
+            response = b""
+            while True:
+                data = sock.recv(4096)
+                if not data:
+                    break
+                response += data
+        finally:
+            sock.close()
+        self.assertTrue(response.startswith(b"HTTP/1.1 200"))
+        self.assertIn(post_data, response)
+
+    def test_cgi_expect_continue_over_limit(self):
+        """Test that an oversized upload is refused before its body."""
+        sock = self._send_expect_head(1024 * 1024)
+        try:
+            response = sock.recv(4096)
+        finally:
+            sock.close()
+        self.assertTrue(response.startswith(b"HTTP/1.1 413"))
+
+    def test_rejected_body_does_not_reset_response(self):
+        """Test that a 413 survives a client that keeps sending its body."""
+        body = b"x" * (512 * 1024)
+        sock = socket.create_connection(
+            (self.server_host, self.server_port), timeout=10
+        )
+        try:
+            sock.sendall(
+                b"POST /cgi-bin/test.sh HTTP/1.1\r\n"
+                b"Host: localhost\r\n"
+                b"Content-Length: %d\r\n\r\n" % len(body)
+            )
+            sock.sendall(body)
+            response = b""
+            while True:
+                data = sock.recv(4096)
+                if not data:
+                    break
+                response += data
+        finally:
+            sock.close()
+        self.assertTrue(response.startswith(b"HTTP/1.1 413"))
+
 
 if __name__ == "__main__":
     # Check if webserv is built (try both locations)
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""
+End-to-end tests for socket activation: webserv serving on listening sockets
+handed over through LISTEN_FDS/LISTEN_PID, as systemd does.
+
+The test plays the supervisor: it owns the listening socket and starts
+webserv with it as fd 3.
+"""
+
+import os
+import signal
+import socket
+import subprocess
+import time
+import unittest
+
+PROJECT_ROOT = os.path.join(os.path.dirname(__file__), "..", "..")
+PORT = 8080
+REQUEST = b"GET /index.html HTTP/1.1\r\nHost: localhost\r\n\r\n"
+
+
+def webserv_path():
+    path = os.path.join(PROJECT_ROOT, "webserv")
+    if not os.path.exists(path):
+        path = os.path.join(PROJECT_ROOT, "build", "webserv")
+    return path
+
+
+def read_all(sock):
+    data = b""
+    while True:
+        chunk = sock.recv(4096)
+        if not chunk:
+            return data
+        data += chunk
+
+
+class TestSocketActivation(unittest.TestCase):
+    """Test serving on sockets inherited from a supervisor."""
+
+    @classmethod
+    def setUpClass(cls):
+        cls.listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        cls.listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        cls.listener.bind(("0.0.0.0", PORT))
+        cls.listener.listen(16)
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.listener.close()
+
+    def setUp(self):
+        self.process = None
+
+    def tearDown(self):
+        self.stop()
+
+    def start(self):
+        """Start webserv the way systemd would: fd 3, LISTEN_PID = its pid."""
+        fd = self.listener.fileno()
+        # The shell's pid is the one webserv will have after exec
+        script = 'export LISTEN_PID=$$ LISTEN_FDS=1; exec "$0" conf/default.conf'
+        self.process = subprocess.Popen(
+            ["sh", "-c", script, webserv_path()],
+            stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT,
+            cwd=PROJECT_ROOT,
+            pass_fds=(3,),
+            preexec_fn=lambda: os.dup2(fd, 3),
+            start_new_session=True,
+        )
+        time.sleep(1)
+        self.assertIsNone(self.process.poll(), "webserv exited early")
+
+    def stop(self):
+        """Stop webserv and return its log output."""
+        if self.process is None:
+            return ""
+        os.killpg(os.getpgid(self.process.pid), signal.SIGTERM)
+        output, _ = self.process.communicate(timeout=5)
+        self.process = None
+        return output.decode(errors="replace")
+
+    def test_serves_on_inherited_socket(self):
+        """webserv adopts the socket instead of binding its own."""
+        self.start()
+        sock = socket.create_connection(("127.0.0.1", PORT), timeout=5)
+        try:
+            sock.sendall(REQUEST)
+            self.assertTrue(read_all(sock).startswith(b"HTTP/1.1 200"))
+        finally:
+            sock.close()
+        log = self.stop()
+        self.assertIn("inherited fd 3", log)
+
+    def test_port_stays_open_across_restart(self):
+        """Clients connecting while webserv is down are served after it
+        comes back, since the supervisor keeps the socket."""
+        self.start()
+        self.stop()
+
+        sock = socket.create_connection(("127.0.0.1", PORT), timeout=5)
+        try:
+            sock.sendall(REQUEST)
+            self.start()
+            self.assertTrue(read_all(sock).startswith(b"HTTP/1.1 200"))
+        finally:
+            sock.close()
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -7,6 +7,7 @@ including read timeouts, write timeouts, and connection management.
 """
 
 import http.client
+import os
 import socket
 import time
 import unittest
@@ -74,6 +75,34 @@ class TestTimeoutFunctionality(WebservTestCase):
 
         conn.close()
 
+    def test_stalled_download_is_closed(self):
+        """Test that a client that stops reading a large file is dropped
+        once the response makes no progress for the write timeout."""
+        size = 50 * 1024 * 1024
+        project_root = os.path.join(os.path.dirname(__file__), "..", "..")
+        path = os.path.join(project_root, "www", "stalled-download.bin")
+        with open(path, "wb") as f:
+            f.truncate(size)
+        sock = socket.create_connection((self.server_host, self.server_port),
+                                        timeout=10)
+        try:
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 65536)
+            sock.sendall(b"GET /stalled-download.bin HTTP/1.1\r\n"
+                         b"Host: localhost\r\n\r\n")
+            received = len(sock.recv(4096))
+            time.sleep(14)
+            while True:
+                data = sock.recv(1024 * 1024)
+                if not data:
+                    break
+                received += len(data)
+        except ConnectionResetError:
+            pass
+        finally:
+            sock.close()
+            os.unlink(path)
+        self.assertLess(received, size)
+
     def test_multiple_connections_independent_timeouts(self):
         """Test that timeouts are handled independently for multiple connections."""
         # Create two connections
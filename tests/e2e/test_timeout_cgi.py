@@ -5,6 +5,8 @@ after approximately 10 seconds.
 """
 
 import os
+import socket
+import subprocess
 import sys
 import time
 import unittest
@@ -29,6 +31,49 @@ class TestCGITimeout(WebservTestCase):
         self.assertGreaterEqual(elapsed, 9.5)
         self.assertLess(elapsed, 15.0)
 
+    def test_slow_cgi_outlasting_read_timeout_is_answered(self):
+        """Test that a CGI still within its own timeout is not cut off by
+        the read timeout counted from when the client connected."""
+        sock = socket.create_connection((self.server_host, self.server_port),
+                                        timeout=15)
+        try:
+            # Idle before the request, then a script that takes 6 s: the
+            # connection is open for longer than the 10 s read timeout
+            time.sleep(5)
+            sock.sendall(
+                b"GET /cgi-bin/slow.sh HTTP/1.1\r\nHost: localhost\r\n\r\n"
+            )
+            data = b""
+            while True:
+                chunk = sock.recv(4096)
+                if not chunk:
+                    break
+                data += chunk
+        finally:
+            sock.close()
+        self.assertTrue(data.startswith(b"HTTP/1.1 200"))
+        self.assertTrue(data.endswith(b"done\n"))
+
+    def test_client_abort_kills_cgi(self):
+        """Test that a CGI run is killed as soon as its client disconnects."""
+        sock = socket.create_connection((self.server_host, self.server_port))
+        sock.sendall(
+            b"GET /cgi-bin/infinite.sh HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        )
+        time.sleep(1)
+        sock.close()
+
+        # The server stays responsive instead of waiting for the script
+        start = time.time()
+        response, _ = self.make_request("GET", "/")
+        self.assertEqual(response.status, 200)
+        self.assertLess(time.time() - start, 2.0)
+
+        running = subprocess.run(
+            ["pgrep", "-f", "infinite.sh"], stdout=subprocess.DEVNULL
+        )
+        self.assertNotEqual(running.returncode, 0)
+
 
 if __name__ == "__main__":
     # Validate the webserv binary exists in usual locations so this test can
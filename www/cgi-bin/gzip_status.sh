@@ -0,0 +1,14 @@
+#!/bin/bash
+# Text body sent with the status named in the query string (gzip tests)
+case "$QUERY_STRING" in
+  206)
+    echo "Status: 206 Partial Content"
+    echo "Content-Range: bytes 0-1499/3000"
+    ;;
+  404)
+    echo "Status: 404 Not Found"
+    ;;
+esac
+echo "Content-Type: text/plain"
+echo ""
+head -c 1500 /dev/zero | tr '\0' 'x'
@@ -0,0 +1,6 @@
+#!/bin/bash
+# Answers after a few seconds, well within the CGI timeout
+sleep 6
+echo "Content-Type: text/plain"
+echo ""
+echo "done"